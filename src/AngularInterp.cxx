@@ -0,0 +1,130 @@
+/** \file AngularInterp.cxx
+
+    \brief Utility to interpolate orientations and directions in tables along great circles.
+    Table must be ordered on the field used to interpolate.
+*/
+#include <cmath>
+#include <cstddef>
+
+#include "tip/AngularInterp.h"
+#include "tip/TipException.h"
+
+namespace {
+
+  const double s_deg_per_rad = 180. / std::acos(-1.);
+
+  /** \brief Scale a vector to unit length, failing for vectors of length 0.
+  */
+  void normalize(std::vector<double> & value) {
+    double norm = 0.;
+    for (std::vector<double>::iterator itor = value.begin(); itor != value.end(); ++itor) norm += *itor * *itor;
+    norm = std::sqrt(norm);
+    if (!(0. < norm)) throw tip::TipException("AngularInterp: cannot interpolate a quaternion or direction of length 0");
+    for (std::vector<double>::iterator itor = value.begin(); itor != value.end(); ++itor) *itor /= norm;
+  }
+
+  /** \brief Convert a direction in degrees to a unit vector.
+  */
+  void toVector(double ra, double dec, std::vector<double> & value) {
+    ra /= s_deg_per_rad;
+    dec /= s_deg_per_rad;
+    value.resize(3);
+    value[0] = std::cos(dec) * std::cos(ra);
+    value[1] = std::cos(dec) * std::sin(ra);
+    value[2] = std::sin(dec);
+  }
+
+}
+
+namespace tip {
+
+  AngularInterp::AngularInterp(const Table::ConstIterator & begin, const Table::ConstIterator & end):
+    IndexedLinearInterp(begin, end) {}
+
+  void AngularInterp::getQuaternion(const std::string & field, std::vector<double> & quaternion) const {
+    std::vector<double> q0(getRecord(field, 0));
+    std::vector<double> q1(getRecord(field, 1));
+    if (4 != q0.size() || 4 != q1.size())
+      throw TipException("AngularInterp::getQuaternion() called for field " + field + " which does not have 4 elements");
+    slerpQuaternion(q0, q1, quaternion);
+  }
+
+  void AngularInterp::getQuaternion(const Table::FieldCont & fields, std::vector<double> & quaternion) const {
+    if (4 != fields.size()) throw TipException("AngularInterp::getQuaternion() must be given 4 fields");
+    std::vector<double> q0(4);
+    std::vector<double> q1(4);
+    for (std::size_t ii = 0; ii != 4; ++ii) {
+      const std::vector<double> & y0(getRecord(fields[ii], 0));
+      const std::vector<double> & y1(getRecord(fields[ii], 1));
+      if (1 != y0.size() || 1 != y1.size())
+        throw TipException("AngularInterp::getQuaternion() called for field " + fields[ii] + " which is not a scalar");
+      q0[ii] = y0[0];
+      q1[ii] = y1[0];
+    }
+    slerpQuaternion(q0, q1, quaternion);
+  }
+
+  void AngularInterp::getDirection(const std::string & ra_field, const std::string & dec_field, double & ra,
+    double & dec) const {
+    const std::vector<double> & ra0(getRecord(ra_field, 0));
+    const std::vector<double> & ra1(getRecord(ra_field, 1));
+    const std::vector<double> & dec0(getRecord(dec_field, 0));
+    const std::vector<double> & dec1(getRecord(dec_field, 1));
+    if (1 != ra0.size() || 1 != ra1.size() || 1 != dec0.size() || 1 != dec1.size())
+      throw TipException("AngularInterp::getDirection() called for fields " + ra_field + " and " + dec_field +
+        " which are not both scalars");
+
+    std::vector<double> v0;
+    std::vector<double> v1;
+    toVector(ra0[0], dec0[0], v0);
+    toVector(ra1[0], dec1[0], v1);
+    std::vector<double> direction;
+    slerp(v0, v1, direction);
+
+    ra = std::atan2(direction[1], direction[0]) * s_deg_per_rad;
+    if (0. > ra) ra += 360.;
+    if (360. <= ra) ra -= 360.;
+    dec = std::asin(direction[2] < -1. ? -1. : direction[2] > 1. ? 1. : direction[2]) * s_deg_per_rad;
+  }
+
+  void AngularInterp::slerpQuaternion(std::vector<double> & q0, std::vector<double> & q1,
+    std::vector<double> & result) const {
+    normalize(q0);
+    normalize(q1);
+
+    // q and -q are the same rotation: take the one closer to q0, so the rotation follows the shorter arc.
+    double dot = 0.;
+    for (std::size_t ii = 0; ii != 4; ++ii) dot += q0[ii] * q1[ii];
+    if (0. > dot) {
+      for (std::size_t ii = 0; ii != 4; ++ii) q1[ii] = -q1[ii];
+    }
+    slerp(q0, q1, result);
+  }
+
+  void AngularInterp::slerp(const std::vector<double> & v0, const std::vector<double> & v1,
+    std::vector<double> & result) const {
+    double t = getFraction();
+    double dot = 0.;
+    for (std::size_t ii = 0; ii != v0.size(); ++ii) dot += v0[ii] * v1[ii];
+    if (dot > 1.) dot = 1.;
+
+    // Opposite vectors are joined by every great circle.
+    if (dot < -1. + 1.e-12)
+      throw TipException("AngularInterp: cannot interpolate between opposite directions");
+
+    // For very close vectors sin(theta) loses precision, but the chord is then indistinguishable from the arc.
+    double c0 = 1. - t;
+    double c1 = t;
+    double theta = std::acos(dot);
+    if (1.e-6 < theta) {
+      double sin_theta = std::sin(theta);
+      c0 = std::sin((1. - t) * theta) / sin_theta;
+      c1 = std::sin(t * theta) / sin_theta;
+    }
+
+    result.resize(v0.size());
+    for (std::size_t ii = 0; ii != v0.size(); ++ii) result[ii] = c0 * v0[ii] + c1 * v1[ii];
+    normalize(result);
+  }
+
+}
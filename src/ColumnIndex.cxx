@@ -0,0 +1,135 @@
+/** \file ColumnIndex.cxx
+
+    \brief Implementation of sparse indices of sorted fields of tables.
+*/
+#include <algorithm>
+#include <cmath>
+
+#include "tip/ColumnIndex.h"
+#include "tip/TipException.h"
+
+namespace tip {
+
+  ColumnIndex::ColumnIndex(const Table & table, const std::string & field, OrderCheck check, Index_t block_size):
+    m_table(table), m_field(field), m_column(0), m_num_records(table.getNumRecords()),
+    m_block_size(0 < block_size ? block_size : 1024), m_first(), m_first_known(), m_block(), m_block_read(-1),
+    m_num_records_read(0) {
+    m_column = m_table.getColumn(m_table.getFieldIndex(m_field));
+    if (!m_column->isScalar()) throw TipException("ColumnIndex: field " + m_field + " is not a scalar field");
+
+    Index_t num_blocks = (m_num_records + m_block_size - 1) / m_block_size;
+    m_first.resize(num_blocks);
+    m_first_known.resize(num_blocks, 0);
+
+    if (eCheckOrder == check) {
+      // Reading each block checks its order and records its first value; check also across blocks.
+      for (Index_t block = 0; block != num_blocks; ++block) {
+        double last = block == 0 ? 0. : m_block.back();
+        readBlock(block);
+        if (0 != block && m_block.front() < last)
+          throw TipException("ColumnIndex: field " + m_field + " is not sorted in increasing order");
+      }
+    }
+  }
+
+  Index_t ColumnIndex::lowerBound(double value) const {
+    Index_t block = findBlock(value, false);
+    // The first block whose first value is not less than the value starts just after the answer, unless the
+    // answer is in the block before it.
+    if (0 == block) return 0;
+    const std::vector<double> & values(readBlock(--block));
+    return block * m_block_size + (std::lower_bound(values.begin(), values.end(), value) - values.begin());
+  }
+
+  Index_t ColumnIndex::upperBound(double value) const {
+    Index_t block = findBlock(value, true);
+    if (0 == block) return 0;
+    const std::vector<double> & values(readBlock(--block));
+    return block * m_block_size + (std::upper_bound(values.begin(), values.end(), value) - values.begin());
+  }
+
+  ColumnIndex::Range_t ColumnIndex::equalRange(double low, double high) const {
+    if (high < low) {
+      Index_t record = lowerBound(low);
+      return Range_t(record, record);
+    }
+    Index_t begin = lowerBound(low);
+    return Range_t(begin, std::max(begin, upperBound(high)));
+  }
+
+  void ColumnIndex::findIntervals(const std::vector<double> & start, const std::vector<double> & stop,
+    RangeCont_t & ranges) const {
+    if (start.size() != stop.size())
+      throw TipException("ColumnIndex::findIntervals was given different numbers of starts and stops");
+
+    // Searching the intervals in order of their starts gives ranges in order, so overlaps are easy to merge.
+    std::vector<std::pair<double, double> > intervals;
+    for (std::vector<double>::size_type index = 0; index != start.size(); ++index)
+      if (start[index] <= stop[index]) intervals.push_back(std::make_pair(start[index], stop[index]));
+    std::sort(intervals.begin(), intervals.end());
+
+    ranges.clear();
+    for (std::vector<std::pair<double, double> >::iterator itor = intervals.begin(); itor != intervals.end(); ++itor) {
+      Range_t range = equalRange(itor->first, itor->second);
+      if (range.first == range.second) continue;
+      if (!ranges.empty() && range.first <= ranges.back().second)
+        ranges.back().second = std::max(ranges.back().second, range.second);
+      else
+        ranges.push_back(range);
+    }
+  }
+
+  double ColumnIndex::getFirst(Index_t block) const {
+    if (0 == m_first_known[block]) {
+      double value = 0.;
+      char null_flag = 0;
+      m_column->get(block * m_block_size, block * m_block_size + 1, &value, &null_flag);
+      ++m_num_records_read;
+      checkValue(value, null_flag);
+      m_first[block] = value;
+      m_first_known[block] = 1;
+    }
+    return m_first[block];
+  }
+
+  const std::vector<double> & ColumnIndex::readBlock(Index_t block) const {
+    if (block == m_block_read) return m_block;
+
+    Index_t record_begin = block * m_block_size;
+    Index_t record_end = std::min(m_num_records, record_begin + m_block_size);
+    m_block_read = -1;
+    m_block.resize(record_end - record_begin);
+    std::vector<char> null_flags(m_block.size());
+    m_column->get(record_begin, record_end, &m_block[0], &null_flags[0]);
+    m_num_records_read += record_end - record_begin;
+
+    for (std::vector<double>::size_type index = 0; index != m_block.size(); ++index) {
+      checkValue(m_block[index], null_flags[index]);
+      if (0 != index && m_block[index] < m_block[index - 1])
+        throw TipException("ColumnIndex: field " + m_field + " is not sorted in increasing order");
+    }
+    m_first[block] = m_block.front();
+    m_first_known[block] = 1;
+    m_block_read = block;
+    return m_block;
+  }
+
+  Index_t ColumnIndex::findBlock(double value, bool strict) const {
+    if (std::isnan(value)) throw TipException("ColumnIndex: cannot look up NaN in field " + m_field);
+    Index_t low = 0;
+    Index_t high = m_first.size();
+    while (low < high) {
+      Index_t middle = low + (high - low) / 2;
+      double first = getFirst(middle);
+      if (first < value || (strict && first == value)) low = middle + 1;
+      else high = middle;
+    }
+    return low;
+  }
+
+  void ColumnIndex::checkValue(double value, char null_flag) const {
+    if (0 != null_flag || std::isnan(value))
+      throw TipException("ColumnIndex: field " + m_field + " has null values, which cannot be indexed");
+  }
+
+}
@@ -8,7 +8,27 @@
 
 namespace tip {
 
-  ExtSummary::ExtSummary(const std::string & ext_id): m_ext_id(ext_id) {}
+  ExtSummary::ExtSummary(const std::string & ext_id): m_ext_id(ext_id), m_ext_type(eUnknown), m_num_records(0),
+    m_num_bytes(0), m_image_dims(), m_field_names() {}
+
+  ExtSummary::ExtSummary(const std::string & ext_id, ExtType ext_type, Index_t num_records, long long num_bytes,
+    const std::vector<PixOrd_t> & image_dims, const std::vector<std::string> & field_names): m_ext_id(ext_id),
+    m_ext_type(ext_type), m_num_records(num_records), m_num_bytes(num_bytes), m_image_dims(image_dims),
+    m_field_names(field_names) {}
 
   const std::string & ExtSummary::getExtId() const { return m_ext_id; }
+
+  ExtSummary::ExtType ExtSummary::getExtType() const { return m_ext_type; }
+
+  bool ExtSummary::isImage() const { return eImage == m_ext_type; }
+
+  bool ExtSummary::isTable() const { return eAsciiTable == m_ext_type || eBinaryTable == m_ext_type; }
+
+  Index_t ExtSummary::getNumRecords() const { return m_num_records; }
+
+  long long ExtSummary::getNumBytes() const { return m_num_bytes; }
+
+  const std::vector<PixOrd_t> & ExtSummary::getImageDimensions() const { return m_image_dims; }
+
+  const std::vector<std::string> & ExtSummary::getFieldNames() const { return m_field_names; }
 }
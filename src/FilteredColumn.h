@@ -0,0 +1,305 @@
+/** \file FilteredColumn.h
+    \brief Column of a filtered view of a table, which maps records of the view to rows of the underlying table.
+*/
+#ifndef tip_FilteredColumn_h
+#define tip_FilteredColumn_h
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tip/IColumn.h"
+#include "tip/TipException.h"
+#include "tip/tip_types.h"
+
+namespace tip {
+
+  /** \class FilteredColumn
+
+      \brief Column abstraction which presents the selected rows of another column as consecutive records. Record
+      i of this column is row rows[i] of the underlying column, where rows is the sorted index of selected rows
+      shared by all columns of the view. Every access is passed on to the underlying column, so nothing is
+      copied. This is not part of the API.
+  */
+  class FilteredColumn : public IColumn {
+    public:
+      typedef std::vector<Index_t> RowCont_t;
+
+      /** \brief Create a column presenting the given rows of another column.
+          \param column The underlying column, which must outlive this column.
+          \param rows The indices of the selected rows of the underlying column, in increasing order.
+      */
+      FilteredColumn(IColumn * column, const std::shared_ptr<const RowCont_t> & rows): IColumn(column->getId()),
+        m_column(column), m_rows(rows) { m_units = column->getUnits(); }
+
+      virtual ~FilteredColumn() throw() {}
+
+      /** \brief Change the rows selected, e.g. after the view is filtered again.
+          \param rows The indices of the selected rows of the underlying column, in increasing order.
+      */
+      void setRows(const std::shared_ptr<const RowCont_t> & rows) { m_rows = rows; }
+
+      virtual void get(Index_t record_index, bool & dest) const { m_column->get(getRow(record_index), dest); }
+      virtual void get(Index_t record_index, double & dest) const { m_column->get(getRow(record_index), dest); }
+      virtual void get(Index_t record_index, float & dest) const { m_column->get(getRow(record_index), dest); }
+      virtual void get(Index_t record_index, char & dest) const { m_column->get(getRow(record_index), dest); }
+      virtual void get(Index_t record_index, signed char & dest) const { m_column->get(getRow(record_index), dest); }
+      virtual void get(Index_t record_index, signed short & dest) const { m_column->get(getRow(record_index), dest); }
+      virtual void get(Index_t record_index, signed int & dest) const { m_column->get(getRow(record_index), dest); }
+      virtual void get(Index_t record_index, signed long & dest) const { m_column->get(getRow(record_index), dest); }
+      virtual void get(Index_t record_index, unsigned char & dest) const { m_column->get(getRow(record_index), dest); }
+      virtual void get(Index_t record_index, unsigned short & dest) const { m_column->get(getRow(record_index), dest); }
+      virtual void get(Index_t record_index, unsigned int & dest) const { m_column->get(getRow(record_index), dest); }
+      virtual void get(Index_t record_index, unsigned long & dest) const { m_column->get(getRow(record_index), dest); }
+      virtual void get(Index_t record_index, signed long long & dest) const { m_column->get(getRow(record_index), dest); }
+      virtual void get(Index_t record_index, unsigned long long & dest) const { m_column->get(getRow(record_index), dest); }
+      virtual void get(Index_t record_index, std::string & dest) const { m_column->get(getRow(record_index), dest); }
+      virtual void get(Index_t record_index, BitStruct & dest) const { m_column->get(getRow(record_index), dest); }
+
+      virtual void get(Index_t record_index, std::vector<bool> & dest) const { m_column->get(getRow(record_index), dest); }
+      virtual void get(Index_t record_index, std::vector<double> & dest) const { m_column->get(getRow(record_index), dest); }
+      virtual void get(Index_t record_index, std::vector<float> & dest) const { m_column->get(getRow(record_index), dest); }
+      virtual void get(Index_t record_index, std::vector<char> & dest) const { m_column->get(getRow(record_index), dest); }
+      virtual void get(Index_t record_index, std::vector<signed char> & dest) const
+        { m_column->get(getRow(record_index), dest); }
+      virtual void get(Index_t record_index, std::vector<signed short> & dest) const
+        { m_column->get(getRow(record_index), dest); }
+      virtual void get(Index_t record_index, std::vector<signed int> & dest) const
+        { m_column->get(getRow(record_index), dest); }
+      virtual void get(Index_t record_index, std::vector<signed long> & dest) const
+        { m_column->get(getRow(record_index), dest); }
+      virtual void get(Index_t record_index, std::vector<unsigned char> & dest) const
+        { m_column->get(getRow(record_index), dest); }
+      virtual void get(Index_t record_index, std::vector<unsigned short> & dest) const
+        { m_column->get(getRow(record_index), dest); }
+      virtual void get(Index_t record_index, std::vector<unsigned int> & dest) const
+        { m_column->get(getRow(record_index), dest); }
+      virtual void get(Index_t record_index, std::vector<unsigned long> & dest) const
+        { m_column->get(getRow(record_index), dest); }
+      virtual void get(Index_t record_index, std::vector<signed long long> & dest) const
+        { m_column->get(getRow(record_index), dest); }
+      virtual void get(Index_t record_index, std::vector<unsigned long long> & dest) const
+        { m_column->get(getRow(record_index), dest); }
+      virtual void get(Index_t record_index, std::vector<std::string> & dest) const
+        { m_column->get(getRow(record_index), dest); }
+      virtual void get(Index_t record_index, std::vector<BitStruct> & dest) const
+        { m_column->get(getRow(record_index), dest); }
+
+      virtual void get(Index_t record_begin, Index_t record_end, double * dest, char * null_flags = 0) const
+        { getRange(record_begin, record_end, dest, null_flags); }
+      virtual void get(Index_t record_begin, Index_t record_end, float * dest, char * null_flags = 0) const
+        { getRange(record_begin, record_end, dest, null_flags); }
+      virtual void get(Index_t record_begin, Index_t record_end, char * dest, char * null_flags = 0) const
+        { getRange(record_begin, record_end, dest, null_flags); }
+      virtual void get(Index_t record_begin, Index_t record_end, signed char * dest, char * null_flags = 0) const
+        { getRange(record_begin, record_end, dest, null_flags); }
+      virtual void get(Index_t record_begin, Index_t record_end, signed short * dest, char * null_flags = 0) const
+        { getRange(record_begin, record_end, dest, null_flags); }
+      virtual void get(Index_t record_begin, Index_t record_end, signed int * dest, char * null_flags = 0) const
+        { getRange(record_begin, record_end, dest, null_flags); }
+      virtual void get(Index_t record_begin, Index_t record_end, signed long * dest, char * null_flags = 0) const
+        { getRange(record_begin, record_end, dest, null_flags); }
+      virtual void get(Index_t record_begin, Index_t record_end, unsigned char * dest, char * null_flags = 0) const
+        { getRange(record_begin, record_end, dest, null_flags); }
+      virtual void get(Index_t record_begin, Index_t record_end, unsigned short * dest, char * null_flags = 0) const
+        { getRange(record_begin, record_end, dest, null_flags); }
+      virtual void get(Index_t record_begin, Index_t record_end, unsigned int * dest, char * null_flags = 0) const
+        { getRange(record_begin, record_end, dest, null_flags); }
+      virtual void get(Index_t record_begin, Index_t record_end, unsigned long * dest, char * null_flags = 0) const
+        { getRange(record_begin, record_end, dest, null_flags); }
+      virtual void get(Index_t record_begin, Index_t record_end, signed long long * dest, char * null_flags = 0) const
+        { getRange(record_begin, record_end, dest, null_flags); }
+      virtual void get(Index_t record_begin, Index_t record_end, unsigned long long * dest, char * null_flags = 0) const
+        { getRange(record_begin, record_end, dest, null_flags); }
+      virtual void get(Index_t record_begin, Index_t record_end, bool * dest, char * null_flags = 0) const
+        { getRange(record_begin, record_end, dest, null_flags); }
+      virtual void get(Index_t record_begin, Index_t record_end, std::string * dest, char * null_flags = 0) const
+        { getRange(record_begin, record_end, dest, null_flags); }
+
+      virtual void set(Index_t record_index, const bool & src) { m_column->set(getRow(record_index), src); }
+      virtual void set(Index_t record_index, const double & src) { m_column->set(getRow(record_index), src); }
+      virtual void set(Index_t record_index, const float & src) { m_column->set(getRow(record_index), src); }
+      virtual void set(Index_t record_index, const char & src) { m_column->set(getRow(record_index), src); }
+      virtual void set(Index_t record_index, const signed char & src) { m_column->set(getRow(record_index), src); }
+      virtual void set(Index_t record_index, const signed short & src) { m_column->set(getRow(record_index), src); }
+      virtual void set(Index_t record_index, const signed int & src) { m_column->set(getRow(record_index), src); }
+      virtual void set(Index_t record_index, const signed long & src) { m_column->set(getRow(record_index), src); }
+      virtual void set(Index_t record_index, const unsigned char & src) { m_column->set(getRow(record_index), src); }
+      virtual void set(Index_t record_index, const unsigned short & src) { m_column->set(getRow(record_index), src); }
+      virtual void set(Index_t record_index, const unsigned int & src) { m_column->set(getRow(record_index), src); }
+      virtual void set(Index_t record_index, const unsigned long & src) { m_column->set(getRow(record_index), src); }
+      virtual void set(Index_t record_index, const signed long long & src) { m_column->set(getRow(record_index), src); }
+      virtual void set(Index_t record_index, const unsigned long long & src) { m_column->set(getRow(record_index), src); }
+      virtual void set(Index_t record_index, const char * src) { m_column->set(getRow(record_index), src); }
+      virtual void set(Index_t record_index, const std::string & src) { m_column->set(getRow(record_index), src); }
+      virtual void set(Index_t record_index, const BitStruct & src) { m_column->set(getRow(record_index), src); }
+
+      virtual void set(Index_t record_index, const std::vector<bool> & src) { m_column->set(getRow(record_index), src); }
+      virtual void set(Index_t record_index, const std::vector<double> & src) { m_column->set(getRow(record_index), src); }
+      virtual void set(Index_t record_index, const std::vector<float> & src) { m_column->set(getRow(record_index), src); }
+      virtual void set(Index_t record_index, const std::vector<char> & src) { m_column->set(getRow(record_index), src); }
+      virtual void set(Index_t record_index, const std::vector<signed char> & src)
+        { m_column->set(getRow(record_index), src); }
+      virtual void set(Index_t record_index, const std::vector<signed short> & src)
+        { m_column->set(getRow(record_index), src); }
+      virtual void set(Index_t record_index, const std::vector<signed int> & src)
+        { m_column->set(getRow(record_index), src); }
+      virtual void set(Index_t record_index, const std::vector<signed long> & src)
+        { m_column->set(getRow(record_index), src); }
+      virtual void set(Index_t record_index, const std::vector<unsigned char> & src)
+        { m_column->set(getRow(record_index), src); }
+      virtual void set(Index_t record_index, const std::vector<unsigned short> & src)
+        { m_column->set(getRow(record_index), src); }
+      virtual void set(Index_t record_index, const std::vector<unsigned int> & src)
+        { m_column->set(getRow(record_index), src); }
+      virtual void set(Index_t record_index, const std::vector<unsigned long> & src)
+        { m_column->set(getRow(record_index), src); }
+      virtual void set(Index_t record_index, const std::vector<signed long long> & src)
+        { m_column->set(getRow(record_index), src); }
+      virtual void set(Index_t record_index, const std::vector<unsigned long long> & src)
+        { m_column->set(getRow(record_index), src); }
+      virtual void set(Index_t record_index, const std::vector<std::string> & src)
+        { m_column->set(getRow(record_index), src); }
+      virtual void set(Index_t record_index, const std::vector<BitStruct> & src)
+        { m_column->set(getRow(record_index), src); }
+
+      virtual void set(Index_t record_begin, const double * src_begin, const double * src_end, const char * null_mask = 0)
+        { setRange(record_begin, src_begin, src_end, null_mask); }
+      virtual void set(Index_t record_begin, const float * src_begin, const float * src_end, const char * null_mask = 0)
+        { setRange(record_begin, src_begin, src_end, null_mask); }
+      virtual void set(Index_t record_begin, const char * src_begin, const char * src_end, const char * null_mask = 0)
+        { setRange(record_begin, src_begin, src_end, null_mask); }
+      virtual void set(Index_t record_begin, const signed char * src_begin, const signed char * src_end,
+        const char * null_mask = 0) { setRange(record_begin, src_begin, src_end, null_mask); }
+      virtual void set(Index_t record_begin, const signed short * src_begin, const signed short * src_end,
+        const char * null_mask = 0) { setRange(record_begin, src_begin, src_end, null_mask); }
+      virtual void set(Index_t record_begin, const signed int * src_begin, const signed int * src_end,
+        const char * null_mask = 0) { setRange(record_begin, src_begin, src_end, null_mask); }
+      virtual void set(Index_t record_begin, const signed long * src_begin, const signed long * src_end,
+        const char * null_mask = 0) { setRange(record_begin, src_begin, src_end, null_mask); }
+      virtual void set(Index_t record_begin, const unsigned char * src_begin, const unsigned char * src_end,
+        const char * null_mask = 0) { setRange(record_begin, src_begin, src_end, null_mask); }
+      virtual void set(Index_t record_begin, const unsigned short * src_begin, const unsigned short * src_end,
+        const char * null_mask = 0) { setRange(record_begin, src_begin, src_end, null_mask); }
+      virtual void set(Index_t record_begin, const unsigned int * src_begin, const unsigned int * src_end,
+        const char * null_mask = 0) { setRange(record_begin, src_begin, src_end, null_mask); }
+      virtual void set(Index_t record_begin, const unsigned long * src_begin, const unsigned long * src_end,
+        const char * null_mask = 0) { setRange(record_begin, src_begin, src_end, null_mask); }
+      virtual void set(Index_t record_begin, const signed long long * src_begin, const signed long long * src_end,
+        const char * null_mask = 0) { setRange(record_begin, src_begin, src_end, null_mask); }
+      virtual void set(Index_t record_begin, const unsigned long long * src_begin, const unsigned long long * src_end,
+        const char * null_mask = 0) { setRange(record_begin, src_begin, src_end, null_mask); }
+
+      virtual bool isNull(Index_t record_index) const { return m_column->isNull(getRow(record_index)); }
+      virtual bool getNull(Index_t record_index, bool & null_value) const
+        { return m_column->getNull(getRow(record_index), null_value); }
+      virtual bool getNull(Index_t record_index, std::vector<bool> & null_value) const
+        { return m_column->getNull(getRow(record_index), null_value); }
+
+      virtual void copy(const IColumn * src, Index_t src_index, Index_t dest_index)
+        { m_column->copy(src, src_index, getRow(dest_index)); }
+
+      virtual bool isScalar() const { return m_column->isScalar(); }
+
+      virtual const std::string implementation() const { return "Filtered" + m_column->implementation(); }
+
+      virtual Index_t getNumElements(Index_t record_index = 0) const
+        { return m_column->getNumElements(m_rows->empty() ? 0 : getRow(record_index)); }
+
+      virtual void setNumElements(Index_t num_elements) { m_column->setNumElements(num_elements); }
+
+      virtual Keyword & getColumnKeyword(const std::string & base_name) { return m_column->getColumnKeyword(base_name); }
+
+      virtual const Keyword & getColumnKeyword(const std::string & base_name) const
+        { return static_cast<const IColumn *>(m_column)->getColumnKeyword(base_name); }
+
+      virtual std::string getFormat() const { return m_column->getFormat(); }
+
+      virtual void setReadAhead(Index_t num_records) const { m_column->setReadAhead(num_records); }
+
+      virtual void getReadAheadStats(unsigned long & num_hits, unsigned long & num_misses) const
+        { m_column->getReadAheadStats(num_hits, num_misses); }
+
+    private:
+      /** \brief Return the row of the underlying column for the given record of this column.
+          \param record_index The index of the record.
+      */
+      Index_t getRow(Index_t record_index) const {
+        if (0 > record_index || Index_t(m_rows->size()) <= record_index)
+          throw TipException("FilteredColumn: record index is outside the filtered table");
+        return (*m_rows)[record_index];
+      }
+
+      /** \brief Check that a range of records of this column exists.
+      */
+      void checkRange(Index_t record_begin, Index_t record_end) const {
+        if (0 > record_begin || record_end < record_begin || Index_t(m_rows->size()) < record_end)
+          throw TipException("FilteredColumn: range of records is outside the filtered table");
+      }
+
+      /** \brief Read a range of records. Rows which lie close together in the underlying column are read in
+          one operation covering the rows between them, and the selected rows are picked out afterwards.
+      */
+      template <typename T>
+      void getRange(Index_t record_begin, Index_t record_end, T * dest, char * null_flags) const {
+        checkRange(record_begin, record_end);
+        const RowCont_t & rows(*m_rows);
+        std::unique_ptr<T[]> buffer;
+        std::vector<char> buffer_flags;
+        Index_t buffer_size = 0;
+        for (Index_t record = record_begin; record != record_end; ) {
+          // Extend the block while the gaps between selected rows are small.
+          Index_t row_begin = rows[record];
+          Index_t block_end = record + 1;
+          while (block_end != record_end && rows[block_end] - rows[block_end - 1] <= s_max_gap &&
+            rows[block_end] - row_begin < s_max_block) ++block_end;
+          Index_t row_end = rows[block_end - 1] + 1;
+          Index_t offset = record - record_begin;
+
+          if (row_end - row_begin == block_end - record) {
+            // All rows of the block are selected: read straight into the destination.
+            m_column->get(row_begin, row_end, dest + offset, 0 != null_flags ? null_flags + offset : 0);
+          } else {
+            if (buffer_size < row_end - row_begin) {
+              buffer_size = row_end - row_begin;
+              buffer.reset(new T[buffer_size]);
+              if (0 != null_flags) buffer_flags.resize(buffer_size);
+            }
+            m_column->get(row_begin, row_end, buffer.get(), 0 != null_flags ? &buffer_flags[0] : 0);
+            for (Index_t index = record; index != block_end; ++index) {
+              dest[index - record_begin] = buffer[rows[index] - row_begin];
+              if (0 != null_flags) null_flags[index - record_begin] = buffer_flags[rows[index] - row_begin];
+            }
+          }
+          record = block_end;
+        }
+      }
+
+      /** \brief Write a range of records, with one write for each run of consecutive rows of the underlying column.
+      */
+      template <typename T>
+      void setRange(Index_t record_begin, const T * src_begin, const T * src_end, const char * null_mask) {
+        Index_t record_end = record_begin + (src_end - src_begin);
+        checkRange(record_begin, record_end);
+        const RowCont_t & rows(*m_rows);
+        for (Index_t record = record_begin; record != record_end; ) {
+          Index_t run_end = record + 1;
+          while (run_end != record_end && rows[run_end] == rows[run_end - 1] + 1) ++run_end;
+          Index_t offset = record - record_begin;
+          m_column->set(rows[record], src_begin + offset, src_begin + (run_end - record_begin),
+            0 != null_mask ? null_mask + offset : 0);
+          record = run_end;
+        }
+      }
+
+      // Rows this close together are read together, and blocks read at once span at most this many rows.
+      static const Index_t s_max_gap = 8;
+      static const Index_t s_max_block = 65536;
+
+      IColumn * m_column;
+      std::shared_ptr<const RowCont_t> m_rows;
+  };
+
+}
+
+#endif
@@ -0,0 +1,210 @@
+/** \file FitsChecksum.cxx
+
+    \brief Vectorized and parallel computation of FITS data unit checksums.
+*/
+#include <exception>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FitsChecksum.h"
+#include "FitsDecoder.h"
+#include "FitsMapping.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TIP_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace {
+
+  using tip::FitsByteSwap;
+
+  // Sums of the high and of the low 16-bit halves of big-endian 32-bit words, kept apart so that no carry is lost.
+  struct HalfSums {
+    unsigned long long m_high;
+    unsigned long long m_low;
+  };
+
+  typedef void (*SumFunc)(const unsigned char *, std::size_t, HalfSums &);
+
+  // Fold a sum into 32 bits by adding the carries back in, which is how a ones' complement sum treats them.
+  unsigned long fold(unsigned long long sum) {
+    while (0 != (sum >> 32)) sum = (sum & 0xffffffffULL) + (sum >> 32);
+    return static_cast<unsigned long>(sum);
+  }
+
+  void sumScalar(const unsigned char * data, std::size_t num_words, HalfSums & sums) {
+    unsigned long long high = 0;
+    unsigned long long low = 0;
+    for (std::size_t ii = 0; ii != num_words; ++ii, data += 4) {
+      high += (static_cast<unsigned int>(data[0]) << 8) | data[1];
+      low += (static_cast<unsigned int>(data[2]) << 8) | data[3];
+    }
+    sums.m_high += high;
+    sums.m_low += low;
+  }
+
+#ifdef TIP_X86_KERNELS
+  // The vector kernels sum into 32-bit lanes, each of which grows by at most 2 * 0xffff per vector, and add the lanes
+  // to the 64-bit sums after this many vectors, before they can overflow.
+  const std::size_t s_max_vectors = 1 << 14;
+
+  // Each kernel swaps the bytes of each 16-bit half, then widens the halves to 32 bits, so that the even lanes sum
+  // the high halves and the odd lanes the low halves.
+  __attribute__((target("sse2"))) void sumSse2(const unsigned char * data, std::size_t num_words, HalfSums & sums) {
+    const __m128i zero = _mm_setzero_si128();
+    for (std::size_t num_vectors = num_words / 4; 0 != num_vectors; ) {
+      std::size_t block_size = num_vectors < s_max_vectors ? num_vectors : s_max_vectors;
+      __m128i sum = zero;
+      for (std::size_t ii = 0; ii != block_size; ++ii, data += 16) {
+        __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data));
+        value = _mm_or_si128(_mm_slli_epi16(value, 8), _mm_srli_epi16(value, 8));
+        sum = _mm_add_epi32(sum, _mm_unpacklo_epi16(value, zero));
+        sum = _mm_add_epi32(sum, _mm_unpackhi_epi16(value, zero));
+      }
+      unsigned int lanes[4];
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes), sum);
+      sums.m_high += static_cast<unsigned long long>(lanes[0]) + lanes[2];
+      sums.m_low += static_cast<unsigned long long>(lanes[1]) + lanes[3];
+      num_vectors -= block_size;
+    }
+    sumScalar(data, num_words % 4, sums);
+  }
+
+  __attribute__((target("avx2"))) void sumAvx2(const unsigned char * data, std::size_t num_words, HalfSums & sums) {
+    const __m256i mask = _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+      1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+    const __m256i zero = _mm256_setzero_si256();
+    for (std::size_t num_vectors = num_words / 8; 0 != num_vectors; ) {
+      std::size_t block_size = num_vectors < s_max_vectors ? num_vectors : s_max_vectors;
+      __m256i sum = zero;
+      for (std::size_t ii = 0; ii != block_size; ++ii, data += 32) {
+        __m256i value = _mm256_shuffle_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(data)), mask);
+        sum = _mm256_add_epi32(sum, _mm256_unpacklo_epi16(value, zero));
+        sum = _mm256_add_epi32(sum, _mm256_unpackhi_epi16(value, zero));
+      }
+      unsigned int lanes[8];
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(lanes), sum);
+      for (std::size_t lane = 0; lane != 8; lane += 2) {
+        sums.m_high += lanes[lane];
+        sums.m_low += lanes[lane + 1];
+      }
+      num_vectors -= block_size;
+    }
+    sumScalar(data, num_words % 8, sums);
+  }
+#endif
+
+  // Use the kernel selected for byte swapping, so that FitsByteSwap::setKernel selects both.
+  SumFunc getSumFunc() {
+#ifdef TIP_X86_KERNELS
+    switch (FitsByteSwap::getKernel()) {
+      case FitsByteSwap::eAvx2: return &sumAvx2;
+      case FitsByteSwap::eSse2: return &sumSse2;
+      default: break;
+    }
+#endif
+    return &sumScalar;
+  }
+
+}
+
+namespace tip {
+
+  const std::size_t FitsChecksum::s_min_thread_bytes;
+
+  unsigned long FitsChecksum::accumulate(const void * data, std::size_t num_bytes, unsigned long sum) {
+    HalfSums sums = { 0, 0 };
+    getSumFunc()(static_cast<const unsigned char *>(data), num_bytes / 4, sums);
+    // The high halves are worth 2^16 each; fold their sum first, so that shifting it cannot overflow.
+    unsigned long long data_sum = (static_cast<unsigned long long>(fold(sums.m_high)) << 16) + sums.m_low;
+    return fold(static_cast<unsigned long long>(sum) + fold(data_sum));
+  }
+
+  unsigned long FitsChecksum::computeDataSum(const void * data, std::size_t num_bytes, unsigned int num_threads,
+    std::size_t min_thread_bytes) {
+    // Give each thread whole records, and at least min_thread_bytes of them.
+    const std::size_t record_size = 2880;
+    std::size_t num_records = num_bytes / record_size;
+    std::size_t num_blocks = 0 != num_threads ? num_threads : std::thread::hardware_concurrency();
+    if (0 != min_thread_bytes && num_blocks > num_bytes / min_thread_bytes) num_blocks = num_bytes / min_thread_bytes;
+    if (num_blocks > num_records) num_blocks = num_records;
+    if (2 > num_blocks) return accumulate(data, num_bytes);
+
+    const unsigned char * bytes = static_cast<const unsigned char *>(data);
+    std::vector<unsigned long> block_sums(num_blocks, 0);
+    auto work = [&](std::size_t index) {
+      std::size_t begin = num_records * index / num_blocks * record_size;
+      std::size_t end = index + 1 == num_blocks ? num_bytes : num_records * (index + 1) / num_blocks * record_size;
+      block_sums[index] = accumulate(bytes + begin, end - begin);
+    };
+
+    std::vector<std::thread> threads;
+    try {
+      for (std::size_t index = 1; index < num_blocks; ++index) threads.push_back(std::thread(work, index));
+    } catch (const std::exception &) {
+      // Could not start a thread: sum the blocks of the threads which were not started here.
+      for (std::size_t index = threads.size() + 1; index < num_blocks; ++index) work(index);
+    }
+    work(0);
+    for (std::vector<std::thread>::iterator itor = threads.begin(); itor != threads.end(); ++itor) itor->join();
+
+    // Ones' complement sums of blocks add up, in any order, to the sum of the whole.
+    unsigned long sum = 0;
+    for (std::vector<unsigned long>::iterator itor = block_sums.begin(); itor != block_sums.end(); ++itor)
+      sum = fold(static_cast<unsigned long long>(sum) + *itor);
+    return sum;
+  }
+
+  bool FitsChecksum::writeChecksum(fitsfile * fp, unsigned int num_threads, int & status) {
+    LONGLONG header_start = 0;
+    LONGLONG data_start = 0;
+    LONGLONG data_end = 0;
+    char file_name[FLEN_FILENAME] = "";
+    int local_status = status;
+    fits_get_hduaddrll(fp, &header_start, &data_start, &data_end, &local_status);
+    fits_file_name(fp, file_name, &local_status);
+    if (0 != local_status || data_end <= data_start || '\0' == file_name[0]) return false;
+
+    // Write the keywords first, as cfitsio would, so that the data unit is where it will stay even if the header
+    // must grow to hold them.
+    char date[FLEN_VALUE] = "";
+    int time_ref = 0;
+    fits_get_system_time(date, &time_ref, &local_status);
+    std::string data_comment = std::string("data unit checksum updated ") + date;
+    char value[FLEN_VALUE] = "";
+    int key_status = local_status;
+    fits_read_keyword(fp, const_cast<char *>("CHECKSUM"), value, 0, &key_status);
+    if (KEY_NO_EXIST == key_status) {
+      std::string comment = std::string("HDU checksum updated ") + date;
+      fits_write_key(fp, TSTRING, const_cast<char *>("CHECKSUM"), const_cast<char *>("0000000000000000"),
+        const_cast<char *>(comment.c_str()), &local_status);
+    }
+    fits_update_key(fp, TSTRING, const_cast<char *>("DATASUM"), const_cast<char *>("0"),
+      const_cast<char *>(data_comment.c_str()), &local_status);
+
+    // Sum the data where they are on disk, once everything cfitsio holds for the file is written there.
+    fits_flush_file(fp, &local_status);
+    fits_get_hduaddrll(fp, &header_start, &data_start, &data_end, &local_status);
+    if (0 != local_status) {
+      status = local_status;
+      return true;
+    }
+    FitsMapping mapping;
+    if (!mapping.map(file_name, fp, data_end - data_start)) return false;
+    unsigned long data_sum = computeDataSum(mapping.getData(), data_end - data_start, num_threads);
+    mapping.unmap();
+
+    // Given DATASUM, cfitsio need only hash the header to complete CHECKSUM.
+    std::ostringstream os;
+    os << data_sum;
+    fits_update_key(fp, TSTRING, const_cast<char *>("DATASUM"), const_cast<char *>(os.str().c_str()),
+      const_cast<char *>(data_comment.c_str()), &local_status);
+    fits_update_chksum(fp, &local_status);
+    status = local_status;
+    return true;
+  }
+
+}
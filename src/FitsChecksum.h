@@ -0,0 +1,58 @@
+/** \file FitsChecksum.h
+
+    \brief Computation of the FITS data unit checksum (DATASUM) with vectorized kernels, in parallel for large data
+    units. This class is not part of the API.
+*/
+#ifndef tip_FitsChecksum_h
+#define tip_FitsChecksum_h
+
+#include <cstddef>
+
+#include "fitsio.h"
+
+namespace tip {
+
+  /** \class FitsChecksum
+
+      \brief Computes the 32-bit ones' complement sum of the big-endian words of a FITS data unit, which is the value
+      of its DATASUM keyword, and writes the checksum keywords of an extension using it. The sum uses the kernel
+      FitsByteSwap uses (AVX2, SSE2 or portable scalar code), and large data units are split into blocks of whole
+      2880-byte records which are summed by separate threads, since the partial sums of a ones' complement sum
+      may be added in any order.
+  */
+  class FitsChecksum {
+    public:
+      /** \brief Add the big-endian 32-bit words of a buffer to a ones' complement sum, as cfitsio's fits_csum does.
+          \param data The words.
+          \param num_bytes The number of bytes, a multiple of 4.
+          \param sum The sum to add to, 0 to start a new sum.
+      */
+      static unsigned long accumulate(const void * data, std::size_t num_bytes, unsigned long sum = 0);
+
+      /** \brief Compute the ones' complement sum of a data unit, summing blocks of whole records in parallel when it
+          is large enough that each thread has at least min_thread_bytes to sum.
+          \param data The data unit.
+          \param num_bytes The number of bytes, a multiple of 4.
+          \param num_threads The maximum number of threads, or 0 for one per core.
+          \param min_thread_bytes The smallest number of bytes worth summing in a thread of its own.
+      */
+      static unsigned long computeDataSum(const void * data, std::size_t num_bytes, unsigned int num_threads = 0,
+        std::size_t min_thread_bytes = s_min_thread_bytes);
+
+      /** \brief Write the DATASUM and CHECKSUM keywords of the current extension of a file open for writing, summing
+          its data unit in place in the file, as computeDataSum does, rather than reading it through cfitsio. Returns
+          false if the data unit is empty or the file cannot be mapped into memory, for example because it is
+          compressed or in memory; the keywords may then hold placeholders, and fits_write_chksum must be used.
+          \param fp The file, positioned at the extension.
+          \param num_threads The maximum number of threads, or 0 for one per core.
+          \param status The cfitsio status.
+      */
+      static bool writeChecksum(fitsfile * fp, unsigned int num_threads, int & status);
+
+      /// \brief The default smallest number of bytes summed by a thread of its own, a whole number of records.
+      static const std::size_t s_min_thread_bytes = 1456 * 2880;
+  };
+
+}
+
+#endif
@@ -10,9 +10,11 @@
 #include <cstdlib>
 #include <cstring>
 #include <cctype>
+#include <limits>
 #include <memory>
 #include <sstream>
 #include <string>
+#include <type_traits>
 #include <typeinfo>
 #include <vector>
 
@@ -44,6 +46,8 @@ namespace tip {
       virtual void get(Index_t record_index, unsigned short & dest) const { getScalar(record_index, dest); }
       virtual void get(Index_t record_index, unsigned int & dest) const { getScalar(record_index, dest); }
       virtual void get(Index_t record_index, unsigned long & dest) const { getScalar(record_index, dest); }
+      virtual void get(Index_t record_index, signed long long & dest) const { getScalar(record_index, dest); }
+      virtual void get(Index_t record_index, unsigned long long & dest) const { getScalar(record_index, dest); }
       //      virtual void get(Index_t record_index, BitStruct & dest) const { getScalar(record_index, dest); }
 
       virtual void get(Index_t record_index, std::vector<double> & dest) const { getVector(record_index, dest); }
@@ -57,8 +61,73 @@ namespace tip {
       virtual void get(Index_t record_index, std::vector<unsigned short> & dest) const { getVector(record_index, dest); }
       virtual void get(Index_t record_index, std::vector<unsigned int> & dest) const { getVector(record_index, dest); }
       virtual void get(Index_t record_index, std::vector<unsigned long> & dest) const { getVector(record_index, dest); }
+      virtual void get(Index_t record_index, std::vector<signed long long> & dest) const { getVector(record_index, dest); }
+      virtual void get(Index_t record_index, std::vector<unsigned long long> & dest) const { getVector(record_index, dest); }
       //      virtual void get(Index_t record_index, std::vector<BitStruct> & dest) const { getVector(record_index, dest); }
 
+      virtual void get(Index_t record_begin, Index_t record_end, double * dest, char * null_flags = 0) const
+        { getRange(record_begin, record_end, dest, null_flags); }
+      virtual void get(Index_t record_begin, Index_t record_end, float * dest, char * null_flags = 0) const
+        { getRange(record_begin, record_end, dest, null_flags); }
+      virtual void get(Index_t record_begin, Index_t record_end, char * dest, char * null_flags = 0) const
+        { getRange(record_begin, record_end, dest, null_flags); }
+      virtual void get(Index_t record_begin, Index_t record_end, signed char * dest, char * null_flags = 0) const
+        { getRange(record_begin, record_end, dest, null_flags); }
+      virtual void get(Index_t record_begin, Index_t record_end, signed short * dest, char * null_flags = 0) const
+        { getRange(record_begin, record_end, dest, null_flags); }
+      virtual void get(Index_t record_begin, Index_t record_end, signed int * dest, char * null_flags = 0) const
+        { getRange(record_begin, record_end, dest, null_flags); }
+      virtual void get(Index_t record_begin, Index_t record_end, signed long * dest, char * null_flags = 0) const
+        { getRange(record_begin, record_end, dest, null_flags); }
+      virtual void get(Index_t record_begin, Index_t record_end, unsigned char * dest, char * null_flags = 0) const
+        { getRange(record_begin, record_end, dest, null_flags); }
+      virtual void get(Index_t record_begin, Index_t record_end, unsigned short * dest, char * null_flags = 0) const
+        { getRange(record_begin, record_end, dest, null_flags); }
+      virtual void get(Index_t record_begin, Index_t record_end, unsigned int * dest, char * null_flags = 0) const
+        { getRange(record_begin, record_end, dest, null_flags); }
+      virtual void get(Index_t record_begin, Index_t record_end, unsigned long * dest, char * null_flags = 0) const
+        { getRange(record_begin, record_end, dest, null_flags); }
+      virtual void get(Index_t record_begin, Index_t record_end, signed long long * dest, char * null_flags = 0) const
+        { getRange(record_begin, record_end, dest, null_flags); }
+      virtual void get(Index_t record_begin, Index_t record_end, unsigned long long * dest, char * null_flags = 0) const
+        { getRange(record_begin, record_end, dest, null_flags); }
+
+      virtual void get(Index_t record_begin, Index_t record_end, bool * dest, char * null_flags = 0) const {
+        if (!checkRange(record_begin, record_end)) return;
+        Index_t num_records = record_end - record_begin;
+        // Read logical values as char, as in get(Index_t, bool &), then convert.
+        std::vector<char> tmp_dest(num_records);
+        int status = 0;
+        int any_null = 0;
+        if (0 == null_flags)
+          fits_read_col(m_ext->getFp(), TLOGICAL, m_field_index, record_begin + 1, 1, num_records, 0, &tmp_dest[0],
+            &any_null, &status);
+        else
+          fits_read_colnull(m_ext->getFp(), TLOGICAL, m_field_index, record_begin + 1, 1, num_records, &tmp_dest[0],
+            null_flags, &any_null, &status);
+        if (0 != status) throw TipException(status, "FitsColumn::getRange failed to read logical cell values");
+        for (Index_t ii = 0; ii != num_records; ++ii) dest[ii] = (0 != tmp_dest[ii]);
+      }
+
+      virtual void get(Index_t record_begin, Index_t record_end, std::string * dest, char * null_flags = 0) const {
+        if (!checkRange(record_begin, record_end)) return;
+        Index_t num_records = record_end - record_begin;
+        // Make one buffer to hold all the strings, and an array of pointers to the individual strings in it.
+        std::vector<char> buf(num_records * (m_display_width + 1), '\0');
+        std::vector<char *> tmp_dest(num_records);
+        for (Index_t ii = 0; ii != num_records; ++ii) tmp_dest[ii] = &buf[ii * (m_display_width + 1)];
+        int status = 0;
+        int any_null = 0;
+        if (0 == null_flags)
+          fits_read_col(m_ext->getFp(), TSTRING, m_field_index, record_begin + 1, 1, num_records,
+            &FitsPrimProps<char *>::undefined(), &tmp_dest[0], &any_null, &status);
+        else
+          fits_read_colnull(m_ext->getFp(), TSTRING, m_field_index, record_begin + 1, 1, num_records, &tmp_dest[0],
+            null_flags, &any_null, &status);
+        if (0 != status) throw TipException(status, "FitsColumn::getRange failed to read string cell values");
+        for (Index_t ii = 0; ii != num_records; ++ii) dest[ii] = tmp_dest[ii];
+      }
+
       virtual void set(Index_t record_index, const double & src) { setScalar(record_index, src); }
       virtual void set(Index_t record_index, const float & src) { setScalar(record_index, src); }
       virtual void set(Index_t record_index, const char & src) { setScalar(record_index, src); }
@@ -70,8 +139,37 @@ namespace tip {
       virtual void set(Index_t record_index, const unsigned short & src) { setScalar(record_index, src); }
       virtual void set(Index_t record_index, const unsigned int & src) { setScalar(record_index, src); }
       virtual void set(Index_t record_index, const unsigned long & src) { setScalar(record_index, src); }
+      virtual void set(Index_t record_index, const signed long long & src) { setScalar(record_index, src); }
+      virtual void set(Index_t record_index, const unsigned long long & src) { setScalar(record_index, src); }
       //      virtual void set(Index_t record_index, const BitStruct & src) { setScalar(record_index, src); }
 
+      virtual void set(Index_t record_begin, const double * src_begin, const double * src_end, const char * null_mask = 0)
+        { setRange(record_begin, src_begin, src_end, null_mask); }
+      virtual void set(Index_t record_begin, const float * src_begin, const float * src_end, const char * null_mask = 0)
+        { setRange(record_begin, src_begin, src_end, null_mask); }
+      virtual void set(Index_t record_begin, const char * src_begin, const char * src_end, const char * null_mask = 0)
+        { setRange(record_begin, src_begin, src_end, null_mask); }
+      virtual void set(Index_t record_begin, const signed char * src_begin, const signed char * src_end, const char * null_mask = 0)
+        { setRange(record_begin, src_begin, src_end, null_mask); }
+      virtual void set(Index_t record_begin, const signed short * src_begin, const signed short * src_end, const char * null_mask = 0)
+        { setRange(record_begin, src_begin, src_end, null_mask); }
+      virtual void set(Index_t record_begin, const signed int * src_begin, const signed int * src_end, const char * null_mask = 0)
+        { setRange(record_begin, src_begin, src_end, null_mask); }
+      virtual void set(Index_t record_begin, const signed long * src_begin, const signed long * src_end, const char * null_mask = 0)
+        { setRange(record_begin, src_begin, src_end, null_mask); }
+      virtual void set(Index_t record_begin, const unsigned char * src_begin, const unsigned char * src_end, const char * null_mask = 0)
+        { setRange(record_begin, src_begin, src_end, null_mask); }
+      virtual void set(Index_t record_begin, const unsigned short * src_begin, const unsigned short * src_end, const char * null_mask = 0)
+        { setRange(record_begin, src_begin, src_end, null_mask); }
+      virtual void set(Index_t record_begin, const unsigned int * src_begin, const unsigned int * src_end, const char * null_mask = 0)
+        { setRange(record_begin, src_begin, src_end, null_mask); }
+      virtual void set(Index_t record_begin, const unsigned long * src_begin, const unsigned long * src_end, const char * null_mask = 0)
+        { setRange(record_begin, src_begin, src_end, null_mask); }
+      virtual void set(Index_t record_begin, const signed long long * src_begin, const signed long long * src_end,
+        const char * null_mask = 0) { setRange(record_begin, src_begin, src_end, null_mask); }
+      virtual void set(Index_t record_begin, const unsigned long long * src_begin, const unsigned long long * src_end,
+        const char * null_mask = 0) { setRange(record_begin, src_begin, src_end, null_mask); }
+
       virtual void set(Index_t record_index, const std::vector<double> & src) { setVector(record_index, src); }
       virtual void set(Index_t record_index, const std::vector<float> & src) { setVector(record_index, src); }
       virtual void set(Index_t record_index, const std::vector<char> & src) { setVector(record_index, src); }
@@ -83,6 +181,8 @@ namespace tip {
       virtual void set(Index_t record_index, const std::vector<unsigned short> & src) { setVector(record_index, src); }
       virtual void set(Index_t record_index, const std::vector<unsigned int> & src) { setVector(record_index, src); }
       virtual void set(Index_t record_index, const std::vector<unsigned long> & src) { setVector(record_index, src); }
+      virtual void set(Index_t record_index, const std::vector<signed long long> & src) { setVector(record_index, src); }
+      virtual void set(Index_t record_index, const std::vector<unsigned long long> & src) { setVector(record_index, src); }
       //      virtual void set(Index_t record_index, const std::vector<BitStruct> & src) { setVector(record_index, src); }
 
       virtual void get(Index_t record_index, std::string & dest) const {
@@ -276,6 +376,7 @@ namespace tip {
         if (!m_scalar) throw TipException("FitsColumn::set(Index_t, const bool &) called but field is not a scalar");
         int status = 0;
         char tmp_src = src;
+        m_ext->setDataModified();
         fits_write_col(m_ext->getFp(), FitsPrimProps<bool>::dataTypeCode(), m_field_index, record_index + 1, 1, m_repeat,
           const_cast<void *>(static_cast<const void *>(&tmp_src)), &status);
         if (0 != status) throw TipException(status, "FitsColumn::set(Index_t, const bool &) failed to write scalar cell value");
@@ -296,6 +397,7 @@ namespace tip {
 
         char * tmp_src = new char[num_els];
         for (Index_t ii = 0; ii < num_els; ++ii) tmp_src[ii] = src[ii];
+        m_ext->setDataModified();
         fits_write_col(m_ext->getFp(), FitsPrimProps<bool>::dataTypeCode(), m_field_index, record_index + 1, 1, num_els,
           tmp_src, &status);
         delete [] tmp_src;
@@ -321,6 +423,7 @@ namespace tip {
         //if (!m_scalar) throw TipException("FitsColumn::setScalar called but field is not a scalar");
         int status = 0;
         if (m_ext->readOnly()) throw TipException("FitsColumn::setScalar called for a read-only file");       
+        m_ext->setDataModified();
         fits_write_col(m_ext->getFp(), TBYTE, m_field_index, record_index + 1, 1, 4,
 			   const_cast<void *>(static_cast<const void *>(&BitArr)), &status);
         if (0 != status) throw TipException(status, "FitsColumn::setScalar failed to write scalar cell value");
@@ -345,6 +448,7 @@ namespace tip {
         U * src_tmp(new U[src.size()]);
         for (std::size_t ii = 0; ii != src.size(); ++ii) src_tmp[ii] = src[ii];
 
+        m_ext->setDataModified();
         fits_write_col(m_ext->getFp(), FitsPrimProps<U>::dataTypeCode(), m_field_index, record_index + 1, 1, num_els,
             src_tmp, &status);
         delete [] src_tmp;
@@ -396,6 +500,7 @@ namespace tip {
 
       virtual bool isNull(Index_t record_index) const {
         if (!m_scalar) throw TipException("FitsColumn::isNull(Index_t) called but field is not a scalar");
+        if (readAhead(record_index)) return 0 != m_cache_null[record_index - m_cache_begin];
         int status = 0;
         int any_null = 0;
         // For strings, make a buffer to hold the value.
@@ -460,6 +565,22 @@ namespace tip {
         }
       }
 
+      /** \brief Copy cells of the given records of another column into consecutive records of this column. Scalar
+          numeric values are read from FITS columns in runs of consecutive records and written a block at a time;
+          other cells are copied one at a time.
+          \param src Pointer to the source column.
+          \param src_indices Indices of the cells in the source column, in the order they are to be copied.
+          \param dest_begin Index of the cell in this column which receives the first source cell.
+      */
+      virtual void copy(const IColumn * src, const std::vector<Index_t> & src_indices, Index_t dest_begin) {
+        // All FITS columns, including filtered and memory-mapped ones, read ranges of scalar cells.
+        if (m_scalar && src->isScalar() && std::string::npos != src->implementation().find("FITS"))
+          copyRange(src, src_indices, dest_begin,
+            std::integral_constant<bool, std::is_arithmetic<T>::value && !std::is_same<T, bool>::value>());
+        else
+          IColumn::copy(src, src_indices, dest_begin);
+      }
+
       /** \brief Return a flag indicating whether this column holds scalar data.
       */
       virtual bool isScalar() const { return m_scalar; }
@@ -491,6 +612,7 @@ namespace tip {
       virtual void setNumElements(Index_t num_elements) {
         if (m_var_length) throw TipException("FitsColumn::setNumElements cannot change the width of variable length column");
         int status = 0;
+        m_ext->setDataModified();
         fits_modify_vector_len(m_ext->getFp(), m_field_index, num_elements, &status);
         if (0 != status) throw TipException(status, "FitsColumn::setNumElements failed to modify field");
 
@@ -512,12 +634,27 @@ namespace tip {
       /// \brief Return a string identifying the full data type of the column.
       virtual std::string getFormat() const { return m_type_string; }
 
+      /** \brief Read scalar numeric values of this column ahead in blocks of records. Vector, string, logical,
+          bit and 64-bit integer columns are never buffered.
+          \param num_records The number of records to read at a time. 0 disables read-ahead.
+      */
+      virtual void setReadAhead(Index_t num_records) const {
+        m_read_ahead = 0 < num_records ? num_records : 0;
+        clearCache();
+      }
+
+      virtual void getReadAheadStats(unsigned long & num_hits, unsigned long & num_misses) const {
+        num_hits = m_num_hits;
+        num_misses = m_num_misses;
+      }
+
     private:
       template <typename U>
       void getScalar(Index_t record_index, U & dest) const {
         // Prevent accidental calling for bool or string. The optimizer will swallow this.
         assert(typeid(U) != typeid(bool) && typeid(U) != typeid(std::string));
         if (!m_scalar) throw TipException("FitsColumn::getScalar was called but field is not a scalar");
+        if (getCached(record_index, dest)) return;
         int status = 0;
         int any_null = 0;
         fits_read_col(m_ext->getFp(), FitsPrimProps<U>::dataTypeCode(), m_field_index, record_index + 1, 1, m_repeat,
@@ -525,6 +662,128 @@ namespace tip {
         if (0 != status) throw TipException(status, "FitsColumn::getScalar failed to read scalar cell value");
       }
 
+      /** \brief Make sure the given record is in the read-ahead buffer, refilling the buffer starting with
+          this record if necessary. Returns false if read-ahead is disabled or does not apply to this column.
+          \param record_index The record to be read.
+      */
+      bool readAhead(Index_t record_index) const {
+        if (0 == m_read_ahead || !m_scalar || m_var_length || TSTRING == m_type_code || TLOGICAL == m_type_code ||
+          TBIT == m_type_code || TLONGLONG == m_type_code || TULONGLONG == m_type_code) return false;
+
+        if (m_cache_begin <= record_index && record_index < m_cache_begin + Index_t(m_cache.size())) {
+          ++m_num_hits;
+          return true;
+        }
+
+        ++m_num_misses;
+        clearCache();
+        Index_t num_records = m_ext->getNumRecords() - record_index;
+        if (m_read_ahead < num_records) num_records = m_read_ahead;
+        // Let an unbuffered read report problems with records out of range.
+        if (0 > record_index || 0 >= num_records) return false;
+
+        // Buffer as double, which holds every value of the (at most 32 bit) numeric column types exactly,
+        // including values scaled by TSCALn/TZEROn. Cfitsio flags null values in a separate array.
+        std::vector<double> cache(num_records);
+        std::vector<char> cache_null(num_records);
+        int status = 0;
+        int any_null = 0;
+        fits_read_colnull(m_ext->getFp(), TDOUBLE, m_field_index, record_index + 1, 1, num_records, &cache[0],
+          &cache_null[0], &any_null, &status);
+        if (0 != status) throw TipException(status, "FitsColumn::readAhead failed to read scalar cell values");
+
+        m_cache.swap(cache);
+        m_cache_null.swap(cache_null);
+        m_cache_begin = record_index;
+        return true;
+      }
+
+      /** \brief Get a scalar value from the read-ahead buffer. Returns false if the value must instead be read
+          directly, either because it is not buffered, or because cfitsio would have to convert it in a way
+          the buffer cannot reproduce (a null in a type without a null value, or a value out of range of U).
+          \param record_index The record to be read.
+          \param dest The output value.
+      */
+      template <typename U>
+      bool getCached(Index_t record_index, U & dest) const {
+        if (!readAhead(record_index)) return false;
+        Index_t offset = record_index - m_cache_begin;
+        if (0 != m_cache_null[offset]) {
+          // Cfitsio does not check for nulls when the null value is 0.
+          if (U(0) == FitsPrimProps<U>::undefined()) return false;
+          dest = FitsPrimProps<U>::undefined();
+          return true;
+        }
+        double value = m_cache[offset];
+        if (std::numeric_limits<U>::is_integer &&
+          (value < double(std::numeric_limits<U>::min()) || value > double(std::numeric_limits<U>::max()))) return false;
+        dest = U(value);
+        return true;
+      }
+
+      /// \brief Strings are never buffered.
+      bool getCached(Index_t, char * &) const { return false; }
+
+      void clearCache() const {
+        m_cache.clear();
+        m_cache_null.clear();
+        m_cache_begin = 0;
+      }
+
+      template <typename U>
+      void getRange(Index_t record_begin, Index_t record_end, U * dest, char * null_flags) const {
+        // Prevent accidental calling for bool or string. The optimizer will swallow this.
+        assert(typeid(U) != typeid(bool) && typeid(U) != typeid(std::string));
+        if (!checkRange(record_begin, record_end)) return;
+        int status = 0;
+        int any_null = 0;
+        // Cfitsio continues reading into the following rows of a scalar column, so one call reads the whole range.
+        if (0 == null_flags)
+          fits_read_col(m_ext->getFp(), FitsPrimProps<U>::dataTypeCode(), m_field_index, record_begin + 1, 1,
+            record_end - record_begin, &FitsPrimProps<U>::undefined(), dest, &any_null, &status);
+        else
+          fits_read_colnull(m_ext->getFp(), FitsPrimProps<U>::dataTypeCode(), m_field_index, record_begin + 1, 1,
+            record_end - record_begin, dest, null_flags, &any_null, &status);
+        if (0 != status) throw TipException(status, "FitsColumn::getRange failed to read scalar cell values");
+      }
+
+      /** \brief Copy scalar numeric values in blocks, converting them to this column's type as they are read.
+      */
+      void copyRange(const IColumn * src, const std::vector<Index_t> & src_indices, Index_t dest_begin, std::true_type) {
+        typedef std::vector<Index_t>::size_type size_type;
+        size_type block_size = size_type(m_ext->getOptimalNumRecords());
+        if (block_size > src_indices.size()) block_size = src_indices.size();
+        std::vector<T> values(block_size);
+        for (size_type begin = 0; begin < src_indices.size(); ) {
+          size_type end = src_indices.size() - begin < block_size ? src_indices.size() : begin + block_size;
+          for (size_type run = begin; run != end; ) {
+            size_type run_end = run + 1;
+            while (run_end != end && src_indices[run_end] == src_indices[run_end - 1] + 1) ++run_end;
+            src->get(src_indices[run], src_indices[run_end - 1] + 1, &values[run - begin]);
+            run = run_end;
+          }
+          // Null values were read as the undefined value, which is written back as null.
+          set(dest_begin + Index_t(begin), &values[0], &values[0] + (end - begin));
+          begin = end;
+        }
+      }
+
+      /** \brief Copy logical, string and bit values one cell at a time.
+      */
+      void copyRange(const IColumn * src, const std::vector<Index_t> & src_indices, Index_t dest_begin, std::false_type) {
+        IColumn::copy(src, src_indices, dest_begin);
+      }
+
+      /** \brief Check that the given range of records may be read from this column, and return false if it is empty.
+          \param record_begin Index of the first record to read.
+          \param record_end Index of the record after the last record to read.
+      */
+      bool checkRange(Index_t record_begin, Index_t record_end) const {
+        if (!m_scalar) throw TipException("FitsColumn::getRange was called but field is not a scalar");
+        if (record_begin > record_end) throw TipException("FitsColumn::getRange was called with an invalid range of records");
+        return record_begin != record_end;
+      }
+
       template <typename U>
       void getVector(Index_t record_index, std::vector<U> & dest) const {
         // Prevent accidental calling for bool or string. The optimizer will swallow this.
@@ -555,11 +814,38 @@ namespace tip {
         if (!m_scalar) throw TipException("FitsColumn::setScalar called but field is not a scalar");
         int status = 0;
         if (m_ext->readOnly()) throw TipException("FitsColumn::setScalar called for a read-only file");
+        clearCache();
+        m_ext->setDataModified();
         fits_write_colnull(m_ext->getFp(), FitsPrimProps<U>::dataTypeCode(), m_field_index, record_index + 1, 1, m_repeat,
           const_cast<void *>(static_cast<const void *>(&dest)), &FitsPrimProps<U>::undefined(), &status);
         if (0 != status) throw TipException(status, "FitsColumn::setScalar failed to write scalar cell value");
       }
 
+      template <typename U>
+      void setRange(Index_t record_begin, const U * src_begin, const U * src_end, const char * null_mask) {
+        // Prevent accidental calling for bool or string. The optimizer will swallow this.
+        assert(typeid(U) != typeid(bool) && typeid(U) != typeid(std::string));
+        if (!m_scalar) throw TipException("FitsColumn::setRange called but field is not a scalar");
+        if (m_ext->readOnly()) throw TipException("FitsColumn::setRange called for a read-only file");
+        if (src_begin > src_end) throw TipException("FitsColumn::setRange called with an invalid range of values");
+        if (src_begin == src_end) return;
+        clearCache();
+        int status = 0;
+        Index_t num_records = src_end - src_begin;
+        m_ext->setDataModified();
+        if (0 == null_mask) {
+          fits_write_colnull(m_ext->getFp(), FitsPrimProps<U>::dataTypeCode(), m_field_index, record_begin + 1, 1, num_records,
+            const_cast<void *>(static_cast<const void *>(src_begin)), &FitsPrimProps<U>::undefined(), &status);
+        } else {
+          // Substitute the undefined value for masked records so that cfitsio writes them as nulls.
+          std::vector<U> src_tmp(src_begin, src_end);
+          for (Index_t ii = 0; ii != num_records; ++ii) if (0 != null_mask[ii]) src_tmp[ii] = FitsPrimProps<U>::undefined();
+          fits_write_colnull(m_ext->getFp(), FitsPrimProps<U>::dataTypeCode(), m_field_index, record_begin + 1, 1, num_records,
+            &src_tmp[0], &FitsPrimProps<U>::undefined(), &status);
+        }
+        if (0 != status) throw TipException(status, "FitsColumn::setRange failed to write scalar cell values");
+      }
+
       template <typename U>
       void setVector(Index_t record_index, const std::vector<U> & src) {
         // Prevent accidental calling for bool or string. The optimizer will swallow this.
@@ -578,6 +864,7 @@ namespace tip {
         U * src_tmp(new U[src.size()]);
         for (std::size_t ii = 0; ii != src.size(); ++ii) src_tmp[ii] = src[ii];
 
+        m_ext->setDataModified();
         fits_write_colnull(m_ext->getFp(), FitsPrimProps<U>::dataTypeCode(), m_field_index, record_index + 1, 1, num_els,
             src_tmp, &FitsPrimProps<U>::undefined(), &status);
         delete [] src_tmp;
@@ -591,6 +878,12 @@ namespace tip {
       Index_t m_width;
       int m_type_code;
       int m_display_width;
+      mutable std::vector<double> m_cache;
+      mutable std::vector<char> m_cache_null;
+      mutable Index_t m_read_ahead;
+      mutable Index_t m_cache_begin;
+      mutable unsigned long m_num_hits;
+      mutable unsigned long m_num_misses;
       bool m_var_length;
       bool m_scalar;
   };
@@ -598,7 +891,8 @@ namespace tip {
   template <typename T>
   inline FitsColumn<T>::FitsColumn(FitsTable * ext, const std::string & id, FieldIndex_t field_index): IColumn(id),
     m_type_string(), m_ext(ext), m_field_index(field_index), m_repeat(0), m_width(0), m_type_code(0), m_display_width(0),
-    m_var_length(false), m_scalar(false) {
+    m_cache(), m_cache_null(), m_read_ahead(0), m_cache_begin(0), m_num_hits(0), m_num_misses(0), m_var_length(false),
+    m_scalar(false) {
 
     // Determine characteristics of this column.
     int status = 0;
@@ -613,7 +907,7 @@ namespace tip {
     getColumnKeyword("TFORM").get(m_type_string);
 
     // Detect unsigned integral types, and modify m_type_string as needed to reflect this.
-    if (TINT == m_type_code || TLONG == m_type_code || TSHORT == m_type_code) {
+    if (TINT == m_type_code || TLONG == m_type_code || TSHORT == m_type_code || TLONGLONG == m_type_code) {
       // Check the tscal.
       double tscal = 0.;
       try {
@@ -642,6 +936,12 @@ namespace tip {
                 if (std::string::npos != index) m_type_string[index] = 'U';
               }
               break;
+            case TLONGLONG:
+              if (1ull<<63u == tzero) {
+                std::string::size_type index = m_type_string.find("K");
+                if (std::string::npos != index) m_type_string[index] = 'W';
+              }
+              break;
             default:
               break;
           }
@@ -0,0 +1,178 @@
+/** \file FitsDecoder.cxx
+
+    \brief Byte-swap kernels used to decode raw FITS data, and their selection at run time.
+*/
+#include <atomic>
+#include <cstring>
+
+#include "FitsDecoder.h"
+#include "tip/TipException.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TIP_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace {
+
+  using tip::FitsByteSwap;
+
+  typedef void (*SwapFunc)(const unsigned char *, std::size_t, unsigned char *);
+
+  // Portable kernels. Each value is read completely before it is written, so src may equal dest.
+  template <std::size_t Size>
+  void swapScalar(const unsigned char * src, std::size_t num_values, unsigned char * dest) {
+    for (std::size_t ii = 0; ii != num_values; ++ii, src += Size, dest += Size) {
+      unsigned char value[Size];
+      for (std::size_t jj = 0; jj != Size; ++jj) value[jj] = src[Size - 1 - jj];
+      std::memcpy(dest, value, Size);
+    }
+  }
+
+#ifdef TIP_X86_KERNELS
+  // SSE2 has no byte shuffle: swap the bytes of each 16-bit word with shifts, after reversing the order of the
+  // words within each value.
+  __attribute__((target("sse2"))) inline __m128i swapWords(__m128i value) {
+    return _mm_or_si128(_mm_slli_epi16(value, 8), _mm_srli_epi16(value, 8));
+  }
+
+  __attribute__((target("sse2"))) void swapSse2_2(const unsigned char * src, std::size_t num_values, unsigned char * dest) {
+    std::size_t num_vectors = num_values / 8;
+    for (std::size_t ii = 0; ii != num_vectors; ++ii, src += 16, dest += 16) {
+      __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(dest), swapWords(value));
+    }
+    swapScalar<2>(src, num_values % 8, dest);
+  }
+
+  __attribute__((target("sse2"))) void swapSse2_4(const unsigned char * src, std::size_t num_values, unsigned char * dest) {
+    std::size_t num_vectors = num_values / 4;
+    for (std::size_t ii = 0; ii != num_vectors; ++ii, src += 16, dest += 16) {
+      __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+      value = _mm_shufflehi_epi16(_mm_shufflelo_epi16(value, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(dest), swapWords(value));
+    }
+    swapScalar<4>(src, num_values % 4, dest);
+  }
+
+  __attribute__((target("sse2"))) void swapSse2_8(const unsigned char * src, std::size_t num_values, unsigned char * dest) {
+    std::size_t num_vectors = num_values / 2;
+    for (std::size_t ii = 0; ii != num_vectors; ++ii, src += 16, dest += 16) {
+      __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+      value = _mm_shufflehi_epi16(_mm_shufflelo_epi16(value, _MM_SHUFFLE(0, 1, 2, 3)), _MM_SHUFFLE(0, 1, 2, 3));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(dest), swapWords(value));
+    }
+    swapScalar<8>(src, num_values % 2, dest);
+  }
+
+  // AVX2 shuffles bytes directly, 32 at a time.
+  template <std::size_t Size>
+  __attribute__((target("avx2"))) void swapAvx2(const unsigned char * src, std::size_t num_values, unsigned char * dest) {
+    char mask_bytes[32];
+    for (std::size_t ii = 0; ii != 32; ++ii) mask_bytes[ii] = char(ii - ii % Size + Size - 1 - ii % Size);
+    __m256i mask = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(mask_bytes));
+    std::size_t values_per_vector = 32 / Size;
+    std::size_t num_vectors = num_values / values_per_vector;
+    for (std::size_t ii = 0; ii != num_vectors; ++ii, src += 32, dest += 32) {
+      __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src));
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(dest), _mm256_shuffle_epi8(value, mask));
+    }
+    swapScalar<Size>(src, num_values % values_per_vector, dest);
+  }
+#endif
+
+  // A kernel is selected by pointing to one of these, which never change, so that the selection may be changed
+  // while other threads swap bytes: each reads the pointer once, and gets a consistent kernel.
+  struct SwapKernel {
+    FitsByteSwap::Kernel m_id;
+    SwapFunc m_swap_2;
+    SwapFunc m_swap_4;
+    SwapFunc m_swap_8;
+  };
+
+  const SwapKernel * findKernel(FitsByteSwap::Kernel kernel) {
+    static const SwapKernel s_scalar = { FitsByteSwap::eScalar, &swapScalar<2>, &swapScalar<4>, &swapScalar<8> };
+#ifdef TIP_X86_KERNELS
+    static const SwapKernel s_sse2 = { FitsByteSwap::eSse2, &swapSse2_2, &swapSse2_4, &swapSse2_8 };
+    static const SwapKernel s_avx2 = { FitsByteSwap::eAvx2, &swapAvx2<2>, &swapAvx2<4>, &swapAvx2<8> };
+    if (FitsByteSwap::eSse2 == kernel) return &s_sse2;
+    if (FitsByteSwap::eAvx2 == kernel) return &s_avx2;
+#else
+    (void)kernel;
+#endif
+    return &s_scalar;
+  }
+
+  std::atomic<const SwapKernel *> & s_getKernel() {
+    static std::atomic<const SwapKernel *> s_kernel(findKernel(FitsByteSwap::getBestKernel()));
+    return s_kernel;
+  }
+
+}
+
+namespace tip {
+
+  FitsByteSwap::Kernel FitsByteSwap::getKernel() {
+    return s_getKernel().load()->m_id;
+  }
+
+  FitsByteSwap::Kernel FitsByteSwap::getBestKernel() {
+    if (isSupported(eAvx2)) return eAvx2;
+    if (isSupported(eSse2)) return eSse2;
+    return eScalar;
+  }
+
+  void FitsByteSwap::setKernel(Kernel kernel) {
+    if (!isSupported(kernel))
+      throw TipException(std::string("FitsByteSwap::setKernel: this processor does not support the ") +
+        getKernelName(kernel) + " kernel");
+    s_getKernel().store(findKernel(kernel));
+  }
+
+  bool FitsByteSwap::isSupported(Kernel kernel) {
+    switch (kernel) {
+      case eScalar: return true;
+#ifdef TIP_X86_KERNELS
+      case eSse2: return 0 != __builtin_cpu_supports("sse2");
+      case eAvx2: return 0 != __builtin_cpu_supports("avx2");
+#endif
+      default: return false;
+    }
+  }
+
+  const char * FitsByteSwap::getKernelName(Kernel kernel) {
+    switch (kernel) {
+      case eSse2: return "SSE2";
+      case eAvx2: return "AVX2";
+      default: return "scalar";
+    }
+  }
+
+  void FitsByteSwap::toNative(const void * src, std::size_t value_size, std::size_t num_values, void * dest) {
+    const unsigned char * src_bytes = static_cast<const unsigned char *>(src);
+    unsigned char * dest_bytes = static_cast<unsigned char *>(dest);
+    const SwapKernel * kernel = s_getKernel().load();
+    switch (value_size) {
+      case 1: if (src != dest) std::memmove(dest, src, num_values); break;
+      case 2: kernel->m_swap_2(src_bytes, num_values, dest_bytes); break;
+      case 4: kernel->m_swap_4(src_bytes, num_values, dest_bytes); break;
+      case 8: kernel->m_swap_8(src_bytes, num_values, dest_bytes); break;
+      default: throw TipException("FitsByteSwap::toNative: values must be 1, 2, 4 or 8 bytes wide");
+    }
+  }
+
+  void FitsByteSwap::gather(const unsigned char * src, std::size_t stride, std::size_t value_size, std::size_t num_values,
+    unsigned char * dest) {
+    // Fixed sizes let the compiler copy each value with a single load and store.
+    switch (value_size) {
+      case 1: for (std::size_t ii = 0; ii != num_values; ++ii, src += stride) dest[ii] = *src; break;
+      case 2: for (std::size_t ii = 0; ii != num_values; ++ii, src += stride, dest += 2) std::memcpy(dest, src, 2); break;
+      case 4: for (std::size_t ii = 0; ii != num_values; ++ii, src += stride, dest += 4) std::memcpy(dest, src, 4); break;
+      case 8: for (std::size_t ii = 0; ii != num_values; ++ii, src += stride, dest += 8) std::memcpy(dest, src, 8); break;
+      default:
+        for (std::size_t ii = 0; ii != num_values; ++ii, src += stride, dest += value_size) std::memcpy(dest, src, value_size);
+        break;
+    }
+  }
+
+}
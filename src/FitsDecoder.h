@@ -0,0 +1,287 @@
+/** \file FitsDecoder.h
+
+    \brief Conversion of raw big-endian FITS data to native values, using vectorized byte-swap kernels.
+    These classes are not part of the API.
+*/
+#ifndef tip_FitsDecoder_h
+#define tip_FitsDecoder_h
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <type_traits>
+
+#include "fitsio.h"
+
+#include "FitsPrimProps.h"
+#include "tip/TipException.h"
+#include "tip/tip_types.h"
+
+namespace tip {
+
+  /** \class FitsByteSwap
+
+      \brief Kernels which convert arrays of big-endian values to native byte order. The fastest kernel the
+      processor supports (AVX2, SSE2 or portable scalar code) is selected the first time one is used.
+  */
+  class FitsByteSwap {
+    public:
+      enum Kernel { eScalar, eSse2, eAvx2 };
+
+      /** \brief Return the kernel currently in use.
+      */
+      static Kernel getKernel();
+
+      /** \brief Return the fastest kernel this processor supports.
+      */
+      static Kernel getBestKernel();
+
+      /** \brief Select the kernel to use, for example to compare kernels. Throws if the processor does not
+          support the kernel. The selection may be changed while other threads read data: each call in progress uses
+          either the old or the new kernel, and all kernels give the same results.
+          \param kernel The kernel.
+      */
+      static void setKernel(Kernel kernel);
+
+      /** \brief Return true if this processor supports the given kernel.
+          \param kernel The kernel.
+      */
+      static bool isSupported(Kernel kernel);
+
+      /** \brief Return a short name for the given kernel, for reports.
+          \param kernel The kernel.
+      */
+      static const char * getKernelName(Kernel kernel);
+
+      /** \brief Convert contiguous big-endian values to native byte order. Source and destination may be the same.
+          \param src The big-endian values.
+          \param value_size The size of each value in bytes: 1, 2, 4 or 8.
+          \param num_values The number of values.
+          \param dest The native values.
+      */
+      static void toNative(const void * src, std::size_t value_size, std::size_t num_values, void * dest);
+
+      /** \brief Copy values which are stride bytes apart (for example one field of consecutive table rows) into
+          a contiguous array, without changing their byte order.
+          \param src The first value.
+          \param stride The distance in bytes between values.
+          \param value_size The size of each value in bytes.
+          \param num_values The number of values.
+          \param dest The contiguous values.
+      */
+      static void gather(const unsigned char * src, std::size_t stride, std::size_t value_size, std::size_t num_values,
+        unsigned char * dest);
+  };
+
+  /** \brief Decode one big-endian FITS value.
+  */
+  template <typename Raw>
+  inline void decodeBigEndian(const unsigned char * src, Raw & dest) {
+    unsigned char bytes[sizeof(Raw)];
+    for (std::size_t ii = 0; ii != sizeof(Raw); ++ii) bytes[ii] = src[sizeof(Raw) - 1 - ii];
+    std::memcpy(&dest, bytes, sizeof(Raw));
+  }
+
+  /** \brief The type cfitsio converts to when reading into the given type. Characters are read as TBYTE.
+  */
+  template <typename U> struct FitsDecodeTarget { typedef U Type; };
+  template <> struct FitsDecodeTarget<char> { typedef unsigned char Type; };
+  template <> struct FitsDecodeTarget<signed char> { typedef unsigned char Type; };
+
+  /** \class FitsDecoder
+
+      \brief Converts raw FITS values of one type to any numeric type, applying scaling (TSCALn/TZEROn or
+      BSCALE/BZERO) and null values (TNULLn, NaN) the way cfitsio does when reading into that type.
+  */
+  class FitsDecoder {
+    public:
+      /** \brief Create a decoder for values of the given type.
+          \param type_code The cfitsio code of the stored type: TBYTE, TSHORT, TLONG (32 bits), TLONGLONG, TFLOAT or TDOUBLE.
+          \param scale The scale factor.
+          \param zero The offset added after scaling.
+          \param check_nulls Whether to check for null values at all. Image reads do not check.
+          \param has_null Whether the integer null value is defined.
+          \param null_value The integer null value.
+      */
+      FitsDecoder(int type_code = TBYTE, double scale = 1., double zero = 0., bool check_nulls = false,
+        bool has_null = false, long long null_value = 0): m_type_code(type_code), m_scale(scale), m_zero(zero),
+        m_null_value(null_value), m_scaled(1. != scale || 0. != zero), m_check_nulls(check_nulls), m_has_null(has_null) {}
+
+      /** \brief Return true if values of the given cfitsio type can be decoded.
+          \param type_code The cfitsio type code, as reported by fits_get_coltype.
+      */
+      static bool isSupported(int type_code) {
+        switch (type_code) {
+          case TBYTE: case TSHORT: case TLONG: case TLONGLONG: case TFLOAT: case TDOUBLE: return true;
+          default: return false;
+        }
+      }
+
+      /** \brief Return the type code of the values stored in an image with the given BITPIX, or 0 if there is none.
+          \param bitpix The value of BITPIX.
+      */
+      static int getImageTypeCode(int bitpix) {
+        switch (bitpix) {
+          case BYTE_IMG: return TBYTE;
+          case SHORT_IMG: return TSHORT;
+          case LONG_IMG: return TLONG;
+          case LONGLONG_IMG: return TLONGLONG;
+          case FLOAT_IMG: return TFLOAT;
+          case DOUBLE_IMG: return TDOUBLE;
+          default: return 0;
+        }
+      }
+
+      /** \brief Return the size of each stored value in bytes.
+      */
+      Index_t getWidth() const {
+        switch (m_type_code) {
+          case TBYTE: return 1;
+          case TSHORT: return 2;
+          case TLONG: case TFLOAT: return 4;
+          default: return 8;
+        }
+      }
+
+      /** \brief Return true if the stored value is null.
+          \param src The stored value.
+      */
+      bool isNull(const unsigned char * src) const {
+        switch (m_type_code) {
+          case TBYTE: return isNullAs<unsigned char>(src);
+          case TSHORT: return isNullAs<short>(src);
+          case TLONG: return isNullAs<int>(src);
+          case TLONGLONG: return isNullAs<long long>(src);
+          case TFLOAT: return isNullAs<float>(src);
+          default: return isNullAs<double>(src);
+        }
+      }
+
+      /** \brief Decode and convert values which are stride bytes apart. Null values become the undefined value for
+          the output type, or are flagged if null_flags is given.
+          \param src The first stored value.
+          \param stride The distance in bytes between stored values.
+          \param num_values The number of values.
+          \param dest The converted values.
+          \param null_flags Optional flags, set to 1 for null values and 0 otherwise.
+      */
+      template <typename U>
+      void decode(const unsigned char * src, Index_t stride, Index_t num_values, U * dest, char * null_flags = 0) const {
+        switch (m_type_code) {
+          case TBYTE: decodeAs<unsigned char>(src, stride, num_values, dest, null_flags); break;
+          case TSHORT: decodeAs<short>(src, stride, num_values, dest, null_flags); break;
+          case TLONG: decodeAs<int>(src, stride, num_values, dest, null_flags); break;
+          case TLONGLONG: decodeAs<long long>(src, stride, num_values, dest, null_flags); break;
+          case TFLOAT: decodeAs<float>(src, stride, num_values, dest, null_flags); break;
+          default: decodeAs<double>(src, stride, num_values, dest, null_flags); break;
+        }
+      }
+
+    private:
+      template <typename Raw>
+      bool isNullValue(const Raw & raw) const {
+        return m_check_nulls && (std::numeric_limits<Raw>::is_integer ? m_has_null && m_null_value == raw : raw != raw);
+      }
+
+      template <typename Raw>
+      bool isNullAs(const unsigned char * src) const {
+        Raw raw;
+        decodeBigEndian(src, raw);
+        return isNullValue(raw);
+      }
+
+      /** \brief Convert a value the way cfitsio does, truncating toward zero and failing if it overflows the
+          type cfitsio would read into.
+      */
+      template <typename Src, typename U>
+      static void convertValue(const Src & src, U & dest) {
+        typedef typename FitsDecodeTarget<U>::Type Dest;
+        typedef std::numeric_limits<Dest> Limits;
+        if (Limits::is_integer) {
+          // Skip the check when every value of the source type fits.
+          if (!std::numeric_limits<Src>::is_integer || sizeof(Src) > sizeof(Dest) ||
+            (sizeof(Src) == sizeof(Dest) && std::numeric_limits<Src>::is_signed != Limits::is_signed) ||
+            (std::numeric_limits<Src>::is_signed && !Limits::is_signed)) {
+            long double value = src;
+            if (value != value) {
+              // Unchecked NaN has no integer value.
+              dest = U();
+              return;
+            }
+            if (!(value > static_cast<long double>(Limits::min()) - 1.L && value < static_cast<long double>(Limits::max()) + 1.L))
+              throw TipException(NUM_OVERFLOW, "FitsDecoder::convertValue: value is out of range for the output type");
+          }
+        } else if (std::numeric_limits<Src>::has_infinity && Src(Limits::max()) < std::numeric_limits<Src>::max()) {
+          // Only double -> float can overflow. Infinities pass through.
+          Src inf = std::numeric_limits<Src>::infinity();
+          if ((src > Src(Limits::max()) || src < -Src(Limits::max())) && src != inf && src != -inf)
+            throw TipException(NUM_OVERFLOW, "FitsDecoder::convertValue: value is out of range for the output type");
+        }
+        dest = static_cast<U>(static_cast<Dest>(src));
+      }
+
+      template <typename Raw, typename U>
+      void decodeAs(const unsigned char * src, Index_t stride, Index_t num_values, U * dest, char * null_flags) const {
+        // Values of the stored type with nothing to check are swapped straight into the destination.
+        if (std::is_same<Raw, U>::value && !m_scaled && !(m_check_nulls && (m_has_null || !std::numeric_limits<Raw>::is_integer))) {
+          if (Index_t(sizeof(Raw)) != stride)
+            FitsByteSwap::gather(src, stride, sizeof(Raw), num_values, reinterpret_cast<unsigned char *>(dest));
+          else
+            std::memcpy(dest, src, num_values * sizeof(Raw));
+          FitsByteSwap::toNative(dest, sizeof(Raw), num_values, dest);
+          if (0 != null_flags) std::fill(null_flags, null_flags + num_values, 0);
+          return;
+        }
+
+        // Otherwise swap blocks which stay in cache, then check and convert them.
+        static const Index_t s_block_size = 1024;
+        Raw raw[s_block_size];
+        const U & undefined(FitsPrimProps<U>::undefined());
+        for (Index_t block_begin = 0; block_begin < num_values; block_begin += s_block_size) {
+          Index_t block_size = std::min(s_block_size, num_values - block_begin);
+          const unsigned char * block_src = src + block_begin * stride;
+          if (Index_t(sizeof(Raw)) != stride) {
+            FitsByteSwap::gather(block_src, stride, sizeof(Raw), block_size, reinterpret_cast<unsigned char *>(raw));
+            FitsByteSwap::toNative(raw, sizeof(Raw), block_size, raw);
+          } else {
+            FitsByteSwap::toNative(block_src, sizeof(Raw), block_size, raw);
+          }
+
+          U * block_dest = dest + block_begin;
+          char * block_null_flags = 0 == null_flags ? 0 : null_flags + block_begin;
+          for (Index_t ii = 0; ii != block_size; ++ii) {
+            if (isNullValue(raw[ii])) {
+              if (0 != block_null_flags) {
+                block_null_flags[ii] = 1;
+                block_dest[ii] = U();
+                continue;
+              } else if (U() != undefined) {
+                block_dest[ii] = undefined;
+                continue;
+              } else if (raw[ii] != raw[ii]) {
+                block_dest[ii] = U();
+                continue;
+              }
+            } else if (0 != block_null_flags) {
+              block_null_flags[ii] = 0;
+            }
+            if (m_scaled) convertValue(raw[ii] * m_scale + m_zero, block_dest[ii]);
+            else convertValue(raw[ii], block_dest[ii]);
+          }
+        }
+      }
+
+      int m_type_code;
+      double m_scale;
+      double m_zero;
+      long long m_null_value;
+      bool m_scaled;
+      bool m_check_nulls;
+      bool m_has_null;
+  };
+
+}
+
+#endif
@@ -5,19 +5,127 @@
     \author James Peachey, HEASARC
 */
 
+#include <cctype>
 #include <cstddef>
 #include <cstdio>
+#include <cstdlib>
 #include <cstring>
 #include <iostream>
 #include <exception>
+#include <map>
+#include <mutex>
 
+#include <sys/stat.h>
+
+#include "FitsChecksum.h"
 #include "FitsFileManager.h"
+#include "FitsFilePool.h"
 #include "FitsTipFile.h"
 #include "fitsio.h"
 #include "tip/FileSummary.h"
+#include "tip/IFileSvc.h"
 #include "tip/Image.h"
 #include "tip/TipException.h"
 
+namespace {
+
+  /// \brief The summary of a FITS file, with the properties which show whether the file has changed since.
+  struct CachedSummary {
+    unsigned long long m_device;
+    unsigned long long m_inode;
+    long long m_size;
+    long long m_mtime;
+    tip::FileSummary m_summary;
+  };
+
+  typedef std::map<std::string, CachedSummary> SummaryCont_t;
+
+  // The cache holds at most this many files; it is emptied when it is full.
+  const SummaryCont_t::size_type s_max_summaries = 256;
+
+  std::mutex & s_getSummaryMutex() {
+    static std::mutex s_summary_mutex;
+    return s_summary_mutex;
+  }
+
+  SummaryCont_t & s_getSummaries() {
+    static SummaryCont_t s_summaries;
+    return s_summaries;
+  }
+
+  // Extensions whose checksums are to be updated by finalizeChecksums, by file and extension number, noting
+  // whether the data, and not only the header, changed.
+  typedef std::map<std::string, std::map<int, bool> > PendingCont_t;
+
+  std::mutex & s_getChecksumMutex() {
+    static std::mutex s_checksum_mutex;
+    return s_checksum_mutex;
+  }
+
+  PendingCont_t & s_getPendingChecksums() {
+    static PendingCont_t s_pending_checksums;
+    return s_pending_checksums;
+  }
+
+  unsigned long long & s_getNumChecksumBytes() {
+    static unsigned long long s_num_checksum_bytes = 0;
+    return s_num_checksum_bytes;
+  }
+
+  /** \brief Return the canonical name of a plain FITS file, and fill in its current state, or return "" if the
+      name uses cfitsio's extended syntax, whose summary may differ from that of the file, or names no regular file.
+  */
+  std::string getSummaryKey(const std::string & file_name, CachedSummary & state) {
+    if (file_name.empty() || "-" == file_name || std::string::npos != file_name.find_first_of("[](){}!|*?$") ||
+      std::string::npos != file_name.find("://"))
+      return std::string();
+
+    struct stat file_status;
+    if (0 != stat(file_name.c_str(), &file_status) || !S_ISREG(file_status.st_mode)) return std::string();
+    char * path = realpath(file_name.c_str(), 0);
+    if (0 == path) return std::string();
+    std::string key(path);
+    std::free(path);
+
+    state.m_device = file_status.st_dev;
+    state.m_inode = file_status.st_ino;
+    state.m_size = file_status.st_size;
+    state.m_mtime = file_status.st_mtime;
+    return key;
+  }
+
+  /** \brief Look up the summary of a file, which is used only if the file is in the same state as when it was
+      summarized. The summary is copied only if the summary argument is not 0.
+  */
+  bool lookUpSummary(const std::string & key, const CachedSummary & state, tip::FileSummary * summary) {
+    if (key.empty()) return false;
+    std::lock_guard<std::mutex> lock(s_getSummaryMutex());
+    SummaryCont_t & summaries(s_getSummaries());
+    SummaryCont_t::iterator itor = summaries.find(key);
+    if (itor == summaries.end()) return false;
+    const CachedSummary & cached(itor->second);
+    if (cached.m_device != state.m_device || cached.m_inode != state.m_inode || cached.m_size != state.m_size ||
+      cached.m_mtime != state.m_mtime) {
+      summaries.erase(itor);
+      return false;
+    }
+    if (0 != summary) *summary = cached.m_summary;
+    return true;
+  }
+
+  /// \brief Store the summary of a file, with the state the file was in before it was opened to summarize it.
+  void storeSummary(const std::string & key, const CachedSummary & state, const tip::FileSummary & summary) {
+    if (key.empty()) return;
+    std::lock_guard<std::mutex> lock(s_getSummaryMutex());
+    SummaryCont_t & summaries(s_getSummaries());
+    if (summaries.size() >= s_max_summaries) summaries.clear();
+    CachedSummary & cached(summaries[key]);
+    cached = state;
+    cached.m_summary = summary;
+  }
+
+}
+
 namespace tip {
 
   // Create a FITS file optionally using a template. File is closed afterwards.
@@ -36,7 +144,9 @@ namespace tip {
     if (!template_name.empty()) {
       full_name += "(" + template_name + ")";
 
-      // Create the file.
+      // Create the file, first closing any pooled copy of the file being replaced.
+      forgetSummary(full_name);
+      FitsFilePool::instance().discard(full_name);
       fits_create_file(&fp, const_cast<char *>(full_name.c_str()), &status);
     } else {
       // No template: need to create primary image explicitly.
@@ -51,26 +161,50 @@ namespace tip {
       throw TipException(status, "Unable to create file named \"" + full_name + "\"");
   }
 
+  void FitsFileManager::createFile(const std::string & file_name, ImageBase::PixelType pixel_type,
+    const ImageBase::PixelCoordinate & dims, double scale, double zero, bool clobber) {
+    // Handle clobber by prepending a bang or not.
+    std::string full_name = clobber ? "!" + file_name : file_name;
+
+    // Create the file and close it; errors are reported by createFile.
+    fitsfile * fp = createFile(full_name, "PRIMARY", dims, pixel_type, scale, zero);
+    closeFile(fp, true, 0);
+  }
+
   TipFile FitsFileManager::createMemFile(const std::string & file_name, const std::string & template_name, bool clobber) {
     return TipFile(new FitsTipFile("mem://" + file_name, template_name, clobber));
   }
 
   void FitsFileManager::appendImage(const std::string & file_name, const std::string & image_name,
-    const ImageBase::PixelCoordinate & dims) {
+    const ImageBase::PixelCoordinate & dims, ImageBase::PixelType pixel_type, double scale, double zero,
+    const ImageCompression & compression) {
+    // Only GZIP can compress floating point pixels without quantizing them.
+    ImageCompression::Algorithm algorithm = compression.getAlgorithm();
+    bool floating = ImageBase::eFloat == pixel_type || ImageBase::eDouble == pixel_type;
+    if (compression.isCompressed() && floating && 0.f == compression.getQuantizeLevel() &&
+      ImageCompression::eGzip != algorithm && ImageCompression::eGzip2 != algorithm)
+      throw TipException("Unable to create image named \"" + image_name + "\" in file \"" + file_name +
+        "\": floating point pixels can only be compressed losslessly with GZIP");
+
     fitsfile * fp = 0;
     int status = 0;
 
     // Open or create the file.
-    fits_open_file(&fp, const_cast<char *>(file_name.c_str()), READWRITE, &status);
+    forgetSummary(file_name);
+    int first_hdu = 1;
+    fp = FitsFilePool::instance().open(file_name, "", READWRITE, status);
     if (0 != status) {
       status = 0;
-      fp = createFile(file_name, image_name, dims);
+      fp = createFile(file_name, image_name, dims, pixel_type, scale, zero, compression);
     } else {
-      fp = createImage(fp, file_name, image_name, dims);
+      // Only the new image, after the existing extensions, has changed.
+      fits_get_num_hdus(fp, &first_hdu, &status);
+      ++first_hdu;
+      fp = createImage(fp, file_name, image_name, dims, pixel_type, scale, zero, compression);
     }
 
     // Close the file; not interested in it anymore.
-    closeFile(fp, true, status);
+    closeFile(fp, true, status, first_hdu);
     if (0 != status)
       throw TipException(status, "Unable to close appended image named \"" + image_name + "\" in file \"" + file_name + "\"");
   }
@@ -80,7 +214,9 @@ namespace tip {
     int status = 0;
 
     // Open or create the file.
-    fits_open_file(&fp, const_cast<char *>(file_name.c_str()), READWRITE, &status);
+    forgetSummary(file_name);
+    int first_hdu = 1;
+    fp = FitsFilePool::instance().open(file_name, "", READWRITE, status);
     if (0 != status) {
       ImageBase::PixelCoordinate dims;
       status = 0;
@@ -89,13 +225,17 @@ namespace tip {
         closeFile(fp, false, status);
         throw TipException(status, "Unable to open or create file named \"" + file_name + "\"");
       }
+    } else {
+      // Only the new table, after the existing extensions, has changed.
+      fits_get_num_hdus(fp, &first_hdu, &status);
+      ++first_hdu;
     }
 
     // Create new table extension at end of file.
     fits_create_tbl(fp, BINARY_TBL, 0, 0, 0, 0, 0, const_cast<char *>(table_name.c_str()), &status);
 
     // Close the file; not interested in it anymore.
-    closeFile(fp, true, status);
+    closeFile(fp, true, status, first_hdu);
 
     if (0 != status)
       throw TipException(status, "Unable to create table named \"" + table_name + "\" in file \"" + file_name + "\"");
@@ -108,11 +248,16 @@ namespace tip {
     // Clear out summary.
     summary.clear();
 
+    // Use the summary made when the file was last opened, if the file has not changed since.
+    CachedSummary state = CachedSummary();
+    std::string key = getSummaryKey(file_name, state);
+    if (lookUpSummary(key, state, &summary)) return;
+
     // Open the file, and complain if it doesn't work:
-    fits_open_file(&fp, const_cast<char *>(file_name.c_str()), READONLY, &status);
+    fp = FitsFilePool::instance().open(file_name, "", READONLY, status);
     if (0 != status)
       throw TipException(status, std::string("Unable to open file named \"") + file_name + "\" with read only access");
-    
+
     // Make sure we scan starting from the first extension, regardless of the full file name used.
     fits_movabs_hdu(fp, 1, 0, &status);
     if (0 != status) {
@@ -120,59 +265,131 @@ namespace tip {
       throw TipException(status, std::string("Unable to move to primary HDU in file named \"") + file_name);
     }
 
-    // String to hold each extension's identity.
-    std::string ext_id;
-
-    while (0 == status) {
-      // Get identifier of current extension, and add that info to the summary.
-      getExtId(fp, ext_id);
-      summary.push_back(ExtSummary(ext_id));
+    readFileSummary(fp, summary, status);
 
-      // Go on to next extension.
-      fits_movrel_hdu(fp, 1, 0, &status);
-    }
     // Clean up.
     closeFile(fp, false, status);
 
     // Flag any condition other than 0 and EOF.
     if (0 != status && END_OF_FILE != status)
       throw TipException(status, std::string("FitsFileManager::getFileSummary had trouble making summary of file ") + file_name);
+
+    storeSummary(key, state, summary);
   }
 
   bool FitsFileManager::isValid(const std::string & file_name) {
+    // A file summarized since it last changed is known to be valid.
+    CachedSummary state = CachedSummary();
+    std::string key = getSummaryKey(file_name, state);
+    if (lookUpSummary(key, state, 0)) return true;
+
     fitsfile * fp = 0;
     int status = 0;
-    fits_open_file(&fp, const_cast<char *>(file_name.c_str()), READONLY, &status);
+    fp = FitsFilePool::instance().open(file_name, "", READONLY, status);
     if (0 != status) return false;
-    closeFile(fp, false, status);
+
+    // Summarize the file while it is open, so that listing or opening its extensions need not open it again.
+    if (!key.empty()) {
+      FileSummary summary;
+      fits_movabs_hdu(fp, 1, 0, &status);
+      readFileSummary(fp, summary, status);
+      if (END_OF_FILE == status) storeSummary(key, state, summary);
+    }
+    closeFile(fp, false, 0);
+    return true;
+  }
+
+  bool FitsFileManager::findExtension(const std::string & file_name, const std::string & ext_name,
+    ExtSummary & ext_summary) {
+    // Leave extended syntax, such as version numbers or types, to cfitsio.
+    if (std::string::npos != ext_name.find_first_of("[](){},;#+*? ")) return false;
+
+    CachedSummary state = CachedSummary();
+    std::string key = getSummaryKey(file_name, state);
+    FileSummary summary;
+    if (!lookUpSummary(key, state, &summary) && !(isValid(file_name) && lookUpSummary(key, state, &summary)))
+      return false;
+
+    // Resolve the name as cfitsio does: by number, counting the primary array as 0, or by name, ignoring case,
+    // where PRIMARY and P name the primary array.
+    bool is_number = !ext_name.empty();
+    std::string upper_name(ext_name);
+    for (std::string::iterator itor = upper_name.begin(); itor != upper_name.end(); ++itor) {
+      if (0 == std::isdigit(static_cast<unsigned char>(*itor))) is_number = false;
+      *itor = std::toupper(static_cast<unsigned char>(*itor));
+    }
+
+    FileSummary::size_type index = summary.size();
+    if (upper_name.empty() || "PRIMARY" == upper_name || "P" == upper_name) {
+      index = 0;
+    } else if (is_number) {
+      index = std::strtoul(ext_name.c_str(), 0, 10);
+    } else {
+      for (index = 0; index != summary.size(); ++index) {
+        std::string upper_id(summary[index].getExtId());
+        for (std::string::iterator itor = upper_id.begin(); itor != upper_id.end(); ++itor)
+          *itor = std::toupper(static_cast<unsigned char>(*itor));
+        if (upper_id == upper_name) break;
+      }
+    }
+    if (index >= summary.size()) return false;
+    ext_summary = summary[index];
     return true;
   }
 
+  void FitsFileManager::forgetSummary(const std::string & file_name) {
+    // Forget the file itself, however it is named.
+    std::string::size_type begin = file_name.compare(0, 1, "!") ? 0 : 1;
+    std::string::size_type end = file_name.find_first_of("[(", begin);
+    CachedSummary state = CachedSummary();
+    std::string key = getSummaryKey(file_name.substr(begin, std::string::npos == end ? end : end - begin), state);
+    if (key.empty()) return;
+    std::lock_guard<std::mutex> lock(s_getSummaryMutex());
+    s_getSummaries().erase(key);
+  }
+
   fitsfile * FitsFileManager::createFile(const std::string & file_name, const std::string & image_name,
-    const ImageBase::PixelCoordinate & dims) {
+    const ImageBase::PixelCoordinate & dims, ImageBase::PixelType pixel_type, double scale, double zero,
+    const ImageCompression & compression) {
     fitsfile * fp = 0;
     int status = 0;
 
-    // Create the file.
+    // Create the file, first closing any pooled copy of the file being replaced.
+    forgetSummary(file_name);
+    FitsFilePool::instance().discard(file_name);
     fits_create_file(&fp, const_cast<char *>(file_name.c_str()), &status);
     if (0 != status) {
       closeFile(fp, false, status);
       throw TipException(status, "Unable to create file named \"" + file_name + "\"");
     }
 
-    return createImage(fp, file_name, image_name, dims);
+    return createImage(fp, file_name, image_name, dims, pixel_type, scale, zero, compression);
   }
 
   fitsfile * FitsFileManager::createImage(fitsfile * fp, const std::string & file_name, const std::string & image_name,
-    const ImageBase::PixelCoordinate & dims) {
+    const ImageBase::PixelCoordinate & dims, ImageBase::PixelType pixel_type, double scale, double zero,
+    const ImageCompression & compression) {
     int status = 0;
 
+    if (compression.isCompressed()) {
+      // Compressed images are stored in binary tables, so a new file needs an empty primary array first.
+      int num_hdus = 0;
+      fits_get_num_hdus(fp, &num_hdus, &status);
+      if (0 == status && 0 == num_hdus) fits_create_img(fp, FLOAT_IMG, 0, 0, &status);
+      setCompression(fp, compression, status);
+      if (0 != status) {
+        closeFile(fp, false, status);
+        throw TipException(status, std::string("Unable to set up compression of image named \"") + image_name +
+          "\" in file \"" + file_name + "\"");
+      }
+    }
+
     // Copy the coordinates to a C-passable form.
     PixOrd_t * dims_tmp = new PixOrd_t[dims.size()];
     for (std::size_t ii = 0; ii != dims.size(); ++ii) dims_tmp[ii] = dims[ii];
 
     // Create new image extension at end of file.
-    fits_create_img(fp, FLOAT_IMG, dims.size(), dims_tmp, &status);
+    fits_create_img(fp, pixel_type, dims.size(), dims_tmp, &status);
 
     // Clean up temporary C array.
     delete [] dims_tmp;
@@ -201,9 +418,44 @@ namespace tip {
       throw TipException(status, std::string("Unable to name image in file \"") + file_name + "\"");
     }
 
+    // Write the scaling only if it is not the default, as cfitsio does.
+    if (1. != scale || 0. != zero) {
+      fits_update_key(fp, TDOUBLE, "BSCALE", &scale, const_cast<char *>("physical = BZERO + BSCALE * stored"), &status);
+      fits_update_key(fp, TDOUBLE, "BZERO", &zero, const_cast<char *>("physical = BZERO + BSCALE * stored"), &status);
+      if (0 != status) {
+        closeFile(fp, false, status);
+        throw TipException(status, std::string("Unable to write scaling of image named \"") + image_name +
+          "\" in file \"" + file_name + "\"");
+      }
+    }
+
     return fp;
   }
 
+  void FitsFileManager::setCompression(fitsfile * fp, const ImageCompression & compression, int & status) {
+    int type = 0;
+    switch (compression.getAlgorithm()) {
+      case ImageCompression::eRice: type = RICE_1; break;
+      case ImageCompression::eGzip: type = GZIP_1; break;
+      case ImageCompression::eGzip2: type = GZIP_2; break;
+      case ImageCompression::eHCompress: type = HCOMPRESS_1; break;
+      case ImageCompression::ePlio: type = PLIO_1; break;
+      default: type = NOCOMPRESS; break;
+    }
+
+    fits_set_compression_type(fp, type, &status);
+    const ImageBase::PixelCoordinate & tile_shape(compression.getTileShape());
+    if (!tile_shape.empty()) {
+      std::vector<long> tile_dims(tile_shape.begin(), tile_shape.end());
+      fits_set_tile_dim(fp, tile_dims.size(), &tile_dims[0], &status);
+    }
+    fits_set_quantize_level(fp, compression.getQuantizeLevel(), &status);
+    if (HCOMPRESS_1 == type) {
+      fits_set_hcomp_scale(fp, compression.getHCompressScale(), &status);
+      fits_set_hcomp_smooth(fp, compression.getHCompressSmooth() ? 1 : 0, &status);
+    }
+  }
+
   void FitsFileManager::getExtId(fitsfile * fp, std::string & ext_id) {
     int status = 0;
 
@@ -226,11 +478,69 @@ namespace tip {
     ext_id = tmp_id;
   }
 
-  void FitsFileManager::closeFile(fitsfile *fp, bool update_checksum, int status) {
+  ExtSummary FitsFileManager::getExtSummary(fitsfile * fp, int & status) {
+    std::string ext_id;
+    getExtId(fp, ext_id);
+
+    int hdu_type = 0;
+    fits_get_hdu_type(fp, &hdu_type, &status);
+    LONGLONG header_start = 0;
+    LONGLONG data_start = 0;
+    LONGLONG data_end = 0;
+    fits_get_hduaddrll(fp, &header_start, &data_start, &data_end, &status);
+
+    ExtSummary::ExtType ext_type = ExtSummary::eUnknown;
+    LONGLONG num_records = 0;
+    std::vector<PixOrd_t> image_dims;
+    std::vector<std::string> field_names;
+    if (IMAGE_HDU == hdu_type) {
+      // This includes tile-compressed images, whose size cfitsio reports as that of the image.
+      ext_type = ExtSummary::eImage;
+      int num_dims = 0;
+      fits_get_img_dim(fp, &num_dims, &status);
+      if (0 == status && 0 < num_dims) {
+        std::vector<long> dims(num_dims);
+        fits_get_img_size(fp, num_dims, &dims[0], &status);
+        image_dims.assign(dims.begin(), dims.end());
+      }
+    } else if (ASCII_TBL == hdu_type || BINARY_TBL == hdu_type) {
+      ext_type = ASCII_TBL == hdu_type ? ExtSummary::eAsciiTable : ExtSummary::eBinaryTable;
+      fits_get_num_rowsll(fp, &num_records, &status);
+      int num_cols = 0;
+      fits_get_num_cols(fp, &num_cols, &status);
+      for (int col_num = 1; 0 == status && col_num <= num_cols; ++col_num) {
+        // Field names are lowercased, as tables give them.
+        char key_name[FLEN_KEYWORD];
+        char col_name[FLEN_VALUE] = "";
+        sprintf(key_name, "TTYPE%d", col_num);
+        int key_status = 0;
+        fits_read_key(fp, TSTRING, key_name, col_name, 0, &key_status);
+        for (char * itor = col_name; '\0' != *itor; ++itor) *itor = std::tolower(static_cast<unsigned char>(*itor));
+        field_names.push_back(col_name);
+      }
+    }
+    return ExtSummary(ext_id, ext_type, num_records, data_end - data_start, image_dims, field_names);
+  }
+
+  void FitsFileManager::readFileSummary(fitsfile * fp, FileSummary & summary, int & status) {
+    while (0 == status) {
+      // Add the summary of the current extension, then go on to the next extension.
+      summary.push_back(getExtSummary(fp, status));
+      fits_movrel_hdu(fp, 1, 0, &status);
+    }
+  }
+
+  void FitsFileManager::closeFile(fitsfile *fp, bool update_checksum, int status, int first_hdu) {
     if (update_checksum && 0 == status) {
-      //int ignored_status = 0;
-      for (int ii = 1; 0 == fits_movabs_hdu(fp, ii, 0, &status) && ii <= fp->Fptr->maxhdu; ++ii) {
-        if (0 != fits_write_chksum(fp, &status)) {
+      // Unless every checksum is to be updated, only the extensions from first_hdu on, which are new, need it.
+      if (IFileSvc::eChecksumAlways == IFileSvc::getChecksumPolicy()) first_hdu = 1;
+      char file_name[FLEN_FILENAME] = "";
+      int num_hdus = 0;
+      fits_file_name(fp, file_name, &status);
+      fits_get_num_hdus(fp, &num_hdus, &status);
+      for (int ii = first_hdu; ii <= num_hdus && 0 == fits_movabs_hdu(fp, ii, 0, &status); ++ii) {
+        updateChecksum(fp, file_name, true, true, status);
+        if (0 != status) {
 	  if (VALUE_UNDEFINED != status) {
 	  throw TipException(status, "FitsFileManager::closeFile could not update checksum.");
 	  }
@@ -243,6 +553,98 @@ namespace tip {
       //Add checks to ensure status is expected ~JA
       status=0;
     }
-    fits_close_file(fp, &status);
+    FitsFilePool::instance().close(fp, status);
+  }
+
+  void FitsFileManager::updateChecksum(fitsfile * fp, const std::string & file_name, bool header_modified,
+    bool data_modified, int & status) {
+    IFileSvc::ChecksumPolicy policy = IFileSvc::getChecksumPolicy();
+    if (IFileSvc::eChecksumAlways == policy) {
+      writeChecksum(fp, true, status);
+      return;
+    }
+    if (!header_modified && !data_modified) return;
+
+    if (IFileSvc::eChecksumDeferred == policy) {
+      // Note the extension, so that finalizeChecksums can update it; a file which cannot be named again, such as a
+      // file in memory, is updated now.
+      CachedSummary state = CachedSummary();
+      std::string key = getSummaryKey(file_name, state);
+      int hdu_num = 0;
+      fits_get_hdu_num(fp, &hdu_num);
+      if (!key.empty() && 0 < hdu_num) {
+        std::lock_guard<std::mutex> lock(s_getChecksumMutex());
+        bool & pending_data(s_getPendingChecksums()[key][hdu_num]);
+        pending_data = pending_data || data_modified;
+        return;
+      }
+    }
+    writeChecksum(fp, data_modified, status);
+  }
+
+  void FitsFileManager::finalizeChecksums() {
+    PendingCont_t pending;
+    {
+      std::lock_guard<std::mutex> lock(s_getChecksumMutex());
+      pending.swap(s_getPendingChecksums());
+    }
+
+    // Update every file, and report the first one which could not be updated.
+    std::string failed_file;
+    int failed_status = 0;
+    for (PendingCont_t::iterator file_itor = pending.begin(); file_itor != pending.end(); ++file_itor) {
+      int status = 0;
+      fitsfile * fp = FitsFilePool::instance().open(file_itor->first, "", READWRITE, status);
+      if (0 != status) {
+        if (failed_file.empty()) { failed_file = file_itor->first; failed_status = status; }
+        continue;
+      }
+      for (std::map<int, bool>::iterator hdu_itor = file_itor->second.begin(); hdu_itor != file_itor->second.end();
+        ++hdu_itor) {
+        // An extension which no longer exists belongs to a file which was replaced, and so has its checksums.
+        if (0 != fits_movabs_hdu(fp, hdu_itor->first, 0, &status)) break;
+        writeChecksum(fp, hdu_itor->second, status);
+        if (VALUE_UNDEFINED == status) status = 0;
+        if (0 != status) break;
+      }
+      if (END_OF_FILE == status || BAD_HDU_NUM == status) status = 0;
+      if (0 != status && failed_file.empty()) { failed_file = file_itor->first; failed_status = status; }
+      closeFile(fp, false, 0);
+    }
+    if (!failed_file.empty())
+      throw TipException(failed_status, "FitsFileManager::finalizeChecksums could not update checksums in file \"" +
+        failed_file + "\"");
+  }
+
+  unsigned long long FitsFileManager::getNumChecksumBytes() {
+    std::lock_guard<std::mutex> lock(s_getChecksumMutex());
+    return s_getNumChecksumBytes();
   }
+
+  void FitsFileManager::writeChecksum(fitsfile * fp, bool data_modified, int & status) {
+    bool data_hashed = true;
+    if (!data_modified) {
+      // The data, and so DATASUM, are unchanged, so only the header need be hashed, if DATASUM is present.
+      int update_status = status;
+      fits_update_chksum(fp, &update_status);
+      if (KEY_NO_EXIST != update_status) {
+        status = update_status;
+        data_hashed = false;
+      }
+    }
+    // Sum the data unit in place, in parallel if it is large, leaving only files which cannot be mapped to cfitsio.
+    if (data_hashed && !FitsChecksum::writeChecksum(fp, IFileSvc::getChecksumThreads(), status))
+      fits_write_chksum(fp, &status);
+
+    LONGLONG header_start = 0;
+    LONGLONG data_start = 0;
+    LONGLONG data_end = 0;
+    int addr_status = 0;
+    fits_get_hduaddrll(fp, &header_start, &data_start, &data_end, &addr_status);
+    if (0 == status && 0 == addr_status) {
+      std::lock_guard<std::mutex> lock(s_getChecksumMutex());
+      s_getNumChecksumBytes() += (data_hashed ? data_end : data_start) - header_start;
+    }
+  }
+
 }
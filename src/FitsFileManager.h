@@ -13,6 +13,7 @@
 #include "fitsio.h"
 #include "tip/FileSummary.h"
 #include "tip/Image.h"
+#include "tip/ImageCompression.h"
 #include "tip/TipFile.h"
 
 namespace tip {
@@ -30,6 +31,17 @@ namespace tip {
       */
       static void createFile(const std::string & file_name, const std::string & template_name = "", bool clobber = true);
 
+      /** \brief Create a new file whose primary array is an image of the given type and dimensions.
+          \param file_name The name of the new file.
+          \param pixel_type The type in which pixels are stored.
+          \param dims The set of sizes for each dimension of the image.
+          \param scale The value of the BSCALE keyword, by which stored values are multiplied.
+          \param zero The value of the BZERO keyword, which is added to stored values after scaling.
+          \param clobber Should existing files be overwritten?
+      */
+      static void createFile(const std::string & file_name, ImageBase::PixelType pixel_type,
+        const ImageBase::PixelCoordinate & dims, double scale, double zero, bool clobber);
+
       /** \brief Use a FITS template to create a new file in memory.
           \param file_name The name of the new file.
           \param template_name The name of the template file.
@@ -41,9 +53,14 @@ namespace tip {
           \param file_name The name of the file to which to append.
           \param image_name The name of the new table.
           \param dims The set of sizes for each dimension of the image.
+          \param pixel_type The type in which pixels are stored.
+          \param scale The value of the BSCALE keyword, by which stored values are multiplied.
+          \param zero The value of the BZERO keyword, which is added to stored values after scaling.
+          \param compression How the image is compressed.
       */
       static void appendImage(const std::string & file_name, const std::string & image_name,
-        const ImageBase::PixelCoordinate & dims);
+        const ImageBase::PixelCoordinate & dims, ImageBase::PixelType pixel_type = ImageBase::eFloat,
+        double scale = 1., double zero = 0., const ImageCompression & compression = ImageCompression());
 
       /** \brief Append a table extension to a file.
           \param file_name The name of the file to which to append.
@@ -62,16 +79,65 @@ namespace tip {
       */
       static bool isValid(const std::string & file_name);
 
+      /** \brief Find the summary of an extension of a FITS file, using the summary of the file cached when it was
+          last classified or summarized, if the file has not changed since (same inode, size and modification time).
+          Returns false if the file is not a plain FITS file, or the extension cannot be found this way; cfitsio
+          must then be asked.
+          \param file_name The name of the file.
+          \param ext_name The name or number of the extension.
+          \param ext_summary The summary of the extension.
+      */
+      static bool findExtension(const std::string & file_name, const std::string & ext_name, ExtSummary & ext_summary);
+
+      /** \brief Forget the cached summary of a file which is being, or has been, changed.
+          \param file_name The name of the file.
+      */
+      static void forgetSummary(const std::string & file_name);
+
+      /** \brief Bring the checksums of the current extension of a file open for writing up to date, as the checksum
+          policy (IFileSvc::setChecksumPolicy) requires: every time; only if it changed, rehashing the data only if
+          they changed; or later, when finalizeChecksums is called.
+          \param fp The file, positioned at the extension.
+          \param file_name The name of the file, by which a deferred update finds it again.
+          \param header_modified Whether the header of the extension has changed.
+          \param data_modified Whether the data of the extension have changed.
+          \param status The cfitsio status.
+      */
+      static void updateChecksum(fitsfile * fp, const std::string & file_name, bool header_modified,
+        bool data_modified, int & status);
+
+      /** \brief Update the checksums whose updates were deferred.
+      */
+      static void finalizeChecksums();
+
+      /** \brief Return the number of bytes hashed so far to compute checksums.
+      */
+      static unsigned long long getNumChecksumBytes();
+
     private:
       static fitsfile * createFile(const std::string & file_name, const std::string & image_name,
-        const ImageBase::PixelCoordinate & dims);
+        const ImageBase::PixelCoordinate & dims, ImageBase::PixelType pixel_type = ImageBase::eFloat,
+        double scale = 1., double zero = 0., const ImageCompression & compression = ImageCompression());
       static fitsfile * createImage(fitsfile * fp, const std::string & file_name, const std::string & image_name,
-        const ImageBase::PixelCoordinate & dims);
+        const ImageBase::PixelCoordinate & dims, ImageBase::PixelType pixel_type = ImageBase::eFloat,
+        double scale = 1., double zero = 0., const ImageCompression & compression = ImageCompression());
+
+      // Make cfitsio compress the next image created in the file as described.
+      static void setCompression(fitsfile * fp, const ImageCompression & compression, int & status);
 
       // Get the extsnsion identifier (name or number).
       static void getExtId(fitsfile * fp, std::string & ext_id);
 
-      static void closeFile(fitsfile *fp, bool update_checksum, int status);
+      // Summarize the current extension.
+      static ExtSummary getExtSummary(fitsfile * fp, int & status);
+
+      // Summarize the current and all following extensions, leaving status END_OF_FILE after the last.
+      static void readFileSummary(fitsfile * fp, FileSummary & summary, int & status);
+
+      // Write checksums for the current extension, hashing its data only if they changed.
+      static void writeChecksum(fitsfile * fp, bool data_modified, int & status);
+
+      static void closeFile(fitsfile *fp, bool update_checksum, int status, int first_hdu = 1);
   };
 
 }
@@ -0,0 +1,239 @@
+/** \file FitsFilePool.cxx
+
+    \brief Implementation of the pool of open FITS files.
+*/
+#include <cctype>
+#include <cstdlib>
+#include <utility>
+
+#include <sys/stat.h>
+
+#include "FitsFilePool.h"
+
+namespace {
+
+  /** \brief Return the name of the file itself, without the clobber flag, extension, filters or template.
+  */
+  std::string rootName(const std::string & file_name) {
+    std::string::size_type begin = file_name.compare(0, 1, "!") ? 0 : 1;
+    std::string::size_type end = file_name.find_first_of("[(", begin);
+    return file_name.substr(begin, std::string::npos == end ? end : end - begin);
+  }
+
+  /** \brief Return whether an extension name can be found with fits_movabs_hdu or fits_movnam_hdu, rather than
+      needing cfitsio's extended syntax parser.
+  */
+  bool isPlainExtension(const std::string & ext_name) {
+    return std::string::npos == ext_name.find_first_of("[](){},;#+*?");
+  }
+
+  /** \brief Move a handle to an extension named as in cfitsio's extended syntax: by number, counting the primary
+      array as 0, or by name, where PRIMARY and P name the primary array.
+  */
+  void moveToExtension(fitsfile * fp, const std::string & ext_name, int & status) {
+    bool is_number = !ext_name.empty();
+    for (std::string::const_iterator itor = ext_name.begin(); itor != ext_name.end(); ++itor)
+      if (0 == std::isdigit(static_cast<unsigned char>(*itor))) is_number = false;
+
+    std::string upper_name(ext_name);
+    for (std::string::iterator itor = upper_name.begin(); itor != upper_name.end(); ++itor)
+      *itor = std::toupper(static_cast<unsigned char>(*itor));
+
+    if (ext_name.empty() || "PRIMARY" == upper_name || "P" == upper_name)
+      fits_movabs_hdu(fp, 1, 0, &status);
+    else if (is_number)
+      fits_movabs_hdu(fp, std::atoi(ext_name.c_str()) + 1, 0, &status);
+    else
+      fits_movnam_hdu(fp, ANY_HDU, const_cast<char *>(ext_name.c_str()), 0, &status);
+  }
+
+}
+
+namespace tip {
+
+  FitsFilePool & FitsFilePool::instance() {
+    static FitsFilePool s_pool;
+    return s_pool;
+  }
+
+  FitsFilePool::FitsFilePool(): m_mutex(), m_entries(), m_handles(), m_max_files(0), m_num_hits(0), m_num_misses(0),
+    m_clock(0) {}
+
+  FitsFilePool::~FitsFilePool() { shrink(0); }
+
+  fitsfile * FitsFilePool::open(const std::string & file_name, const std::string & ext_name, int mode, int & status) {
+    if (0 != status) return 0;
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    Entry current = Entry();
+    std::string key;
+    if (0 != m_max_files && isPlainExtension(ext_name)) key = getKey(file_name, current);
+
+    EntryCont_t::iterator itor = m_entries.end();
+    if (!key.empty()) {
+      itor = m_entries.find(key);
+      if (itor != m_entries.end() && 0 == itor->second.m_num_users) {
+        // A file which is not in use may have been changed on disk, or may be open with too little access.
+        const Entry & entry(itor->second);
+        if (entry.m_device != current.m_device || entry.m_inode != current.m_inode ||
+          entry.m_size != current.m_size || entry.m_mtime_ns != current.m_mtime_ns ||
+          (READWRITE == mode && READONLY == entry.m_mode)) {
+          closeEntry(itor);
+          itor = m_entries.end();
+        }
+      } else if (itor != m_entries.end() && READWRITE == mode && READONLY == itor->second.m_mode) {
+        // In use read-only: let cfitsio report that it cannot be opened read-write.
+        key.clear();
+      }
+    } else if (READWRITE == mode && !m_entries.empty()) {
+      // Cfitsio cannot open a file read-write while the pool holds it open read-only.
+      Entry ignored = Entry();
+      EntryCont_t::iterator found = m_entries.find(getKey(rootName(file_name), ignored));
+      if (found != m_entries.end() && 0 == found->second.m_num_users) closeEntry(found);
+    }
+
+    if (key.empty()) {
+      std::string full_name(file_name);
+      if (!ext_name.empty()) full_name += "[" + ext_name + "]";
+      fitsfile * fp = 0;
+      fits_open_file(&fp, const_cast<char *>(full_name.c_str()), mode, &status);
+      return 0 == status ? fp : 0;
+    }
+
+    if (itor == m_entries.end()) {
+      fitsfile * pool_fp = 0;
+      fits_open_file(&pool_fp, const_cast<char *>(file_name.c_str()), mode, &status);
+      if (0 != status) return 0;
+      ++m_num_misses;
+      current.m_fp = pool_fp;
+      current.m_mode = mode;
+      itor = m_entries.insert(std::make_pair(key, current)).first;
+    } else {
+      ++m_num_hits;
+    }
+
+    // Give the caller a handle of its own, which shares the pool's file.
+    fitsfile * fp = 0;
+    fits_reopen_file(itor->second.m_fp, &fp, &status);
+    if (0 == status) moveToExtension(fp, ext_name, status);
+    itor->second.m_last_used = ++m_clock;
+    if (0 != status) {
+      if (0 != fp) {
+        int close_status = 0;
+        fits_close_file(fp, &close_status);
+      }
+      shrink(m_max_files);
+      return 0;
+    }
+    ++itor->second.m_num_users;
+    m_handles[fp] = key;
+    shrink(m_max_files);
+    return fp;
+  }
+
+  void FitsFilePool::close(fitsfile * fp, int & status) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::map<fitsfile *, std::string>::iterator handle = m_handles.find(fp);
+    if (handle == m_handles.end()) {
+      fits_close_file(fp, &status);
+      return;
+    }
+    EntryCont_t::iterator itor = m_entries.find(handle->second);
+    m_handles.erase(handle);
+
+    // The pool's own handle keeps the file open.
+    fits_close_file(fp, &status);
+    if (itor == m_entries.end() || 0 != --itor->second.m_num_users) return;
+
+    // Make the file on disk current, and note its state, so that changes made by others can be detected.
+    Entry & entry(itor->second);
+    int flush_status = 0;
+    if (READWRITE == entry.m_mode) fits_flush_file(entry.m_fp, &flush_status);
+    Entry current = Entry();
+    if (0 != flush_status || getKey(itor->first, current).empty()) {
+      closeEntry(itor);
+      return;
+    }
+    entry.m_device = current.m_device;
+    entry.m_inode = current.m_inode;
+    entry.m_size = current.m_size;
+    entry.m_mtime_ns = current.m_mtime_ns;
+    entry.m_last_used = ++m_clock;
+    shrink(m_max_files);
+  }
+
+  void FitsFilePool::discard(const std::string & file_name) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_entries.empty()) return;
+    Entry ignored = Entry();
+    EntryCont_t::iterator itor = m_entries.find(getKey(rootName(file_name), ignored));
+    if (itor != m_entries.end() && 0 == itor->second.m_num_users) closeEntry(itor);
+  }
+
+  unsigned int FitsFilePool::getMaxFiles() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_max_files;
+  }
+
+  void FitsFilePool::setMaxFiles(unsigned int max_files) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_max_files = max_files;
+    shrink(m_max_files);
+  }
+
+  void FitsFilePool::getStats(unsigned long & num_hits, unsigned long & num_misses) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    num_hits = m_num_hits;
+    num_misses = m_num_misses;
+  }
+
+  std::string FitsFilePool::getKey(const std::string & file_name, Entry & entry) const {
+    // Names with extended syntax, or naming URLs, devices or standard input, are left to cfitsio.
+    if (file_name.empty() || "-" == file_name || std::string::npos != file_name.find_first_of("[](){}!|*?$") ||
+      std::string::npos != file_name.find("://"))
+      return std::string();
+
+    struct stat file_status;
+    if (0 != stat(file_name.c_str(), &file_status) || !S_ISREG(file_status.st_mode)) return std::string();
+    char * path = realpath(file_name.c_str(), 0);
+    if (0 == path) return std::string();
+    std::string key(path);
+    std::free(path);
+
+    entry.m_device = file_status.st_dev;
+    entry.m_inode = file_status.st_ino;
+    entry.m_size = file_status.st_size;
+    // Record the modification time to the nanosecond where the file system does, so that a file rewritten within the
+    // same second is still seen to have changed.
+#if defined(__APPLE__)
+    long mtime_nsec = file_status.st_mtimespec.tv_nsec;
+#elif defined(WIN32)
+    long mtime_nsec = 0;
+#else
+    long mtime_nsec = file_status.st_mtim.tv_nsec;
+#endif
+    entry.m_mtime_ns = file_status.st_mtime * 1000000000LL + mtime_nsec;
+    return key;
+  }
+
+  void FitsFilePool::closeEntry(EntryCont_t::iterator itor) {
+    int status = 0;
+    fits_close_file(itor->second.m_fp, &status);
+    m_entries.erase(itor);
+  }
+
+  void FitsFilePool::shrink(EntryCont_t::size_type max_files) {
+    while (m_entries.size() > max_files) {
+      EntryCont_t::iterator oldest = m_entries.end();
+      for (EntryCont_t::iterator itor = m_entries.begin(); itor != m_entries.end(); ++itor) {
+        if (0 == itor->second.m_num_users && (oldest == m_entries.end() ||
+          itor->second.m_last_used < oldest->second.m_last_used))
+          oldest = itor;
+      }
+      // Files in use are never closed, so the pool may stay over its maximum until they are.
+      if (oldest == m_entries.end()) break;
+      closeEntry(oldest);
+    }
+  }
+
+}
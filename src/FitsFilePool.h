@@ -0,0 +1,122 @@
+/** \file FitsFilePool.h
+
+    \brief Pool of open FITS files, shared by the objects which read and write them.
+    This class is not part of the API.
+*/
+#ifndef tip_FitsFilePool_h
+#define tip_FitsFilePool_h
+
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "fitsio.h"
+
+namespace tip {
+
+  /** \class FitsFilePool
+
+      \brief Keeps FITS files open after the last object using them is closed, so that opening the same file again,
+      for example to classify it and then read it, or to visit each of its extensions in turn, does not open it and
+      parse its headers again. Each file open in the pool has one cfitsio handle of its own; objects are given
+      handles made from it with fits_reopen_file, which share the file and its buffers but have their own current
+      extension. Since cfitsio does not allow a shared file to be used by two threads at once, handles to be used in
+      other threads are not opened through the pool (see FitsHeader::eUnpooled).
+
+      Only plain files named without cfitsio's extended syntax are pooled, and only while the number of files in the
+      pool is below its maximum; the files which have been used least recently and are not in use are closed to make
+      room. A file which has changed on disk since it was last used (different inode, size or modification time, to
+      the nanosecond where the file system records it) is closed and opened again. Files opened read-only are reopened read-write when needed, if no object is using
+      them, because cfitsio cannot share a file between read-only and read-write handles. When the last object
+      using a file opened read-write closes it, the file is flushed, so that its contents on disk are current.
+
+      By default the maximum number of files is 0, and every handle is opened and closed directly.
+  */
+  class FitsFilePool {
+    public:
+      /// \brief Return the pool used by all FITS objects.
+      static FitsFilePool & instance();
+
+      /// \brief Destructor. Closes the files which are no longer used.
+      ~FitsFilePool();
+
+      /** \brief Open a file, positioned at the given extension, with or without write access, as fits_open_file
+          does. Returns 0, and sets the status, if it cannot be opened.
+          \param file_name The name of the file, which may use cfitsio's extended syntax.
+          \param ext_name The name or number of the extension; "" for the primary array.
+          \param mode The access mode, READONLY or READWRITE.
+          \param status The cfitsio status, which is set if the file cannot be opened.
+      */
+      fitsfile * open(const std::string & file_name, const std::string & ext_name, int mode, int & status);
+
+      /** \brief Close a handle opened by open, or any other cfitsio handle, as fits_close_file does.
+          \param fp The handle.
+          \param status The cfitsio status.
+      */
+      void close(fitsfile * fp, int & status);
+
+      /** \brief Close the pooled file with the given name if it is not in use, because it is about to be replaced,
+          or opened with different access.
+          \param file_name The name of the file, which may use cfitsio's extended syntax.
+      */
+      void discard(const std::string & file_name);
+
+      /// \brief Return the maximum number of files kept open.
+      unsigned int getMaxFiles() const;
+
+      /** \brief Set the maximum number of files kept open, closing the least recently used files which are not in
+          use until there are no more than that. 0 disables pooling.
+          \param max_files The maximum number of files.
+      */
+      void setMaxFiles(unsigned int max_files);
+
+      /** \brief Get the number of opens which found their file in the pool, and the number which opened it.
+          \param num_hits The number of opens which found their file in the pool.
+          \param num_misses The number of opens of files which can be pooled but were not in the pool.
+      */
+      void getStats(unsigned long & num_hits, unsigned long & num_misses) const;
+
+    private:
+      /// \brief A file held open by the pool.
+      struct Entry {
+        fitsfile * m_fp;
+        int m_mode;
+        unsigned long m_num_users;
+        unsigned long long m_last_used;
+        unsigned long long m_device;
+        unsigned long long m_inode;
+        long long m_size;
+        long long m_mtime_ns;
+      };
+
+      typedef std::map<std::string, Entry> EntryCont_t;
+
+      FitsFilePool();
+
+      // The pool is not copied.
+      FitsFilePool(const FitsFilePool &);
+      FitsFilePool & operator =(const FitsFilePool &);
+
+      /** \brief Return the canonical name of a plain file, or "" if the name uses extended syntax or does not name a
+          regular file, and fill in the properties which show whether a pooled file has changed.
+      */
+      std::string getKey(const std::string & file_name, Entry & entry) const;
+
+      /// \brief Close the file of an entry which is not in use, and remove the entry.
+      void closeEntry(EntryCont_t::iterator itor);
+
+      /// \brief Close files which are not in use, least recently used first, until the pool is small enough.
+      void shrink(EntryCont_t::size_type max_files);
+
+      mutable std::mutex m_mutex;
+      EntryCont_t m_entries;
+      std::map<fitsfile *, std::string> m_handles;
+      unsigned int m_max_files;
+      unsigned long m_num_hits;
+      unsigned long m_num_misses;
+      unsigned long long m_clock;
+  };
+
+}
+
+#endif
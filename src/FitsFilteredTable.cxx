@@ -0,0 +1,116 @@
+/** \file FitsFilteredTable.cxx
+
+    \brief Implementation of filtered views of FITS tables.
+*/
+#include "FitsFilteredTable.h"
+#include "tip/IFileSvc.h"
+#include "tip/TableFilter.h"
+#include "tip/TipException.h"
+
+namespace tip {
+
+  FitsFilteredTable::FitsFilteredTable(FitsTable * table, const std::string & filter): m_table(table), m_rows(),
+    m_columns() {
+    std::shared_ptr<RowCont_t> rows(new RowCont_t);
+    Index_t num_rows = m_table->getNumRecords();
+    if (std::string::npos == filter.find_first_not_of(" \t\n")) {
+      // A blank filter selects every row.
+      rows->resize(num_rows);
+      for (Index_t row = 0; row != num_rows; ++row) (*rows)[row] = row;
+    } else {
+      findRows(filter, false, *rows);
+    }
+    m_rows = rows;
+  }
+
+  FitsFilteredTable::FitsFilteredTable(FitsTable * table, const std::shared_ptr<const RowCont_t> & rows): m_table(table),
+    m_rows(rows), m_columns() {}
+
+  FitsFilteredTable::~FitsFilteredTable() {
+    for (std::vector<FilteredColumn *>::reverse_iterator itor = m_columns.rbegin(); itor != m_columns.rend(); ++itor)
+      delete *itor;
+    m_columns.clear();
+  }
+
+  void FitsFilteredTable::setNumRecords(Index_t) {
+    throw TipException("FitsFilteredTable::setNumRecords: the number of records of filtered table " + getName() +
+      " cannot be changed");
+  }
+
+  IColumn * FitsFilteredTable::getColumn(FieldIndex_t field_index) { return makeColumn(field_index); }
+
+  const IColumn * FitsFilteredTable::getColumn(FieldIndex_t field_index) const { return makeColumn(field_index); }
+
+  void FitsFilteredTable::copyCell(const Table * src_ext, FieldIndex_t src_field, Index_t src_record,
+    FieldIndex_t dest_field, Index_t dest_record) {
+    getColumn(dest_field)->copy(src_ext->getColumn(src_field), src_record, dest_record);
+  }
+
+  void FitsFilteredTable::copyRecord(const Table * src_ext, Index_t src_record, Index_t dest_record) {
+    const FieldCont & fields(getValidFields());
+    for (FieldCont::const_iterator itor = fields.begin(); itor != fields.end(); ++itor)
+      copyCell(src_ext, src_ext->getFieldIndex(*itor), src_record, getFieldIndex(*itor), dest_record);
+  }
+
+  void FitsFilteredTable::appendField(const std::string & field_name, const std::string & format) {
+    m_table->appendField(field_name, format);
+  }
+
+  void FitsFilteredTable::filterRows(const std::string & filter) {
+    // A blank filter is treated as a no-op.
+    if (std::string::npos == filter.find_first_not_of(" \t\n")) return;
+
+    // Keep the rows of the current selection which also match the new expression.
+    std::shared_ptr<RowCont_t> rows(new RowCont_t);
+    findRows(filter, true, *rows);
+    m_rows = rows;
+
+    for (std::vector<FilteredColumn *>::iterator itor = m_columns.begin(); itor != m_columns.end(); ++itor)
+      if (0 != *itor) (*itor)->setRows(m_rows);
+  }
+
+  Table * FitsFilteredTable::openReader(const FieldCont & fields) const {
+    std::unique_ptr<Table> reader(m_table->openReader(fields));
+    FitsTable * fits_reader = dynamic_cast<FitsTable *>(reader.get());
+    if (0 == fits_reader) return 0;
+    reader.release();
+    return new FitsFilteredTable(fits_reader, m_rows);
+  }
+
+  void FitsFilteredTable::findRows(const std::string & filter, bool in_view, RowCont_t & rows) const {
+    if (IFileSvc::getCompiledFilters()) {
+      try {
+        // Evaluating on the view only reads the rows already selected.
+        TableFilter compiled(filter);
+        std::vector<char> selected;
+        if (in_view) compiled.select(*this, selected);
+        else compiled.select(*m_table, selected);
+        for (std::vector<char>::size_type index = 0; index != selected.size(); ++index)
+          if (0 != selected[index]) rows.push_back(in_view ? (*m_rows)[index] : index);
+        return;
+      } catch (const TipException &) {
+        // Leave expressions which TableFilter cannot handle to cfitsio.
+        rows.clear();
+      }
+    }
+
+    std::vector<char> selected;
+    m_table->findRows(filter, selected);
+    if (in_view) {
+      for (RowCont_t::const_iterator itor = m_rows->begin(); itor != m_rows->end(); ++itor)
+        if (0 != selected[*itor]) rows.push_back(*itor);
+    } else {
+      for (std::vector<char>::size_type row = 0; row != selected.size(); ++row)
+        if (0 != selected[row]) rows.push_back(row);
+    }
+  }
+
+  IColumn * FitsFilteredTable::makeColumn(FieldIndex_t field_index) const {
+    // Get the underlying column first, which checks the index.
+    IColumn * column = m_table->getColumn(field_index);
+    if (m_columns.size() <= std::vector<FilteredColumn *>::size_type(field_index)) m_columns.resize(field_index + 1, 0);
+    if (0 == m_columns[field_index]) m_columns[field_index] = new FilteredColumn(column, m_rows);
+    return m_columns[field_index];
+  }
+
+}
@@ -0,0 +1,140 @@
+/** \file FitsFilteredTable.h
+
+    \brief Filtered view of a FITS table, which selects rows through an index instead of copying them.
+    This class is not part of the API.
+*/
+#ifndef tip_FitsFilteredTable_h
+#define tip_FitsFilteredTable_h
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "FilteredColumn.h"
+#include "FitsTable.h"
+#include "tip/IColumn.h"
+#include "tip/Table.h"
+#include "tip/tip_types.h"
+
+namespace tip {
+
+  /** \class FitsFilteredTable
+
+      \brief Table which presents the rows of a FITS table matching a filtering expression as consecutive records.
+      The expression is evaluated once with fits_find_rows, and the indices of the matching rows are kept;
+      records of the view are then read from (and written to) the corresponding rows of the underlying table.
+      Unlike filtering with extended file name syntax or FitsTable::filterRows, nothing is copied and the file
+      is not changed. Filtering the view again only narrows the index, so filters may be stacked cheaply.
+
+      If IFileSvc::setCompiledFilters has been called, expressions are evaluated with TableFilter instead,
+      unless they use features which it does not support.
+
+      The number of records of a view cannot be changed. Fields appended through the view are appended to the
+      underlying table.
+  */
+  class FitsFilteredTable : public Table {
+    public:
+      typedef FilteredColumn::RowCont_t RowCont_t;
+
+      /** \brief Create a view of the rows of a table which match the given expression.
+          \param table The underlying table, which the view takes over and deletes, even if this throws.
+          \param filter The filtering expression, in cfitsio's row filter syntax.
+      */
+      FitsFilteredTable(FitsTable * table, const std::string & filter);
+
+      /** \brief Create a view of the given rows of a table.
+          \param table The underlying table, which the view takes over and deletes.
+          \param rows The indices of the selected rows, in increasing order.
+      */
+      FitsFilteredTable(FitsTable * table, const std::shared_ptr<const RowCont_t> & rows);
+
+      /** \brief Destructor. Deletes the columns of the view, then the underlying table.
+      */
+      virtual ~FitsFilteredTable();
+
+      virtual Header & getHeader() { return m_table->getHeader(); }
+
+      virtual const Header & getHeader() const { return m_table->getHeader(); }
+
+      virtual bool isImage() const { return false; }
+
+      virtual bool isTable() const { return true; }
+
+      virtual const std::string & getName() const { return m_table->getName(); }
+
+      virtual void setName(const std::string & name) { m_table->setName(name); }
+
+      /** \brief Return the number of rows selected.
+      */
+      virtual Index_t getNumRecords() const { return m_rows->size(); }
+
+      /** \brief Not supported: throws.
+      */
+      virtual void setNumRecords(Index_t num_records);
+
+      virtual const FieldCont & getValidFields() const { return m_table->getValidFields(); }
+
+      virtual IColumn * getColumn(FieldIndex_t field_index);
+
+      virtual const IColumn * getColumn(FieldIndex_t field_index) const;
+
+      virtual FieldIndex_t getFieldIndex(const std::string & field_name) const { return m_table->getFieldIndex(field_name); }
+
+      virtual void copyCell(const Table * src_ext, FieldIndex_t src_field, Index_t src_record, FieldIndex_t dest_field,
+        Index_t dest_record);
+
+      virtual void copyRecord(const Table * src_ext, Index_t src_record, Index_t dest_record);
+
+      virtual void appendField(const std::string & field_name, const std::string & format);
+
+      /** \brief Narrow the selection to the selected rows which also match the given expression.
+          \param filter The filtering expression.
+      */
+      virtual void filterRows(const std::string & filter);
+
+      virtual void setReadAhead(Index_t num_records) const { m_table->setReadAhead(num_records); }
+
+      virtual void getReadAheadStats(unsigned long & num_hits, unsigned long & num_misses) const
+        { m_table->getReadAheadStats(num_hits, num_misses); }
+
+      virtual Index_t getOptimalNumRecords() const { return m_table->getOptimalNumRecords(); }
+
+      /** \brief Open the underlying table again, and return a view of it which shares this view's selection.
+          \param fields Names of fields to set up when the table is opened.
+      */
+      virtual Table * openReader(const FieldCont & fields = FieldCont()) const;
+
+      /** \brief Return the indices of the selected rows of the underlying table.
+      */
+      const RowCont_t & getRows() const { return *m_rows; }
+
+      /** \brief Return the underlying table.
+      */
+      const FitsTable & getTable() const { return *m_table; }
+
+    private:
+      // Views are not copied.
+      FitsFilteredTable(const FitsFilteredTable &);
+      FitsFilteredTable & operator =(const FitsFilteredTable &);
+
+      /** \brief Find the rows which match an expression, using TableFilter if IFileSvc::getCompiledFilters() is
+          true and it supports the expression, and cfitsio otherwise.
+          \param filter The filtering expression.
+          \param in_view Whether to search only the rows already selected, rather than the whole table.
+          \param rows The output indices of the matching rows of the underlying table, in increasing order.
+      */
+      void findRows(const std::string & filter, bool in_view, RowCont_t & rows) const;
+
+      /** \brief Return the column of the view for the given field, creating it first if this has not yet been done.
+          \param field_index The index of the field.
+      */
+      IColumn * makeColumn(FieldIndex_t field_index) const;
+
+      std::unique_ptr<FitsTable> m_table;
+      std::shared_ptr<const RowCont_t> m_rows;
+      mutable std::vector<FilteredColumn *> m_columns;
+  };
+
+}
+
+#endif
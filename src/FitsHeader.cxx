@@ -7,14 +7,17 @@
 #include <cctype>
 #include <sstream>
 
+#include "FitsFileManager.h"
+#include "FitsFilePool.h"
 #include "FitsHeader.h"
 #include "tip/TipException.h"
 
 namespace tip {
 
   FitsHeader::FitsHeader(const std::string & file_name, const std::string & ext_name,
-    const std::string & filter, bool read_only): m_keyword_seq(), m_file_name(file_name), m_ext_name(ext_name),
-    m_filter(filter), m_fp(0), m_is_primary(false), m_is_table(false), m_read_only(read_only) { open(); }
+    const std::string & filter, bool read_only, OpenMode open_mode): m_keyword_seq(), m_file_name(file_name),
+    m_ext_name(ext_name), m_filter(filter), m_fp(0), m_is_primary(false), m_is_table(false), m_read_only(read_only),
+    m_header_modified(false), m_data_modified(false), m_open_mode(open_mode) { open(); }
 
   // Close file automatically while destructing.
   FitsHeader::~FitsHeader() { close(); }
@@ -32,17 +35,30 @@ namespace tip {
       if (!m_filter.empty()) s << "[" << m_filter << "]";
       std::string file_name = s.str();
 
+      // Files are opened through the pool, which can only find the extension itself when there is no filter.
+      // Handles meant for other threads are opened on their own, because the handles the pool gives out share one
+      // cfitsio file, which must not be used by two threads at once.
+      FitsFilePool & pool(FitsFilePool::instance());
+      std::string pool_name = m_filter.empty() ? m_file_name : file_name;
+      std::string pool_ext = m_filter.empty() ? m_ext_name : std::string();
+      auto openFile = [&](int mode) {
+        fitsfile * new_fp = 0;
+        if (ePooled == m_open_mode) new_fp = pool.open(pool_name, pool_ext, mode, status);
+        else fits_open_file(&new_fp, const_cast<char *>(file_name.c_str()), mode, &status);
+        return 0 == status ? new_fp : 0;
+      };
+
       // Try to open the fits file read-write, unless read-only mode was explicitly set before open
       // was called.
       if (!m_read_only)
-        fits_open_file(&fp, const_cast<char *>(file_name.c_str()), READWRITE, &status);
+        fp = openFile(READWRITE);
 
       // If opening read-write didn't work, or if read-only mode was explicitly set before open
       // was called...
       if (0 != status || m_read_only) {
         // Attempt to open the file read-only:
         status = 0;
-        fits_open_file(&fp, const_cast<char *>(file_name.c_str()), READONLY, &status);
+        fp = openFile(READONLY);
         m_read_only = true;
       }
 
@@ -59,8 +75,9 @@ namespace tip {
         throw TipException(status, std::string("Could not open FITS extension \"") + file_name + '"');
       }
 
-      // Success: save the pointer.
+      // Success: save the pointer. A file open for writing may change, so its cached summary is no longer used.
       m_fp = fp;
+      if (!m_read_only) FitsFileManager::forgetSummary(m_file_name);
 
       // Read all keywords.
       loadAllKeywords();
@@ -100,15 +117,22 @@ namespace tip {
   // Close file.
   void FitsHeader::close(int status) {
     if (0 != m_fp) {
-      if (!m_read_only) fits_write_chksum(m_fp, &status);
+      // Bring the checksums up to date as the checksum policy requires. A filtered extension is a copy in memory,
+      // whose checksums cannot be deferred.
+      if (!m_read_only)
+        FitsFileManager::updateChecksum(m_fp, m_filter.empty() ? m_file_name : std::string(), m_header_modified,
+          m_data_modified, status);
       if (VALUE_UNDEFINED != status && 0 != status) {
 	throw TipException(status, "Close: Something's Wrong!");
       }
       //status check
       status = 0;
-      fits_close_file(m_fp, &status);
+      FitsFilePool::instance().close(m_fp, status);
+      if (!m_read_only) FitsFileManager::forgetSummary(m_file_name);
     }
     m_fp = 0;
+    m_header_modified = false;
+    m_data_modified = false;
   }
 
   Header::Iterator FitsHeader::find(const std::string & key_name) {
@@ -125,6 +149,7 @@ namespace tip {
 
   Header::Iterator FitsHeader::insert(Iterator itor, const KeyRecord & record) {
     int status = 0;
+    m_header_modified = true;
     fits_insert_record(m_fp, itor - m_keyword_seq.begin() + 1, const_cast<char *>(record.get().c_str()), &status);
     if (0 != status) {
       std::string msg = "Cannot insert record " + record.get();
@@ -140,6 +165,7 @@ namespace tip {
 
   Header::Iterator FitsHeader::erase(Iterator itor) {
     int status = 0;
+    m_header_modified = true;
     fits_delete_record(m_fp, itor - begin() + 1, &status);
     return m_keyword_seq.erase(itor);
   }
@@ -147,6 +173,7 @@ namespace tip {
   void FitsHeader::erase(const std::string & key_name) {
     int status = 0;
     // First, erase all matching keywords as far as cfitsio is concerned.
+    m_header_modified = true;
     do {
       fits_delete_key(m_fp, const_cast<char *>(key_name.c_str()), &status);
     } while (0 == status);
@@ -179,6 +206,7 @@ namespace tip {
     if (m_read_only)
       throw TipException(formatWhat(std::string("Cannot write comment for keyword \"") + name + "\"; object is not writable"));
     int status = 0;
+    m_header_modified = true;
     fits_modify_comment(m_fp, const_cast<char *>(name.c_str()), const_cast<char *>(comment.c_str()), &status);
     if (0 != status) throw TipException(status, formatWhat(std::string("Cannot write comment for keyword \"") + name + '"'));
   }
@@ -195,6 +223,7 @@ namespace tip {
     if (m_read_only)
       throw TipException(formatWhat(std::string("Cannot write unit for keyword \"") + name + "\"; object is not writable"));
     int status = 0;
+    m_header_modified = true;
     fits_write_key_unit(m_fp, const_cast<char *>(name.c_str()), const_cast<char *>(unit.c_str()), &status);
     if (0 != status) throw TipException(status, formatWhat(std::string("Cannot write unit for keyword \"") + name + '"'));
   }
@@ -203,6 +232,7 @@ namespace tip {
     if (m_read_only)
       throw TipException(formatWhat("Cannot add comment string; object is not writable"));
     int status = 0;
+    m_header_modified = true;
     fits_write_comment(m_fp, const_cast<char *>(comment.c_str()), &status);
     if (0 != status) throw TipException(status, formatWhat("Cannot add comment string"));
   }
@@ -211,6 +241,7 @@ namespace tip {
     if (m_read_only)
       throw TipException(formatWhat("Cannot add history string; object is not writable"));
     int status = 0;
+    m_header_modified = true;
     fits_write_history(m_fp, const_cast<char *>(history.c_str()), &status);
     if (0 != status) throw TipException(status, formatWhat("Cannot add history string"));
   }
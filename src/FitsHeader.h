@@ -13,8 +13,13 @@ namespace tip {
 
   class FitsHeader : public Header {
     public:
+      /** \brief How the file is opened: through the file pool (FitsFilePool), or with a handle of its own, which
+          shares nothing with other handles and so may be used in another thread.
+      */
+      enum OpenMode { ePooled, eUnpooled };
+
       FitsHeader(const std::string & file_name, const std::string & ext_name,
-        const std::string & filter = "", bool read_only = true);
+        const std::string & filter = "", bool read_only = true, OpenMode open_mode = ePooled);
 
       virtual ~FitsHeader();
 
@@ -33,6 +38,11 @@ namespace tip {
 
       bool readOnly() const { return m_read_only; }
 
+      /** \brief Note that the data unit of this extension has been changed, so that its DATASUM is recomputed when it
+          is closed.
+      */
+      void setDataModified() { m_data_modified = true; }
+
       virtual KeySeq_t::size_type getNumKeywords() const { return m_keyword_seq.size(); }
 
       virtual Iterator begin() { return m_keyword_seq.begin(); }
@@ -187,6 +197,9 @@ namespace tip {
       bool m_is_primary;
       bool m_is_table;
       bool m_read_only;
+      bool m_header_modified;
+      bool m_data_modified;
+      OpenMode m_open_mode;
   };
 
   // Getting keywords.
@@ -231,6 +244,7 @@ namespace tip {
     static int data_type_code = FitsPrimProps<T>::dataTypeCode();
     int status = 0;
     T tmp = value;
+    m_header_modified = true;
     fits_update_key(m_fp, data_type_code, const_cast<char *>(name.c_str()), &tmp, 0, &status);
     if (0 != status) throw TipException(status, formatWhat(std::string("Cannot write keyword \"") + name + '"'));
   }
@@ -243,6 +257,7 @@ namespace tip {
     static int data_type_code = FitsPrimProps<bool>::dataTypeCode();
     int status = 0;
     int tmp = value;
+    m_header_modified = true;
     fits_update_key(m_fp, data_type_code, const_cast<char *>(name.c_str()), &tmp, 0, &status);
     if (0 != status) throw TipException(status, formatWhat(std::string("Cannot write keyword \"") + name + '"'));
   }
@@ -256,6 +271,7 @@ namespace tip {
     int status = 0;
     char tmp[FLEN_KEYWORD];
     std::strncpy(tmp, value.c_str(), FLEN_KEYWORD - 1);
+    m_header_modified = true;
     fits_update_key(m_fp, data_type_code, const_cast<char *>(name.c_str()), tmp, 0, &status);
     fits_flush_file(m_fp,&status);
     if (0 != status) throw TipException(status, formatWhat(std::string("Cannot write keyword \"") + name + '"'));
@@ -270,6 +286,7 @@ namespace tip {
     int status = 0;
     char tmp[FLEN_KEYWORD];
     strncpy(tmp, value, FLEN_KEYWORD - 1);
+    m_header_modified = true;
     fits_update_key(m_fp, data_type_code, const_cast<char *>(name.c_str()), tmp, 0, &status);
     if (0 != status) throw TipException(status, formatWhat(std::string("Cannot write keyword \"") + name + '"'));
   }
@@ -317,6 +334,7 @@ namespace tip {
     int status = 0;
     char tmp[FLEN_CARD];
     strncpy(tmp, record.c_str(), FLEN_CARD - 1);
+    m_header_modified = true;
     fits_update_card(m_fp, const_cast<char *>(name.c_str()), tmp, &status);
     if (0 != status) throw TipException(status, formatWhat(std::string("Cannot write key record\"") + name + '"'));
   }
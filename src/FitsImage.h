@@ -8,13 +8,19 @@
 #define tip_FitsImage_h
 
 #include <cstddef>
+#include <exception>
+#include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "fitsio.h"
 
+#include "FitsDecoder.h"
 #include "FitsHeader.h"
+#include "FitsMapping.h"
 #include "FitsPrimProps.h"
+#include "tip/IFileSvc.h"
 #include "tip/Image.h"
 #include "tip/tip_types.h"
 
@@ -34,9 +40,11 @@ namespace tip {
       /** \brief Create an object to provide low-level access to the given FITS extension.
           \param file_name The name of the FITS file.
           \param ext_name The name of the FITS extension.
+          \param open_mode Whether to open the file through the file pool, or with a handle of its own, which may be
+          used in another thread.
       */
       FitsTypedImage(const std::string & file_name, const std::string & ext_name,
-        const std::string & filter = "", bool read_only = true);
+        const std::string & filter = "", bool read_only = true, FitsHeader::OpenMode open_mode = FitsHeader::ePooled);
 
       /** \brief Destructor. Closes image if it is open.
       */
@@ -132,11 +140,33 @@ namespace tip {
       */
       void openImage();
 
+      /** \brief Read the whole image straight from a memory mapping of the file, if the image is stored uncompressed
+          in a plain file. Returns false, without reading anything, if it is not.
+          \param image_size The number of pixels in the image.
+          \param image The array in which to store the image.
+      */
+      bool getMapped(PixOrd_t image_size, std::vector<T> & image) const;
+
+      /** \brief Read a slice of a tile-compressed image in several threads, each of which decompresses whole tiles
+          through its own handle. Returns false, without reading anything, if the image is not compressed, cannot
+          be opened again, or the slice is too small to divide.
+          \param range A container of intervals which give the range of pixels in each image dimension.
+          \param image The first pixel of the array in which to store the slice.
+      */
+      bool getParallel(const ImageBase::PixelCoordRange & range, T * image) const;
+
+      /** \brief Read a slice of the image through this object's handle.
+          \param range A container of intervals which give the range of pixels in each image dimension.
+          \param image The first pixel of the array in which to store the slice.
+      */
+      void readSubset(const ImageBase::PixelCoordRange & range, T * image) const;
+
     private:
       std::string formatWhat(const std::string & msg) const;
 
       FitsHeader m_header;
       std::string m_file_name;
+      std::string m_ext_name;
       std::string m_filter;
       ImageBase::PixelCoordinate m_image_dimensions;
   };
@@ -145,8 +175,9 @@ namespace tip {
 
   template <typename T>
   inline FitsTypedImage<T>::FitsTypedImage(const std::string & file_name, const std::string & ext_name,
-    const std::string & filter, bool read_only): m_header(file_name, ext_name, filter, read_only),
-    m_file_name(file_name), m_filter(filter), m_image_dimensions() { openImage(); }
+    const std::string & filter, bool read_only, FitsHeader::OpenMode open_mode):
+    m_header(file_name, ext_name, filter, read_only, open_mode),
+    m_file_name(file_name), m_ext_name(ext_name), m_filter(filter), m_image_dimensions() { openImage(); }
 
   // Close file automatically while destructing.
   template <typename T>
@@ -191,6 +222,7 @@ namespace tip {
     if (0 != status) throw TipException(status, formatWhat("setImageDimensions cannot determine image type"));
 
     // Resize the image.
+    m_header.setDataModified();
     fits_resize_img(m_header.getFp(), bitpix, naxis, naxes, &status);
     delete [] naxes;
 
@@ -234,6 +266,7 @@ namespace tip {
     T array[2] = { pixel, 0 };
 
     // Write the copy to the output file:
+    m_header.setDataModified();
     fits_write_pix(m_header.getFp(), FitsPrimProps<T>::dataTypeCode(), cf_coord, 1, array, &status);
     delete [] cf_coord;
 
@@ -275,6 +308,7 @@ namespace tip {
     double array[2] = { pixel, 0. };
 
     // Write the copy to the output file:
+    m_header.setDataModified();
     fits_write_pix(m_header.getFp(), TDOUBLE, cf_coord, 1, array, &status);
     delete [] cf_coord;
 
@@ -329,55 +363,185 @@ namespace tip {
     for (ImageBase::PixelCoordinate::const_iterator itor = m_image_dimensions.begin(); itor != m_image_dimensions.end(); ++itor)
       image_size *= *itor;
 
-    // Make sure image is large enough to accomodate the image.
-    T * image_tmp(new T[image_size]);
+    // Avoid cfitsio's buffers when the image can be decoded straight from the file.
+    if (getMapped(image_size, image)) return;
+
+    // Read straight into the output, so that only one copy of a large image is ever held in memory.
+    image.resize(image_size);
+    if (0 >= image_size) return;
+
+    // Decompress large compressed images in parallel.
+    ImageBase::PixelCoordRange range(m_image_dimensions.size());
+    for (ImageBase::PixelCoordRange::size_type index = 0; index != range.size(); ++index)
+      range[index].second = m_image_dimensions[index];
+    if (getParallel(range, &image[0])) return;
 
     // Starting coordinate is the first pixel in each dimension.
-    PixOrd_t * coord(new PixOrd_t[m_image_dimensions.size()]);
-    for (std::size_t ii = 0; ii != m_image_dimensions.size(); ++ii) coord[ii] = 1;
+    std::vector<long> coord(m_image_dimensions.size(), 1);
 
     // Get the image itself.
-    fits_read_pix(m_header.getFp(), FitsPrimProps<T>::dataTypeCode(), coord, image_size, 0, image_tmp, 0, &status);
+    fits_read_pix(m_header.getFp(), FitsPrimProps<T>::dataTypeCode(), &coord[0], image_size, 0, &image[0], 0, &status);
     if (0 != status) {
-      delete [] coord;
-      delete [] image_tmp;
-      throw TipException(status, formatWhat("Cannot read image of type " + FitsPrimProps<T>::dataTypeCode()));
+      std::ostringstream os;
+      os << "Cannot read image of type " << FitsPrimProps<T>::dataTypeCode();
+      throw TipException(status, formatWhat(os.str()));
+    }
+  }
+
+  template <typename T>
+  inline bool FitsTypedImage<T>::getMapped(PixOrd_t image_size, std::vector<T> & image) const {
+    // Filtered images are copies held by cfitsio, and tile-compressed images are stored in a table.
+    if (!m_filter.empty() || 0 >= image_size) return false;
+    fitsfile * fp = m_header.getFp();
+    int status = 0;
+    if (0 != fits_is_compressed_image(fp, &status) || 0 != status) return false;
+
+    int bitpix = 0;
+    fits_get_img_type(fp, &bitpix, &status);
+    int type_code = FitsDecoder::getImageTypeCode(bitpix);
+    if (0 != status || 0 == type_code) return false;
+
+    // Get scaling, which is optional.
+    double scale = 1.;
+    fits_read_key(fp, TDOUBLE, "BSCALE", &scale, 0, &status);
+    if (KEY_NO_EXIST == status) status = 0;
+    double zero = 0.;
+    fits_read_key(fp, TDOUBLE, "BZERO", &zero, 0, &status);
+    if (KEY_NO_EXIST == status) status = 0;
+
+    // Make sure pixels written through cfitsio are in the file.
+    if (!m_header.readOnly()) fits_flush_buffer(fp, 0, &status);
+    if (0 != status) return false;
+
+    // Like fits_read_pix with no null value, this does not check for undefined pixels.
+    FitsDecoder decoder(type_code, scale, zero);
+    FitsMapping mapping;
+    if (!mapping.map(m_file_name, fp, image_size * decoder.getWidth())) return false;
+    image.resize(image_size);
+    decoder.decode(mapping.getData(), decoder.getWidth(), image_size, &image[0]);
+    return true;
+  }
+
+  template <typename T>
+  inline bool FitsTypedImage<T>::getParallel(const ImageBase::PixelCoordRange & range, T * image) const {
+    // Filtered images are copies held by cfitsio, which cannot be opened again.
+    if (!m_filter.empty() || range.empty() || 0 == fits_is_reentrant()) return false;
+    fitsfile * fp = m_header.getFp();
+    int status = 0;
+    if (0 == fits_is_compressed_image(fp, &status) || 0 != status) return false;
+
+    // Divide the last axis into slabs of whole tiles, so that no tile is decompressed by two threads. Each slab
+    // covers the whole range of the other axes, so it is a contiguous part of the output.
+    ImageBase::PixelCoordRange::size_type last = range.size() - 1;
+    std::vector<long> tile_dims(range.size(), 1);
+    fits_get_tile_dim(fp, tile_dims.size(), &tile_dims[0], &status);
+    if (0 != status) return false;
+    PixOrd_t tile_depth = 0 < tile_dims[last] ? tile_dims[last] : 1;
+    PixOrd_t layer_size = 1;
+    for (ImageBase::PixelCoordRange::size_type index = 0; index != last; ++index)
+      layer_size *= range[index].second - range[index].first;
+    PixOrd_t first_tile = range[last].first / tile_depth;
+    PixOrd_t num_tiles = (range[last].second + tile_depth - 1) / tile_depth - first_tile;
+
+    // Give each thread at least a million pixels, so that opening the file again costs little by comparison.
+    const PixOrd_t min_pixels = 1 << 20;
+    PixOrd_t num_threads = IFileSvc::getImageThreads();
+    if (0 == num_threads) num_threads = std::thread::hardware_concurrency();
+    if (num_threads > num_tiles) num_threads = num_tiles;
+    PixOrd_t max_threads = layer_size * (range[last].second - range[last].first) / min_pixels;
+    if (num_threads > max_threads) num_threads = max_threads;
+    if (2 > num_threads) return false;
+
+    // Make sure changes made through this image are on disk, where the new handles will read them.
+    if (!m_header.readOnly()) {
+      fits_flush_file(fp, &status);
+      if (0 != status) throw TipException(status, formatWhat("could not flush changes to the image"));
+    }
+
+    // Open the readers in this thread, because opening files is not thread safe. This object reads the first slab.
+    // The other readers have handles of their own, not shared through the pool, since they read in other threads.
+    std::vector<const FitsTypedImage *> readers(1, this);
+    std::vector<ImageBase::PixelCoordRange> slabs(num_threads, range);
+    std::vector<T *> dest(num_threads, image);
+    try {
+      for (PixOrd_t index = 0; index != num_threads; ++index) {
+        PixOrd_t begin = (first_tile + num_tiles * index / num_threads) * tile_depth;
+        PixOrd_t end = (first_tile + num_tiles * (index + 1) / num_threads) * tile_depth;
+        slabs[index][last].first = begin > range[last].first ? begin : range[last].first;
+        slabs[index][last].second = end < range[last].second ? end : range[last].second;
+        dest[index] = image + (slabs[index][last].first - range[last].first) * layer_size;
+        if (0 != index) readers.push_back(new FitsTypedImage(m_file_name, m_ext_name, "", true, FitsHeader::eUnpooled));
+      }
+    } catch (const TipException &) {
+      for (std::size_t index = 1; index < readers.size(); ++index) delete readers[index];
+      return false;
+    }
+
+    std::vector<std::exception_ptr> errors(num_threads);
+    auto work = [&](std::size_t index) {
+      try {
+        readers[index]->readSubset(slabs[index], dest[index]);
+      } catch (...) {
+        errors[index] = std::current_exception();
+      }
+    };
+
+    std::vector<std::thread> threads;
+    try {
+      for (std::size_t index = 1; index < readers.size(); ++index) threads.push_back(std::thread(work, index));
+    } catch (const std::exception &) {
+      // Could not start a thread: read the slabs of the threads which were not started here.
+      for (std::size_t index = threads.size() + 1; index < readers.size(); ++index) work(index);
     }
-    image.assign(image_tmp, image_tmp + image_size);
-    delete [] coord;
-    delete [] image_tmp;
+    work(0);
+    for (std::vector<std::thread>::iterator itor = threads.begin(); itor != threads.end(); ++itor) itor->join();
+    for (std::size_t index = 1; index < readers.size(); ++index) delete readers[index];
+
+    for (std::vector<std::exception_ptr>::iterator itor = errors.begin(); itor != errors.end(); ++itor)
+      if (*itor) std::rethrow_exception(*itor);
+    return true;
   }
 
   template <typename T>
   inline void FitsTypedImage<T>::get(const ImageBase::PixelCoordRange & range, std::vector<T> & image) const {
+    // Compute the size of the slice, and resize image array.
+    PixOrd_t slice_size = 1;
+    for (ImageBase::PixelCoordRange::size_type index = 0; index != range.size(); ++index)
+      slice_size *= range[index].second - range[index].first;
+    image.resize(slice_size);
+    if (0 >= slice_size) return;
+
+    // Decompress large slices of compressed images in parallel.
+    if (getParallel(range, &image[0])) return;
+
+    readSubset(range, &image[0]);
+  }
+
+  template <typename T>
+  inline void FitsTypedImage<T>::readSubset(const ImageBase::PixelCoordRange & range, T * image) const {
     int status = 0;
 
     // Create arrays which contain first and last pixel in cfitsio's indexing scheme.
     std::vector<long> fpixel(range.size());
     std::vector<long> lpixel(range.size());
 
-    // Interpret range to get arrays of first and last pixels, as well as the total image size.
+    // Interpret range to get arrays of first and last pixels.
     // Note: Correct for fact that lpixel is indexed starting with 1 not 0:
     //   fpixel = begin_pixel + 1 (offset for indexing)
     // However, for lpixel there is a second correction because end_pixel is defined as one past the last pixel. So:
     //   lpixel = end_pixel + 1 (offset for indexing) - 1 (end_pixel is one pixel past last pixel) = end_pixel
     // Thus, these corrections offset, and so there is no correction for lpixel.
-    PixOrd_t slice_size = 1;
     for (ImageBase::PixelCoordRange::size_type index = 0; index != range.size(); ++index) {
       fpixel[index] = range[index].first + 1; // Cfitsio indexes image coordinates starting with 1 not 0.
       lpixel[index] = range[index].second; // DO NOT add 1, because range already is 1 past the last pixel.
-      slice_size *= range[index].second - range[index].first;
     }
 
-    // Resize image array.
-    image.resize(slice_size);
-
     // Set up the down sampling array: skip no pixels.
     std::vector<long> inc(fpixel.size(), 1);
 
     // Get the image.
     fits_read_subset(m_header.getFp(), FitsPrimProps<T>::dataTypeCode(), &*fpixel.begin(), &*lpixel.begin(), &*inc.begin(),
-      0, &*image.begin(), 0, &status);
+      0, image, 0, &status);
     if (0 != status) throw TipException(status, formatWhat("could not read image subset"));
   }
 
@@ -397,6 +561,7 @@ namespace tip {
     ImageBase::PixelCoordinate coord(m_image_dimensions.size(), 1);
 
     // Write the image itself.
+    m_header.setDataModified();
     fits_write_pix(m_header.getFp(), FitsPrimProps<T>::dataTypeCode(), &*coord.begin(), image_size,
       const_cast<T *>(&*image.begin()), &status);
   }
@@ -421,6 +586,7 @@ namespace tip {
     }
 
     // Write the image itself.
+    m_header.setDataModified();
     fits_write_subset(m_header.getFp(), FitsPrimProps<T>::dataTypeCode(), &*fpixel.begin(), &*lpixel.begin(),
       const_cast<T *>(&*image.begin()), &status);
   }
@@ -0,0 +1,181 @@
+/** \file FitsMappedColumn.h
+    \brief Read-only access to fixed-width FITS binary table columns through a memory mapping of the data unit.
+*/
+#ifndef tip_FitsMappedColumn_h
+#define tip_FitsMappedColumn_h
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "fitsio.h"
+
+#include "FitsDecoder.h"
+#include "tip/IColumn.h"
+#include "tip/Table.h"
+#include "tip/TipException.h"
+#include "tip/tip_types.h"
+
+namespace tip {
+
+  /** \class FitsMappedColumn
+
+      \brief Column abstraction which reads numeric cells of an uncompressed FITS binary table straight from a
+      memory mapping of the table's data unit, applying TSCALn/TZEROn and TNULLn the same way cfitsio does.
+      Conversions which the mapping does not serve (strings, logicals, null flags of vectors, keywords) are
+      passed on to the ordinary FITS column. This is not part of the API.
+  */
+  class FitsMappedColumn : public IColumn {
+    public:
+      /** \brief Create a column which reads from the mapping.
+          \param table The table which contains the column.
+          \param fits_column The ordinary FITS column for the same field.
+          \param data Pointer to the first byte of this column in the first row of the mapped data unit.
+          \param row_width The width of a row in bytes (NAXIS1).
+          \param repeat The number of elements in each cell.
+          \param decoder Decoder for the stored values, with the column's scaling and null value.
+      */
+      FitsMappedColumn(const Table * table, IColumn * fits_column, const unsigned char * data, Index_t row_width,
+        Index_t repeat, const FitsDecoder & decoder): IColumn(fits_column->getId()), m_decoder(decoder), m_table(table),
+        m_fits_column(fits_column), m_data(data), m_row_width(row_width), m_repeat(repeat)
+        { m_units = fits_column->getUnits(); }
+
+      virtual ~FitsMappedColumn() throw() {}
+
+      virtual void get(Index_t record_index, double & dest) const { getScalar(record_index, dest); }
+      virtual void get(Index_t record_index, float & dest) const { getScalar(record_index, dest); }
+      virtual void get(Index_t record_index, char & dest) const { getScalar(record_index, dest); }
+      virtual void get(Index_t record_index, signed char & dest) const { getScalar(record_index, dest); }
+      virtual void get(Index_t record_index, signed short & dest) const { getScalar(record_index, dest); }
+      virtual void get(Index_t record_index, signed int & dest) const { getScalar(record_index, dest); }
+      virtual void get(Index_t record_index, signed long & dest) const { getScalar(record_index, dest); }
+      virtual void get(Index_t record_index, unsigned char & dest) const { getScalar(record_index, dest); }
+      virtual void get(Index_t record_index, unsigned short & dest) const { getScalar(record_index, dest); }
+      virtual void get(Index_t record_index, unsigned int & dest) const { getScalar(record_index, dest); }
+      virtual void get(Index_t record_index, unsigned long & dest) const { getScalar(record_index, dest); }
+      virtual void get(Index_t record_index, signed long long & dest) const { getScalar(record_index, dest); }
+      virtual void get(Index_t record_index, unsigned long long & dest) const { getScalar(record_index, dest); }
+
+      virtual void get(Index_t record_index, std::vector<double> & dest) const { getVector(record_index, dest); }
+      virtual void get(Index_t record_index, std::vector<float> & dest) const { getVector(record_index, dest); }
+      virtual void get(Index_t record_index, std::vector<char> & dest) const { getVector(record_index, dest); }
+      virtual void get(Index_t record_index, std::vector<signed char> & dest) const { getVector(record_index, dest); }
+      virtual void get(Index_t record_index, std::vector<signed short> & dest) const { getVector(record_index, dest); }
+      virtual void get(Index_t record_index, std::vector<signed int> & dest) const { getVector(record_index, dest); }
+      virtual void get(Index_t record_index, std::vector<signed long> & dest) const { getVector(record_index, dest); }
+      virtual void get(Index_t record_index, std::vector<unsigned char> & dest) const { getVector(record_index, dest); }
+      virtual void get(Index_t record_index, std::vector<unsigned short> & dest) const { getVector(record_index, dest); }
+      virtual void get(Index_t record_index, std::vector<unsigned int> & dest) const { getVector(record_index, dest); }
+      virtual void get(Index_t record_index, std::vector<unsigned long> & dest) const { getVector(record_index, dest); }
+      virtual void get(Index_t record_index, std::vector<signed long long> & dest) const { getVector(record_index, dest); }
+      virtual void get(Index_t record_index, std::vector<unsigned long long> & dest) const { getVector(record_index, dest); }
+
+      virtual void get(Index_t record_begin, Index_t record_end, double * dest, char * null_flags = 0) const
+        { getRange(record_begin, record_end, dest, null_flags); }
+      virtual void get(Index_t record_begin, Index_t record_end, float * dest, char * null_flags = 0) const
+        { getRange(record_begin, record_end, dest, null_flags); }
+      virtual void get(Index_t record_begin, Index_t record_end, char * dest, char * null_flags = 0) const
+        { getRange(record_begin, record_end, dest, null_flags); }
+      virtual void get(Index_t record_begin, Index_t record_end, signed char * dest, char * null_flags = 0) const
+        { getRange(record_begin, record_end, dest, null_flags); }
+      virtual void get(Index_t record_begin, Index_t record_end, signed short * dest, char * null_flags = 0) const
+        { getRange(record_begin, record_end, dest, null_flags); }
+      virtual void get(Index_t record_begin, Index_t record_end, signed int * dest, char * null_flags = 0) const
+        { getRange(record_begin, record_end, dest, null_flags); }
+      virtual void get(Index_t record_begin, Index_t record_end, signed long * dest, char * null_flags = 0) const
+        { getRange(record_begin, record_end, dest, null_flags); }
+      virtual void get(Index_t record_begin, Index_t record_end, unsigned char * dest, char * null_flags = 0) const
+        { getRange(record_begin, record_end, dest, null_flags); }
+      virtual void get(Index_t record_begin, Index_t record_end, unsigned short * dest, char * null_flags = 0) const
+        { getRange(record_begin, record_end, dest, null_flags); }
+      virtual void get(Index_t record_begin, Index_t record_end, unsigned int * dest, char * null_flags = 0) const
+        { getRange(record_begin, record_end, dest, null_flags); }
+      virtual void get(Index_t record_begin, Index_t record_end, unsigned long * dest, char * null_flags = 0) const
+        { getRange(record_begin, record_end, dest, null_flags); }
+      virtual void get(Index_t record_begin, Index_t record_end, signed long long * dest, char * null_flags = 0) const
+        { getRange(record_begin, record_end, dest, null_flags); }
+      virtual void get(Index_t record_begin, Index_t record_end, unsigned long long * dest, char * null_flags = 0) const
+        { getRange(record_begin, record_end, dest, null_flags); }
+
+      // Conversions to logicals and strings are left to cfitsio.
+      virtual void get(Index_t record_index, bool & dest) const { m_fits_column->get(record_index, dest); }
+      virtual void get(Index_t record_index, std::string & dest) const { m_fits_column->get(record_index, dest); }
+      virtual void get(Index_t record_index, std::vector<bool> & dest) const { m_fits_column->get(record_index, dest); }
+      virtual void get(Index_t record_index, std::vector<std::string> & dest) const
+        { m_fits_column->get(record_index, dest); }
+      virtual void get(Index_t record_begin, Index_t record_end, bool * dest, char * null_flags = 0) const
+        { m_fits_column->get(record_begin, record_end, dest, null_flags); }
+      virtual void get(Index_t record_begin, Index_t record_end, std::string * dest, char * null_flags = 0) const
+        { m_fits_column->get(record_begin, record_end, dest, null_flags); }
+
+      virtual bool isNull(Index_t record_index) const {
+        if (!isScalar()) throw TipException("FitsMappedColumn::isNull(Index_t) called but field is not a scalar");
+        checkRange(record_index, record_index + 1);
+        return m_decoder.isNull(m_data + record_index * m_row_width);
+      }
+
+      virtual bool getNull(Index_t record_index, bool & null_value) const { return null_value = isNull(record_index); }
+
+      virtual bool getNull(Index_t record_index, std::vector<bool> & null_value) const
+        { return m_fits_column->getNull(record_index, null_value); }
+
+      virtual bool isScalar() const { return 1 == m_repeat; }
+
+      virtual const std::string implementation() const { return "memory-mapped FITS"; }
+
+      virtual Index_t getNumElements(Index_t = 0) const { return m_repeat; }
+
+      virtual Keyword & getColumnKeyword(const std::string & name) { return m_fits_column->getColumnKeyword(name); }
+
+      virtual const Keyword & getColumnKeyword(const std::string & name) const {
+        const IColumn * fits_column = m_fits_column;
+        return fits_column->getColumnKeyword(name);
+      }
+
+      virtual std::string getFormat() const { return m_fits_column->getFormat(); }
+
+    private:
+      /** \brief Throw if the given records are not all in the table.
+      */
+      void checkRange(Index_t record_begin, Index_t record_end) const {
+        if (0 > record_begin || record_end < record_begin || m_table->getNumRecords() < record_end) {
+          std::ostringstream os;
+          os << "FitsMappedColumn::checkRange: records [" << record_begin << ", " << record_end <<
+            ") are not in the table";
+          throw TipException(BAD_ROW_NUM, os.str());
+        }
+      }
+
+      template <typename U>
+      void getScalar(Index_t record_index, U & dest) const {
+        if (!isScalar()) throw TipException("FitsMappedColumn::getScalar was called but field is not a scalar");
+        checkRange(record_index, record_index + 1);
+        m_decoder.decode(m_data + record_index * m_row_width, m_row_width, 1, &dest);
+      }
+
+      template <typename U>
+      void getVector(Index_t record_index, std::vector<U> & dest) const {
+        if (isScalar()) throw TipException("FitsMappedColumn::getVector was called but field is not a vector");
+        checkRange(record_index, record_index + 1);
+        dest.resize(m_repeat);
+        m_decoder.decode(m_data + record_index * m_row_width, m_decoder.getWidth(), m_repeat, &dest[0]);
+      }
+
+      template <typename U>
+      void getRange(Index_t record_begin, Index_t record_end, U * dest, char * null_flags) const {
+        if (!isScalar()) throw TipException("FitsMappedColumn::getRange was called but field is not a scalar");
+        checkRange(record_begin, record_end);
+        m_decoder.decode(m_data + record_begin * m_row_width, m_row_width, record_end - record_begin, dest, null_flags);
+      }
+
+      FitsDecoder m_decoder;
+      const Table * m_table;
+      IColumn * m_fits_column;
+      const unsigned char * m_data;
+      Index_t m_row_width;
+      Index_t m_repeat;
+  };
+
+}
+
+#endif
@@ -0,0 +1,143 @@
+/** \file FitsMappedTable.cxx
+
+    \brief Implementation of read-only FITS tables read through a memory mapping of the data unit.
+*/
+#include <sstream>
+
+#include "fitsio.h"
+#include "FitsDecoder.h"
+#include "FitsMappedColumn.h"
+#include "FitsMappedTable.h"
+#include "tip/TipException.h"
+
+namespace tip {
+
+  FitsMappedTable::FitsMappedTable(const std::string & file_name, const std::string & ext_name, const FieldCont & fields):
+    FitsTable(file_name, ext_name, "", true, fields), m_layout(), m_mapped_columns(), m_mapping(),
+    m_row_width(0) {
+    m_mapped_columns.resize(getValidFields().size(), 0);
+    mapData(file_name);
+  }
+
+  FitsMappedTable::~FitsMappedTable() {
+    // FITS columns belong to FitsTable, so only mapped columns are held here.
+    for (std::vector<IColumn *>::reverse_iterator itor = m_mapped_columns.rbegin(); itor != m_mapped_columns.rend(); ++itor)
+      delete *itor;
+    m_mapped_columns.clear();
+    m_mapping.unmap();
+  }
+
+  IColumn * FitsMappedTable::getColumn(FieldIndex_t field_index) {
+    if (0 > field_index || m_mapped_columns.size() <= std::vector<IColumn *>::size_type(field_index))
+      throw TipException("FitsMappedTable::getColumn called with invalid index");
+    return makeMappedColumn(field_index);
+  }
+
+  const IColumn * FitsMappedTable::getColumn(FieldIndex_t field_index) const {
+    if (0 > field_index || m_mapped_columns.size() <= std::vector<IColumn *>::size_type(field_index))
+      throw TipException("FitsMappedTable::getColumn const called with invalid index");
+    return makeMappedColumn(field_index);
+  }
+
+  Table * FitsMappedTable::openReader(const FieldCont & fields) const {
+    if (0 == fits_is_reentrant()) return 0;
+    return new FitsMappedTable(getFileName(), getExtName(), fields);
+  }
+
+  void FitsMappedTable::filterRows(const std::string & filter) {
+    // A blank filter is treated as a no-op.
+    if (std::string::npos == filter.find_first_not_of(" \t\n")) return;
+    throw TipException("FitsMappedTable::filterRows: memory-mapped table " + getName() +
+      " cannot be filtered; give the filter when opening the table instead");
+  }
+
+  void FitsMappedTable::mapData(const std::string & file_name) {
+    fitsfile * fp = getFp();
+    int status = 0;
+
+    // Only binary tables have a fixed binary layout.
+    std::string xtension;
+    getHeader().getKeyword("XTENSION", xtension);
+    if ("BINTABLE" != xtension) return;
+
+    // Work out where each field starts in a row, and which fields can be read from the mapping.
+    long row_width = 0;
+    getHeader().getKeyword("NAXIS1", row_width);
+    Index_t offset = 0;
+    m_layout.resize(m_mapped_columns.size());
+    for (std::vector<FieldLayout>::size_type index = 0; index != m_layout.size(); ++index) {
+      int col_num = index + 1;
+      int type_code = 0;
+      long repeat = 0;
+      long width = 0;
+      fits_get_coltype(fp, col_num, &type_code, &repeat, &width, &status);
+      if (0 != status) return;
+
+      Index_t num_bytes = 0;
+      if (0 > type_code) {
+        // Variable-length descriptors: 'P' is two 32-bit integers, 'Q' is two 64-bit integers.
+        std::ostringstream os;
+        os << "TFORM" << col_num;
+        std::string format;
+        getHeader().getKeyword(os.str(), format);
+        num_bytes = std::string::npos == format.find_first_of("Qq") ? 8 : 16;
+      } else if (TSTRING == type_code) {
+        num_bytes = repeat;
+      } else if (TBIT == type_code) {
+        num_bytes = (repeat + 7) / 8;
+      } else {
+        num_bytes = repeat * width;
+      }
+
+      FieldLayout & layout(m_layout[index]);
+      layout.m_offset = offset;
+      layout.m_repeat = repeat;
+      layout.m_type_code = type_code;
+      layout.m_mapped = FitsDecoder::isSupported(type_code) && 0 < repeat;
+      offset += num_bytes;
+    }
+
+    // If the layout does not add up, do not trust it.
+    if (offset != row_width) return;
+
+    // Map the rows, not including the heap.
+    if (m_mapping.map(file_name, fp, Index_t(row_width) * getNumRecords())) m_row_width = row_width;
+  }
+
+  IColumn * FitsMappedTable::makeMappedColumn(FieldIndex_t field_index) const {
+    IColumn * column = m_mapped_columns[field_index];
+    if (0 != column) return column;
+
+    // The FITS column is needed in any case, for conversions the mapping does not handle.
+    IColumn * fits_column = makeColumn(field_index);
+    if (!isMapped() || !m_layout[field_index].m_mapped) return fits_column;
+
+    const FieldLayout & layout(m_layout[field_index]);
+    fitsfile * fp = getFp();
+    int col_num = field_index + 1;
+    std::ostringstream os;
+    os << col_num;
+
+    // Get scaling and null value, which are optional.
+    int status = 0;
+    double scale = 1.;
+    fits_read_key(fp, TDOUBLE, ("TSCAL" + os.str()).c_str(), &scale, 0, &status);
+    if (KEY_NO_EXIST == status) status = 0;
+    double zero = 0.;
+    fits_read_key(fp, TDOUBLE, ("TZERO" + os.str()).c_str(), &zero, 0, &status);
+    if (KEY_NO_EXIST == status) status = 0;
+    LONGLONG null_value = 0;
+    bool has_null = true;
+    fits_read_key(fp, TLONGLONG, ("TNULL" + os.str()).c_str(), &null_value, 0, &status);
+    if (KEY_NO_EXIST == status) {
+      has_null = false;
+      status = 0;
+    }
+    if (0 != status) throw TipException(status, "FitsMappedTable::makeMappedColumn could not read scaling keywords for field " +
+      fits_column->getId());
+
+    return m_mapped_columns[field_index] = new FitsMappedColumn(this, fits_column, m_mapping.getData() + layout.m_offset,
+      m_row_width, layout.m_repeat, FitsDecoder(layout.m_type_code, scale, zero, true, has_null, null_value));
+  }
+
+}
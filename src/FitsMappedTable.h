@@ -0,0 +1,90 @@
+/** \file FitsMappedTable.h
+
+    \brief Read-only FITS binary table whose numeric columns are read through a memory mapping of the data unit.
+    This class is not part of the API.
+*/
+#ifndef tip_FitsMappedTable_h
+#define tip_FitsMappedTable_h
+
+#include <string>
+#include <vector>
+
+#include "FitsMapping.h"
+#include "FitsTable.h"
+#include "tip/IColumn.h"
+#include "tip/tip_types.h"
+
+namespace tip {
+
+  /** \class FitsMappedTable
+
+      \brief Read-only FITS table which maps the data unit of the extension into memory, and serves reads of
+      fixed-width numeric fields (B, I, J, K, E and D formats, scalar or vector) straight from the mapping,
+      without going through cfitsio's buffers. Everything else, including the header and fields of other
+      formats, is handled by FitsTable.
+
+      The table is only mapped when the file is an uncompressed local file which cfitsio reads in place;
+      otherwise, for example for gzipped files or files opened with extended syntax, the object silently
+      behaves exactly like a read-only FitsTable.
+  */
+  class FitsMappedTable : public FitsTable {
+    public:
+      /** \brief Open the given FITS extension read-only and map its data unit if possible.
+          \param file_name The name of the FITS file.
+          \param ext_name The name of the FITS extension.
+          \param fields Names of fields to set up when the table is opened, as for FitsTable.
+      */
+      FitsMappedTable(const std::string & file_name, const std::string & ext_name, const FieldCont & fields = FieldCont());
+
+      /** \brief Destructor. Unmaps the data unit, then closes the table.
+      */
+      virtual ~FitsMappedTable();
+
+      virtual IColumn * getColumn(FieldIndex_t field_index);
+
+      virtual const IColumn * getColumn(FieldIndex_t field_index) const;
+
+      /** \brief Open the same extension again, mapped if this table is mapped.
+          \param fields Names of fields to set up when the table is opened.
+      */
+      virtual Table * openReader(const FieldCont & fields = FieldCont()) const;
+
+      /** \brief Mapped tables cannot be filtered after they are opened. Filter when opening the table instead.
+      */
+      virtual void filterRows(const std::string & filter);
+
+      /** \brief Return true if the data unit was mapped, false if all reads go through cfitsio.
+      */
+      bool isMapped() const { return m_mapping.isMapped(); }
+
+    private:
+      /** \brief Layout of a field within a row of the data unit.
+      */
+      struct FieldLayout {
+        FieldLayout(): m_offset(0), m_repeat(0), m_type_code(0), m_mapped(false) {}
+        Index_t m_offset;
+        Index_t m_repeat;
+        int m_type_code;
+        bool m_mapped;
+      };
+
+      /** \brief Work out the layout of all fields, and map the data unit if the layout and file allow it.
+          \param file_name The name of the FITS file.
+      */
+      void mapData(const std::string & file_name);
+
+      /** \brief Return the mapped column for the given field, creating it first if this has not yet been done,
+          or the FITS column if the field is not mapped.
+          \param field_index The index of the field.
+      */
+      IColumn * makeMappedColumn(FieldIndex_t field_index) const;
+
+      std::vector<FieldLayout> m_layout;
+      mutable std::vector<IColumn *> m_mapped_columns;
+      FitsMapping m_mapping;
+      Index_t m_row_width;
+  };
+
+}
+
+#endif
@@ -0,0 +1,80 @@
+/** \file FitsMapping.cxx
+
+    \brief Implementation of read-only memory mapping of FITS data units.
+*/
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "FitsMapping.h"
+
+namespace tip {
+
+  bool FitsMapping::map(const std::string & file_name, fitsfile * fp, Index_t data_size) {
+    unmap();
+    if (0 >= data_size) return false;
+#ifndef _WIN32
+    int status = 0;
+    LONGLONG head_start = 0;
+    LONGLONG data_start = 0;
+    LONGLONG data_end = 0;
+    fits_get_hduaddrll(fp, &head_start, &data_start, &data_end, &status);
+    if (0 != status || data_start + data_size > data_end) return false;
+
+    // Get the first card of the header, to compare with the file.
+    char card[FLEN_CARD] = "";
+    fits_read_record(fp, 1, card, &status);
+    if (0 != status) return false;
+
+    // The name may use extended syntax, or name a compressed file or URL, in which case cfitsio does not read the
+    // file in place, and the mapping is not possible or would not match.
+    int fd = open(file_name.c_str(), O_RDONLY);
+    if (0 > fd) return false;
+    struct stat file_stat;
+    if (0 != fstat(fd, &file_stat) || file_stat.st_size < data_start + data_size) {
+      close(fd);
+      return false;
+    }
+
+    // Map from the page containing the header to the end of the requested data.
+    long page_size = sysconf(_SC_PAGESIZE);
+    off_t map_offset = head_start - head_start % page_size;
+    std::size_t map_size = data_start + data_size - map_offset;
+    void * map_addr = mmap(0, map_size, PROT_READ, MAP_SHARED, fd, map_offset);
+    close(fd);
+    if (MAP_FAILED == map_addr) return false;
+
+    // Confirm that the mapped file has this header where cfitsio has it.
+    const unsigned char * base = static_cast<const unsigned char *>(map_addr);
+    if (0 != std::memcmp(base + (head_start - map_offset), card, std::strlen(card))) {
+      munmap(map_addr, map_size);
+      return false;
+    }
+    madvise(map_addr, map_size, MADV_SEQUENTIAL);
+
+    m_map_addr = map_addr;
+    m_map_size = map_size;
+    m_data = base + (data_start - map_offset);
+    return true;
+#else
+    (void)file_name;
+    (void)fp;
+    return false;
+#endif
+  }
+
+  void FitsMapping::unmap() {
+#ifndef _WIN32
+    if (0 != m_map_addr) munmap(m_map_addr, m_map_size);
+#endif
+    m_map_addr = 0;
+    m_map_size = 0;
+    m_data = 0;
+  }
+
+}
@@ -0,0 +1,60 @@
+/** \file FitsMapping.h
+
+    \brief Read-only memory mapping of the data unit of a FITS extension. This class is not part of the API.
+*/
+#ifndef tip_FitsMapping_h
+#define tip_FitsMapping_h
+
+#include <cstddef>
+#include <string>
+
+#include "fitsio.h"
+
+#include "tip/tip_types.h"
+
+namespace tip {
+
+  /** \class FitsMapping
+
+      \brief Maps the data unit of the current HDU of an open FITS file into memory, read-only. Mapping is only
+      possible when cfitsio reads the named file in place; the mapping is checked against the header cfitsio has
+      open, so compressed files, in-memory files and names with extended syntax are simply not mapped.
+  */
+  class FitsMapping {
+    public:
+      FitsMapping(): m_map_addr(0), m_map_size(0), m_data(0) {}
+
+      /** \brief Destructor. Unmaps the data.
+      */
+      ~FitsMapping() { unmap(); }
+
+      /** \brief Map the start of the data unit of the current HDU. Returns false if this is not possible.
+          \param file_name The name of the file as given to cfitsio.
+          \param fp The open file, positioned at the HDU.
+          \param data_size The number of bytes of the data unit to map.
+      */
+      bool map(const std::string & file_name, fitsfile * fp, Index_t data_size);
+
+      /** \brief Remove the mapping, if any.
+      */
+      void unmap();
+
+      /** \brief Return the first byte of the data unit, or 0 if it is not mapped.
+      */
+      const unsigned char * getData() const { return m_data; }
+
+      bool isMapped() const { return 0 != m_data; }
+
+    private:
+      // Mappings are not copied.
+      FitsMapping(const FitsMapping &);
+      FitsMapping & operator =(const FitsMapping &);
+
+      void * m_map_addr;
+      std::size_t m_map_size;
+      const unsigned char * m_data;
+  };
+
+}
+
+#endif
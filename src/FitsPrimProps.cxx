@@ -30,6 +30,7 @@ namespace {
   unsigned int s_unsigned_int_undef = std::numeric_limits<unsigned int>::min();
   unsigned long s_unsigned_long_undef = std::numeric_limits<unsigned long>::min();
   long long s_long_long_undef = std::numeric_limits<long long>::min(); 
+  unsigned long long s_unsigned_long_long_undef = std::numeric_limits<unsigned long long>::min();
   //Need to use a structure (BitStruct in Header.h) to hold limits for TBIT, since the unsigned long primitive is already used above.
   tip::BitStruct s_bit_undef(std::numeric_limits<unsigned long>::min()) ;
  }
@@ -53,6 +54,7 @@ namespace tip {
   template <> int FitsPrimProps<unsigned int>::dataTypeCode() { return TUINT; }
   template <> int FitsPrimProps<unsigned long>::dataTypeCode() { return TULONG; }
   template <> int FitsPrimProps<long long>::dataTypeCode() { return TLONGLONG; }
+  template <> int FitsPrimProps<unsigned long long>::dataTypeCode() { return TULONGLONG; }
   template <> int FitsPrimProps<BitStruct>::dataTypeCode() { return TBIT; }
 
   template <> char * & FitsPrimProps<char *>::undefined() { return s_cp_undef; }
@@ -70,6 +72,7 @@ namespace tip {
   template <> unsigned int & FitsPrimProps<unsigned int>::undefined() { return s_unsigned_int_undef; }
   template <> unsigned long & FitsPrimProps<unsigned long>::undefined() { return s_unsigned_long_undef; }
   template <> long long & FitsPrimProps<long long>::undefined() { return s_long_long_undef; }
+  template <> unsigned long long & FitsPrimProps<unsigned long long>::undefined() { return s_unsigned_long_long_undef; }
   template <> BitStruct & FitsPrimProps<BitStruct>::undefined() { return s_bit_undef; }
 
 }
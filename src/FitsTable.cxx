@@ -5,20 +5,41 @@
     \author James Peachey, HEASARC
 */
 #include <algorithm>
+#include <cctype>
 #include <sstream>
 
 #include "fitsio.h"
 #include "FitsColumn.h"
+#include "FitsFilteredTable.h"
 #include "FitsPrimProps.h"
 #include "FitsTable.h"
 #include "tip/TipException.h"
 
+namespace {
+
+  // Return the value of a keyword as written in the header, or "" if it is absent.
+  std::string readKeyword(fitsfile * fp, const std::string & name, int & status) {
+    char value[FLEN_VALUE] = "";
+    int key_status = status;
+    fits_read_keyword(fp, const_cast<char *>(name.c_str()), value, 0, &key_status);
+    if (KEY_NO_EXIST != key_status) status = key_status;
+    return 0 == key_status ? value : "";
+  }
+
+}
+
 namespace tip {
 
   FitsTable::FitsTable(const std::string & file_name, const std::string & ext_name,
-    const std::string & filter, bool read_only): m_header(file_name, ext_name, filter, read_only),
-    m_file_name(file_name), m_filter(filter), m_col_name_lookup(), m_fields(), m_columns(),
-    m_num_records(0) { openTable(); }
+    const std::string & filter, bool read_only, const FieldCont & fields, FitsHeader::OpenMode open_mode):
+    m_header(file_name, ext_name, filter, read_only, open_mode),
+    m_file_name(file_name), m_ext_name(ext_name), m_filter(filter), m_col_name_lookup(), m_fields(), m_col_names(), m_needed_fields(fields),
+    m_columns(), m_num_records(0), m_read_ahead(0) {
+    // Field lookup is case insensitive.
+    for (FieldCont::iterator itor = m_needed_fields.begin(); itor != m_needed_fields.end(); ++itor)
+      for (std::string::iterator c_itor = itor->begin(); c_itor != itor->end(); ++c_itor) *c_itor = tolower(*c_itor);
+    openTable();
+  }
 
   // Close file automatically while destructing.
   FitsTable::~FitsTable() { close(); }
@@ -26,7 +47,9 @@ namespace tip {
   // Close file.
   void FitsTable::close(int status) {
     for (std::vector<IColumn *>::reverse_iterator itor = m_columns.rbegin(); itor != m_columns.rend(); ++itor) delete *itor;
+    m_columns.clear();
     m_fields.clear();
+    m_col_names.clear();
     m_col_name_lookup.clear();
     m_header.close(status);
   }
@@ -47,6 +70,7 @@ namespace tip {
   void FitsTable::setNumRecords(Index_t num_records) {
     if (m_header.readOnly()) throw TipException(formatWhat("setNumRecords called, but object is not writable"));
     int status = 0;
+    m_header.setDataModified();
     if (m_num_records < num_records) {
       fits_insert_rows(m_header.getFp(), m_num_records, num_records - m_num_records, &status);
       if (0 != status) throw TipException(status, formatWhat("setNumRecords could not insert rows in FITS table"));
@@ -56,6 +80,9 @@ namespace tip {
       if (0 != status) throw TipException(status, formatWhat("setNumRecords could not delete rows from FITS table"));
       m_num_records = num_records;
     }
+
+    // Discard buffered values, which may refer to rows which no longer exist.
+    if (0 != m_read_ahead) setReadAhead(m_read_ahead);
   }
 
   const Table::FieldCont & FitsTable::getValidFields() const { return m_fields; }
@@ -63,24 +90,24 @@ namespace tip {
   IColumn * FitsTable::getColumn(FieldIndex_t field_index) {
     if (0 > field_index || m_columns.size() <= std::vector<IColumn*>::size_type(field_index))
       throw TipException(formatWhat("FitsTable::getColumn called with invalid index"));
-    return m_columns[field_index];
+    return makeColumn(field_index);
   }
 
   const IColumn * FitsTable::getColumn(FieldIndex_t field_index) const {
     if (0 > field_index || m_columns.size() <= std::vector<IColumn*>::size_type(field_index))
       throw TipException(formatWhat("FitsTable::getColumn const called with invalid index"));
-    return m_columns[field_index];
+    return makeColumn(field_index);
   }
 
   FieldIndex_t FitsTable::getFieldIndex(const std::string & field_name) const {
-    // Copy field name and make it lowercase.
-    std::string lc_name = field_name;
-    for (std::string::iterator itor = lc_name.begin(); itor != lc_name.end(); ++itor) *itor = tolower(*itor);
-
-    // Find (lowercased) field_name in container of columns. Complain if not found.
-    std::map<std::string, FieldIndex_t>::const_iterator field_itor = m_col_name_lookup.find(lc_name);
+    // Find field_name in container of columns. The lookup ignores case, so no lowercased copy is needed.
+    // Complain if not found.
+    FieldLookup_t::const_iterator field_itor = m_col_name_lookup.find(field_name);
     if (field_itor == m_col_name_lookup.end())
-      throw TipException(formatWhat(std::string("Could not get field index for field ") + lc_name));
+      throw TipException(formatWhat(std::string("Could not get field index for field ") + field_name));
+
+    // Set up the column if this was deferred when the table was opened.
+    makeColumn(field_itor->second);
 
     // Get the number of the column.
     return field_itor->second;
@@ -101,6 +128,7 @@ namespace tip {
     int col_num = m_fields.size() + 1;
 
     // Call cfitsio to insert the field (column). Note: respect original case of client:
+    m_header.setDataModified();
     fits_insert_col(m_header.getFp(), col_num, const_cast<char *>(field_name.c_str()), const_cast<char *>(format.c_str()), &status);
     if (0 != status) {
       std::ostringstream os;
@@ -139,6 +167,7 @@ namespace tip {
 //      case TFLOAT: value = &FitsPrimProps<float>::undefined(); break;
 //      case TDOUBLE: value = &FitsPrimProps<double>::undefined(); break;
       case TLONGLONG: value = &FitsPrimProps<long long>::undefined(); break;
+      case TULONGLONG: value = &FitsPrimProps<unsigned long long>::undefined(); break;
 //      case TBIT: type_code = TBYTE; value = &FitsPrimProps<BitStruct>::undefined(); break;
       default: break;
     }
@@ -168,6 +197,7 @@ namespace tip {
     if (std::string::npos == filter.find_first_not_of(" \t\n")) return;
 
     int status = 0;
+    m_header.setDataModified();
     fits_flush_file(m_header.getFp(), &status);
     fits_select_rows(m_header.getFp(), m_header.getFp(), const_cast<char *>(filter.c_str()), &status);
     if (0 != status) throw TipException(status, formatWhat("filterRows had an error applying the filtering expression " + filter));
@@ -189,6 +219,74 @@ namespace tip {
     // Save the number of rows.
     m_num_records = (Index_t) nrows;
 
+    // Keep track of the filters applied to this table.
+    m_filter = m_filter.empty() ? filter : "(" + m_filter + ") && (" + filter + ")";
+
+    // Discard buffered values, which refer to the rows before filtering.
+    if (0 != m_read_ahead) setReadAhead(m_read_ahead);
+  }
+
+  void FitsTable::findRows(const std::string & filter, std::vector<char> & selected) const {
+    selected.assign(m_num_records, 0);
+    if (0 == m_num_records) return;
+
+    int status = 0;
+    long num_selected = 0;
+    fits_find_rows(m_header.getFp(), const_cast<char *>(filter.c_str()), 1, m_num_records, &num_selected, &selected[0],
+      &status);
+    if (0 != status) throw TipException(status, formatWhat("findRows had an error applying the filtering expression " + filter));
+  }
+
+  void FitsTable::copyRows(const Table * src_ext, const std::vector<Index_t> & src_records, Index_t dest_first_record) {
+    if (m_header.readOnly()) throw TipException(formatWhat("copyRows called, but object is not writable"));
+    checkCopyRows(src_ext, src_records, dest_first_record);
+    Index_t dest_end = dest_first_record + Index_t(src_records.size());
+    if (m_num_records < dest_end) setNumRecords(dest_end);
+
+    // Rows laid out the same way are copied as they are; otherwise fields are copied and converted in blocks.
+    if (!copyRowBytes(src_ext, src_records, dest_first_record)) Table::copyRows(src_ext, src_records, dest_first_record);
+  }
+
+  void FitsTable::setReadAhead(Index_t num_records) const {
+    m_read_ahead = 0 < num_records ? num_records : 0;
+    // Columns which have not been set up yet get the setting when they are created.
+    for (std::vector<IColumn *>::iterator itor = m_columns.begin(); itor != m_columns.end(); ++itor)
+      if (0 != *itor) (*itor)->setReadAhead(m_read_ahead);
+  }
+
+  void FitsTable::getReadAheadStats(unsigned long & num_hits, unsigned long & num_misses) const {
+    num_hits = 0;
+    num_misses = 0;
+    for (std::vector<IColumn *>::const_iterator itor = m_columns.begin(); itor != m_columns.end(); ++itor) {
+      if (0 == *itor) continue;
+      unsigned long column_hits = 0;
+      unsigned long column_misses = 0;
+      (*itor)->getReadAheadStats(column_hits, column_misses);
+      num_hits += column_hits;
+      num_misses += column_misses;
+    }
+  }
+
+  Index_t FitsTable::getOptimalNumRecords() const {
+    int status = 0;
+    long num_rows = 0;
+    fits_get_rowsize(m_header.getFp(), &num_rows, &status);
+    if (0 != status) throw TipException(status, formatWhat("getOptimalNumRecords could not get optimal number of rows"));
+    return 0 < num_rows ? num_rows : 1;
+  }
+
+  Table * FitsTable::openReader(const FieldCont & fields) const {
+    // Cfitsio only supports reading the same file in separate threads if it was built to be thread safe.
+    if (!m_filter.empty() || 0 == fits_is_reentrant()) return 0;
+
+    // Make sure changes made through this table are on disk, where the new handle will read them.
+    if (!readOnly()) {
+      int status = 0;
+      fits_flush_file(m_header.getFp(), &status);
+      if (0 != status) throw TipException(status, formatWhat("openReader could not flush changes to the table"));
+    }
+    // The reader is used in another thread, so it must not share this table's file through the pool.
+    return new FitsTable(m_file_name, m_ext_name, "", true, fields, FitsHeader::eUnpooled);
   }
 
   void FitsTable::openTable() {
@@ -237,9 +335,46 @@ namespace tip {
         }
       }
     } while (COL_NOT_FOUND != column_status && 0 != column_status);
+
+    // Confirm all the needed fields are present.
+    for (FieldCont::const_iterator itor = m_needed_fields.begin(); itor != m_needed_fields.end(); ++itor) {
+      if (m_col_name_lookup.end() == m_col_name_lookup.find(*itor)) {
+        close(status);
+        throw TipException(formatWhat("Could not find needed field " + *itor));
+      }
+    }
+
+    // Fields appended later are always set up at once.
+    m_needed_fields.clear();
   }
 
   void FitsTable::getColumnInfo(const std::string & col_name, Index_t col_num) {
+    // Make a lowercase copy of field name for comparison and lookup purposes:
+    std::string lc_name = col_name;
+    for (std::string::iterator itor = lc_name.begin(); itor != lc_name.end(); ++itor) *itor = tolower(*itor);
+
+    // Save column index (one less than column number) indexed on lowercased column name:
+    m_col_name_lookup[lc_name] = col_num - 1;
+
+    // Save lower cased name of field in sequential container of field names, and the original name for the column:
+    m_fields.push_back(lc_name);
+    m_col_names.push_back(col_name);
+    m_columns.push_back(0);
+
+    // Set up the column now unless it was left out of the fields needed when the table was opened.
+    if (m_needed_fields.empty() || m_needed_fields.end() != std::find(m_needed_fields.begin(), m_needed_fields.end(), lc_name))
+      makeColumn(m_columns.size() - 1);
+  }
+
+  IColumn * FitsTable::makeColumn(FieldIndex_t field_index) const {
+    IColumn * column = m_columns[field_index];
+    if (0 != column) return column;
+
+    // Columns refer back to their table, which they may modify.
+    FitsTable * self = const_cast<FitsTable *>(this);
+    const std::string & col_name(m_col_names[field_index]);
+    int col_num = field_index + 1;
+
     int type_code = 0;
     int status = 0;
 
@@ -254,43 +389,61 @@ namespace tip {
     // Handle variable-length column specifiers.
     if (0 > type_code) type_code *= -1;
 
+    // A K column offset by TZERO = 2^63 holds unsigned 64-bit values, which only the equivalent type shows.
+    if (TLONGLONG == type_code) {
+      int eq_type_code = 0;
+      fits_get_eqcoltype(m_header.getFp(), col_num, &eq_type_code, 0, 0, &status);
+      if (0 != status) {
+        std::ostringstream s;
+        s << "Could not get equivalent type information for column number " << col_num;
+        throw TipException(status, formatWhat(s.str()));
+      }
+      if (TULONGLONG == eq_type_code || -TULONGLONG == eq_type_code) type_code = TULONGLONG;
+    }
+
     // Create column abstraction for this column.
     switch (type_code) {
       case TLOGICAL:
-        m_columns.push_back(new FitsColumn<bool>(this, col_name, col_num));
+        column = new FitsColumn<bool>(self, col_name, col_num);
         break;
       case TDOUBLE:
-        m_columns.push_back(new FitsColumn<double>(this, col_name, col_num));
+        column = new FitsColumn<double>(self, col_name, col_num);
         break;
       case TFLOAT:
-        m_columns.push_back(new FitsColumn<float>(this, col_name, col_num));
+        column = new FitsColumn<float>(self, col_name, col_num);
         break;
       case TBYTE:
-        m_columns.push_back(new FitsColumn<char>(this, col_name, col_num));
+        column = new FitsColumn<char>(self, col_name, col_num);
         break;
       case TSHORT:
-        m_columns.push_back(new FitsColumn<signed short>(this, col_name, col_num));
+        column = new FitsColumn<signed short>(self, col_name, col_num);
         break;
       case TINT:
-        m_columns.push_back(new FitsColumn<signed int>(this, col_name, col_num));
+        column = new FitsColumn<signed int>(self, col_name, col_num);
         break;
       case TLONG:
-        m_columns.push_back(new FitsColumn<signed long>(this, col_name, col_num));
+        column = new FitsColumn<signed long>(self, col_name, col_num);
         break;
       case TUSHORT:
-        m_columns.push_back(new FitsColumn<unsigned short>(this, col_name, col_num));
+        column = new FitsColumn<unsigned short>(self, col_name, col_num);
         break;
       case TUINT:
-        m_columns.push_back(new FitsColumn<unsigned int>(this, col_name, col_num));
+        column = new FitsColumn<unsigned int>(self, col_name, col_num);
         break;
       case TULONG:
-        m_columns.push_back(new FitsColumn<unsigned long>(this, col_name, col_num));
+        column = new FitsColumn<unsigned long>(self, col_name, col_num);
+        break;
+      case TLONGLONG:
+        column = new FitsColumn<signed long long>(self, col_name, col_num);
+        break;
+      case TULONGLONG:
+        column = new FitsColumn<unsigned long long>(self, col_name, col_num);
         break;
       case TSTRING:
-        m_columns.push_back(new FitsColumn<std::string>(this, col_name, col_num));
+        column = new FitsColumn<std::string>(self, col_name, col_num);
         break;
       case TBIT:
-      	m_columns.push_back(new FitsColumn<BitStruct>(this, col_name, col_num));
+      	column = new FitsColumn<BitStruct>(self, col_name, col_num);
       	break;
       default: {
           std::ostringstream os;
@@ -300,16 +453,91 @@ namespace tip {
         }
     }
 
-    // Make a lowercase copy of field name for comparison and lookup purposes:
-    std::string lc_name = col_name;
-    for (std::string::iterator itor = lc_name.begin(); itor != lc_name.end(); ++itor) *itor = tolower(*itor);
 
-    // Save column number indexed on lowercased column name:
-    m_col_name_lookup[lc_name] = m_columns.size() - 1;
+    m_columns[field_index] = column;
 
-    // Save lower cased name of field in sequential container of field names:
-    m_fields.push_back(lc_name);
+    // Apply the table's read-ahead setting to the new column.
+    column->setReadAhead(m_read_ahead);
+
+    return column;
+  }
+
+  std::string FitsTable::getLayout(Index_t & row_width) const {
+    // Only rows of binary tables hold all their data, and then only if no field has variable length.
+    fitsfile * fp = m_header.getFp();
+    int status = 0;
+    int hdu_type = 0;
+    LONGLONG width = 0;
+    int num_fields = 0;
+    fits_get_hdu_type(fp, &hdu_type, &status);
+    fits_read_key(fp, TLONGLONG, const_cast<char *>("NAXIS1"), &width, 0, &status);
+    fits_read_key(fp, TINT, const_cast<char *>("TFIELDS"), &num_fields, 0, &status);
+    if (0 != status || BINARY_TBL != hdu_type || 0 >= width) return std::string();
+    row_width = width;
+
+    // Fields must have the same names, in the same order, and the same formats and scaling.
+    std::ostringstream os;
+    os << width << ' ' << num_fields;
+    const char * key_names[] = { "TTYPE", "TFORM", "TSCAL", "TZERO", "TNULL", "TDIM" };
+    for (int field = 1; field <= num_fields; ++field) {
+      for (std::size_t key = 0; key != sizeof(key_names) / sizeof(key_names[0]); ++key) {
+        std::ostringstream key_name;
+        key_name << key_names[key] << field;
+        std::string value = readKeyword(fp, key_name.str(), status);
+        for (std::string::iterator itor = value.begin(); itor != value.end(); ++itor) *itor = std::toupper(*itor);
+        if (1 == key && std::string::npos != value.find_first_of("PQ")) return std::string();
+        os << ' ' << value;
+      }
+    }
+    return 0 == status ? os.str() : std::string();
+  }
+
+  bool FitsTable::copyRowBytes(const Table * src_ext, const std::vector<Index_t> & src_records,
+    Index_t dest_first_record) {
+    // A filtered view of a FITS table is copied from the selected rows of the underlying table.
+    const FitsTable * src_table = dynamic_cast<const FitsTable *>(src_ext);
+    const std::vector<Index_t> * rows = &src_records;
+    std::vector<Index_t> view_rows;
+    const FitsFilteredTable * view = dynamic_cast<const FitsFilteredTable *>(src_ext);
+    if (0 != view) {
+      src_table = &view->getTable();
+      view_rows.reserve(src_records.size());
+      for (std::vector<Index_t>::const_iterator itor = src_records.begin(); itor != src_records.end(); ++itor)
+        view_rows.push_back(view->getRows()[*itor]);
+      rows = &view_rows;
+    }
+    if (0 == src_table) return false;
+    Index_t row_width = 0;
+    Index_t src_row_width = 0;
+    std::string layout = getLayout(row_width);
+    if (layout.empty() || layout != src_table->getLayout(src_row_width)) return false;
+
+    // Read runs of consecutive rows into a buffer, and write each full buffer at once.
+    typedef std::vector<Index_t>::size_type size_type;
+    size_type block_size = size_type(src_table->getOptimalNumRecords());
+    if (block_size > rows->size()) block_size = rows->size();
+    std::vector<unsigned char> buffer(block_size * row_width);
+    fitsfile * src_fp = src_table->getFp();
+    int status = 0;
+    m_header.setDataModified();
+    for (size_type begin = 0; 0 == status && begin < rows->size(); ) {
+      size_type end = rows->size() - begin < block_size ? rows->size() : begin + block_size;
+      for (size_type run = begin; 0 == status && run != end; ) {
+        size_type run_end = run + 1;
+        while (run_end != end && (*rows)[run_end] == (*rows)[run_end - 1] + 1) ++run_end;
+        fits_read_tblbytes(src_fp, (*rows)[run] + 1, 1, (run_end - run) * row_width, &buffer[(run - begin) * row_width],
+          &status);
+        run = run_end;
+      }
+      fits_write_tblbytes(m_header.getFp(), dest_first_record + begin + 1, 1, (end - begin) * row_width, &buffer[0],
+        &status);
+      begin = end;
+    }
 
+    // Discard buffered values, which may refer to the rows overwritten.
+    if (0 != m_read_ahead) setReadAhead(m_read_ahead);
+    if (0 != status) throw TipException(status, formatWhat("copyRows could not copy rows"));
+    return true;
   }
 
   std::string FitsTable::formatWhat(const std::string & msg) const {
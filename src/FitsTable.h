@@ -7,8 +7,10 @@
 #ifndef tip_FitsTable_h
 #define tip_FitsTable_h
 
-#include <map>
+#include <cctype>
+#include <cstddef>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "fitsio.h"
@@ -33,9 +35,14 @@ namespace tip {
       /** \brief Create an object to provide low-level access to the given FITS extension.
           \param file_name The name of the FITS file.
           \param ext_name The name of the FITS extension.
+          \param fields Names of fields to set up when the table is opened. Other fields are set up
+          the first time they are used. If empty, all fields are set up at once.
+          \param open_mode Whether to open the file through the file pool, or with a handle of its own, which may be
+          used in another thread.
       */
       FitsTable(const std::string & file_name, const std::string & ext_name,
-        const std::string & filter = "", bool read_only = true);
+        const std::string & filter = "", bool read_only = true, const FieldCont & fields = FieldCont(),
+        FitsHeader::OpenMode open_mode = FitsHeader::ePooled);
 
       /** \brief Destructor. Closes table if it is open.
       */
@@ -111,6 +118,15 @@ namespace tip {
       */
       virtual void copyRecord(const Table * src_ext, Index_t src_record, Index_t dest_record);
 
+      /** \brief Copy the given records of a source table into consecutive records of this table, adding records all
+          at once if needed. If the source is a FITS table, or a filtered view of one, with the same layout as this
+          table, the rows are copied as raw bytes; otherwise the fields are copied one at a time, in blocks.
+          \param src_ext The source table.
+          \param src_records The indices of the records to copy from the source table.
+          \param dest_first_record The index of the record of this table which receives the first record copied.
+      */
+      virtual void copyRows(const Table * src_ext, const std::vector<Index_t> & src_records, Index_t dest_first_record);
+
       /** \brief Append a field to the table.
           \param field_name The name of the field to append.
           \param format The format of the field to append, e.g. 1D for scalar double, 8J for vector long, etc.
@@ -124,32 +140,114 @@ namespace tip {
       */
       virtual void filterRows(const std::string & filter);
 
+      /** \brief Evaluate a filtering expression for every row of the table with fits_find_rows, without changing
+          the table.
+          \param filter The string containing the filtering expression.
+          \param selected Flags, one per row, set non-0 for rows which match the expression.
+      */
+      void findRows(const std::string & filter, std::vector<char> & selected) const;
+
+      /** \brief Read scalar fields ahead in blocks of records. The setting also applies to fields appended later.
+          \param num_records The number of records to read at a time. 0 disables read-ahead.
+      */
+      virtual void setReadAhead(Index_t num_records) const;
+
+      virtual void getReadAheadStats(unsigned long & num_hits, unsigned long & num_misses) const;
+
+      /** \brief Return the number of rows cfitsio can read or write at once most efficiently (fits_get_rowsize).
+      */
+      virtual Index_t getOptimalNumRecords() const;
+
+      /** \brief Open the same extension read-only with a new cfitsio handle, after flushing any changes made through
+          this table. Returns 0 if the table was filtered, because the filtered rows exist only in this table's
+          handle, or if cfitsio was not built to be thread safe.
+          \param fields Names of fields to set up when the table is opened.
+      */
+      virtual Table * openReader(const FieldCont & fields = FieldCont()) const;
+
       fitsfile * getFp() const { return m_header.getFp(); }
 
       bool readOnly() const { return m_header.readOnly(); }
 
+      /// \brief Note that values in the table have been written, so that its DATASUM is recomputed when it is closed.
+      void setDataModified() { m_header.setDataModified(); }
+
+      const std::string & getFileName() const { return m_file_name; }
+
+      const std::string & getExtName() const { return m_ext_name; }
+
     protected:
       /** \brief Open the FITS table. Exceptions will be thrown if the extension does not exist, or if
           the extension is not a table. Normally this is called by open()
       */
       void openTable();
 
-      /** \brief Get all pertinent information about a column, and store it:
+      /** \brief Register a column by name, and set it up unless it was left out of the fields needed when the
+          table was opened:
           \param col_name The name of the column.
           \param col_num The number of the column in the FITS file.
       */
       void getColumnInfo(const std::string & col_name, Index_t col_num);
 
+      /** \brief Return the column abstraction for the given field, creating it first if this has not yet been done.
+          \param field_index The index of the field, which is one less than the column number in the FITS file.
+      */
+      IColumn * makeColumn(FieldIndex_t field_index) const;
+
     private:
+      /** \brief Case-insensitive hash of field names, so that names need not be copied and lowercased to be looked up.
+      */
+      struct FieldNameHash {
+        std::size_t operator ()(const std::string & name) const {
+          // FNV-1a hash of the lowercased characters.
+          std::size_t hash = 2166136261u;
+          for (std::string::const_iterator itor = name.begin(); itor != name.end(); ++itor) {
+            hash ^= std::size_t(std::tolower(static_cast<unsigned char>(*itor)));
+            hash *= 16777619u;
+          }
+          return hash;
+        }
+      };
+
+      /** \brief Case-insensitive comparison of field names, consistent with FieldNameHash.
+      */
+      struct FieldNameEqual {
+        bool operator ()(const std::string & name1, const std::string & name2) const {
+          if (name1.size() != name2.size()) return false;
+          for (std::string::size_type index = 0; index != name1.size(); ++index) {
+            if (std::tolower(static_cast<unsigned char>(name1[index])) != std::tolower(static_cast<unsigned char>(name2[index])))
+              return false;
+          }
+          return true;
+        }
+      };
+
+      typedef std::unordered_map<std::string, FieldIndex_t, FieldNameHash, FieldNameEqual> FieldLookup_t;
+
+      /** \brief Return a description of the layout of the rows of this table, which is the same for two tables whose
+          rows may be copied from one to the other as bytes, or "" if rows of this table cannot be copied that way.
+          \param row_width The number of bytes in each row.
+      */
+      std::string getLayout(Index_t & row_width) const;
+
+      /** \brief Copy rows as raw bytes if the source has the same layout as this table. Returns false, having copied
+          nothing, if it does not.
+      */
+      bool copyRowBytes(const Table * src_ext, const std::vector<Index_t> & src_records, Index_t dest_first_record);
+
       std::string formatWhat(const std::string & msg) const;
 
       FitsHeader m_header;
       std::string m_file_name;
+      std::string m_ext_name;
       std::string m_filter;
-      std::map<std::string, FieldIndex_t> m_col_name_lookup;
+      FieldLookup_t m_col_name_lookup;
       FieldCont m_fields;
-      std::vector<IColumn *> m_columns;
+      FieldCont m_col_names;
+      FieldCont m_needed_fields;
+      mutable std::vector<IColumn *> m_columns;
       Index_t m_num_records;
+      mutable Index_t m_read_ahead;
   };
 
   // Copying cells.
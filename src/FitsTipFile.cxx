@@ -1,4 +1,6 @@
 #include "FitsTipFile.h"
+#include "FitsFileManager.h"
+#include "FitsFilePool.h"
 
 #include "fitsio.h"
 
@@ -10,12 +12,13 @@
 
 namespace tip {
 
-  FitsTipFile::FitsTipFile(const std::string & file_name): ITipFile(file_name), m_fp(0), m_read_only(true) {
+  FitsTipFile::FitsTipFile(const std::string & file_name): ITipFile(file_name), m_fp(0), m_read_only(true),
+    m_created(false) {
     openFile();
   }
 
   FitsTipFile::FitsTipFile(const std::string & file_name, const std::string & template_name, bool clobber): ITipFile(file_name),
-    m_fp(0), m_read_only(true) {
+    m_fp(0), m_read_only(true), m_created(false) {
     std::string full_name;
 
     // Handle clobber by prepending a bang or not.
@@ -28,7 +31,9 @@ namespace tip {
     // Fitsio stuff.
     int status = 0;
 
-    // Create the file.
+    // Create the file, first closing any pooled copy of the file being replaced.
+    FitsFileManager::forgetSummary(full_name);
+    FitsFilePool::instance().discard(full_name);
     fits_create_file(&m_fp, const_cast<char *>(full_name.c_str()), &status);
     if (0 != status) {
       closeFile(false, status);
@@ -46,9 +51,11 @@ namespace tip {
       }
     }
     m_read_only = false;
+    m_created = true;
   }
 
-  FitsTipFile::FitsTipFile(const FitsTipFile & file): ITipFile(file.getName()), m_fp(0), m_read_only(true) {
+  FitsTipFile::FitsTipFile(const FitsTipFile & file): ITipFile(file.getName()), m_fp(0), m_read_only(true),
+    m_created(false) {
     openFile();
   }
 
@@ -76,15 +83,20 @@ namespace tip {
     
     fitsfile * new_fp = 0;
     int status = 0;
+    FitsFileManager::forgetSummary(full_name);
+    FitsFilePool::instance().discard(full_name);
     fits_create_file(&new_fp, const_cast<char *>(full_name.c_str()), &status);
     if (0 != status) throw TipException(status, "FitsTipFile::copyFile could not create file " + new_file_name);
 
     fits_copy_file(m_fp, new_fp, 1, 1, 1, &status);
     if (0 != status) throw TipException(status, "FitsTipFile::copyFile Somethings Wrong!" + new_file_name);
     //int ignored_status = status;
-    for (int ii = 1; 0 == fits_movabs_hdu(new_fp, ii, 0, &status) && ii <= new_fp->Fptr->maxhdu; ++ii) {
+    int num_hdus = 0;
+    fits_get_num_hdus(new_fp, &num_hdus, &status);
+    for (int ii = 1; ii <= num_hdus && 0 == fits_movabs_hdu(new_fp, ii, 0, &status); ++ii) {
       // Why are write commands throwing 204 errors (VALUE_UNDEFINED?)
-      if (0 != fits_write_chksum(new_fp, &status) && VALUE_UNDEFINED != status) throw TipException(status, "FitsTipFile::copyFile could not update checksum for " + new_file_name);
+      FitsFileManager::updateChecksum(new_fp, new_file_name, true, true, status);
+      if (0 != status && VALUE_UNDEFINED != status) throw TipException(status, "FitsTipFile::copyFile could not update checksum for " + new_file_name);
       status = 0;
     }
     //Previous loop should throw status != 0 when complete.  Look up error name and run check.
@@ -103,11 +115,14 @@ namespace tip {
   void FitsTipFile::openFile() {
     int status = 0;
     m_read_only = false;
-    fits_open_file(&m_fp, const_cast<char *>(getName().c_str()), READWRITE, &status);
-    if (0 != status) {
+    m_fp = FitsFilePool::instance().open(getName(), "", READWRITE, status);
+    if (0 == status) {
+      // A file open for writing may change, so its cached summary is no longer used.
+      FitsFileManager::forgetSummary(getName());
+    } else {
       status = 0;
       m_read_only = true;
-      fits_open_file(&m_fp, const_cast<char *>(getName().c_str()), READONLY, &status);
+      m_fp = FitsFilePool::instance().open(getName(), "", READONLY, status);
 
       if (0 != status && VALUE_UNDEFINED != status)
         throw TipException(status, "FitsTipFile::openFile could not open " + getName() + " either read/write or read-only");
@@ -115,10 +130,16 @@ namespace tip {
   }
 
   void FitsTipFile::closeFile(bool update_checksum, int status) {
+    // Extensions are changed through their own objects, which update their own checksums, so unless every checksum
+    // is to be updated, only the extensions of a file created here need updating.
+    if (!m_created && IFileSvc::eChecksumAlways != IFileSvc::getChecksumPolicy()) update_checksum = false;
     if (update_checksum && 0 == status) {
       //int ignored_status = 0;
-      for (int ii = 1; 0 == fits_movabs_hdu(m_fp, ii, 0, &status) && ii <= m_fp->Fptr->maxhdu; ++ii) {
-        if (fits_write_chksum(m_fp, &status) && VALUE_UNDEFINED != status) throw TipException(status, "FitsTipFile::closeFile could not update checksum.");
+      int num_hdus = 0;
+      fits_get_num_hdus(m_fp, &num_hdus, &status);
+      for (int ii = 1; ii <= num_hdus && 0 == fits_movabs_hdu(m_fp, ii, 0, &status); ++ii) {
+        FitsFileManager::updateChecksum(m_fp, getName(), true, true, status);
+        if (0 != status && VALUE_UNDEFINED != status) throw TipException(status, "FitsTipFile::closeFile could not update checksum.");
 	status = 0;
       }
     }
@@ -127,7 +148,8 @@ namespace tip {
     } else if (0 != status && VALUE_UNDEFINED != status) { 
       throw TipException(status, "FitsTipFile::copyFile could not update checksum for this file!!!!");
     }
-    fits_close_file(m_fp, &status);
+    FitsFilePool::instance().close(m_fp, status);
+    if (!m_read_only) FitsFileManager::forgetSummary(getName());
     m_fp = 0;
   }
 
@@ -67,6 +67,7 @@ namespace tip {
     private:
       fitsfile * m_fp;
       bool m_read_only;
+      bool m_created;
   };
 }
 
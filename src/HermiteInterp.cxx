@@ -0,0 +1,132 @@
+/** \file HermiteInterp.cxx
+
+    \brief Utility to interpolate values in tables with cubic Hermite splines.
+    Table must be ordered on the field used to interpolate.
+*/
+#include <algorithm>
+#include <cmath>
+
+#include "tip/HermiteInterp.h"
+#include "tip/IColumn.h"
+#include "tip/TipException.h"
+
+namespace tip {
+
+  HermiteInterp::HermiteInterp(const Table::ConstIterator & begin, const Table::ConstIterator & end,
+    SlopeMethod method): IndexedLinearInterp(begin, end), m_method(method), m_splines() {}
+
+  void HermiteInterp::interpolate(const std::string &, const std::vector<double> &, const Table::FieldCont &,
+    std::vector<std::vector<double> > &) {
+    throw TipException("HermiteInterp::interpolate() cannot interpolate many values in one call");
+  }
+
+  double HermiteInterp::get(const std::string & field) const {
+    const Spline & spline(getSpline(field));
+    if (1 != spline.m_num_elements)
+      throw TipException("HermiteInterp::get(const std::string &) called for field " + field + " which is not a scalar");
+    std::vector<double> value;
+    get(field, value);
+    return value[0];
+  }
+
+  void HermiteInterp::get(const std::string & field, std::vector<double> & value) const {
+    const Spline & spline(getSpline(field));
+    Index_t interval = getInterval();
+    const std::vector<double> & x(getAbscissa());
+    double h = x[interval + 1] - x[interval];
+    double t = getFraction();
+
+    // Hermite basis functions.
+    double h00 = (1. + 2. * t) * (1. - t) * (1. - t);
+    double h10 = t * (1. - t) * (1. - t) * h;
+    double h01 = t * t * (3. - 2. * t);
+    double h11 = t * t * (t - 1.) * h;
+
+    std::size_t num_elements = spline.m_num_elements;
+    const double * y0 = &spline.m_value[interval * num_elements];
+    const double * m0 = &spline.m_slope[interval * num_elements];
+    const double * y1 = y0 + num_elements;
+    const double * m1 = m0 + num_elements;
+    value.resize(num_elements);
+    for (std::size_t ii = 0; ii != num_elements; ++ii)
+      value[ii] = h00 * y0[ii] + h10 * m0[ii] + h01 * y1[ii] + h11 * m1[ii];
+  }
+
+  const HermiteInterp::Spline & HermiteInterp::getSpline(const std::string & field) const {
+    // Confirm there is an interval first, so that errors are the same as for the other interpolators.
+    getInterval();
+
+    const Table * table = getTable();
+    FieldIndex_t field_index = table->getFieldIndex(field);
+    Spline & spline(m_splines[field_index]);
+    if (getAbscissaIndex() == spline.m_abscissa_index) return spline;
+
+    // Read every record of the range: scalar fields in one bulk read, vector fields record by record.
+    spline.m_abscissa_index = -1;
+    const IColumn * column = table->getColumn(field_index);
+    Index_t begin_index = getBeginIndex();
+    Index_t num_records = getNumRecords();
+    if (column->isScalar()) {
+      spline.m_num_elements = 1;
+      spline.m_value.resize(num_records);
+      column->get(begin_index, begin_index + num_records, &spline.m_value[0]);
+    } else {
+      std::vector<double> row;
+      for (Index_t record = 0; record != num_records; ++record) {
+        column->get(begin_index + record, row);
+        if (0 == record) {
+          spline.m_num_elements = row.size();
+          spline.m_value.resize(num_records * row.size());
+        } else if (row.size() != spline.m_num_elements) {
+          throw TipException("HermiteInterp::get() called for field " + field + " whose number of elements varies");
+        }
+        std::copy(row.begin(), row.end(), spline.m_value.begin() + record * row.size());
+      }
+    }
+
+    spline.m_slope.resize(spline.m_value.size());
+    for (std::size_t ii = 0; ii != spline.m_num_elements; ++ii)
+      computeSlopes(getAbscissa(), &spline.m_value[ii], spline.m_num_elements, &spline.m_slope[ii]);
+    spline.m_abscissa_index = getAbscissaIndex();
+    return spline;
+  }
+
+  void HermiteInterp::computeSlopes(const std::vector<double> & x, const double * y, std::size_t stride,
+    double * slope) const {
+    std::size_t num_records = x.size();
+    if (2 > num_records) return;
+
+    // Slopes of the intervals, with two made-up intervals at each end as Akima prescribes. Intervals of 0 width
+    // have no slope of their own, and never contain a value, so use 0.
+    std::vector<double> secant(num_records + 3);
+    for (std::size_t ii = 0; ii + 1 != num_records; ++ii) {
+      double h = x[ii + 1] - x[ii];
+      secant[ii + 2] = 0. != h ? (y[(ii + 1) * stride] - y[ii * stride]) / h : 0.;
+    }
+    if (2 == num_records) {
+      slope[0] = slope[stride] = secant[2];
+      return;
+    }
+    secant[1] = 2. * secant[2] - secant[3];
+    secant[0] = 2. * secant[1] - secant[2];
+    secant[num_records + 1] = 2. * secant[num_records] - secant[num_records - 1];
+    secant[num_records + 2] = 2. * secant[num_records + 1] - secant[num_records];
+
+    // The slope at record ii uses the intervals ii - 2 to ii + 1, which are secant[ii] to secant[ii + 3].
+    for (std::size_t ii = 0; ii != num_records; ++ii) {
+      const double * d = &secant[ii];
+      double value = .5 * (d[1] + d[2]);
+      if (eAkima == m_method) {
+        double w1 = std::fabs(d[3] - d[2]);
+        double w2 = std::fabs(d[1] - d[0]);
+        if (0. < w1 + w2) value = (w1 * d[1] + w2 * d[2]) / (w1 + w2);
+      } else if (0 == ii) {
+        value = d[2];
+      } else if (num_records - 1 == ii) {
+        value = d[1];
+      }
+      slope[ii * stride] = value;
+    }
+  }
+
+}
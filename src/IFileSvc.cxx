@@ -9,9 +9,13 @@
 #include <memory>
 
 #include "FitsFileManager.h"
+#include "FitsFilePool.h"
+#include "FitsFilteredTable.h"
 #include "FitsImage.h"
+#include "FitsMappedTable.h"
 #include "FitsTable.h"
 #include "FitsTipFile.h"
+#include "RowIndexCache.h"
 #include "tip/Extension.h"
 #include "tip/FileSummary.h"
 #include "tip/IFileSvc.h"
@@ -30,6 +34,65 @@ namespace {
     return s_tmp_file_name;
   }
 
+  bool & s_getMapTables() {
+    static bool s_map_tables = false;
+    return s_map_tables;
+  }
+
+  bool & s_getFilterViews() {
+    static bool s_filter_views = false;
+    return s_filter_views;
+  }
+
+  bool & s_getCompiledFilters() {
+    static bool s_compiled_filters = false;
+    return s_compiled_filters;
+  }
+
+  std::string & s_getIndexCacheDir() {
+    static std::string s_index_cache_dir;
+    return s_index_cache_dir;
+  }
+
+  unsigned int & s_getImageThreads() {
+    static unsigned int s_image_threads = 0;
+    return s_image_threads;
+  }
+
+  unsigned int & s_getChecksumThreads() {
+    static unsigned int s_checksum_threads = 0;
+    return s_checksum_threads;
+  }
+
+  tip::IFileSvc::ChecksumPolicy & s_getChecksumPolicy() {
+    static tip::IFileSvc::ChecksumPolicy s_checksum_policy = tip::IFileSvc::eChecksumModified;
+    return s_checksum_policy;
+  }
+
+  /** \brief Open a view of the rows of a FITS table which match a filter, reusing the rows stored in the index
+      cache if one is in use and its entry is up to date, and storing them there otherwise.
+  */
+  tip::Table * openView(tip::FitsTable * table, const std::string & file_name, const std::string & table_name,
+    const std::string & filter) {
+    using namespace tip;
+    std::unique_ptr<FitsTable> owned_table(table);
+    const std::string & dir_name(s_getIndexCacheDir());
+    if (dir_name.empty()) return new FitsFilteredTable(owned_table.release(), filter);
+
+    RowIndexCache cache(dir_name, s_getCompiledFilters());
+    std::shared_ptr<RowIndexCache::RowCont_t> rows(new RowIndexCache::RowCont_t);
+    if (cache.load(file_name, table_name, filter, *table, *rows))
+      return new FitsFilteredTable(owned_table.release(), rows);
+
+    std::unique_ptr<FitsFilteredTable> view(new FitsFilteredTable(owned_table.release(), filter));
+    try {
+      cache.store(file_name, table_name, filter, *table, view->getRows());
+    } catch (const TipException &) {
+      // The cache only saves time, so failing to write it, e.g. to a full disk, does not fail the read.
+    }
+    return view.release();
+  }
+
 }
 
 namespace tip {
@@ -70,6 +133,82 @@ namespace tip {
     s_getTmpFileName() = tmp_file_name;
   }
 
+  bool IFileSvc::getMapTables() {
+    return s_getMapTables();
+  }
+
+  void IFileSvc::setMapTables(bool map_tables) {
+    s_getMapTables() = map_tables;
+  }
+
+  bool IFileSvc::getFilterViews() {
+    return s_getFilterViews();
+  }
+
+  void IFileSvc::setFilterViews(bool filter_views) {
+    s_getFilterViews() = filter_views;
+  }
+
+  bool IFileSvc::getCompiledFilters() {
+    return s_getCompiledFilters();
+  }
+
+  void IFileSvc::setCompiledFilters(bool compiled_filters) {
+    s_getCompiledFilters() = compiled_filters;
+  }
+
+  const std::string & IFileSvc::getIndexCacheDir() {
+    return s_getIndexCacheDir();
+  }
+
+  void IFileSvc::setIndexCacheDir(const std::string & dir_name) {
+    s_getIndexCacheDir() = dir_name;
+  }
+
+  unsigned int IFileSvc::getImageThreads() {
+    return s_getImageThreads();
+  }
+
+  void IFileSvc::setImageThreads(unsigned int num_threads) {
+    s_getImageThreads() = num_threads;
+  }
+
+  unsigned int IFileSvc::getFilePoolSize() {
+    return FitsFilePool::instance().getMaxFiles();
+  }
+
+  void IFileSvc::setFilePoolSize(unsigned int max_files) {
+    FitsFilePool::instance().setMaxFiles(max_files);
+  }
+
+  void IFileSvc::getFilePoolStats(unsigned long & num_hits, unsigned long & num_misses) {
+    FitsFilePool::instance().getStats(num_hits, num_misses);
+  }
+
+  IFileSvc::ChecksumPolicy IFileSvc::getChecksumPolicy() {
+    return s_getChecksumPolicy();
+  }
+
+  void IFileSvc::setChecksumPolicy(ChecksumPolicy policy) {
+    s_getChecksumPolicy() = policy;
+  }
+
+  void IFileSvc::finalize() {
+    FitsFileManager::finalizeChecksums();
+  }
+
+  unsigned long long IFileSvc::getNumChecksumBytes() {
+    return FitsFileManager::getNumChecksumBytes();
+  }
+
+  unsigned int IFileSvc::getChecksumThreads() {
+    return s_getChecksumThreads();
+  }
+
+  void IFileSvc::setChecksumThreads(unsigned int num_threads) {
+    s_getChecksumThreads() = num_threads;
+  }
+
   // Destructor for a file service.
   IFileSvc::~IFileSvc() {
   }
@@ -79,6 +218,11 @@ namespace tip {
     FitsFileManager::createFile(file_name, template_name, clobber);
   }
 
+  void IFileSvc::createFile(const std::string & file_name, ImageBase::PixelType pixel_type,
+    const ImageBase::PixelCoordinate & dims, double scale, double zero, bool clobber) {
+    FitsFileManager::createFile(file_name, pixel_type, dims, scale, zero, clobber);
+  }
+
   TipFile IFileSvc::createMemFile(const std::string & file_name, const std::string & template_name, bool clobber) {
     return FitsFileManager::createMemFile(file_name, template_name, clobber);
   }
@@ -92,6 +236,17 @@ namespace tip {
     FitsFileManager::appendImage(file_name, image_name, dims);
   }
 
+  void IFileSvc::appendImage(const std::string & file_name, const std::string & image_name,
+    const ImageBase::PixelCoordinate & dims, const ImageCompression & compression) {
+    FitsFileManager::appendImage(file_name, image_name, dims, ImageBase::eFloat, 1., 0., compression);
+  }
+
+  void IFileSvc::appendImage(const std::string & file_name, const std::string & image_name,
+    const ImageBase::PixelCoordinate & dims, ImageBase::PixelType pixel_type, double scale, double zero,
+    const ImageCompression & compression) {
+    FitsFileManager::appendImage(file_name, image_name, dims, pixel_type, scale, zero, compression);
+  }
+
   void IFileSvc::appendTable(const std::string & file_name, const std::string & table_name) {
     FitsFileManager::appendTable(file_name, table_name);
   }
@@ -111,6 +266,11 @@ namespace tip {
   // Open read-write an extension in a file, be it FITS or Root, table or image.
   Extension * IFileSvc::editExtension(const std::string & file_name, const std::string & ext_name,
     const std::string & filter) {
+    // An extension known from the file's summary to be an image need not be tried as a table first.
+    ExtSummary ext_summary("");
+    if (FitsFileManager::findExtension(file_name, ext_name, ext_summary) && ext_summary.isImage())
+      return editImage(file_name, ext_name, filter);
+
     Extension * ext = 0;
     try {
       ext = editTable(file_name, ext_name, filter);
@@ -138,39 +298,36 @@ namespace tip {
   }
 
   // Edit a image in a file, be it FITS or Root.
-  TypedImage<double> * IFileSvc::editImageDbl(const std::string & file_name, const std::string & table_name,
+  template <typename T>
+  TypedImage<T> * IFileSvc::editImage(const std::string & file_name, const std::string & image_name,
     const std::string & filter) {
-    TypedImage<double> * image = 0;
+    TypedImage<T> * image = 0;
     std::string file_type = classifyFile(file_name);
     if (file_type == "fits")
-      image = new FitsTypedImage<double>(file_name, table_name, filter, false);
+      image = new FitsTypedImage<T>(file_name, image_name, filter, false);
     else if (file_type == "root")
       throw TipException("Root images are not supported.");
     return image;
   }
 
-  // Edit a image in a file, be it FITS or Root.
+  TypedImage<double> * IFileSvc::editImageDbl(const std::string & file_name, const std::string & table_name,
+    const std::string & filter) {
+    return editImage<double>(file_name, table_name, filter);
+  }
+
   TypedImage<float> * IFileSvc::editImageFlt(const std::string & file_name, const std::string & table_name,
     const std::string & filter) {
-    TypedImage<float> * image = 0;
-    std::string file_type = classifyFile(file_name);
-    if (file_type == "fits")
-      image = new FitsTypedImage<float>(file_name, table_name, filter, false);
-    else if (file_type == "root")
-      throw TipException("Root images are not supported.");
-    return image;
+    return editImage<float>(file_name, table_name, filter);
   }
 
-  // Edit a image in a file, be it FITS or Root.
   TypedImage<int> * IFileSvc::editImageInt(const std::string & file_name, const std::string & table_name,
     const std::string & filter) {
-    TypedImage<int> * image = 0;
-    std::string file_type = classifyFile(file_name);
-    if (file_type == "fits")
-      image = new FitsTypedImage<int>(file_name, table_name, filter, false);
-    else if (file_type == "root")
-      throw TipException("Root images are not supported.");
-    return image;
+    return editImage<int>(file_name, table_name, filter);
+  }
+
+  TypedImage<long long> * IFileSvc::editImageLongLong(const std::string & file_name, const std::string & table_name,
+    const std::string & filter) {
+    return editImage<long long>(file_name, table_name, filter);
   }
 
   // Edit a table in a file, be it FITS or Root.
@@ -190,6 +347,11 @@ namespace tip {
   // Read-only an extension in a file, be it FITS or Root, table or image.
   const Extension * IFileSvc::readExtension(const std::string & file_name, const std::string & ext_name,
     const std::string & filter) {
+    // An extension known from the file's summary to be an image need not be tried as a table first.
+    ExtSummary ext_summary("");
+    if (FitsFileManager::findExtension(file_name, ext_name, ext_summary) && ext_summary.isImage())
+      return readImage(file_name, ext_name, filter);
+
     const Extension * ext = 0;
     try {
       ext = readTable(file_name, ext_name, filter);
@@ -205,56 +367,74 @@ namespace tip {
   }
 
   // Read-only an image in a file, be it FITS or Root.
-  const TypedImage<double> * IFileSvc::readImageDbl(const std::string & file_name, const std::string & table_name,
+  template <typename T>
+  const TypedImage<T> * IFileSvc::readImage(const std::string & file_name, const std::string & image_name,
     const std::string & filter) {
-    TypedImage<double> * image = 0;
+    TypedImage<T> * image = 0;
     std::string file_type = classifyFile(file_name);
     if (file_type == "fits")
-      image = new FitsTypedImage<double>(file_name, table_name, filter, true);
-#ifndef BUILD_WITHOUT_ROOT
+      image = new FitsTypedImage<T>(file_name, image_name, filter, true);
     else if (file_type == "root")
       throw TipException("Root images are not supported.");
-#endif
     return image;
   }
 
-  // Read-only an image in a file, be it FITS or Root.
+  const TypedImage<double> * IFileSvc::readImageDbl(const std::string & file_name, const std::string & table_name,
+    const std::string & filter) {
+    return readImage<double>(file_name, table_name, filter);
+  }
+
   const TypedImage<float> * IFileSvc::readImageFlt(const std::string & file_name, const std::string & table_name,
     const std::string & filter) {
-    TypedImage<float> * image = 0;
-    std::string file_type = classifyFile(file_name);
-    if (file_type == "fits")
-      image = new FitsTypedImage<float>(file_name, table_name, filter, true);
-#ifndef BUILD_WITHOUT_ROOT
-    else if (file_type == "root")
-      throw TipException("Root images are not supported.");
-#endif
-    return image;
+    return readImage<float>(file_name, table_name, filter);
   }
 
-  // Read-only an image in a file, be it FITS or Root.
   const TypedImage<int> * IFileSvc::readImageInt(const std::string & file_name, const std::string & table_name,
     const std::string & filter) {
-    TypedImage<int> * image = 0;
+    return readImage<int>(file_name, table_name, filter);
+  }
+
+  const TypedImage<long long> * IFileSvc::readImageLongLong(const std::string & file_name, const std::string & table_name,
+    const std::string & filter) {
+    return readImage<long long>(file_name, table_name, filter);
+  }
+
+  // Read-only a table in a file, be it FITS or Root.
+  const Table * IFileSvc::readTable(const std::string & file_name, const std::string & table_name,
+    const std::string & filter) {
+    Table * table = 0;
     std::string file_type = classifyFile(file_name);
-    if (file_type == "fits")
-      image = new FitsTypedImage<int>(file_name, table_name, filter, true);
+    bool blank_filter = std::string::npos == filter.find_first_not_of(" \t\n");
+    if (file_type == "fits" && (getFilterViews() || !getIndexCacheDir().empty()) && !blank_filter)
+      table = openView(getMapTables() ? new FitsMappedTable(file_name, table_name) :
+        new FitsTable(file_name, table_name, "", true), file_name, table_name, filter);
+    else if (file_type == "fits" && getMapTables() && blank_filter)
+      table = new FitsMappedTable(file_name, table_name);
+    else if (file_type == "fits")
+      table = new FitsTable(file_name, table_name, filter, true);
 #ifndef BUILD_WITHOUT_ROOT
     else if (file_type == "root")
-      throw TipException("Root images are not supported.");
+      table = new RootTable(file_name, table_name, filter, true);
 #endif
-    return image;
+    return table;
   }
 
-  // Read-only a table in a file, be it FITS or Root.
+  // Read-only a table in a file, be it FITS or Root, setting up only the needed fields.
   const Table * IFileSvc::readTable(const std::string & file_name, const std::string & table_name,
-    const std::string & filter) {
+    const std::string & filter, const std::vector<std::string> & fields) {
     Table * table = 0;
     std::string file_type = classifyFile(file_name);
-    if (file_type == "fits")
-      table = new FitsTable(file_name, table_name, filter, true);
+    bool blank_filter = std::string::npos == filter.find_first_not_of(" \t\n");
+    if (file_type == "fits" && (getFilterViews() || !getIndexCacheDir().empty()) && !blank_filter)
+      table = openView(getMapTables() ? new FitsMappedTable(file_name, table_name, fields) :
+        new FitsTable(file_name, table_name, "", true, fields), file_name, table_name, filter);
+    else if (file_type == "fits" && getMapTables() && blank_filter)
+      table = new FitsMappedTable(file_name, table_name, fields);
+    else if (file_type == "fits")
+      table = new FitsTable(file_name, table_name, filter, true, fields);
 #ifndef BUILD_WITHOUT_ROOT
     else if (file_type == "root")
+      // Root tables already activate branches only when their fields are first looked up.
       table = new RootTable(file_name, table_name, filter, true);
 #endif
     return table;
@@ -305,4 +485,34 @@ namespace tip {
   // Protected constructor which adds the current object to the registry of IFileSvc objects.
   IFileSvc::IFileSvc() {}
 
+  // The pixel types supported by editImage and readImage.
+  template TypedImage<unsigned char> * IFileSvc::editImage<unsigned char>(const std::string &, const std::string &,
+    const std::string &);
+  template TypedImage<short> * IFileSvc::editImage<short>(const std::string &, const std::string &,
+    const std::string &);
+  template TypedImage<unsigned short> * IFileSvc::editImage<unsigned short>(const std::string &, const std::string &,
+    const std::string &);
+  template TypedImage<int> * IFileSvc::editImage<int>(const std::string &, const std::string &,
+    const std::string &);
+  template TypedImage<long long> * IFileSvc::editImage<long long>(const std::string &, const std::string &,
+    const std::string &);
+  template TypedImage<float> * IFileSvc::editImage<float>(const std::string &, const std::string &,
+    const std::string &);
+  template TypedImage<double> * IFileSvc::editImage<double>(const std::string &, const std::string &,
+    const std::string &);
+  template const TypedImage<unsigned char> * IFileSvc::readImage<unsigned char>(const std::string &, const std::string &,
+    const std::string &);
+  template const TypedImage<short> * IFileSvc::readImage<short>(const std::string &, const std::string &,
+    const std::string &);
+  template const TypedImage<unsigned short> * IFileSvc::readImage<unsigned short>(const std::string &, const std::string &,
+    const std::string &);
+  template const TypedImage<int> * IFileSvc::readImage<int>(const std::string &, const std::string &,
+    const std::string &);
+  template const TypedImage<long long> * IFileSvc::readImage<long long>(const std::string &, const std::string &,
+    const std::string &);
+  template const TypedImage<float> * IFileSvc::readImage<float>(const std::string &, const std::string &,
+    const std::string &);
+  template const TypedImage<double> * IFileSvc::readImage<double>(const std::string &, const std::string &,
+    const std::string &);
+
 }
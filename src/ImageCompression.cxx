@@ -0,0 +1,30 @@
+/** \file ImageCompression.cxx
+    \brief Description of how the pixels of a new image are to be tile-compressed.
+*/
+#include "tip/ImageCompression.h"
+
+namespace tip {
+
+  ImageCompression::ImageCompression(Algorithm algorithm, const ImageBase::PixelCoordinate & tile_shape):
+    m_algorithm(algorithm), m_tile_shape(tile_shape), m_quantize_level(0.f), m_hcompress_scale(0.f),
+    m_hcompress_smooth(false) {}
+
+  ImageCompression::Algorithm ImageCompression::getAlgorithm() const { return m_algorithm; }
+
+  bool ImageCompression::isCompressed() const { return eNone != m_algorithm; }
+
+  const ImageBase::PixelCoordinate & ImageCompression::getTileShape() const { return m_tile_shape; }
+
+  float ImageCompression::getQuantizeLevel() const { return m_quantize_level; }
+
+  void ImageCompression::setQuantizeLevel(float quantize_level) { m_quantize_level = quantize_level; }
+
+  float ImageCompression::getHCompressScale() const { return m_hcompress_scale; }
+
+  void ImageCompression::setHCompressScale(float scale) { m_hcompress_scale = scale; }
+
+  bool ImageCompression::getHCompressSmooth() const { return m_hcompress_smooth; }
+
+  void ImageCompression::setHCompressSmooth(bool smooth) { m_hcompress_smooth = smooth; }
+
+}
@@ -0,0 +1,300 @@
+/** \file IndexedLinearInterp.cxx
+
+    \brief Utility to interpolate values in tables, searching an in-memory copy of the field used to interpolate.
+    Table must be ordered on the field used to interpolate.
+*/
+#include <algorithm>
+#include <cstddef>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TIP_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+#include "tip/IColumn.h"
+#include "tip/IndexedLinearInterp.h"
+#include "tip/TipException.h"
+
+namespace {
+
+  /** \brief Portable kernel computing result[i] = coeff0[i] * y0[i] + coeff1[i] * y1[i].
+  */
+  void weightedSumScalar(const double * coeff0, const double * y0, const double * coeff1, const double * y1,
+    std::size_t num_values, double * result) {
+    for (std::size_t ii = 0; ii != num_values; ++ii) result[ii] = coeff0[ii] * y0[ii] + coeff1[ii] * y1[ii];
+  }
+
+#ifdef TIP_X86_KERNELS
+  /** \brief AVX kernel computing the same sums four at a time. Multiplies and adds are kept separate so that
+      results are identical to the portable kernel and to LinearInterp.
+  */
+  __attribute__((target("avx"))) void weightedSumAvx(const double * coeff0, const double * y0, const double * coeff1,
+    const double * y1, std::size_t num_values, double * result) {
+    std::size_t ii = 0;
+    for (; ii + 4 <= num_values; ii += 4) {
+      __m256d sum0 = _mm256_mul_pd(_mm256_loadu_pd(coeff0 + ii), _mm256_loadu_pd(y0 + ii));
+      __m256d sum1 = _mm256_mul_pd(_mm256_loadu_pd(coeff1 + ii), _mm256_loadu_pd(y1 + ii));
+      _mm256_storeu_pd(result + ii, _mm256_add_pd(sum0, sum1));
+    }
+    weightedSumScalar(coeff0 + ii, y0 + ii, coeff1 + ii, y1 + ii, num_values - ii, result + ii);
+  }
+#endif
+
+  /** \brief Compute weighted sums with the fastest kernel this processor supports.
+  */
+  void weightedSum(const double * coeff0, const double * y0, const double * coeff1, const double * y1,
+    std::size_t num_values, double * result) {
+#ifdef TIP_X86_KERNELS
+    static const bool s_has_avx = 0 != __builtin_cpu_supports("avx");
+    if (s_has_avx) {
+      weightedSumAvx(coeff0, y0, coeff1, y1, num_values, result);
+      return;
+    }
+#endif
+    weightedSumScalar(coeff0, y0, coeff1, y1, num_values, result);
+  }
+
+}
+
+namespace tip {
+
+  IndexedLinearInterp::IndexedLinearInterp(const Table::ConstIterator & begin, const Table::ConstIterator & end):
+    m_table((*begin).getExtensionData()), m_begin_index((*begin).getIndex()),
+    m_num_records((*end).getIndex() - (*begin).getIndex()), m_abscissa_index(-1), m_abscissa(), m_cursor(0), m_match(),
+    m_coeff(), m_rows() {
+    if (0 > m_num_records)
+      throw TipException("IndexedLinearInterp::IndexedLinearInterp() called with end before begin");
+    m_match[0] = m_match[1] = -1;
+  }
+
+  void IndexedLinearInterp::interpolate(const std::string & field, double value) {
+    m_match[0] = -1;
+    m_match[1] = -1;
+
+    loadAbscissa(m_table->getFieldIndex(field), field);
+
+    // Find first interval which might contain the value. A NaN is not in any interval.
+    Index_t after = value == value ? findAfter(value) : m_num_records;
+
+    // Check ranges.
+    if (0 == after)
+      throw TipException("IndexedLinearInterp::interpolate() called for a value before the first value in range");
+    else if (m_num_records == after)
+      throw TipException("IndexedLinearInterp::interpolate() called for a value after the last value in range");
+    m_cursor = after;
+
+    double x0 = m_abscissa[after - 1];
+    double x1 = m_abscissa[after];
+    double D = x1 - x0;
+
+    if (0. == D)
+      throw TipException("IndexedLinearInterp::interpolate() called for an interpolation interval of 0 width");
+
+    // Success: save the records and determine coefficients for interpolating all requested other fields.
+    m_match[0] = m_begin_index + after - 1;
+    m_match[1] = m_begin_index + after;
+    m_coeff[0] = (x1 - value) / D;
+    m_coeff[1] = (value - x0) / D;
+  }
+
+  double IndexedLinearInterp::get(const std::string & field) const {
+    const std::vector<double> & y0(getRow(field, 0));
+    const std::vector<double> & y1(getRow(field, 1));
+    if (1 != y0.size() || 1 != y1.size())
+      throw TipException("IndexedLinearInterp::get(const std::string &) called for field " + field + " which is not a scalar");
+    return m_coeff[0] * y0[0] + m_coeff[1] * y1[0];
+  }
+
+  void IndexedLinearInterp::get(const std::string & field, std::vector<double> & value) const {
+    const std::vector<double> & y0(getRow(field, 0));
+    const std::vector<double> & y1(getRow(field, 1));
+
+    value.resize(y0.size());
+
+    // Compute output and assign it to the output vector.
+    for (std::vector<double>::size_type ii = 0; ii < y0.size(); ++ii)
+      value[ii] = m_coeff[0] * y0[ii] + m_coeff[1] * y1[ii];
+  }
+
+  void IndexedLinearInterp::interpolate(const std::string & field, const std::vector<double> & values,
+    const Table::FieldCont & fields, std::vector<std::vector<double> > & results) {
+    loadAbscissa(m_table->getFieldIndex(field), field);
+    std::size_t num_values = values.size();
+
+    // Visit the values in increasing order, so that all intervals are found in one pass over the abscissa.
+    std::vector<std::size_t> order(num_values);
+    bool sorted = true;
+    for (std::size_t ii = 0; ii != num_values; ++ii) {
+      if (values[ii] != values[ii])
+        throw TipException("IndexedLinearInterp::interpolate() called for a value after the last value in range");
+      if (0 != ii && values[ii] < values[ii - 1]) sorted = false;
+      order[ii] = ii;
+    }
+    if (!sorted)
+      std::stable_sort(order.begin(), order.end(),
+        [&values](std::size_t ii, std::size_t jj) { return values[ii] < values[jj]; });
+
+    // Find the interval and coefficients for each value, in the order the values were given.
+    std::vector<Index_t> after(num_values);
+    std::vector<double> coeff0(num_values);
+    std::vector<double> coeff1(num_values);
+    for (std::vector<std::size_t>::iterator itor = order.begin(); itor != order.end(); ++itor) {
+      double value = values[*itor];
+      Index_t found = findAfter(value);
+      if (0 == found)
+        throw TipException("IndexedLinearInterp::interpolate() called for a value before the first value in range");
+      else if (m_num_records == found)
+        throw TipException("IndexedLinearInterp::interpolate() called for a value after the last value in range");
+      m_cursor = found;
+
+      double x0 = m_abscissa[found - 1];
+      double x1 = m_abscissa[found];
+      double D = x1 - x0;
+      if (0. == D)
+        throw TipException("IndexedLinearInterp::interpolate() called for an interpolation interval of 0 width");
+
+      after[*itor] = found;
+      coeff0[*itor] = (x1 - value) / D;
+      coeff1[*itor] = (value - x0) / D;
+    }
+
+    results.resize(fields.size());
+    if (0 == num_values) {
+      for (std::size_t field_number = 0; field_number != fields.size(); ++field_number) results[field_number].clear();
+      return;
+    }
+
+    // Records spanned by the values, relative to the first record of the range.
+    Index_t first = after[order.front()] - 1;
+    Index_t last = after[order.back()];
+
+    std::vector<double> y0;
+    std::vector<double> y1;
+    std::vector<double> field_coeff0;
+    std::vector<double> field_coeff1;
+    for (std::size_t field_number = 0; field_number != fields.size(); ++field_number) {
+      const IColumn * column = m_table->getColumn(m_table->getFieldIndex(fields[field_number]));
+      std::size_t num_elements = 0;
+
+      if (column->isScalar() && last - first < Index_t(4 * num_values)) {
+        // The values are dense enough to read every record they span with one bulk read.
+        num_elements = 1;
+        std::vector<double> y(last - first + 1);
+        column->get(m_begin_index + first, m_begin_index + last + 1, &y[0]);
+        y0.resize(num_values);
+        y1.resize(num_values);
+        for (std::size_t ii = 0; ii != num_values; ++ii) {
+          y0[ii] = y[after[ii] - 1 - first];
+          y1[ii] = y[after[ii] - first];
+        }
+      } else {
+        // Read each record used once, in increasing order, copying the two records of each interval.
+        RowCache cache;
+        for (std::vector<std::size_t>::iterator itor = order.begin(); itor != order.end(); ++itor) {
+          Index_t record = m_begin_index + after[*itor];
+          const std::vector<double> & row0(fetchRow(column, record - 1, record, cache));
+          const std::vector<double> & row1(fetchRow(column, record, record - 1, cache));
+          if (itor == order.begin()) {
+            num_elements = row0.size();
+            y0.resize(num_values * num_elements);
+            y1.resize(num_values * num_elements);
+          }
+          if (row0.size() != num_elements || row1.size() != num_elements)
+            throw TipException("IndexedLinearInterp::interpolate() called for field " + fields[field_number] +
+              " whose number of elements varies");
+          std::copy(row0.begin(), row0.end(), y0.begin() + *itor * num_elements);
+          std::copy(row1.begin(), row1.end(), y1.begin() + *itor * num_elements);
+        }
+      }
+
+      // Repeat the coefficients for each element of vector fields, so that one kernel handles all fields.
+      const double * c0 = &coeff0[0];
+      const double * c1 = &coeff1[0];
+      if (1 != num_elements) {
+        field_coeff0.resize(num_values * num_elements);
+        field_coeff1.resize(num_values * num_elements);
+        for (std::size_t ii = 0; ii != num_values; ++ii) {
+          std::fill_n(field_coeff0.begin() + ii * num_elements, num_elements, coeff0[ii]);
+          std::fill_n(field_coeff1.begin() + ii * num_elements, num_elements, coeff1[ii]);
+        }
+        c0 = field_coeff0.empty() ? 0 : &field_coeff0[0];
+        c1 = field_coeff1.empty() ? 0 : &field_coeff1[0];
+      }
+
+      std::vector<double> & result(results[field_number]);
+      result.resize(num_values * num_elements);
+      if (!result.empty()) weightedSum(c0, &y0[0], c1, &y1[0], result.size(), &result[0]);
+    }
+  }
+
+  void IndexedLinearInterp::loadAbscissa(FieldIndex_t field_index, const std::string & field) {
+    if (field_index == m_abscissa_index) return;
+
+    // Read the whole range of records at once.
+    m_abscissa_index = -1;
+    m_abscissa.resize(m_num_records);
+    if (0 != m_num_records) m_table->get(field, m_begin_index, m_begin_index + m_num_records, &m_abscissa[0]);
+
+    // The search relies on the order of the records, so confirm it once here.
+    for (Index_t index = 1; index < m_num_records; ++index) {
+      if (m_abscissa[index] < m_abscissa[index - 1])
+        throw TipException("IndexedLinearInterp::interpolate() called for field " + field + " whose values decrease");
+    }
+
+    m_abscissa_index = field_index;
+    m_cursor = 0;
+  }
+
+  Index_t IndexedLinearInterp::findAfter(double value) const {
+    // Start from the interval found last time: when values arrive in increasing order, the answer is usually the
+    // same interval or the next one, and only otherwise is the rest of the array searched.
+    const double * x = m_abscissa.empty() ? 0 : &m_abscissa[0];
+    Index_t begin = 0;
+    Index_t end = m_num_records;
+    if (m_cursor < m_num_records) {
+      if (x[m_cursor] <= value) {
+        begin = m_cursor + 1;
+        if (m_num_records == begin || value < x[begin]) return begin;
+      } else {
+        end = m_cursor;
+        if (0 == end || x[end - 1] <= value) return end;
+      }
+    }
+    return std::upper_bound(x + begin, x + end, value) - x;
+  }
+
+  Index_t IndexedLinearInterp::getInterval() const {
+    if (0 > m_match[0])
+      throw TipException("IndexedLinearInterp::get() called without a successful call to interpolate()");
+    return m_match[0] - m_begin_index;
+  }
+
+  const std::vector<double> & IndexedLinearInterp::getRow(const std::string & field, int which) const {
+    if (0 > m_match[which])
+      throw TipException("IndexedLinearInterp::get() called without a successful call to interpolate()");
+
+    FieldIndex_t field_index = m_table->getFieldIndex(field);
+    return fetchRow(m_table->getColumn(field_index), m_match[which], m_match[1 - which], m_rows[field_index]);
+  }
+
+  const std::vector<double> & IndexedLinearInterp::fetchRow(const IColumn * column, Index_t record, Index_t keep,
+    RowCache & cache) {
+    // The record may be in either slot, because the record after one interval is the record before the next.
+    for (int slot = 0; slot != 2; ++slot) {
+      if (record == cache.m_record[slot]) return cache.m_value[slot];
+    }
+
+    // Replace the slot not holding the other record of the interval.
+    int slot = keep == cache.m_record[0] ? 1 : 0;
+    cache.m_record[slot] = -1;
+    if (column->isScalar()) {
+      cache.m_value[slot].resize(1);
+      column->get(record, cache.m_value[slot][0]);
+    } else {
+      column->get(record, cache.m_value[slot]);
+    }
+    cache.m_record[slot] = record;
+    return cache.m_value[slot];
+  }
+
+}
@@ -5,6 +5,7 @@
 #ifndef tip_RootColumn_h
 #define tip_RootColumn_h
 
+#include <algorithm>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -50,6 +51,24 @@ namespace tip {
 
       virtual void get(Index_t record_index, std::vector<unsigned long> & dest) const;
 
+      virtual void get(Index_t record_begin, Index_t record_end, double * dest, char * null_flags = 0) const
+        { getRange(record_begin, record_end, dest, null_flags); }
+
+      virtual void get(Index_t record_begin, Index_t record_end, float * dest, char * null_flags = 0) const
+        { getRange(record_begin, record_end, dest, null_flags); }
+
+      virtual void get(Index_t record_begin, Index_t record_end, int * dest, char * null_flags = 0) const
+        { getRange(record_begin, record_end, dest, null_flags); }
+
+      virtual void get(Index_t record_begin, Index_t record_end, unsigned int * dest, char * null_flags = 0) const
+        { getRange(record_begin, record_end, dest, null_flags); }
+
+      virtual void get(Index_t record_begin, Index_t record_end, long * dest, char * null_flags = 0) const
+        { getRange(record_begin, record_end, dest, null_flags); }
+
+      virtual void get(Index_t record_begin, Index_t record_end, unsigned long * dest, char * null_flags = 0) const
+        { getRange(record_begin, record_end, dest, null_flags); }
+
       /** \brief Returns the name of the particular column implementation (subclass identifier).
       */
       virtual const std::string implementation() const  { return "Root"; }
@@ -59,6 +78,9 @@ namespace tip {
 
       void getEntry(Index_t record_index) const;
 
+      template <typename U>
+      void getRange(Index_t record_begin, Index_t record_end, U * dest, char * null_flags) const;
+
       std::string m_leaf_name;
       TTree * m_tree;
       T * m_buf;
@@ -179,6 +201,19 @@ namespace tip {
     for (size_type ii = 0; ii != m_num_elements; ++ii) dest[ii] = (unsigned long)(m_buf[ii]);
   }
 
+  template <typename T>
+  template <typename U>
+  inline void RootColumn<T>::getRange(Index_t record_begin, Index_t record_end, U * dest, char * null_flags) const {
+    if (1u != m_num_elements) throw TipException("RootColumn::getRange(Index_t, Index_t, U *): Cannot convert vector to scalar");
+    // Root has no null values.
+    if (0 != null_flags && record_begin < record_end) std::fill(null_flags, null_flags + (record_end - record_begin), 0);
+    // Root offers no bulk access to a single leaf, so emulate it by reading one entry at a time.
+    for (Index_t record_index = record_begin; record_index < record_end; ++record_index) {
+      getEntry(record_index);
+      dest[record_index - record_begin] = U(*m_buf);
+    }
+  }
+
   template <typename T>
   inline void RootColumn<T>::getEntry(Index_t record_index) const {
     Int_t status = m_tree->GetEntry(record_index);
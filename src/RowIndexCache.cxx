@@ -0,0 +1,176 @@
+/** \file RowIndexCache.cxx
+
+    \brief Implementation of the cache of rows of tables which match filtering expressions.
+*/
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "RowIndexCache.h"
+#include "tip/Header.h"
+#include "tip/TipException.h"
+
+namespace {
+
+  /** \brief Return the absolute path of a file, so that entries do not depend on the current directory.
+  */
+  std::string canonicalName(const std::string & file_name) {
+    char * path = realpath(file_name.c_str(), 0);
+    if (0 == path) return file_name;
+    std::string retval(path);
+    std::free(path);
+    return retval;
+  }
+
+  /** \brief Replace line breaks in an expression, so that it occupies one line of the sidecar header.
+  */
+  std::string oneLine(const std::string & text) {
+    std::string retval(text);
+    for (std::string::iterator itor = retval.begin(); itor != retval.end(); ++itor)
+      if ('\n' == *itor || '\r' == *itor) *itor = ' ';
+    return retval;
+  }
+
+  /** \brief Return true if an expression may read files other than the one filtered, such as good time intervals
+      or regions, or is itself read from a file. Changes to those files could not be detected, so such expressions
+      are not cached.
+  */
+  bool readsOtherFiles(const std::string & filter) {
+    std::string text(filter);
+    for (std::string::iterator itor = text.begin(); itor != text.end(); ++itor) *itor = std::tolower(*itor);
+    const char * functions[] = { "gtifilter", "gtioverlap", "gtifind", "regfilter" };
+    for (std::size_t index = 0; index != sizeof(functions) / sizeof(functions[0]); ++index)
+      if (std::string::npos != text.find(functions[index])) return true;
+    std::string::size_type first = text.find_first_not_of(" \t\n");
+    return std::string::npos != first && '@' == text[first];
+  }
+
+}
+
+namespace tip {
+
+  RowIndexCache::RowIndexCache(const std::string & dir_name, bool compiled_filters): m_dir_name(dir_name),
+    m_compiled_filters(compiled_filters) {}
+
+  bool RowIndexCache::load(const std::string & file_name, const std::string & ext_name, const std::string & filter,
+    const Table & table, RowCont_t & rows) const {
+    std::string header = makeHeader(file_name, ext_name, filter, table);
+    if (header.empty()) return false;
+    std::ifstream in(getFileName(file_name, ext_name, filter).c_str(), std::ios::binary);
+    if (!in) return false;
+
+    // The entry must describe exactly this file, in its current state, this extension and this expression.
+    std::string stored_header(header.size(), '\0');
+    in.read(&stored_header[0], stored_header.size());
+    if (!in || stored_header != header) return false;
+
+    std::string label;
+    Index_t num_runs = 0;
+    in >> label >> num_runs;
+    if (!in || "runs" != label || 0 > num_runs) return false;
+
+    RowCont_t cached_rows;
+    Index_t num_records = table.getNumRecords();
+    Index_t end = 0;
+    for (Index_t run = 0; run != num_runs; ++run) {
+      Index_t begin = 0;
+      Index_t length = 0;
+      in >> begin >> length;
+      if (!in || begin < end || 0 >= length || num_records - length < begin) return false;
+      for (Index_t row = begin; row != begin + length; ++row) cached_rows.push_back(row);
+      end = begin + length;
+    }
+    rows.swap(cached_rows);
+    return true;
+  }
+
+  void RowIndexCache::store(const std::string & file_name, const std::string & ext_name, const std::string & filter,
+    const Table & table, const RowCont_t & rows) const {
+    std::string header = makeHeader(file_name, ext_name, filter, table);
+    if (header.empty()) return;
+
+    // Store runs of consecutive rows, which is compact for the usual selections of time or energy ranges.
+    std::ostringstream runs;
+    Index_t num_runs = 0;
+    for (RowCont_t::const_iterator itor = rows.begin(); itor != rows.end(); ) {
+      RowCont_t::const_iterator run_end = itor + 1;
+      while (run_end != rows.end() && *run_end == *(run_end - 1) + 1) ++run_end;
+      runs << *itor << " " << (run_end - itor) << "\n";
+      ++num_runs;
+      itor = run_end;
+    }
+
+    // Write a temporary file, then rename it, so that no process ever reads a partial entry.
+    std::string cache_file_name = getFileName(file_name, ext_name, filter);
+    std::ostringstream os;
+    os << cache_file_name << "." << getpid() << ".tmp";
+    std::string tmp_file_name = os.str();
+    {
+      std::ofstream out(tmp_file_name.c_str(), std::ios::binary | std::ios::trunc);
+      out << header << "runs " << num_runs << "\n" << runs.str();
+      if (!out) {
+        std::remove(tmp_file_name.c_str());
+        throw TipException("RowIndexCache::store could not write file " + tmp_file_name);
+      }
+    }
+    if (0 != std::rename(tmp_file_name.c_str(), cache_file_name.c_str())) {
+      std::remove(tmp_file_name.c_str());
+      throw TipException("RowIndexCache::store could not rename " + tmp_file_name + " to " + cache_file_name);
+    }
+  }
+
+  std::string RowIndexCache::getFileName(const std::string & file_name, const std::string & ext_name,
+    const std::string & filter) const {
+    // Name the file after a 64 bit FNV-1a hash of what it identifies; its header resolves any collision.
+    std::string key = canonicalName(file_name) + "\n" + ext_name + "\n" + oneLine(filter) + "\n" + getEngine();
+    unsigned long long hash = 14695981039346656037ull;
+    for (std::string::const_iterator itor = key.begin(); itor != key.end(); ++itor) {
+      hash ^= static_cast<unsigned char>(*itor);
+      hash *= 1099511628211ull;
+    }
+    std::ostringstream os;
+    os << m_dir_name << "/tip_rows_" << std::hex << std::setw(16) << std::setfill('0') << hash << ".idx";
+    return os.str();
+  }
+
+  std::string RowIndexCache::makeHeader(const std::string & file_name, const std::string & ext_name,
+    const std::string & filter, const Table & table) const {
+    // Files which cannot be examined, such as those given with extended file name syntax, are not cached, nor are
+    // expressions which read other files.
+    struct stat file_status;
+    if (0 != stat(file_name.c_str(), &file_status) || readsOtherFiles(filter)) return std::string();
+
+    // Include the fraction of a second where the file system records it, so that a file rewritten with the same
+    // size within the same second is still seen to have changed.
+#if defined(__APPLE__)
+    long mtime_nsec = file_status.st_mtimespec.tv_nsec;
+#elif defined(WIN32)
+    long mtime_nsec = 0;
+#else
+    long mtime_nsec = file_status.st_mtim.tv_nsec;
+#endif
+
+    std::string datasum;
+    try {
+      table.getHeader()["DATASUM"].get(datasum);
+    } catch (const TipException &) {
+      // Tables without a DATASUM keyword are identified by the file's size and time alone.
+    }
+
+    std::ostringstream os;
+    os << "tip row index 3\n" << "file " << canonicalName(file_name) << "\n" << "extension " << ext_name << "\n" <<
+      "filter " << oneLine(filter) << "\n" << "engine " << getEngine() << "\n" << "size " << file_status.st_size <<
+      "\n" << "mtime " << file_status.st_mtime << "." << std::setw(9) << std::setfill('0') << mtime_nsec <<
+      std::setfill(' ') << "\n" << "records " << table.getNumRecords() << "\n" << "datasum " << datasum << "\n";
+    return os.str();
+  }
+
+  const char * RowIndexCache::getEngine() const { return m_compiled_filters ? "TableFilter" : "cfitsio"; }
+
+}
@@ -0,0 +1,86 @@
+/** \file RowIndexCache.h
+
+    \brief Cache, in files on disk, of the rows of tables which match filtering expressions.
+    This class is not part of the API.
+*/
+#ifndef tip_RowIndexCache_h
+#define tip_RowIndexCache_h
+
+#include <string>
+#include <vector>
+
+#include "tip/Table.h"
+#include "tip/tip_types.h"
+
+namespace tip {
+
+  /** \class RowIndexCache
+
+      \brief Keeps the indices of the rows of a table which match a filtering expression in a sidecar file, so that
+      opening the same file with the same filter again does not evaluate the expression again. Each sidecar file
+      holds the rows for one file, extension and expression, stored as runs of consecutive rows.
+
+      An entry is only used if the file has the same size and modification time as when the entry was stored, and
+      the table has the same number of records and the same DATASUM keyword, if it has one. Otherwise the entry is
+      stale, and is replaced when the rows are stored again. Expressions which read other files, such as gtifilter
+      and regfilter, are never cached, since changes to those files could not be detected. The rows selected by
+      TableFilter and by cfitsio may differ, for example where cfitsio divides integers, so entries record which of
+      them selected the rows, and are only used with the same one.
+  */
+  class RowIndexCache {
+    public:
+      typedef std::vector<Index_t> RowCont_t;
+
+      /** \brief Create a cache which keeps its files in the given directory, which must exist.
+          \param dir_name The name of the directory.
+          \param compiled_filters Whether the rows are selected with TableFilter, rather than cfitsio (see
+          IFileSvc::setCompiledFilters).
+      */
+      RowIndexCache(const std::string & dir_name, bool compiled_filters);
+
+      /** \brief Read the rows which match an expression from the cache. Return false, leaving the rows unchanged,
+          if there is no entry, or the entry is stale.
+          \param file_name The name of the file.
+          \param ext_name The name of the extension.
+          \param filter The filtering expression.
+          \param table The table, opened without filtering.
+          \param rows The output indices of the matching rows, in increasing order.
+      */
+      bool load(const std::string & file_name, const std::string & ext_name, const std::string & filter,
+        const Table & table, RowCont_t & rows) const;
+
+      /** \brief Store the rows which match an expression in the cache, replacing any existing entry.
+          \param file_name The name of the file.
+          \param ext_name The name of the extension.
+          \param filter The filtering expression.
+          \param table The table, opened without filtering.
+          \param rows The indices of the matching rows, in increasing order.
+      */
+      void store(const std::string & file_name, const std::string & ext_name, const std::string & filter,
+        const Table & table, const RowCont_t & rows) const;
+
+      /** \brief Return the name of the sidecar file for the given file, extension and expression.
+          \param file_name The name of the file.
+          \param ext_name The name of the extension.
+          \param filter The filtering expression.
+      */
+      std::string getFileName(const std::string & file_name, const std::string & ext_name, const std::string & filter)
+        const;
+
+    private:
+      /** \brief Return the header of the sidecar file, which identifies the file, table and expression exactly,
+          including the properties of the file and table which show whether the entry is stale.
+      */
+      std::string makeHeader(const std::string & file_name, const std::string & ext_name, const std::string & filter,
+        const Table & table) const;
+
+      /// \brief Return the name of what selects the rows, TableFilter or cfitsio.
+      const char * getEngine() const;
+
+      std::string m_dir_name;
+      bool m_compiled_filters;
+  };
+
+}
+
+#endif
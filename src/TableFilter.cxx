@@ -0,0 +1,573 @@
+/** \file TableFilter.cxx
+
+    \brief Implementation of compiled row filtering expressions.
+*/
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <utility>
+
+#include "tip/IFileSvc.h"
+#include "tip/TableFilter.h"
+#include "tip/TableScan.h"
+#include "tip/TipException.h"
+
+namespace {
+
+  double elapsed(const std::chrono::steady_clock::time_point & start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  std::string toLower(const std::string & text) {
+    std::string retval(text);
+    for (std::string::iterator itor = retval.begin(); itor != retval.end(); ++itor)
+      *itor = std::tolower(static_cast<unsigned char>(*itor));
+    return retval;
+  }
+
+  // The kernels below branch on which arguments are constant once per block, so that each loop only reads arrays
+  // and can be vectorized by the compiler.
+  template <typename Op>
+  void applyUnary(Op op, const double * x, double x_value, tip::Index_t num_values, double * result) {
+    if (0 != x) {
+      for (tip::Index_t ii = 0; ii != num_values; ++ii) result[ii] = op(x[ii]);
+    } else {
+      std::fill(result, result + num_values, op(x_value));
+    }
+  }
+
+  template <typename Op>
+  void applyBinary(Op op, const double * x, double x_value, const double * y, double y_value, tip::Index_t num_values,
+    double * result) {
+    if (0 != x && 0 != y) {
+      for (tip::Index_t ii = 0; ii != num_values; ++ii) result[ii] = op(x[ii], y[ii]);
+    } else if (0 != x) {
+      for (tip::Index_t ii = 0; ii != num_values; ++ii) result[ii] = op(x[ii], y_value);
+    } else if (0 != y) {
+      for (tip::Index_t ii = 0; ii != num_values; ++ii) result[ii] = op(x_value, y[ii]);
+    } else {
+      std::fill(result, result + num_values, op(x_value, y_value));
+    }
+  }
+
+}
+
+namespace tip {
+
+  /** \class TableFilter::Parser
+
+      \brief Recursive descent parser which compiles an expression into the instructions of a TableFilter,
+      folding operations whose arguments are all constant as it goes.
+  */
+  class TableFilter::Parser {
+    public:
+      Parser(TableFilter & filter): m_filter(filter), m_text(filter.m_expression), m_pos(0) {}
+
+      void compile() {
+        m_filter.m_result = parseOr();
+        skipSpace();
+        if (m_pos != m_text.size()) error("unexpected text");
+      }
+
+    private:
+      void skipSpace() {
+        while (m_pos != m_text.size() && std::isspace(static_cast<unsigned char>(m_text[m_pos]))) ++m_pos;
+      }
+
+      /// \brief Consume the given token if it comes next, ignoring case.
+      bool accept(const char * token) {
+        skipSpace();
+        std::size_t length = std::strlen(token);
+        if (m_text.size() - m_pos < length) return false;
+        for (std::size_t ii = 0; ii != length; ++ii)
+          if (std::tolower(static_cast<unsigned char>(m_text[m_pos + ii])) != token[ii]) return false;
+        m_pos += length;
+        return true;
+      }
+
+      void expect(const char * token) {
+        if (!accept(token)) error(std::string("expected \"") + token + "\"");
+      }
+
+      void error(const std::string & msg) const {
+        std::ostringstream os;
+        os << "TableFilter: " << msg << " at position " << m_pos << " in expression \"" << m_text << "\"";
+        throw TipException(os.str());
+      }
+
+      Operand parseOr() {
+        Operand left = parseAnd();
+        while (accept("||") || accept(".or.")) left = emit(eOr, left, parseAnd());
+        return left;
+      }
+
+      Operand parseAnd() {
+        Operand left = parseComparison();
+        while (accept("&&") || accept(".and.")) left = emit(eAnd, left, parseComparison());
+        return left;
+      }
+
+      Operand parseComparison() {
+        Operand left = parseAdditive();
+        while (true) {
+          if (accept("==") || accept(".eq.")) left = emit(eEqual, left, parseAdditive());
+          else if (accept("!=") || accept(".ne.")) left = emit(eNotEqual, left, parseAdditive());
+          else if (accept("<=") || accept(".le.")) left = emit(eLessEqual, left, parseAdditive());
+          else if (accept(">=") || accept(".ge.")) left = emit(eGreaterEqual, left, parseAdditive());
+          else if (accept("<") || accept(".lt.")) left = emit(eLess, left, parseAdditive());
+          else if (accept(">") || accept(".gt.")) left = emit(eGreater, left, parseAdditive());
+          else if (accept("=")) left = emit(eEqual, left, parseAdditive());
+          else return left;
+        }
+      }
+
+      Operand parseAdditive() {
+        Operand left = parseMultiplicative();
+        while (true) {
+          if (accept("+")) left = emit(eAdd, left, parseMultiplicative());
+          else if (accept("-")) left = emit(eSubtract, left, parseMultiplicative());
+          else return left;
+        }
+      }
+
+      Operand parseMultiplicative() {
+        Operand left = parseUnary();
+        while (true) {
+          if (accept("*")) left = emit(eMultiply, left, parseUnary());
+          else if (accept("/")) left = emit(eDivide, left, parseUnary());
+          else if (accept("%")) left = emit(eModulo, left, parseUnary());
+          else return left;
+        }
+      }
+
+      Operand parseUnary() {
+        if (accept("-")) return emit(eNegate, parseUnary());
+        if (accept("+")) return parseUnary();
+        if (accept(".not.")) return emit(eNot, parseUnary());
+        skipSpace();
+        if (0 != m_text.compare(m_pos, 2, "!=") && accept("!")) return emit(eNot, parseUnary());
+        return parsePower();
+      }
+
+      Operand parsePower() {
+        Operand base = parsePrimary();
+        // Powers associate to the right, and bind more tightly than a unary minus on their left.
+        if (accept("**") || accept("^")) return emit(ePower, base, parseUnary());
+        return base;
+      }
+
+      Operand parsePrimary() {
+        skipSpace();
+        if (m_pos == m_text.size()) error("unexpected end");
+        char next = m_text[m_pos];
+        char after = m_pos + 1 < m_text.size() ? m_text[m_pos + 1] : '\0';
+
+        if (std::isdigit(static_cast<unsigned char>(next)) ||
+          ('.' == next && std::isdigit(static_cast<unsigned char>(after)))) {
+          const char * begin = m_text.c_str() + m_pos;
+          char * end = 0;
+          double value = std::strtod(begin, &end);
+          // In 5.lt.x the dot belongs to the operator.
+          if ('.' == end[-1] && std::isalpha(static_cast<unsigned char>(*end))) --end;
+          m_pos += end - begin;
+          return Operand(Operand::eConstant, value);
+        }
+
+        if (accept("(")) {
+          Operand value = parseOr();
+          expect(")");
+          return value;
+        }
+
+        if (accept("#row")) return emit(eRow);
+
+        if ('"' == next || '\'' == next) error("strings are only supported as arguments of gtifilter");
+
+        std::string name;
+        if ('$' == next) {
+          // Field names which are not identifiers may be quoted with $.
+          std::string::size_type end = m_text.find('$', m_pos + 1);
+          if (std::string::npos == end) error("unterminated field name");
+          name = m_text.substr(m_pos + 1, end - m_pos - 1);
+          m_pos = end + 1;
+          return field(name);
+        }
+
+        if (!std::isalpha(static_cast<unsigned char>(next)) && '_' != next) error("unexpected character");
+        std::string::size_type begin = m_pos;
+        while (m_pos != m_text.size() &&
+          (std::isalnum(static_cast<unsigned char>(m_text[m_pos])) || '_' == m_text[m_pos])) ++m_pos;
+        name = m_text.substr(begin, m_pos - begin);
+
+        if (!accept("(")) return field(name);
+        return parseFunction(toLower(name));
+      }
+
+      Operand parseFunction(const std::string & name) {
+        if ("gtifilter" == name) return parseGtiFilter();
+
+        std::vector<Operand> args;
+        if (!accept(")")) {
+          args.push_back(parseOr());
+          while (accept(",")) args.push_back(parseOr());
+          expect(")");
+        }
+
+        static const struct { const char * m_name; OpCode m_op; std::size_t m_num_args; } s_functions[] = {
+          { "abs", eAbs, 1 }, { "sqrt", eSqrt, 1 }, { "exp", eExp, 1 }, { "log", eLog, 1 }, { "log10", eLog10, 1 },
+          { "sin", eSin, 1 }, { "cos", eCos, 1 }, { "tan", eTan, 1 }, { "min", eMin, 2 }, { "max", eMax, 2 },
+          { "range", eRange, 3 }
+        };
+        for (std::size_t ii = 0; ii != sizeof(s_functions) / sizeof(s_functions[0]); ++ii) {
+          if (name != s_functions[ii].m_name) continue;
+          if (args.size() != s_functions[ii].m_num_args) error("wrong number of arguments for function " + name);
+          return emit(s_functions[ii].m_op, args);
+        }
+        error("unsupported function " + name);
+        return Operand();
+      }
+
+      /// \brief Parse the arguments of gtifilter, after the opening parenthesis, and read the intervals.
+      Operand parseGtiFilter() {
+        std::string file_name;
+        if (!parseString(file_name) || std::string::npos == file_name.find_first_not_of(" \t"))
+          error("gtifilter needs the name of a file holding the intervals");
+
+        Operand value;
+        std::string start_field("START");
+        std::string stop_field("STOP");
+        if (accept(",")) {
+          value = parseOr();
+          if (accept(",")) {
+            if (!parseString(start_field)) error("expected the name of the start field");
+            expect(",");
+            if (!parseString(stop_field)) error("expected the name of the stop field");
+          }
+        } else {
+          value = field("TIME");
+        }
+        expect(")");
+
+        // Split an extension given in brackets from the file name.
+        std::string ext_name("GTI");
+        std::string::size_type open = file_name.find('[');
+        if (std::string::npos != open && ']' == file_name[file_name.size() - 1]) {
+          ext_name = file_name.substr(open + 1, file_name.size() - open - 2);
+          file_name.erase(open);
+        }
+
+        // Sort and merge the intervals, so that one search finds the only interval which might hold a value.
+        std::vector<double> start;
+        std::vector<double> stop;
+        std::unique_ptr<const Table> table(IFileSvc::instance().readTable(file_name, ext_name));
+        table->getColumnData(start_field, start);
+        table->getColumnData(stop_field, stop);
+        std::vector<std::pair<double, double> > intervals;
+        for (std::size_t ii = 0; ii != start.size(); ++ii)
+          if (start[ii] <= stop[ii]) intervals.push_back(std::make_pair(start[ii], stop[ii]));
+        std::sort(intervals.begin(), intervals.end());
+
+        m_filter.m_starts.push_back(std::vector<double>());
+        m_filter.m_stops.push_back(std::vector<double>());
+        std::vector<double> & starts(m_filter.m_starts.back());
+        std::vector<double> & stops(m_filter.m_stops.back());
+        for (std::size_t ii = 0; ii != intervals.size(); ++ii) {
+          if (!stops.empty() && intervals[ii].first <= stops.back()) {
+            stops.back() = std::max(stops.back(), intervals[ii].second);
+          } else {
+            starts.push_back(intervals[ii].first);
+            stops.push_back(intervals[ii].second);
+          }
+        }
+
+        return emit(eInterval, std::vector<Operand>(1, value), m_filter.m_starts.size() - 1);
+      }
+
+      bool parseString(std::string & value) {
+        skipSpace();
+        if (m_pos == m_text.size() || ('"' != m_text[m_pos] && '\'' != m_text[m_pos])) return false;
+        std::string::size_type end = m_text.find(m_text[m_pos], m_pos + 1);
+        if (std::string::npos == end) error("unterminated string");
+        value = m_text.substr(m_pos + 1, end - m_pos - 1);
+        m_pos = end + 1;
+        return true;
+      }
+
+      /// \brief Return the operand for a field, adding it to the fields read by the filter if it is new.
+      Operand field(const std::string & name) {
+        if (name.empty()) error("empty field name");
+        std::string lower_name = toLower(name);
+        Table::FieldCont & fields(m_filter.m_fields);
+        for (std::size_t ii = 0; ii != fields.size(); ++ii)
+          if (toLower(fields[ii]) == lower_name) return Operand(Operand::eField, 0., ii);
+        fields.push_back(name);
+        return Operand(Operand::eField, 0., fields.size() - 1);
+      }
+
+      Operand emit(OpCode op) { return emit(op, std::vector<Operand>()); }
+
+      Operand emit(OpCode op, const Operand & x) { return emit(op, std::vector<Operand>(1, x)); }
+
+      Operand emit(OpCode op, const Operand & x, const Operand & y) {
+        std::vector<Operand> args(1, x);
+        args.push_back(y);
+        return emit(op, args);
+      }
+
+      Operand emit(OpCode op, const std::vector<Operand> & args, std::size_t intervals = 0) {
+        Instruction instruction;
+        instruction.m_op = op;
+        instruction.m_args = args;
+        instruction.m_result = m_filter.m_code.size();
+        instruction.m_intervals = intervals;
+
+        // Fold operations on constants now rather than repeating them for every record.
+        bool constant = eRow != op;
+        for (std::vector<Operand>::const_iterator itor = args.begin(); itor != args.end(); ++itor)
+          constant = constant && Operand::eConstant == itor->m_kind;
+        if (constant) {
+          double value = 0.;
+          m_filter.apply(instruction, std::vector<const double *>(args.size(), 0), 0, 1, &value);
+          return Operand(Operand::eConstant, value);
+        }
+
+        m_filter.m_code.push_back(instruction);
+        return Operand(Operand::eRegister, 0., instruction.m_result);
+      }
+
+      TableFilter & m_filter;
+      const std::string & m_text;
+      std::string::size_type m_pos;
+  };
+
+  /** \class TableFilter::Worker
+
+      \brief Evaluates blocks in one thread of a scan, with its own registers, and accounts for the time spent.
+  */
+  class TableFilter::Worker {
+    public:
+      Worker(const TableFilter & filter, char * selected): m_filter(filter), m_selected(selected), m_registers(),
+        m_read_time(0.), m_evaluate_time(0.), m_num_selected(0) {}
+
+      void operator ()(const ScanBlock & block) {
+        m_read_time += block.getReadTime();
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        char * selected = m_selected + block.getRecordBegin();
+        m_filter.evaluate(block, m_registers, selected);
+        for (Index_t ii = 0; ii != block.getNumRecords(); ++ii) m_num_selected += selected[ii];
+        m_evaluate_time += elapsed(start);
+      }
+
+      static void merge(Worker & total, Worker & part) {
+        total.m_read_time += part.m_read_time;
+        total.m_evaluate_time += part.m_evaluate_time;
+        total.m_num_selected += part.m_num_selected;
+      }
+
+      const TableFilter & m_filter;
+      char * m_selected;
+      std::vector<std::vector<double> > m_registers;
+      double m_read_time;
+      double m_evaluate_time;
+      Index_t m_num_selected;
+  };
+
+  TableFilter::TableFilter(const std::string & expression): m_expression(expression), m_fields(), m_code(),
+    m_result(), m_starts(), m_stops(), m_num_threads(0), m_stats() {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    if (std::string::npos == m_expression.find_first_not_of(" \t\n"))
+      throw TipException("TableFilter: the expression is blank");
+    Parser(*this).compile();
+    m_stats.m_parse_time = elapsed(start);
+  }
+
+  void TableFilter::select(const Table & table, std::vector<char> & selected) const {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    Index_t num_records = table.getNumRecords();
+    selected.assign(num_records, 0);
+    Worker worker(*this, selected.empty() ? 0 : &selected[0]);
+    unsigned int num_threads = 0;
+
+    if (0 < num_records && m_fields.empty()) {
+      // Nothing needs to be read, for example for filters on #row only.
+      Index_t block_size = table.getOptimalNumRecords();
+      ScanBlock block;
+      for (Index_t record_begin = 0; record_begin < num_records; record_begin += block_size) {
+        block.read(std::vector<const IColumn *>(), record_begin, std::min(num_records, record_begin + block_size));
+        worker(block);
+      }
+      num_threads = 1;
+    } else if (0 < num_records) {
+      TableScan scan(table, m_fields);
+      scan.setNumThreads(m_num_threads);
+      scan.run(worker, &Worker::merge);
+      num_threads = scan.getNumThreadsUsed();
+    }
+
+    m_stats.m_read_time = worker.m_read_time;
+    m_stats.m_evaluate_time = worker.m_evaluate_time;
+    m_stats.m_total_time = elapsed(start);
+    m_stats.m_num_records = num_records;
+    m_stats.m_num_selected = worker.m_num_selected;
+    m_stats.m_num_threads = num_threads;
+  }
+
+  void TableFilter::select(const Table & table, std::vector<Index_t> & records) const {
+    std::vector<char> selected;
+    select(table, selected);
+    records.clear();
+    records.reserve(m_stats.m_num_selected);
+    for (std::vector<char>::size_type ii = 0; ii != selected.size(); ++ii)
+      if (0 != selected[ii]) records.push_back(ii);
+  }
+
+  void TableFilter::evaluate(const ScanBlock & block, std::vector<std::vector<double> > & registers,
+    char * selected) const {
+    Index_t num_values = block.getNumRecords();
+    registers.resize(m_code.size());
+    std::vector<const double *> args;
+    for (std::vector<Instruction>::const_iterator itor = m_code.begin(); itor != m_code.end(); ++itor) {
+      args.resize(itor->m_args.size());
+      for (std::size_t ii = 0; ii != args.size(); ++ii) {
+        const Operand & arg(itor->m_args[ii]);
+        if (Operand::eField == arg.m_kind) args[ii] = block.getValues(arg.m_index);
+        else if (Operand::eRegister == arg.m_kind) args[ii] = &registers[arg.m_index][0];
+        else args[ii] = 0;
+      }
+      registers[itor->m_result].resize(num_values);
+      apply(*itor, args, block.getRecordBegin(), num_values, &registers[itor->m_result][0]);
+    }
+
+    if (Operand::eConstant == m_result.m_kind) {
+      std::fill(selected, selected + num_values, 0. != m_result.m_value ? 1 : 0);
+    } else {
+      const double * result = Operand::eField == m_result.m_kind ? block.getValues(m_result.m_index) :
+        &registers[m_result.m_index][0];
+      for (Index_t ii = 0; ii != num_values; ++ii) selected[ii] = 0. != result[ii] ? 1 : 0;
+    }
+
+    // Records in which any field used is null are not selected.
+    for (std::size_t field_number = 0; field_number != m_fields.size(); ++field_number) {
+      const char * null_flags = block.getNullFlags(field_number);
+      for (Index_t ii = 0; ii != num_values; ++ii) selected[ii] = 0 != null_flags[ii] ? 0 : selected[ii];
+    }
+  }
+
+  void TableFilter::apply(const Instruction & instruction, const std::vector<const double *> & args,
+    Index_t record_begin, Index_t num_values, double * result) const {
+    const std::vector<Operand> & operand(instruction.m_args);
+    const double * x = args.empty() ? 0 : args[0];
+    double x_value = operand.empty() ? 0. : operand[0].m_value;
+    const double * y = args.size() < 2 ? 0 : args[1];
+    double y_value = operand.size() < 2 ? 0. : operand[1].m_value;
+
+    switch (instruction.m_op) {
+      case eAdd: applyBinary([](double a, double b) { return a + b; }, x, x_value, y, y_value, num_values, result);
+        break;
+      case eSubtract: applyBinary([](double a, double b) { return a - b; }, x, x_value, y, y_value, num_values,
+        result);
+        break;
+      case eMultiply: applyBinary([](double a, double b) { return a * b; }, x, x_value, y, y_value, num_values,
+        result);
+        break;
+      case eDivide: applyBinary([](double a, double b) { return a / b; }, x, x_value, y, y_value, num_values, result);
+        break;
+      case eModulo: applyBinary([](double a, double b) { return std::fmod(a, b); }, x, x_value, y, y_value, num_values,
+        result);
+        break;
+      case ePower: applyBinary([](double a, double b) { return std::pow(a, b); }, x, x_value, y, y_value, num_values,
+        result);
+        break;
+      case eEqual: applyBinary([](double a, double b) { return a == b ? 1. : 0.; }, x, x_value, y, y_value,
+        num_values, result);
+        break;
+      case eNotEqual: applyBinary([](double a, double b) { return a != b ? 1. : 0.; }, x, x_value, y, y_value,
+        num_values, result);
+        break;
+      case eLess: applyBinary([](double a, double b) { return a < b ? 1. : 0.; }, x, x_value, y, y_value, num_values,
+        result);
+        break;
+      case eLessEqual: applyBinary([](double a, double b) { return a <= b ? 1. : 0.; }, x, x_value, y, y_value,
+        num_values, result);
+        break;
+      case eGreater: applyBinary([](double a, double b) { return a > b ? 1. : 0.; }, x, x_value, y, y_value,
+        num_values, result);
+        break;
+      case eGreaterEqual: applyBinary([](double a, double b) { return a >= b ? 1. : 0.; }, x, x_value, y, y_value,
+        num_values, result);
+        break;
+      case eAnd: applyBinary([](double a, double b) { return 0. != a && 0. != b ? 1. : 0.; }, x, x_value, y, y_value,
+        num_values, result);
+        break;
+      case eOr: applyBinary([](double a, double b) { return 0. != a || 0. != b ? 1. : 0.; }, x, x_value, y, y_value,
+        num_values, result);
+        break;
+      case eMin: applyBinary([](double a, double b) { return b < a ? b : a; }, x, x_value, y, y_value, num_values,
+        result);
+        break;
+      case eMax: applyBinary([](double a, double b) { return a < b ? b : a; }, x, x_value, y, y_value, num_values,
+        result);
+        break;
+      case eNegate: applyUnary([](double a) { return -a; }, x, x_value, num_values, result);
+        break;
+      case eNot: applyUnary([](double a) { return 0. == a ? 1. : 0.; }, x, x_value, num_values, result);
+        break;
+      case eAbs: applyUnary([](double a) { return std::fabs(a); }, x, x_value, num_values, result);
+        break;
+      case eSqrt: applyUnary([](double a) { return std::sqrt(a); }, x, x_value, num_values, result);
+        break;
+      case eExp: applyUnary([](double a) { return std::exp(a); }, x, x_value, num_values, result);
+        break;
+      case eLog: applyUnary([](double a) { return std::log(a); }, x, x_value, num_values, result);
+        break;
+      case eLog10: applyUnary([](double a) { return std::log10(a); }, x, x_value, num_values, result);
+        break;
+      case eSin: applyUnary([](double a) { return std::sin(a); }, x, x_value, num_values, result);
+        break;
+      case eCos: applyUnary([](double a) { return std::cos(a); }, x, x_value, num_values, result);
+        break;
+      case eTan: applyUnary([](double a) { return std::tan(a); }, x, x_value, num_values, result);
+        break;
+      case eRange: {
+          // Limits are almost always constants, so handle that case separately.
+          const double * low = args[1];
+          const double * high = args[2];
+          double low_value = operand[1].m_value;
+          double high_value = operand[2].m_value;
+          if (0 != x && 0 == low && 0 == high) {
+            for (Index_t ii = 0; ii != num_values; ++ii)
+              result[ii] = low_value <= x[ii] && x[ii] <= high_value ? 1. : 0.;
+          } else {
+            for (Index_t ii = 0; ii != num_values; ++ii) {
+              double value = 0 != x ? x[ii] : x_value;
+              result[ii] = (0 != low ? low[ii] : low_value) <= value && value <= (0 != high ? high[ii] : high_value) ?
+                1. : 0.;
+            }
+          }
+        }
+        break;
+      case eInterval:
+        for (Index_t ii = 0; ii != num_values; ++ii)
+          result[ii] = inIntervals(instruction.m_intervals, 0 != x ? x[ii] : x_value) ? 1. : 0.;
+        break;
+      case eRow:
+        for (Index_t ii = 0; ii != num_values; ++ii) result[ii] = record_begin + ii + 1;
+        break;
+      default:
+        throw TipException("TableFilter::apply: unknown instruction");
+    }
+  }
+
+  bool TableFilter::inIntervals(std::size_t intervals, double value) const {
+    const std::vector<double> & starts(m_starts[intervals]);
+    std::vector<double>::const_iterator itor = std::upper_bound(starts.begin(), starts.end(), value);
+    if (starts.begin() == itor) return false;
+    return value <= m_stops[intervals][itor - starts.begin() - 1];
+  }
+
+}
@@ -0,0 +1,130 @@
+/** \file TableScan.cxx
+
+    \brief Implementation of parallel scans of tables.
+*/
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <memory>
+#include <thread>
+
+#include "tip/TableScan.h"
+#include "tip/TipException.h"
+
+namespace tip {
+
+  void ScanBlock::read(const std::vector<const IColumn *> & columns, Index_t record_begin, Index_t record_end) {
+    if (columns.size() != m_values.size()) throw TipException("ScanBlock::read was given the wrong number of columns");
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    m_record_begin = record_begin;
+    m_record_end = record_end;
+    for (std::size_t index = 0; index != columns.size(); ++index) {
+      m_values[index].resize(record_end - record_begin);
+      m_null_flags[index].resize(record_end - record_begin);
+      columns[index]->get(record_begin, record_end, &m_values[index][0], &m_null_flags[index][0]);
+    }
+    m_read_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  TableScan::TableScan(const Table & table, const Table::FieldCont & fields): m_table(table), m_fields(fields),
+    m_readers(), m_columns(), m_block_size(0), m_num_threads(0), m_num_threads_used(0) {
+    if (m_fields.empty()) throw TipException("TableScan::TableScan: no fields to scan were given");
+  }
+
+  TableScan::~TableScan() { closeReaders(); }
+
+  unsigned int TableScan::openReaders() {
+    closeReaders();
+
+    // Use no more threads than there are blocks.
+    Index_t num_records = m_table.getNumRecords();
+    Index_t block_size = 0 < m_block_size ? m_block_size : m_table.getOptimalNumRecords();
+    Index_t num_blocks = (num_records + block_size - 1) / block_size;
+    Index_t num_threads = 0 != m_num_threads ? m_num_threads : std::thread::hardware_concurrency();
+    if (num_threads > num_blocks) num_threads = num_blocks;
+
+    try {
+      // Each thread reads its own instance of the table, or this table when there is only one thread.
+      for (Index_t index = 0; index < num_threads && 1 < num_threads; ++index) {
+        Table * reader = m_table.openReader(m_fields);
+        if (0 == reader) break;
+        m_readers.push_back(reader);
+      }
+      if (m_readers.size() != std::vector<Table *>::size_type(num_threads)) closeReaders();
+
+      // Look up the columns here, because tables set columns up on first use, which is not thread safe.
+      std::size_t num_tables = m_readers.empty() ? 1 : m_readers.size();
+      m_columns.assign(num_tables, std::vector<const IColumn *>(m_fields.size()));
+      for (std::size_t index = 0; index != num_tables; ++index) {
+        const Table & table(m_readers.empty() ? m_table : *m_readers[index]);
+        for (std::size_t field_number = 0; field_number != m_fields.size(); ++field_number) {
+          const IColumn * column = table.getColumn(table.getFieldIndex(m_fields[field_number]));
+          if (!column->isScalar())
+            throw TipException("TableScan: field " + m_fields[field_number] + " is not a scalar field");
+          m_columns[index][field_number] = column;
+        }
+      }
+    } catch (...) {
+      closeReaders();
+      throw;
+    }
+
+    m_num_threads_used = m_columns.size();
+    return m_num_threads_used;
+  }
+
+  void TableScan::execute(const std::vector<IWorker *> & workers) {
+    if (workers.size() != m_columns.size()) {
+      closeReaders();
+      throw TipException("TableScan::execute was given the wrong number of workers");
+    }
+
+    Index_t num_records = m_table.getNumRecords();
+    Index_t block_size = 0 < m_block_size ? m_block_size : m_table.getOptimalNumRecords();
+    std::atomic<Index_t> next_record(0);
+    std::atomic<bool> failed(false);
+    std::vector<std::exception_ptr> errors(workers.size());
+
+    // Each thread takes the next block until there are none left, or until any thread fails.
+    auto work = [&](std::size_t thread_index) {
+      try {
+        ScanBlock block(m_fields.size());
+        while (!failed) {
+          Index_t record_begin = next_record.fetch_add(block_size);
+          if (record_begin >= num_records) break;
+          Index_t record_end = num_records - record_begin < block_size ? num_records : record_begin + block_size;
+          block.read(m_columns[thread_index], record_begin, record_end);
+          workers[thread_index]->process(block);
+        }
+      } catch (...) {
+        errors[thread_index] = std::current_exception();
+        failed = true;
+      }
+    };
+
+    // The calling thread does its share of the work.
+    std::vector<std::thread> threads;
+    try {
+      for (std::size_t index = 1; index < workers.size(); ++index) threads.push_back(std::thread(work, index));
+    } catch (...) {
+      // Could not start a thread: stop those which were started.
+      failed = true;
+      for (std::vector<std::thread>::iterator itor = threads.begin(); itor != threads.end(); ++itor) itor->join();
+      closeReaders();
+      throw TipException("TableScan::execute could not start a thread");
+    }
+    if (!workers.empty()) work(0);
+    for (std::vector<std::thread>::iterator itor = threads.begin(); itor != threads.end(); ++itor) itor->join();
+    closeReaders();
+
+    for (std::vector<std::exception_ptr>::iterator itor = errors.begin(); itor != errors.end(); ++itor)
+      if (*itor) std::rethrow_exception(*itor);
+  }
+
+  void TableScan::closeReaders() {
+    for (std::vector<Table *>::reverse_iterator itor = m_readers.rbegin(); itor != m_readers.rend(); ++itor) delete *itor;
+    m_readers.clear();
+    m_columns.clear();
+  }
+
+}
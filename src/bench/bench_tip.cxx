@@ -0,0 +1,728 @@
+/** \file bench_tip.cxx
+    \brief Timing comparisons between alternative ways of reading and writing data through tip.
+    This is not a unit test. It creates a scratch FITS file and reports how long each access
+    pattern takes, so that changes to the column and table implementations can be evaluated.
+    Usage: bench_tip [num_records]
+*/
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+#include "fitsio.h"
+
+#include "FitsChecksum.h"
+#include "FitsDecoder.h"
+#include "tip/ColumnIndex.h"
+#include "tip/FileSummary.h"
+#include "tip/IFileSvc.h"
+#include "tip/Image.h"
+#include "tip/ImageCompression.h"
+#include "tip/ImageTileReader.h"
+#include "tip/IndexedLinearInterp.h"
+#include "tip/LinearInterp.h"
+#include "tip/Table.h"
+#include "tip/TableFilter.h"
+#include "tip/TableScan.h"
+#include "tip/TipException.h"
+#include "tip/tip_types.h"
+
+namespace {
+
+  using namespace tip;
+
+  /** \class WallTimer
+      \brief Measure elapsed real time, which includes time spent waiting for the disk, and does not add up the
+      processor time of several threads.
+  */
+  class WallTimer {
+    public:
+      WallTimer(): m_start(std::chrono::steady_clock::now()) {}
+
+      double elapsed() const { return std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count(); }
+
+    private:
+      std::chrono::steady_clock::time_point m_start;
+  };
+
+  void report(const std::string & what, Index_t num_records, double seconds, double check_sum) {
+    std::cout.width(56);
+    std::cout << std::left << what << ": " << seconds << " s";
+    if (0. < seconds) std::cout << " (" << num_records / seconds << " records/s)";
+    // Print a checksum of the values read so that the optimizer cannot discard the loops.
+    std::cout << " [sum " << check_sum << "]" << std::endl;
+  }
+
+  /** \brief Create a scratch event table with scalar TIME and ENERGY fields.
+      \param file_name The name of the file to create.
+      \param num_records The number of records in the table.
+  */
+  void makeEventFile(const std::string & file_name, Index_t num_records) {
+    std::remove(file_name.c_str());
+    IFileSvc::instance().appendTable(file_name, "EVENTS");
+    std::unique_ptr<Table> table(IFileSvc::instance().editTable(file_name, "EVENTS"));
+    table->appendField("TIME", "1D");
+    table->appendField("ENERGY", "1E");
+    table->setNumRecords(num_records);
+
+    std::vector<double> time(num_records);
+    std::vector<float> energy(num_records);
+    for (Index_t index = 0; index != num_records; ++index) {
+      time[index] = 2.4e8 + .125 * index;
+      energy[index] = 100.f + index % 1000;
+    }
+    if (0 != num_records) {
+      table->set("time", 0, &time[0], &time[0] + num_records);
+      table->set("energy", 0, &energy[0], &energy[0] + num_records);
+    }
+  }
+
+  /// \brief Compare reading a scalar field record by record with reading it in blocks of records.
+  void benchRead(const std::string & file_name) {
+    std::unique_ptr<const Table> table(IFileSvc::instance().readTable(file_name, "EVENTS"));
+    Index_t num_records = table->getNumRecords();
+
+    {
+      WallTimer timer;
+      double sum = 0.;
+      for (Table::ConstIterator itor = table->begin(); itor != table->end(); ++itor) sum += (*itor)["time"].get();
+      report("read TIME record by record through ConstIterator", num_records, timer.elapsed(), sum);
+    }
+
+    for (Index_t read_ahead = 1024; read_ahead <= 65536; read_ahead *= 8) {
+      // The counters accumulate, so report the change over this loop.
+      unsigned long num_hits = 0;
+      unsigned long prev_misses = 0;
+      table->getReadAheadStats(num_hits, prev_misses);
+      table->setReadAhead(read_ahead);
+      WallTimer timer;
+      double sum = 0.;
+      for (Table::ConstIterator itor = table->begin(); itor != table->end(); ++itor) sum += (*itor)["time"].get();
+      unsigned long num_misses = 0;
+      table->getReadAheadStats(num_hits, num_misses);
+      std::ostringstream os;
+      os << "read TIME through ConstIterator, read-ahead " << read_ahead << " (" << num_misses - prev_misses << " misses)";
+      report(os.str(), num_records, timer.elapsed(), sum);
+      table->setReadAhead(0);
+    }
+
+    {
+      WallTimer timer;
+      std::vector<double> time(num_records);
+      if (0 != num_records) table->get("time", 0, num_records, &time[0]);
+      double sum = 0.;
+      for (std::vector<double>::iterator itor = time.begin(); itor != time.end(); ++itor) sum += *itor;
+      report("read TIME with one bulk call to Table::get", num_records, timer.elapsed(), sum);
+    }
+
+    {
+      WallTimer timer;
+      std::vector<double> time;
+      table->getColumnData("time", time);
+      double sum = 0.;
+      for (std::vector<double>::iterator itor = time.begin(); itor != time.end(); ++itor) sum += *itor;
+      std::ostringstream os;
+      os << "read TIME with Table::getColumnData (blocks of " << table->getOptimalNumRecords() << ")";
+      report(os.str(), num_records, timer.elapsed(), sum);
+    }
+
+    {
+      WallTimer timer;
+      const Index_t block_size = 65536;
+      std::vector<double> time(block_size);
+      double sum = 0.;
+      for (Index_t begin = 0; begin < num_records; begin += block_size) {
+        Index_t end = begin + block_size < num_records ? begin + block_size : num_records;
+        table->get("time", begin, end, &time[0]);
+        for (Index_t ii = 0; ii != end - begin; ++ii) sum += time[ii];
+      }
+      report("read TIME in blocks of 65536 records with Table::get", num_records, timer.elapsed(), sum);
+    }
+  }
+
+  void benchByteSwap(Index_t num_values) {
+    // Arbitrary bytes will do: the kernels do not interpret the values.
+    std::vector<double> src(num_values);
+    for (Index_t index = 0; index != num_values; ++index) src[index] = 1. + index;
+    std::vector<double> dest(num_values);
+
+    FitsByteSwap::Kernel best_kernel = FitsByteSwap::getKernel();
+    for (int kernel = FitsByteSwap::eScalar; kernel <= FitsByteSwap::eAvx2; ++kernel) {
+      if (!FitsByteSwap::isSupported(FitsByteSwap::Kernel(kernel))) continue;
+      FitsByteSwap::setKernel(FitsByteSwap::Kernel(kernel));
+      const char * name = FitsByteSwap::getKernelName(FitsByteSwap::Kernel(kernel));
+      for (std::size_t value_size = 2; value_size <= 8; value_size *= 2) {
+        Index_t count = num_values * 8 / value_size;
+        WallTimer timer;
+        for (int repeat = 0; repeat != 10; ++repeat) FitsByteSwap::toNative(&src[0], value_size, count, &dest[0]);
+        std::ostringstream os;
+        os << "swap " << value_size << "-byte values x10, " << name << " kernel";
+        report(os.str(), 10 * count, timer.elapsed(), double(reinterpret_cast<unsigned char *>(&dest[0])[1]));
+      }
+    }
+    FitsByteSwap::setKernel(best_kernel);
+  }
+
+  void benchImage(const std::string & file_name, Index_t num_pixels) {
+    std::remove(file_name.c_str());
+    ImageBase::PixelCoordinate dims(1, num_pixels);
+    IFileSvc::instance().appendImage(file_name, "IMAGE", dims);
+    {
+      std::unique_ptr<Image> image(IFileSvc::instance().editImage(file_name, "IMAGE"));
+      std::vector<float> pixels(num_pixels);
+      for (Index_t index = 0; index != num_pixels; ++index) pixels[index] = index % 4096 * .5f;
+      image->set(pixels);
+    }
+
+    {
+      // Conversion by cfitsio, for comparison.
+      fitsfile * fp = 0;
+      int status = 0;
+      fits_open_file(&fp, file_name.c_str(), READONLY, &status);
+      std::vector<float> pixels(num_pixels);
+      WallTimer timer;
+      long first_pixel = 1;
+      fits_read_pix(fp, TFLOAT, &first_pixel, num_pixels, 0, &pixels[0], 0, &status);
+      double elapsed = timer.elapsed();
+      fits_close_file(fp, &status);
+      if (0 != status) throw TipException(status, "benchImage could not read image with cfitsio");
+      double sum = 0.;
+      for (std::vector<float>::iterator itor = pixels.begin(); itor != pixels.end(); ++itor) sum += *itor;
+      report("read float image with fits_read_pix", num_pixels, elapsed, sum);
+    }
+
+    FitsByteSwap::Kernel best_kernel = FitsByteSwap::getKernel();
+    for (int kernel = FitsByteSwap::eScalar; kernel <= FitsByteSwap::eAvx2; ++kernel) {
+      if (!FitsByteSwap::isSupported(FitsByteSwap::Kernel(kernel))) continue;
+      FitsByteSwap::setKernel(FitsByteSwap::Kernel(kernel));
+      std::unique_ptr<const TypedImage<double> > image(IFileSvc::instance().readImageDbl(file_name, "IMAGE"));
+      std::vector<double> pixels;
+      WallTimer timer;
+      image->get(pixels);
+      double elapsed = timer.elapsed();
+      double sum = 0.;
+      for (std::vector<double>::iterator itor = pixels.begin(); itor != pixels.end(); ++itor) sum += *itor;
+      std::ostringstream os;
+      os << "read float image as double with Image::get, " << FitsByteSwap::getKernelName(FitsByteSwap::Kernel(kernel));
+      report(os.str(), num_pixels, elapsed, sum);
+    }
+    FitsByteSwap::setKernel(best_kernel);
+
+    for (unsigned int prefetch = 0; prefetch != 3; prefetch += 2) {
+      std::unique_ptr<const TypedImage<float> > image(IFileSvc::instance().readImageFlt(file_name, "IMAGE"));
+      ImageTileReader<float> reader(*image, ImageBase::PixelCoordinate(1, 65536), prefetch);
+      std::vector<float> tile;
+      double sum = 0.;
+      WallTimer timer;
+      while (reader.next(tile))
+        for (std::vector<float>::iterator itor = tile.begin(); itor != tile.end(); ++itor) sum += *itor;
+      double elapsed = timer.elapsed();
+      std::ostringstream os;
+      os << "read and sum float image in tiles with ImageTileReader, prefetch " << prefetch;
+      report(os.str(), num_pixels, elapsed, sum);
+    }
+    std::remove(file_name.c_str());
+
+    // The same pixels, compressed in tiles of 65536 pixels.
+    IFileSvc::instance().appendImage(file_name, "IMAGE", dims,
+      ImageCompression(ImageCompression::eGzip2, ImageBase::PixelCoordinate(1, 65536)));
+    {
+      std::unique_ptr<Image> image(IFileSvc::instance().editImage(file_name, "IMAGE"));
+      std::vector<float> pixels(num_pixels);
+      for (Index_t index = 0; index != num_pixels; ++index) pixels[index] = index % 4096 * .5f;
+      image->set(pixels);
+    }
+
+    unsigned int image_threads = IFileSvc::getImageThreads();
+    const unsigned int thread_counts[] = { 1, 0 };
+    for (std::size_t index = 0; index != 2; ++index) {
+      unsigned int num_threads = thread_counts[index];
+      IFileSvc::setImageThreads(num_threads);
+      std::unique_ptr<const TypedImage<float> > image(IFileSvc::instance().readImageFlt(file_name, "IMAGE"));
+      std::vector<float> pixels;
+      WallTimer timer;
+      image->get(pixels);
+      double elapsed = timer.elapsed();
+      double sum = 0.;
+      for (std::vector<float>::iterator itor = pixels.begin(); itor != pixels.end(); ++itor) sum += *itor;
+      report(1 == num_threads ? "read GZIP_2 compressed image in one thread" :
+        "read GZIP_2 compressed image in one thread per core", num_pixels, elapsed, sum);
+    }
+    IFileSvc::setImageThreads(image_threads);
+    std::remove(file_name.c_str());
+
+    // The same pixels, which are multiples of .5, stored exactly as scaled 16-bit integers.
+    IFileSvc::instance().appendImage(file_name, "IMAGE", dims, ImageBase::eShort, .5);
+    {
+      std::unique_ptr<TypedImage<float> > image(IFileSvc::instance().editImage<float>(file_name, "IMAGE"));
+      std::vector<float> pixels(num_pixels);
+      for (Index_t index = 0; index != num_pixels; ++index) pixels[index] = index % 4096 * .5f;
+      image->set(pixels);
+    }
+    {
+      std::unique_ptr<const TypedImage<float> > image(IFileSvc::instance().readImage<float>(file_name, "IMAGE"));
+      std::vector<float> pixels;
+      WallTimer timer;
+      image->get(pixels);
+      double elapsed = timer.elapsed();
+      double sum = 0.;
+      for (std::vector<float>::iterator itor = pixels.begin(); itor != pixels.end(); ++itor) sum += *itor;
+      report("read scaled 16-bit image as float with Image::get", num_pixels, elapsed, sum);
+    }
+    std::remove(file_name.c_str());
+  }
+
+  /** \brief Time opening the event table and reading its header many times, as tools which visit a file
+      repeatedly do, with and without the file pool.
+  */
+  void benchReopen(const std::string & file_name) {
+    const Index_t num_opens = 1000;
+    unsigned int pool_size = IFileSvc::getFilePoolSize();
+    unsigned int pool_sizes[] = { 0, 8 };
+    for (unsigned int * size = pool_sizes; size != pool_sizes + 2; ++size) {
+      IFileSvc::setFilePoolSize(*size);
+      WallTimer timer;
+      double sum = 0.;
+      for (Index_t index = 0; index != num_opens; ++index) {
+        std::unique_ptr<const Table> table(IFileSvc::instance().readTable(file_name, "EVENTS"));
+        sum += table->getNumRecords();
+      }
+      report(0 == *size ? "open EVENTS table repeatedly" : "open EVENTS table repeatedly, pooled", num_opens,
+        timer.elapsed(), sum);
+    }
+    IFileSvc::setFilePoolSize(pool_size);
+  }
+
+  /** \brief Time listing the extensions of a file many times, which after the first time uses the cached summary.
+  */
+  void benchSummary(const std::string & file_name) {
+    const Index_t num_summaries = 1000;
+    WallTimer timer;
+    double sum = 0.;
+    for (Index_t index = 0; index != num_summaries; ++index) {
+      FileSummary summary;
+      IFileSvc::instance().getFileSummary(file_name, summary);
+      sum += summary.back().getNumRecords();
+    }
+    report("summarize event file repeatedly", num_summaries, timer.elapsed(), sum);
+  }
+
+  void benchMappedRead(const std::string & file_name) {
+    bool map_tables = IFileSvc::getMapTables();
+    IFileSvc::setMapTables(true);
+    std::unique_ptr<const Table> table(IFileSvc::instance().readTable(file_name, "EVENTS"));
+    IFileSvc::setMapTables(map_tables);
+    Index_t num_records = table->getNumRecords();
+
+    {
+      WallTimer timer;
+      double sum = 0.;
+      for (Table::ConstIterator itor = table->begin(); itor != table->end(); ++itor) sum += (*itor)["time"].get();
+      report("read TIME record by record through ConstIterator, memory-mapped", num_records, timer.elapsed(), sum);
+    }
+
+    {
+      WallTimer timer;
+      std::vector<double> time;
+      table->getColumnData("time", time);
+      double sum = 0.;
+      for (std::vector<double>::iterator itor = time.begin(); itor != time.end(); ++itor) sum += *itor;
+      report("read TIME with Table::getColumnData, memory-mapped", num_records, timer.elapsed(), sum);
+    }
+
+    {
+      WallTimer timer;
+      std::vector<float> energy;
+      table->getColumnData("energy", energy);
+      double sum = 0.;
+      for (std::vector<float>::iterator itor = energy.begin(); itor != energy.end(); ++itor) sum += *itor;
+      report("read ENERGY with Table::getColumnData, memory-mapped", num_records, timer.elapsed(), sum);
+    }
+  }
+
+
+  /** \class TimeHistogram
+      \brief Bins event times, as a typical scan of an event file.
+  */
+  class TimeHistogram {
+    public:
+      TimeHistogram(double t_start, double t_stop, std::size_t num_bins): m_t_start(t_start),
+        m_bin_width((t_stop - t_start) / num_bins), m_counts(num_bins) {}
+
+      void operator ()(const ScanBlock & block) {
+        const double * time = block.getValues(0);
+        for (Index_t index = 0; index != block.getNumRecords(); ++index) {
+          double bin = (time[index] - m_t_start) / m_bin_width;
+          if (0. <= bin && bin < m_counts.size()) ++m_counts[std::size_t(bin)];
+        }
+      }
+
+      double getTotal() const {
+        double total = 0.;
+        for (std::vector<double>::const_iterator itor = m_counts.begin(); itor != m_counts.end(); ++itor) total += *itor;
+        return total;
+      }
+
+      struct Merge {
+        void operator ()(TimeHistogram & total, const TimeHistogram & part) const {
+          for (std::size_t index = 0; index != total.m_counts.size(); ++index) total.m_counts[index] += part.m_counts[index];
+        }
+      };
+
+    private:
+      double m_t_start;
+      double m_bin_width;
+      std::vector<double> m_counts;
+  };
+
+  /// \brief Compare binning event times with TableScan using increasing numbers of threads.
+  void benchScan(const std::string & file_name) {
+    std::unique_ptr<const Table> table(IFileSvc::instance().readTable(file_name, "EVENTS"));
+    Index_t num_records = table->getNumRecords();
+    unsigned int max_threads = std::thread::hardware_concurrency();
+    if (0 == max_threads) max_threads = 1;
+
+    TableScan scan(*table, Table::FieldCont(1, "time"));
+    for (unsigned int num_threads = 1; ; num_threads *= 2) {
+      if (num_threads > max_threads) num_threads = max_threads;
+      scan.setNumThreads(num_threads);
+      WallTimer timer;
+      TimeHistogram hist(2.4e8, 2.4e8 + .125 * num_records, 1000);
+      scan.run(hist, TimeHistogram::Merge());
+      std::ostringstream os;
+      os << "bin TIME with TableScan, " << scan.getNumThreadsUsed() << " thread(s)";
+      report(os.str(), num_records, timer.elapsed(), hist.getTotal());
+      if (num_threads == max_threads) break;
+    }
+  }
+
+  /// \brief Compare selecting events with cfitsio's row filter and with TableFilter, showing where the time goes.
+  void benchFilter(const std::string & file_name) {
+    std::string filter = "ENERGY > 500. && ENERGY < 900. && TIME % 10 < 5";
+    WallTimer timer;
+    std::unique_ptr<const Table> filtered(IFileSvc::instance().readTable(file_name, "EVENTS", filter));
+    Index_t num_selected = filtered->getNumRecords();
+    filtered.reset();
+    std::unique_ptr<const Table> table(IFileSvc::instance().readTable(file_name, "EVENTS"));
+    Index_t num_records = table->getNumRecords();
+    report("select events with cfitsio row filter", num_records, timer.elapsed(), num_selected);
+
+    TableFilter compiled(filter);
+    for (unsigned int num_threads = 1; num_threads <= 2; ++num_threads) {
+      compiled.setNumThreads(2 == num_threads ? 0 : 1);
+      std::vector<char> selected;
+      compiled.select(*table, selected);
+      const TableFilter::Stats & stats(compiled.getStats());
+      std::ostringstream os;
+      os << "select events with TableFilter, " << stats.m_num_threads << " thread(s)";
+      report(os.str(), num_records, stats.m_total_time, stats.m_num_selected);
+      std::cout << "  parse " << stats.m_parse_time << " s, read " << stats.m_read_time << " s, evaluate " <<
+        stats.m_evaluate_time << " s" << std::endl;
+    }
+  }
+
+  /// \brief Compare cutting a short time window out of the event table by scanning TIME and with a ColumnIndex.
+  void benchTimeWindow(const std::string & file_name) {
+    std::unique_ptr<const Table> table(IFileSvc::instance().readTable(file_name, "EVENTS"));
+    Index_t num_records = table->getNumRecords();
+    // The middle hundredth of the table.
+    double t_start = 2.4e8 + .125 * (num_records / 2);
+    double t_stop = t_start + .125 * (num_records / 100);
+
+    WallTimer timer;
+    std::vector<double> time;
+    table->getColumnData("time", time);
+    Index_t num_in_window = 0;
+    for (std::vector<double>::iterator itor = time.begin(); itor != time.end(); ++itor)
+      if (t_start <= *itor && *itor <= t_stop) ++num_in_window;
+    report("find time window by scanning TIME", num_records, timer.elapsed(), num_in_window);
+
+    timer = WallTimer();
+    ColumnIndex index(*table, "time", ColumnIndex::eAssumeOrder);
+    ColumnIndex::Range_t range = index.equalRange(t_start, t_stop);
+    report("find time window with ColumnIndex", num_records, timer.elapsed(), range.second - range.first);
+    std::cout << "  " << index.getNumRecordsRead() << " records read" << std::endl;
+  }
+
+  /** \brief Create a scratch spacecraft table like an FT2 file, with one record every 30 s.
+      \param file_name The name of the file to create.
+      \param num_records The number of records in the table.
+  */
+  void makeFt2File(const std::string & file_name, Index_t num_records) {
+    std::remove(file_name.c_str());
+    IFileSvc::instance().appendTable(file_name, "SC_DATA");
+    std::unique_ptr<Table> table(IFileSvc::instance().editTable(file_name, "SC_DATA"));
+    table->appendField("START", "1D");
+    table->appendField("SC_POSITION", "3E");
+    table->setNumRecords(num_records);
+
+    std::vector<double> start(num_records);
+    for (Index_t index = 0; index != num_records; ++index) start[index] = 2.4e8 + 30. * index;
+    if (0 != num_records) table->set("start", 0, &start[0], &start[0] + num_records);
+
+    std::vector<double> position(3);
+    Table::Iterator itor = table->begin();
+    for (Index_t index = 0; index != num_records; ++index, ++itor) {
+      position[0] = 7.e6 * std::cos(index * 1.e-2);
+      position[1] = 7.e6 * std::sin(index * 1.e-2);
+      position[2] = 1.e3 * (index % 100);
+      (*itor)["sc_position"].set(position);
+    }
+  }
+
+  /** \brief Compare LinearInterp with IndexedLinearInterp, one value at a time and in batches, interpolating
+      spacecraft position at event times which arrive in increasing order, as they do in an event file, and in
+      random order.
+      \param file_name The name of the scratch file to use.
+      \param num_records The number of records in the spacecraft table.
+      \param num_events The number of event times to interpolate.
+  */
+  void benchInterpolation(const std::string & file_name, Index_t num_records, Index_t num_events) {
+    makeFt2File(file_name, num_records);
+    std::unique_ptr<const Table> table(IFileSvc::instance().readTable(file_name, "SC_DATA"));
+
+    // Event times inside the covered interval, in increasing order, and the same times shuffled.
+    double t_start = 2.4e8;
+    double t_span = 30. * (num_records - 1);
+    std::vector<double> sorted_time(num_events);
+    for (Index_t index = 0; index != num_events; ++index) sorted_time[index] = t_start + t_span * (index + .5) / num_events;
+    std::vector<double> random_time(sorted_time);
+    std::srand(1);
+    for (Index_t index = num_events - 1; 0 < index; --index) std::swap(random_time[index], random_time[std::rand() % (index + 1)]);
+
+    std::ostringstream os;
+    os << " (" << num_records << " records)";
+    std::vector<double> position;
+    for (int random = 0; random != 2; ++random) {
+      const std::vector<double> & time(random ? random_time : sorted_time);
+      const std::string order(random ? "random" : "sorted");
+
+      {
+        WallTimer timer;
+        LinearInterp interp(table->begin(), table->end());
+        double sum = 0.;
+        for (Index_t index = 0; index != num_events; ++index) {
+          interp.interpolate("START", time[index]);
+          interp.get("SC_POSITION", position);
+          sum += position[2];
+        }
+        report("LinearInterp, " + order + " times" + os.str(), num_events, timer.elapsed(), sum);
+      }
+
+      {
+        WallTimer timer;
+        IndexedLinearInterp interp(table->begin(), table->end());
+        double sum = 0.;
+        for (Index_t index = 0; index != num_events; ++index) {
+          interp.interpolate("START", time[index]);
+          interp.get("SC_POSITION", position);
+          sum += position[2];
+        }
+        report("IndexedLinearInterp, " + order + " times" + os.str(), num_events, timer.elapsed(), sum);
+      }
+
+      {
+        WallTimer timer;
+        IndexedLinearInterp interp(table->begin(), table->end());
+        std::vector<std::vector<double> > results;
+        interp.interpolate("START", time, Table::FieldCont(1, "SC_POSITION"), results);
+        double sum = 0.;
+        for (Index_t index = 0; index != num_events; ++index) sum += results[0][3 * index + 2];
+        report("IndexedLinearInterp batch, " + order + " times" + os.str(), num_events, timer.elapsed(), sum);
+      }
+    }
+    table.reset();
+    std::remove(file_name.c_str());
+  }
+
+  /// \brief Compare writing a scalar field record by record with writing it in one bulk operation.
+  void benchWrite(const std::string & file_name) {
+    std::unique_ptr<Table> table(IFileSvc::instance().editTable(file_name, "EVENTS"));
+    Index_t num_records = table->getNumRecords();
+
+    {
+      WallTimer timer;
+      Index_t index = 0;
+      for (Table::Iterator itor = table->begin(); itor != table->end(); ++itor, ++index)
+        (*itor)["time"].set(2.4e8 + .125 * index);
+      report("write TIME record by record through Iterator", num_records, timer.elapsed(), 0.);
+    }
+
+    {
+      WallTimer timer;
+      std::vector<double> time(num_records);
+      for (Index_t index = 0; index != num_records; ++index) time[index] = 2.4e8 + .125 * index;
+      if (0 != num_records) table->set("time", 0, &time[0], &time[0] + num_records);
+      report("write TIME with one bulk call to Table::set", num_records, timer.elapsed(), 0.);
+    }
+
+    {
+      WallTimer timer;
+      std::vector<float> energy(num_records);
+      std::vector<char> null_mask(num_records, 0);
+      for (Index_t index = 0; index != num_records; ++index) {
+        energy[index] = 100.f + index % 1000;
+        null_mask[index] = 0 == index % 100;
+      }
+      if (0 != num_records) table->set("energy", 0, &energy[0], &energy[0] + num_records, &null_mask[0]);
+      report("write ENERGY with Table::set and a null mask (1% nulls)", num_records, timer.elapsed(), 0.);
+    }
+  }
+
+
+  /** \brief Look up a field the way FitsTable::getFieldIndex used to: copy and lowercase the name, then search a map.
+      This is kept here only for comparison with the hashed lookup.
+  */
+  FieldIndex_t mapLookup(const std::map<std::string, FieldIndex_t> & lookup, const std::string & field_name) {
+    std::string lc_name = field_name;
+    for (std::string::iterator itor = lc_name.begin(); itor != lc_name.end(); ++itor) *itor = std::tolower(*itor);
+    std::map<std::string, FieldIndex_t>::const_iterator found = lookup.find(lc_name);
+    return lookup.end() == found ? -1 : found->second;
+  }
+
+  /// \brief Compare ways of identifying fields: lookup by name, through records by name, and through field handles.
+  void benchFieldLookup(const std::string & file_name) {
+    std::unique_ptr<const Table> table(IFileSvc::instance().readTable(file_name, "EVENTS"));
+    Index_t num_records = table->getNumRecords();
+    const std::string field_name = "ENERGY";
+
+    {
+      std::map<std::string, FieldIndex_t> lookup;
+      const Table::FieldCont & fields(table->getValidFields());
+      for (Table::FieldCont::size_type index = 0; index != fields.size(); ++index) lookup[fields[index]] = index;
+      WallTimer timer;
+      double sum = 0.;
+      for (Index_t index = 0; index != num_records; ++index) sum += mapLookup(lookup, field_name);
+      report("look up field name: lowercased copy + std::map", num_records, timer.elapsed(), sum);
+    }
+
+    {
+      WallTimer timer;
+      double sum = 0.;
+      for (Index_t index = 0; index != num_records; ++index) sum += table->getFieldIndex(field_name);
+      report("look up field name: Table::getFieldIndex", num_records, timer.elapsed(), sum);
+    }
+
+    {
+      WallTimer timer;
+      double sum = 0.;
+      for (Table::ConstIterator itor = table->begin(); itor != table->end(); ++itor) sum += (*itor)["energy"].get();
+      report("read ENERGY through ConstIterator by field name", num_records, timer.elapsed(), sum);
+    }
+
+    {
+      WallTimer timer;
+      Table::FieldHandle energy = table->getFieldHandle("energy");
+      double sum = 0.;
+      for (Table::ConstIterator itor = table->begin(); itor != table->end(); ++itor) sum += (*itor)[energy].get();
+      report("read ENERGY through ConstIterator by field handle", num_records, timer.elapsed(), sum);
+    }
+  }
+
+  /** \brief Time appending a small table to the event file under each checksum policy, and report how many bytes
+      were hashed to update the checksums.
+  */
+  void benchChecksum(const std::string & file_name) {
+    IFileSvc::ChecksumPolicy policy = IFileSvc::getChecksumPolicy();
+    IFileSvc::ChecksumPolicy policies[] = { IFileSvc::eChecksumAlways, IFileSvc::eChecksumModified };
+    const char * names[] = { "always", "modified only" };
+    for (int index = 0; index != 2; ++index) {
+      IFileSvc::setChecksumPolicy(policies[index]);
+      std::ostringstream os;
+      os << "CHECKSUM_BENCH" << index;
+      unsigned long long num_bytes = IFileSvc::getNumChecksumBytes();
+      WallTimer timer;
+      IFileSvc::instance().appendTable(file_name, os.str());
+      double elapsed = timer.elapsed();
+      // The sum reported is the number of bytes hashed.
+      report(std::string("append table, checksums ") + names[index], 1, elapsed,
+        double(IFileSvc::getNumChecksumBytes() - num_bytes));
+    }
+    IFileSvc::setChecksumPolicy(policy);
+  }
+
+  void benchDataSum(Index_t num_values) {
+    // A data unit of whole records, as large as the byte-swap buffers.
+    std::vector<unsigned char> data((num_values * 8 / 2880 + 1) * 2880);
+    for (std::vector<unsigned char>::size_type index = 0; index != data.size(); ++index)
+      data[index] = static_cast<unsigned char>(index * 7 + index / 13);
+
+    FitsByteSwap::Kernel best_kernel = FitsByteSwap::getKernel();
+    for (int kernel = FitsByteSwap::eScalar; kernel <= FitsByteSwap::eAvx2; ++kernel) {
+      if (!FitsByteSwap::isSupported(FitsByteSwap::Kernel(kernel))) continue;
+      FitsByteSwap::setKernel(FitsByteSwap::Kernel(kernel));
+      const char * name = FitsByteSwap::getKernelName(FitsByteSwap::Kernel(kernel));
+      // 0 threads means one per core; blocks of 2880 bytes let even a small unit be split.
+      const unsigned int thread_counts[] = { 1, 0 };
+      for (int index = 0; index != 2; ++index) {
+        WallTimer timer;
+        unsigned long sum = 0;
+        for (int repeat = 0; repeat != 10; ++repeat)
+          sum = FitsChecksum::computeDataSum(&data[0], data.size(), thread_counts[index], 2880);
+        std::ostringstream os;
+        os << "sum data unit x10, " << name << " kernel, " << (1 == thread_counts[index] ? "1 thread" : "all cores");
+        report(os.str(), 10 * Index_t(data.size() / 4), timer.elapsed(), double(sum));
+      }
+    }
+    FitsByteSwap::setKernel(best_kernel);
+  }
+
+}
+
+int main(int argc, char ** argv) {
+  int status = 0;
+  try {
+    tip::Index_t num_records = 1 < argc ? std::atol(argv[1]) : 1000000;
+    std::string file_name = "bench_tip_events.fits";
+
+    std::cout << "Creating " << file_name << " with " << num_records << " records" << std::endl;
+    makeEventFile(file_name, num_records);
+
+    benchRead(file_name);
+
+    benchMappedRead(file_name);
+
+    benchReopen(file_name);
+
+    benchSummary(file_name);
+
+    benchScan(file_name);
+
+    benchFilter(file_name);
+
+    benchTimeWindow(file_name);
+
+    benchByteSwap(num_records);
+
+    benchImage("bench_tip_image.fits", num_records);
+
+    // A small spacecraft file like the one in the data directory, then one covering about a month.
+    benchInterpolation("bench_tip_ft2.fits", 100, 10000);
+    benchInterpolation("bench_tip_ft2.fits", 100000, 10000);
+
+    benchWrite(file_name);
+
+    benchFieldLookup(file_name);
+
+    benchChecksum(file_name);
+
+    benchDataSum(num_records);
+
+    std::remove(file_name.c_str());
+  } catch (const std::exception & x) {
+    std::cerr << "Caught " << typeid(x).name() << ": " << x.what() << std::endl;
+    status = 1;
+  }
+  return status;
+}
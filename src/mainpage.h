@@ -163,6 +163,154 @@
     which uses types which ultimately provide modify access to the
     table's cells.
 
+    For large tables, a scalar column may also be read and written
+    a block of records at a time, which avoids the per-row overhead
+    of the iterator loop above:
+
+\verbatim
+    // Example 7:
+    // Same modification of the ph_time column as Example 5 (here restoring the original values),
+    // but reading and writing blocks of records in single operations instead of one row at a time.
+    table = IFileSvc::instance().editTable("day023.fits", "LAT_Event_Summary");
+
+    Index_t num_records = table->getNumRecords();
+    std::vector<double> ph_time(num_records);
+
+    // Read the whole column, modify it in memory, and write it back:
+    table->get("ph_time", 0, num_records, &ph_time[0]);
+    for (std::vector<double>::iterator itor = ph_time.begin(); itor != ph_time.end(); ++itor) *itor += 86400.;
+    table->set("ph_time", 0, &ph_time[0], &ph_time[0] + num_records);
+\endverbatim
+
+    A null mask (an array of char parallel to the values, non-0 for
+    records which should be written as undefined) may be passed as
+    an optional last argument to Table::set.
+
+    Read-only tables in uncompressed local FITS files may also be read
+    through a memory mapping of the table data, by calling
+    IFileSvc::setMapTables(true) before calling readTable. Numeric
+    fields are then read straight from the mapped file, bypassing
+    cfitsio's buffers. Such tables cannot be filtered after they are
+    opened.
+
+    After IFileSvc::setFilterViews(true), readTable applies filters to
+    FITS tables by evaluating the expression once (fits_find_rows) and
+    keeping the indices of the matching rows, rather than having cfitsio
+    copy them. The records of such a view are read in place from the
+    file, which is never changed; filterRows narrows the selection, and
+    views may be scanned by TableScan in several threads.
+
+    Files which are filtered the same way again and again, such as archive
+    event files, can skip evaluating the expression after the first time:
+    IFileSvc::setIndexCacheDir(dir) makes readTable store the indices of
+    the matching rows, as runs, in a sidecar file in dir, and build the
+    view from it when the same file, extension and filter are read again.
+    Entries are ignored once the file or table has changed.
+
+    To process every record of large tables using several threads, use
+    TableScan. Each thread opens its own read-only instance of the table,
+    reads blocks of records of the requested scalar fields in bulk, and
+    passes each block to a user function object; results may be combined
+    afterwards by a reduction. Filtered tables are scanned in the calling
+    thread. Parallel reads of FITS files require cfitsio to have been
+    built to be thread safe (fits_is_reentrant).
+
+    TableFilter selects the records of any table, FITS or Root, which
+    satisfy a row filter expression in a subset of cfitsio's syntax
+    (arithmetic, comparisons, logic, range() and gtifilter()). The
+    expression is compiled once; blocks of records are then read in bulk
+    and evaluated one operation at a time over whole arrays, in several
+    threads as by TableScan. TableFilter::getStats reports how long
+    parsing, reading and evaluating took. After
+    IFileSvc::setCompiledFilters(true), filtered views use TableFilter
+    for the expressions it supports.
+
+    For fields which are sorted in increasing order, such as TIME in event
+    and spacecraft tables, ColumnIndex finds the records whose values lie
+    in a range (lowerBound, upperBound, equalRange) or in a set of good
+    time intervals (findIntervals) without reading the whole field. It
+    keeps the first value of each block of records, searches those, and
+    reads only the blocks which hold the ends of each range.
+
+    To interpolate in large tables which are ordered on the field used to
+    interpolate, such as spacecraft position from FT2 files at every event
+    time, use IndexedLinearInterp instead of LinearInterp. It has the same
+    interface, but reads the interpolation field into memory once and finds
+    each interval by binary search, rather than reading records one by one
+    from the beginning of the table for every value. Its batch form of
+    interpolate computes several fields, scalar or vector, at many values
+    in one call.
+
+    Two interpolators share IndexedLinearInterp's interval search.
+    HermiteInterp interpolates with cubic Hermite splines (Akima or finite
+    difference slopes, computed once per field), which suits smooth
+    quantities such as orbit positions. AngularInterp interpolates attitude
+    quaternions by SLERP and (RA, Dec) pairs along great circles.
+
+    ImageTileReader reads an image of any size one N-dimensional tile at a
+    time, in storage order, with one subset read per tile, so that large
+    count or exposure cubes can be processed with a tile-sized buffer. With
+    a prefetch depth, another thread reads the next tiles while the caller
+    works on the current one; buffers are exchanged rather than copied.
+
+    IFileSvc::appendImage accepts an ImageCompression, which creates a
+    tile-compressed image (Rice, GZIP, HCOMPRESS or PLIO, with an optional
+    tile shape and quantization of floating point pixels) that is otherwise
+    read and written like any other image. Large reads of compressed images
+    are divided into slabs of whole tiles, which are decompressed in
+    parallel through separate file handles when cfitsio is thread safe; see
+    IFileSvc::setImageThreads.
+
+    New images need not store floats: IFileSvc::createFile and
+    IFileSvc::appendImage accept a pixel type (ImageBase::eByte, eShort,
+    eInt, eLongLong, eFloat or eDouble) and optional BSCALE and BZERO, so
+    a counts map may be written as 16-bit integers. The templates
+    IFileSvc::editImage<T> and IFileSvc::readImage<T> open an image with
+    pixels of any of the types unsigned char, short, unsigned short, int,
+    long long, float or double.
+
+    Tools which open the same files repeatedly, for example to classify a
+    file, list its extensions and then read them, may call
+    IFileSvc::setFilePoolSize to keep that many files open after they are
+    closed. Later opens of a pooled file share it through fits_reopen_file
+    instead of opening it and parsing its headers again; a file which has
+    changed on disk is opened afresh. IFileSvc::getFilePoolStats reports
+    how many opens were saved.
+
+    IFileSvc::getFileSummary gives, for each extension, its kind
+    (ExtSummary::getExtType), its number of records, the size of its data
+    in bytes, and the dimensions of an image or the names of a table's
+    fields. The summary of each FITS file is cached when the file is
+    first classified or summarized, and reused until the file changes on
+    disk or is written through tip, so that classifying a file and then
+    opening its extensions by name or number does not reopen it, and
+    IFileSvc::readExtension opens an image directly instead of first
+    trying to open it as a table.
+
+    Checksums are updated only for the extensions which change: appending
+    a table to a large file hashes the new table, not the whole file, and
+    an extension whose header alone changed keeps its DATASUM. Tools which
+    change many extensions may defer the updates with
+    IFileSvc::setChecksumPolicy(IFileSvc::eChecksumDeferred) and make them
+    once with IFileSvc::finalize; IFileSvc::eChecksumAlways restores the
+    old behavior. IFileSvc::getNumChecksumBytes reports the bytes hashed.
+
+    When the data of an extension must be hashed, tip computes DATASUM
+    itself, summing the data in place in the file with the same SSE2 or
+    AVX2 kernel used for byte swapping, and splitting data units larger
+    than a few megabytes into blocks of whole records summed by separate
+    threads (IFileSvc::setChecksumThreads). Cfitsio then hashes only the
+    header to complete CHECKSUM. Files which cannot be mapped into memory,
+    such as compressed files, are hashed by cfitsio as before.
+
+    Table::copyRows copies a list of records of one table, for example
+    the records a filtered view selects, into another table starting at
+    a given record, growing it once if needed. When both are FITS binary
+    tables with the same layout, the raw bytes of the rows are read and
+    written in blocks; otherwise each field is copied in blocks of
+    records, converting numeric scalar values to the type of the
+    destination field.
+
     <hr>
     \section notes Release Notes
     \section requirements Requirements
@@ -272,6 +420,11 @@
     Clients may obtain Image objects using IFileSvc's readImage and
     editImage methods, which are similar to readTable and editTable,
     respectively.
+    Typed variants (readImageDbl, readImageInt, readImageLongLong and
+    the corresponding edit methods) return TypedImage objects whose pixels
+    have the given type; readImageLongLong preserves the full precision of
+    64-bit integer (BITPIX = 64) images. Table fields in the 64-bit integer
+    (K) format may likewise be read and written as long long.
 
     \section jobOptions jobOptions
     Not applicable.
@@ -7,6 +7,7 @@
 
 #include <iostream>
 #include <typeinfo>
+#include <vector>
 
 #include "tip/Header.h"
 #include "tip/IFileSvc.h"
@@ -124,5 +125,24 @@ int main() {
   }
   delete table; table = 0;
   delete const_table; const_table = 0;
+
+  try {
+    // Example 7:
+    // Same modification of the ph_time column as Example 5 (here restoring the original values),
+    // but reading and writing blocks of records in single operations instead of one row at a time.
+    table = IFileSvc::instance().editTable("day023.fits", "LAT_Event_Summary");
+
+    Index_t num_records = table->getNumRecords();
+    std::vector<double> ph_time(num_records);
+
+    // Read the whole column, modify it in memory, and write it back:
+    table->get("ph_time", 0, num_records, &ph_time[0]);
+    for (std::vector<double>::iterator itor = ph_time.begin(); itor != ph_time.end(); ++itor) *itor += 86400.;
+    table->set("ph_time", 0, &ph_time[0], &ph_time[0] + num_records);
+
+  } catch (const std::exception & x) {
+    std::cerr << "Caught " << typeid(x).name() << ": " << x.what() << std::endl;
+  }
+  delete table; table = 0;
   return 0;
 }
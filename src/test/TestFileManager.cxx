@@ -7,9 +7,14 @@
 #include <cstdlib>
 #include <memory>
 #include <iostream>
+#include <vector>
 
+#include "FitsChecksum.h"
+#include "FitsDecoder.h"
 #include "FitsFileManager.h"
+#include "FitsMapping.h"
 #include "FitsTipFile.h"
+#include "fitsio.h"
 #ifndef BUILD_WITHOUT_ROOT
 #include "RootTable.h"
 #endif
@@ -21,6 +26,30 @@
 #include "tip/Table.h"
 #include "tip/tip_types.h"
 
+namespace {
+
+  // Return whether cfitsio finds the checksums of every extension in a file correct.
+  bool checksumsValid(const std::string & file_name) {
+    fitsfile * fp = 0;
+    int status = 0;
+    fits_open_file(&fp, const_cast<char *>(file_name.c_str()), READONLY, &status);
+    int num_hdus = 0;
+    fits_get_num_hdus(fp, &num_hdus, &status);
+    bool valid = 0 == status && 0 < num_hdus;
+    for (int ii = 1; valid && ii <= num_hdus; ++ii) {
+      int data_ok = 0;
+      int hdu_ok = 0;
+      fits_movabs_hdu(fp, ii, 0, &status);
+      fits_verify_chksum(fp, &data_ok, &hdu_ok, &status);
+      valid = 0 == status && 1 == data_ok && 1 == hdu_ok;
+    }
+    status = 0;
+    if (0 != fp) fits_close_file(fp, &status);
+    return valid;
+  }
+
+}
+
 namespace tip {
 
   int TestFileManager::test(int status) {
@@ -54,6 +83,15 @@ namespace tip {
     // Test file access.
     tipFileTest();
 
+    // Test pooling of open files.
+    filePoolTest();
+
+    // Test checksum policies.
+    checksumTest();
+
+    // Test computing data checksums.
+    dataSumTest();
+
     return getStatus();
   }
 
@@ -206,6 +244,50 @@ namespace tip {
     }
 
     delete table;
+
+    // Test opening table read-only with only some fields set up at first.
+    std::vector<std::string> fields(1, "CHANNEL");
+    msg = std::string("TestFileManager::readTableTest opening extension SPECTRUM of file ") + data_dir +
+      "a1.pha with only field CHANNEL needed";
+    try {
+      std::unique_ptr<const Table> full_table(IFileSvc::instance().readTable(data_dir + "a1.pha", "SPECTRUM"));
+      std::unique_ptr<const Table> projected_table(IFileSvc::instance().readTable(data_dir + "a1.pha", "SPECTRUM", "", fields));
+      if (full_table->getValidFields() == projected_table->getValidFields())
+        ReportExpected(msg + " gave the same valid fields as opening all fields");
+      else
+        ReportUnexpected(msg + " did not give the same valid fields as opening all fields");
+
+      // Compare the needed field and a field which was not needed, which is set up when first used.
+      Table::ConstIterator full_itor = full_table->begin();
+      Table::ConstIterator projected_itor = projected_table->begin();
+      long full_channel = 0;
+      long projected_channel = 0;
+      std::vector<double> full_counts;
+      std::vector<double> projected_counts;
+      for (; full_itor != full_table->end(); ++full_itor, ++projected_itor) {
+        (*full_itor)["channel"].get(full_channel);
+        (*projected_itor)["channel"].get(projected_channel);
+        (*full_itor)["counts"].get(full_counts);
+        (*projected_itor)["counts"].get(projected_counts);
+        if (full_channel != projected_channel || full_counts != projected_counts) break;
+      }
+      if (full_itor == full_table->end())
+        ReportExpected(msg + " gave the same values as opening all fields");
+      else
+        ReportUnexpected(msg + " did not give the same values as opening all fields");
+    } catch(const TipException & x) {
+      ReportUnexpected(msg + " failed", x);
+    }
+
+    fields.push_back("NO_SUCH_FIELD");
+    msg = std::string("TestFileManager::readTableTest opening extension SPECTRUM of file ") + data_dir +
+      "a1.pha with a needed field which does not exist";
+    try {
+      std::unique_ptr<const Table> projected_table(IFileSvc::instance().readTable(data_dir + "a1.pha", "SPECTRUM", "", fields));
+      ReportUnexpected(msg + " succeeded");
+    } catch(const TipException & x) {
+      ReportExpected(msg + " failed", x);
+    }
   }
 
   void TestFileManager::fileStatusTest() {
@@ -423,4 +505,208 @@ namespace tip {
     }
   }
 
+  void TestFileManager::filePoolTest() {
+    std::string file_name = "pooled_file.fits";
+    try {
+      IFileSvc & file_svc(IFileSvc::instance());
+      IFileSvc::setFilePoolSize(4);
+      remove(file_name.c_str());
+      file_svc.appendTable(file_name, "TABLE1");
+      file_svc.appendTable(file_name, "TABLE2");
+
+      // Visit each extension, and the summary, several times; at most the first open should open the file. The
+      // cached summary is forgotten each time, so that each visit to the summary opens the file.
+      unsigned long start_hits = 0;
+      unsigned long start_misses = 0;
+      IFileSvc::getFilePoolStats(start_hits, start_misses);
+      FileSummary summary;
+      for (int ii = 0; ii != 3; ++ii) {
+        FitsFileManager::forgetSummary(file_name);
+        file_svc.getFileSummary(file_name, summary);
+        std::unique_ptr<const Extension> table1(file_svc.readExtension(file_name, "TABLE1"));
+        std::unique_ptr<const Extension> table2(file_svc.readExtension(file_name, "2"));
+      }
+      unsigned long num_hits = 0;
+      unsigned long num_misses = 0;
+      IFileSvc::getFilePoolStats(num_hits, num_misses);
+      if (1 < num_misses - start_misses || 8 > num_hits - start_hits)
+        ReportUnexpected("filePoolTest: after at least 9 opens of one file, pool had " +
+          toString(num_hits - start_hits) + " hits and " + toString(num_misses - start_misses) + " misses");
+      else
+        ReportExpected("filePoolTest: repeated opens of one file reused the pooled file");
+
+      // A summary served from the cache does not open the file at all.
+      IFileSvc::getFilePoolStats(start_hits, start_misses);
+      file_svc.getFileSummary(file_name, summary);
+      file_svc.getFileSummary(file_name, summary);
+      IFileSvc::getFilePoolStats(num_hits, num_misses);
+      if (start_hits != num_hits || start_misses != num_misses)
+        ReportUnexpected("filePoolTest: getting a cached summary opened the file " +
+          toString(num_hits - start_hits + num_misses - start_misses) + " times");
+      else
+        ReportExpected("filePoolTest: getting a cached summary did not open the file");
+
+      // Write through the pool, then read back what was written.
+      {
+        std::unique_ptr<Extension> table2(file_svc.editExtension(file_name, "TABLE2"));
+        table2->getHeader().setKeyword("POOLED", 7);
+      }
+      std::unique_ptr<const Extension> table2(file_svc.readExtension(file_name, "TABLE2"));
+      int pooled = 0;
+      table2->getHeader().getKeyword("POOLED", pooled);
+      if (7 != pooled)
+        ReportUnexpected("filePoolTest: read keyword POOLED = " + toString(pooled) + " through the pool, not 7");
+      else
+        ReportExpected("filePoolTest: read through the pool a keyword written through the pool");
+      table2.reset();
+
+      // Replace the file; the pooled copy of the old file must not be used.
+      file_svc.createFile(file_name);
+      try {
+        std::unique_ptr<const Extension> table1(file_svc.readExtension(file_name, "TABLE1"));
+        ReportUnexpected("filePoolTest: opened an extension of a file which was replaced");
+      } catch (const TipException & x) {
+        ReportExpected("filePoolTest: did not open an extension of a file which was replaced", x);
+      }
+
+      IFileSvc::setFilePoolSize(0);
+      if (0 != IFileSvc::getFilePoolSize())
+        ReportUnexpected("filePoolTest: setFilePoolSize(0) did not disable the pool");
+    } catch (const TipException & x) {
+      ReportUnexpected("TestFileManager::filePoolTest caught unexpected exception", x);
+    }
+    IFileSvc::setFilePoolSize(0);
+    remove(file_name.c_str());
+  }
+
+  void TestFileManager::checksumTest() {
+    std::string file_name = "checksum_file.fits";
+    IFileSvc::ChecksumPolicy policy = IFileSvc::getChecksumPolicy();
+    try {
+      IFileSvc & file_svc(IFileSvc::instance());
+      IFileSvc::setChecksumPolicy(IFileSvc::eChecksumModified);
+      remove(file_name.c_str());
+      file_svc.appendTable(file_name, "TABLE1");
+      {
+        std::unique_ptr<Table> table(file_svc.editTable(file_name, "TABLE1"));
+        table->appendField("TIME", "1D");
+        table->setNumRecords(1000);
+      }
+
+      // Appending a table should hash only the new table, not the 8000 bytes of the first one.
+      unsigned long long num_bytes = IFileSvc::getNumChecksumBytes();
+      file_svc.appendTable(file_name, "TABLE2");
+      unsigned long long num_hashed = IFileSvc::getNumChecksumBytes() - num_bytes;
+      if (0 == num_hashed || 8000 <= num_hashed)
+        ReportUnexpected("checksumTest: appending an empty table hashed " + toString(num_hashed) + " bytes");
+      else if (!checksumsValid(file_name))
+        ReportUnexpected("checksumTest: checksums are not valid after appending a table");
+      else
+        ReportExpected("checksumTest: appending a table hashed only the new table");
+
+      // Opening a table for writing without changing it should hash nothing.
+      num_bytes = IFileSvc::getNumChecksumBytes();
+      delete file_svc.editTable(file_name, "TABLE1");
+      if (num_bytes != IFileSvc::getNumChecksumBytes())
+        ReportUnexpected("checksumTest: closing an unchanged table hashed it");
+
+      // Filtering a table deletes rows in place, so its checksums must be updated when it is closed.
+      {
+        std::unique_ptr<Table> table(file_svc.editTable(file_name, "TABLE1"));
+        std::vector<double> time(1000);
+        for (std::vector<double>::size_type ii = 0; ii != time.size(); ++ii) time[ii] = ii;
+        table->set("TIME", 0, &time[0], &time[0] + time.size());
+      }
+      {
+        std::unique_ptr<Table> table(file_svc.editTable(file_name, "TABLE1"));
+        table->filterRows("TIME < 500");
+      }
+      if (!checksumsValid(file_name))
+        ReportUnexpected("checksumTest: checksums are not valid after filtering a table");
+      else
+        ReportExpected("checksumTest: filtering a table updated its checksums");
+
+      // Deferred updates wait for finalize, which leaves the checksums valid.
+      IFileSvc::setChecksumPolicy(IFileSvc::eChecksumDeferred);
+      num_bytes = IFileSvc::getNumChecksumBytes();
+      {
+        std::unique_ptr<Table> table(file_svc.editTable(file_name, "TABLE1"));
+        table->setNumRecords(1001);
+      }
+      {
+        std::unique_ptr<Extension> table(file_svc.editExtension(file_name, "TABLE2"));
+        table->getHeader().setKeyword("DEFERRED", true);
+      }
+      if (num_bytes != IFileSvc::getNumChecksumBytes())
+        ReportUnexpected("checksumTest: deferred checksums were computed before finalize was called");
+      IFileSvc::finalize();
+      if (num_bytes == IFileSvc::getNumChecksumBytes() || !checksumsValid(file_name))
+        ReportUnexpected("checksumTest: finalize did not leave valid checksums");
+      else
+        ReportExpected("checksumTest: finalize updated deferred checksums");
+    } catch (const TipException & x) {
+      ReportUnexpected("TestFileManager::checksumTest caught unexpected exception", x);
+    }
+    IFileSvc::setChecksumPolicy(policy);
+    remove(file_name.c_str());
+  }
+
+  void TestFileManager::dataSumTest() {
+    std::string file_name = "datasum_file.fits";
+    const char * data_files[] = { "arlac.pha", "aeff_DC1.fits", "groD4-dc2v1.fits" };
+    FitsByteSwap::Kernel best_kernel = FitsByteSwap::getKernel();
+    try {
+      for (std::size_t ff = 0; ff != sizeof(data_files) / sizeof(data_files[0]); ++ff) {
+        // Copying a file writes the checksums of every extension, summing the data of each here.
+        std::string msg = std::string("dataSumTest: copying ") + data_files[ff];
+        FitsTipFile(getDataDir() + data_files[ff]).copyFile(file_name);
+        if (!checksumsValid(file_name)) {
+          ReportUnexpected(msg + " did not write valid checksums");
+          continue;
+        }
+
+        // Compare the sums each kernel computes, in blocks of single records, with the sums cfitsio computes.
+        fitsfile * fp = 0;
+        int status = 0;
+        int num_hdus = 0;
+        fits_open_file(&fp, const_cast<char *>(file_name.c_str()), READONLY, &status);
+        fits_get_num_hdus(fp, &num_hdus, &status);
+        bool sums_match = 0 == status;
+        for (int ii = 1; sums_match && ii <= num_hdus; ++ii) {
+          LONGLONG header_start = 0;
+          LONGLONG data_start = 0;
+          LONGLONG data_end = 0;
+          unsigned long data_sum = 0;
+          unsigned long hdu_sum = 0;
+          fits_movabs_hdu(fp, ii, 0, &status);
+          fits_get_hduaddrll(fp, &header_start, &data_start, &data_end, &status);
+          fits_get_chksum(fp, &data_sum, &hdu_sum, &status);
+          FitsMapping mapping;
+          if (0 != status || (data_end > data_start && !mapping.map(file_name, fp, data_end - data_start))) {
+            sums_match = false;
+            break;
+          }
+          for (int kernel = FitsByteSwap::eScalar; kernel <= FitsByteSwap::eAvx2; ++kernel) {
+            if (!FitsByteSwap::isSupported(FitsByteSwap::Kernel(kernel))) continue;
+            FitsByteSwap::setKernel(FitsByteSwap::Kernel(kernel));
+            if (data_sum != FitsChecksum::computeDataSum(mapping.getData(), data_end - data_start, 3, 2880)) {
+              ReportUnexpected(msg + ": the " + FitsByteSwap::getKernelName(FitsByteSwap::Kernel(kernel)) +
+                " kernel did not compute the data sum of extension " + toString(ii - 1) + " as cfitsio does");
+              sums_match = false;
+            }
+          }
+        }
+        FitsByteSwap::setKernel(best_kernel);
+        status = 0;
+        if (0 != fp) fits_close_file(fp, &status);
+        if (sums_match) ReportExpected(msg + " wrote valid checksums, with data sums which match cfitsio's");
+        else ReportUnexpected(msg + ": data sums could not be compared with cfitsio's, or differ from them");
+      }
+    } catch (const TipException & x) {
+      ReportUnexpected("TestFileManager::dataSumTest caught unexpected exception", x);
+    }
+    FitsByteSwap::setKernel(best_kernel);
+    remove(file_name.c_str());
+  }
+
 }
@@ -44,6 +44,15 @@ namespace tip {
 
       /// \brief Test ITipFile and subclasses.
       void tipFileTest();
+
+      /// \brief Test reopening files kept open by the file pool.
+      void filePoolTest();
+
+      /// \brief Test the checksum policies.
+      void checksumTest();
+
+      /// \brief Test computing the data checksums of extensions in parallel.
+      void dataSumTest();
   };
 
 }
@@ -2,11 +2,14 @@
     \brief Implementation for class to perform detailed testing of data file abstractions.
     \author James Peachey, HEASARC
 */
+#include <cstdio>
+#include <memory>
 #include <string>
 
 #include "TestFileSummary.h"
 #include "tip/FileSummary.h"
 #include "tip/IFileSvc.h"
+#include "tip/Table.h"
 #include "tip/TipException.h"
 
 namespace tip {
@@ -45,9 +48,57 @@ namespace tip {
       } catch (const TipException & x) {
         ReportUnexpected(msg + " failed", x);
       }
+
+      msg = "checking layout of extensions in data file summary";
+      if (3u == summary.size()) {
+        // Primary array is a 55 x 50 32-bit image; the tables have 500 and 2 rows, each in one 2880 byte block.
+        const ExtSummary & primary(summary[0]);
+        const ExtSummary & spectrum(summary[1]);
+        const ExtSummary & gti(summary[2]);
+        if (!primary.isImage() || 2u != primary.getImageDimensions().size() ||
+          55 != primary.getImageDimensions()[0] || 50 != primary.getImageDimensions()[1] ||
+          11520 != primary.getNumBytes())
+          ReportUnexpected(msg + ": primary array is not summarized as a 55 x 50 image of 11520 bytes");
+        else if (ExtSummary::eBinaryTable != spectrum.getExtType() || 500 != spectrum.getNumRecords() ||
+          2880 != spectrum.getNumBytes() || 2u != spectrum.getFieldNames().size() ||
+          "channel" != spectrum.getFieldNames()[0] || "counts" != spectrum.getFieldNames()[1])
+          ReportUnexpected(msg + ": SPECTRUM is not summarized as a binary table of 500 records with fields channel "
+            "and counts");
+        else if (!gti.isTable() || gti.isImage() || 2 != gti.getNumRecords())
+          ReportUnexpected(msg + ": GTI is not summarized as a table of 2 records");
+        else
+          ReportExpected(msg + " succeeded");
+      }
+    } catch (const TipException & x) {
+      ReportUnexpected(msg + " failed", x);
+    }
+
+    std::string file_name = "summary_file.fits";
+    try {
+      msg = "summarizing a file which is changed after it is summarized";
+      remove(file_name.c_str());
+      IFileSvc::instance().appendTable(file_name, "EVENTS");
+
+      FileSummary summary;
+      IFileSvc::instance().getFileSummary(file_name, summary);
+      if (2u != summary.size() || 0 != summary[1].getNumRecords())
+        ReportUnexpected(msg + ": new table is not summarized as having 0 records");
+
+      // Add records; the next summary must see them, not the summary remembered from before.
+      {
+        std::unique_ptr<Table> table(IFileSvc::instance().editTable(file_name, "EVENTS"));
+        table->appendField("TIME", "1D");
+        table->setNumRecords(10);
+      }
+      IFileSvc::instance().getFileSummary(file_name, summary);
+      if (2u != summary.size() || 10 != summary[1].getNumRecords() || 1u != summary[1].getFieldNames().size())
+        ReportUnexpected(msg + ": summary does not show the field and records added to the table");
+      else
+        ReportExpected(msg + " succeeded");
     } catch (const TipException & x) {
       ReportUnexpected(msg + " failed", x);
     }
+    remove(file_name.c_str());
 
     return getStatus();
   }
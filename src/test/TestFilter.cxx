@@ -2,13 +2,21 @@
     \brief Implementation of class to perform detailed testing of Filter abstractions.
     \author James Peachey, HEASARC
 */
+#include <cstdio>
+#include <fstream>
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
+#include "FitsFilteredTable.h"
+#include "FitsTable.h"
+#include "RowIndexCache.h"
 #include "TestFilter.h"
 
 #include "tip/IFileSvc.h"
 #include "tip/Table.h"
+#include "tip/TableFilter.h"
 #include "tip/TipException.h"
 
 namespace tip {
@@ -61,7 +69,271 @@ namespace tip {
       ReportExpected("in TestFilter::test, applying filter \"" + filter + "\" generated exception", x);
     }
 
+    compiledFilterTest();
+
+    indexCacheTest();
+
     return getStatus();
   }
 
+  void TestFilter::compiledFilterTest() {
+    std::string msg = "TestFilter::compiledFilterTest: creating compiled_filter.fits";
+    const Index_t num_records = 1000;
+    try {
+      remove("compiled_filter.fits");
+      IFileSvc::instance().appendTable("compiled_filter.fits", "EVENTS");
+      std::unique_ptr<Table> table(IFileSvc::instance().editTable("compiled_filter.fits", "EVENTS"));
+      table->appendField("TIME", "1D");
+      table->appendField("ENERGY", "1E");
+      table->appendField("PHA", "1J");
+      table->setNumRecords(num_records);
+      std::vector<double> time(num_records);
+      std::vector<float> energy(num_records);
+      std::vector<long> pha(num_records);
+      for (Index_t ii = 0; ii != num_records; ++ii) {
+        time[ii] = ii;
+        energy[ii] = (ii * 37) % 200;
+        pha[ii] = ii % 11;
+      }
+      table->set("time", 0, &time[0], &time[0] + num_records);
+      table->set("energy", 0, &energy[0], &energy[0] + num_records);
+      table->set("pha", 0, &pha[0], &pha[0] + num_records);
+
+      IFileSvc::instance().appendTable("compiled_filter.fits", "GTI");
+      std::unique_ptr<Table> gti(IFileSvc::instance().editTable("compiled_filter.fits", "GTI"));
+      gti->appendField("START", "1D");
+      gti->appendField("STOP", "1D");
+      // Out of order and overlapping, which cfitsio handles and so must TableFilter.
+      double start[] = { 600.25, 100.25, 150.25, 900.75 };
+      double stop[] = { 700.25, 200.25, 250.25, 901.75 };
+      gti->setNumRecords(4);
+      gti->set("start", 0, start, start + 4);
+      gti->set("stop", 0, stop, stop + 4);
+    } catch (const TipException & x) {
+      ReportUnexpected(msg + " failed", x);
+      remove("compiled_filter.fits");
+      return;
+    }
+
+    // Each expression must select the same records as the equivalent expression does in cfitsio.
+    std::vector<std::pair<std::string, std::string> > filters;
+    filters.push_back(std::make_pair("ENERGY > 100. && TIME < 500.", "ENERGY > 100. && TIME < 500."));
+    filters.push_back(std::make_pair("range(energy, 50., 150.) || Pha % 7 == 0",
+      "(ENERGY >= 50. && ENERGY <= 150.) || PHA % 7 == 0"));
+    filters.push_back(std::make_pair("abs(ENERGY - 100.) < 10. .and. .not. (PHA .eq. 3)",
+      "abs(ENERGY - 100.) < 10. .and. .not. (PHA .eq. 3)"));
+    filters.push_back(std::make_pair("#row > 990 || -TIME > -2 * 5 + 1", "#row > 990 || -TIME > -2 * 5 + 1"));
+    filters.push_back(std::make_pair("2 ** 3 == 8 && max(PHA, 5) <= 5", "PHA <= 5"));
+    filters.push_back(std::make_pair("gtifilter(\"compiled_filter.fits[GTI]\")",
+      "gtifilter(\"compiled_filter.fits[GTI]\")"));
+    filters.push_back(std::make_pair("gtifilter('compiled_filter.fits[GTI]', TIME + 0.5, 'START', 'STOP') && PHA > 2",
+      "gtifilter(\"compiled_filter.fits[GTI]\", TIME + 0.5, \"START\", \"STOP\") && PHA > 2"));
+    msg = "TestFilter::compiledFilterTest: comparing TableFilter with cfitsio";
+    try {
+      std::unique_ptr<const Table> table(IFileSvc::instance().readTable("compiled_filter.fits", "EVENTS"));
+      std::vector<double> time(num_records);
+      table->get("time", 0, num_records, &time[0]);
+      for (std::vector<std::pair<std::string, std::string> >::iterator itor = filters.begin(); itor != filters.end();
+        ++itor) {
+        TableFilter filter(itor->first);
+        std::vector<Index_t> records;
+        filter.select(*table, records);
+        std::vector<double> selected_time;
+        for (std::vector<Index_t>::iterator rec_itor = records.begin(); rec_itor != records.end(); ++rec_itor)
+          selected_time.push_back(time[*rec_itor]);
+
+        std::unique_ptr<const Table> cfitsio_table(IFileSvc::instance().readTable("compiled_filter.fits", "EVENTS",
+          itor->second));
+        std::vector<double> cfitsio_time(cfitsio_table->getNumRecords());
+        if (!cfitsio_time.empty()) cfitsio_table->get("time", 0, cfitsio_time.size(), &cfitsio_time[0]);
+
+        const TableFilter::Stats & stats(filter.getStats());
+        if (selected_time.empty() || selected_time != cfitsio_time)
+          ReportUnexpected(msg + ": filter \"" + itor->first + "\" selected " + toString(selected_time.size()) +
+            " records, not the " + toString(cfitsio_time.size()) + " records selected by cfitsio");
+        else if (num_records != stats.m_num_records || Index_t(records.size()) != stats.m_num_selected)
+          ReportUnexpected(msg + ": filter \"" + itor->first + "\" did not report the numbers of records correctly");
+        else
+          ReportExpected(msg + ": filter \"" + itor->first + "\" selected the same records as cfitsio");
+      }
+
+      // The result must not depend on the number of threads.
+      TableFilter filter("ENERGY > 100. && TIME < 500.");
+      std::vector<char> selected;
+      filter.select(*table, selected);
+      std::vector<char> serial_selected;
+      filter.setNumThreads(1);
+      filter.select(*table, serial_selected);
+      if (selected != serial_selected || 1 != filter.getStats().m_num_threads)
+        ReportUnexpected(msg + ": filtering with one thread did not give the same result");
+      else
+        ReportExpected(msg + ": filtering with one thread gave the same result");
+    } catch (const TipException & x) {
+      ReportUnexpected(msg + " failed", x);
+    }
+
+    // Invalid expressions must be reported when the filter is created, and unknown fields when it is used.
+    const char * bad_filters[] = { "ENERGY >", "(ENERGY > 1", "foo(ENERGY) > 1", "min(ENERGY) > 1", "ENERGY > 'x'",
+      "gtifilter()", "ENERGY > 1 2", "  " };
+    for (std::size_t ii = 0; ii != sizeof(bad_filters) / sizeof(bad_filters[0]); ++ii) {
+      try {
+        TableFilter filter(bad_filters[ii]);
+        ReportUnexpected("TestFilter::compiledFilterTest: creating filter \"" + std::string(bad_filters[ii]) +
+          "\" did not throw an exception");
+      } catch (const TipException & x) {
+        ReportExpected("TestFilter::compiledFilterTest: creating filter \"" + std::string(bad_filters[ii]) +
+          "\" threw exception", x);
+      }
+    }
+    try {
+      std::unique_ptr<const Table> table(IFileSvc::instance().readTable("compiled_filter.fits", "EVENTS"));
+      TableFilter filter("NO_SUCH_FIELD > 1");
+      std::vector<char> selected;
+      filter.select(*table, selected);
+      ReportUnexpected("TestFilter::compiledFilterTest: filtering on a field which does not exist did not throw");
+    } catch (const TipException & x) {
+      ReportExpected("TestFilter::compiledFilterTest: filtering on a field which does not exist threw exception", x);
+    }
+
+    // Views with compiled filters must select the same records as cfitsio, also when filters are stacked.
+    msg = "TestFilter::compiledFilterTest: filtering a view with compiled filters";
+    try {
+      IFileSvc::setCompiledFilters(true);
+      std::unique_ptr<Table> view(new FitsFilteredTable(new FitsTable("compiled_filter.fits", "EVENTS"),
+        "ENERGY > 100."));
+      view->filterRows("PHA < 4");
+      IFileSvc::setCompiledFilters(false);
+      std::unique_ptr<const Table> table(IFileSvc::instance().readTable("compiled_filter.fits", "EVENTS",
+        "ENERGY > 100. && PHA < 4"));
+      Index_t num_filtered = table->getNumRecords();
+      std::vector<double> view_time(num_filtered);
+      std::vector<double> table_time(num_filtered);
+      if (0 != num_filtered && num_filtered == view->getNumRecords()) {
+        view->get("time", 0, num_filtered, &view_time[0]);
+        table->get("time", 0, num_filtered, &table_time[0]);
+      }
+      if (0 == num_filtered || num_filtered != view->getNumRecords() || view_time != table_time)
+        ReportUnexpected(msg + " did not select the same records as cfitsio");
+      else
+        ReportExpected(msg + " selected the same records as cfitsio");
+    } catch (const TipException & x) {
+      IFileSvc::setCompiledFilters(false);
+      ReportUnexpected(msg + " failed", x);
+    }
+
+    remove("compiled_filter.fits");
+  }
+
+
+  void TestFilter::indexCacheTest() {
+    std::string msg = "TestFilter::indexCacheTest: creating filter_cache.fits";
+    const Index_t num_records = 100;
+    try {
+      remove("filter_cache.fits");
+      IFileSvc::instance().appendTable("filter_cache.fits", "EVENTS");
+      std::unique_ptr<Table> table(IFileSvc::instance().editTable("filter_cache.fits", "EVENTS"));
+      table->appendField("ENERGY", "1E");
+      table->setNumRecords(num_records);
+      std::vector<float> energy(num_records);
+      for (Index_t ii = 0; ii != num_records; ++ii) energy[ii] = ii;
+      table->set("energy", 0, &energy[0], &energy[0] + num_records);
+    } catch (const TipException & x) {
+      ReportUnexpected(msg + " failed", x);
+      remove("filter_cache.fits");
+      return;
+    }
+
+    std::string filter = "ENERGY > 89.5";
+    RowIndexCache cache(".", IFileSvc::getCompiledFilters());
+    std::string cache_file_name = cache.getFileName("filter_cache.fits", "EVENTS", filter);
+    remove(cache_file_name.c_str());
+    IFileSvc::setIndexCacheDir(".");
+
+    // The first read evaluates the filter, and stores the rows.
+    msg = "TestFilter::indexCacheTest: reading filter_cache.fits with filter \"" + filter + "\"";
+    try {
+      std::unique_ptr<const Table> table(IFileSvc::instance().readTable("filter_cache.fits", "EVENTS", filter));
+      if (10 != table->getNumRecords())
+        ReportUnexpected(msg + " the first time read " + toString(table->getNumRecords()) + " records, not 10");
+      else if (!std::ifstream(cache_file_name.c_str()))
+        ReportUnexpected(msg + " the first time did not create " + cache_file_name);
+      else
+        ReportExpected(msg + " the first time read 10 records and stored them in the cache");
+    } catch (const TipException & x) {
+      ReportUnexpected(msg + " the first time failed", x);
+    }
+
+    // Replace the entry with different rows, which must be what the next read selects.
+    try {
+      std::unique_ptr<const Table> table(IFileSvc::instance().readTable("filter_cache.fits", "EVENTS"));
+      RowIndexCache::RowCont_t rows;
+      rows.push_back(0);
+      rows.push_back(1);
+      rows.push_back(5);
+      cache.store("filter_cache.fits", "EVENTS", filter, *table, rows);
+      table.reset(IFileSvc::instance().readTable("filter_cache.fits", "EVENTS", filter));
+      double energy = -1.;
+      (*table->begin())["energy"].get(energy);
+      if (3 == table->getNumRecords() && 0. == energy)
+        ReportExpected(msg + " again used the rows stored in the cache");
+      else
+        ReportUnexpected(msg + " again did not use the rows stored in the cache");
+    } catch (const TipException & x) {
+      ReportUnexpected(msg + " again failed", x);
+    }
+
+    // The other filter engine may select other rows, so it must not use the entry.
+    try {
+      RowIndexCache other_cache(".", !IFileSvc::getCompiledFilters());
+      std::unique_ptr<const Table> table(IFileSvc::instance().readTable("filter_cache.fits", "EVENTS"));
+      RowIndexCache::RowCont_t rows;
+      if (other_cache.getFileName("filter_cache.fits", "EVENTS", filter) == cache_file_name ||
+        other_cache.load("filter_cache.fits", "EVENTS", filter, *table, rows))
+        ReportUnexpected(msg + " with the other filter engine used the rows it stored in the cache");
+      else
+        ReportExpected(msg + " with the other filter engine did not use the rows it stored in the cache");
+    } catch (const TipException & x) {
+      ReportUnexpected(msg + " with the other filter engine failed", x);
+    }
+
+    // Once the table changes, the entry is stale, so the filter must be evaluated again.
+    try {
+      std::unique_ptr<Table> table(IFileSvc::instance().editTable("filter_cache.fits", "EVENTS"));
+      table->setNumRecords(num_records + 1);
+      table.reset();
+      std::unique_ptr<const Table> filtered(IFileSvc::instance().readTable("filter_cache.fits", "EVENTS", filter));
+      if (10 == filtered->getNumRecords())
+        ReportExpected(msg + " after changing the table ignored the stale entry in the cache");
+      else
+        ReportUnexpected(msg + " after changing the table read " + toString(filtered->getNumRecords()) +
+          " records, not 10");
+    } catch (const TipException & x) {
+      ReportUnexpected(msg + " after changing the table failed", x);
+    }
+
+    // Expressions which read other files are not cached, since changes to those files would not be noticed.
+    msg = "TestFilter::indexCacheTest: storing the rows matching an expression which reads a GTI file";
+    try {
+      std::string gti_filter = "gtifilter(\"gti.fits[GTI]\", TIME)";
+      std::string gti_cache_file_name = cache.getFileName("filter_cache.fits", "EVENTS", gti_filter);
+      remove(gti_cache_file_name.c_str());
+      std::unique_ptr<const Table> table(IFileSvc::instance().readTable("filter_cache.fits", "EVENTS"));
+      RowIndexCache::RowCont_t rows(1, 0);
+      cache.store("filter_cache.fits", "EVENTS", gti_filter, *table, rows);
+      if (std::ifstream(gti_cache_file_name.c_str()) || cache.load("filter_cache.fits", "EVENTS", gti_filter, *table,
+        rows)) {
+        ReportUnexpected(msg + " cached them");
+        remove(gti_cache_file_name.c_str());
+      } else {
+        ReportExpected(msg + " did not cache them");
+      }
+    } catch (const TipException & x) {
+      ReportUnexpected(msg + " failed", x);
+    }
+
+    IFileSvc::setIndexCacheDir("");
+    remove(cache_file_name.c_str());
+    remove("filter_cache.fits");
+  }
+
 }
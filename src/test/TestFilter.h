@@ -21,6 +21,13 @@ namespace tip {
       /** \brief Perform all detailed tests.
       */
       virtual int test(int status);
+
+    private:
+      /// \brief Test filtering with TableFilter, and views using it, against filtering by cfitsio.
+      void compiledFilterTest();
+
+      /// \brief Test reusing the rows which match a filter from the index cache, and rejecting stale entries.
+      void indexCacheTest();
   };
 
 }
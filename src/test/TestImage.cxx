@@ -7,11 +7,19 @@
 #include <cstdio>
 #include <iostream>
 #include <memory>
+#include <string>
+#include <utility>
 #include <vector>
 
+#include "fitsio.h"
+
+#include "FitsDecoder.h"
 #include "TestImage.h"
+#include "tip/FileSummary.h"
 #include "tip/IFileSvc.h"
 #include "tip/Image.h"
+#include "tip/ImageCompression.h"
+#include "tip/ImageTileReader.h"
 
 namespace tip {
 
@@ -261,6 +269,282 @@ namespace tip {
       ReportUnexpected("TestImage::test caught exception ", x);
     }
 
+    // Test that every byte-swap kernel this processor supports agrees with a plain byte reversal, for all widths.
+    try {
+      std::vector<unsigned char> big_endian(8 * 67);
+      for (std::size_t ii = 0; ii != big_endian.size(); ++ii) big_endian[ii] = static_cast<unsigned char>(ii * 37 + 11);
+
+      FitsByteSwap::Kernel best_kernel = FitsByteSwap::getBestKernel();
+      FitsByteSwap::Kernel kernel[] = { FitsByteSwap::eScalar, FitsByteSwap::eSse2, FitsByteSwap::eAvx2 };
+      for (std::size_t kk = 0; kk != sizeof(kernel) / sizeof(kernel[0]); ++kk) {
+        if (!FitsByteSwap::isSupported(kernel[kk])) continue;
+        FitsByteSwap::setKernel(kernel[kk]);
+        for (std::size_t value_size = 1; value_size <= 8; value_size *= 2) {
+          // Use an odd number of values so that the kernels' tail handling is exercised too.
+          std::size_t num_values = big_endian.size() / value_size - 1;
+          std::vector<unsigned char> native(num_values * value_size);
+          FitsByteSwap::toNative(&big_endian[0], value_size, num_values, &native[0]);
+          for (std::size_t ii = 0; ii != native.size(); ++ii) {
+            std::size_t value_begin = ii - ii % value_size;
+            if (native[ii] != big_endian[value_begin + value_size - 1 - ii % value_size]) {
+              FitsByteSwap::setKernel(best_kernel);
+              throw TipException(std::string("Byte-swap kernel ") + FitsByteSwap::getKernelName(kernel[kk]) +
+                " did not reverse the bytes of each value");
+            }
+          }
+        }
+      }
+      FitsByteSwap::setKernel(best_kernel);
+
+      // Whole-image reads are decoded by the kernels; compare with pixel-by-pixel reads.
+      std::vector<float> image_vec;
+      m_const_image->get(image_vec);
+      dims = m_const_image->getImageDimensions();
+      if (image_vec.size() != std::size_t(dims[0] * dims[1]))
+        throw TipException("Reading a whole image produced the wrong number of pixels");
+      for (int ii = 0; ii < dims[0]; ++ii) {
+        for (int jj = 0; jj < dims[1]; ++jj) {
+          double pixel = 0.;
+          m_const_image->getPixel(ii, jj, pixel);
+          if (pixel != image_vec[ii + jj * dims[0]])
+            throw TipException("Reading a whole image does not agree with reading it pixel by pixel");
+        }
+      }
+
+      ReportExpected("TestImage::test found that byte-swap kernels and whole-image reads give the expected values");
+    } catch (const TipException & x) {
+      ReportUnexpected("TestImage::test caught exception ", x);
+    }
+
+    // Test that 64-bit integer images are read and written without loss of precision.
+    try {
+      remove("long_long_image.fits");
+
+      // Create a BITPIX = 64 image directly with cfitsio.
+      fitsfile * fp = 0;
+      int status = 0;
+      long naxes[] = { 5, 4 };
+      fits_create_file(&fp, "long_long_image.fits", &status);
+      fits_create_img(fp, LONGLONG_IMG, 2, naxes, &status);
+      fits_close_file(fp, &status);
+      if (0 != status) throw TipException(status, "Could not create 64-bit integer image long_long_image.fits");
+
+      // Use values which a double cannot hold exactly.
+      std::vector<long long> expected(naxes[0] * naxes[1]);
+      for (std::size_t ii = 0; ii != expected.size(); ++ii) expected[ii] = ((1ll << 60) + 1) * (ii % 2 ? -1 : 1) + ii;
+      {
+        std::unique_ptr<TypedImage<long long> > image(IFileSvc::instance().editImageLongLong("long_long_image.fits", ""));
+        image->set(expected);
+      }
+
+      std::unique_ptr<const TypedImage<long long> > image(IFileSvc::instance().readImageLongLong("long_long_image.fits", ""));
+      std::vector<long long> image_vec;
+      image->get(image_vec);
+      if (expected != image_vec)
+        throw TipException("Whole 64-bit integer image did not read back the same as it was written");
+      if (expected[naxes[0] + 1] != image->get(1, 1))
+        throw TipException("64-bit integer pixel did not read back the same as it was written");
+
+      ReportExpected("TestImage::test read and wrote a 64-bit integer image without loss of precision");
+    } catch (const TipException & x) {
+      ReportUnexpected("TestImage::test caught exception ", x);
+    }
+    remove("long_long_image.fits");
+
+    // Test reading a cube one tile at a time, with and without reading ahead.
+    try {
+      remove("tile_image.fits");
+      std::vector<PixOrd_t> dims(3);
+      dims[0] = 13;
+      dims[1] = 7;
+      dims[2] = 5;
+      IFileSvc::instance().appendImage("tile_image.fits", "cube", dims);
+
+      std::vector<float> expected(dims[0] * dims[1] * dims[2]);
+      for (std::size_t ii = 0; ii != expected.size(); ++ii) expected[ii] = ii;
+      {
+        std::unique_ptr<TypedImage<float> > image(IFileSvc::instance().editImageFlt("tile_image.fits", "cube"));
+        image->set(expected);
+      }
+
+      std::unique_ptr<const TypedImage<float> > image(IFileSvc::instance().readImageFlt("tile_image.fits", "cube"));
+      std::vector<float> image_vec;
+      image->get(image_vec);
+      if (expected != image_vec) throw TipException("Whole cube did not read back the same as it was written");
+
+      // Use tiles which do not divide the cube, so that edge tiles are smaller.
+      ImageBase::PixelCoordinate shape(3);
+      shape[0] = 4;
+      shape[1] = 0;
+      shape[2] = 2;
+      for (unsigned int prefetch = 0; prefetch != 3; ++prefetch) {
+        ImageTileReader<float> reader(*image, shape, prefetch);
+        if (4 * 3 != reader.getNumTiles())
+          throw TipException("ImageTileReader::getNumTiles returned " + toString(reader.getNumTiles()) + ", not 12");
+        std::vector<float> assembled(expected.size(), -1.f);
+        std::vector<float> tile;
+        PixOrd_t num_tiles = 0;
+        for (; reader.next(tile); ++num_tiles) {
+          const ImageBase::PixelCoordRange & range(reader.getRange());
+          std::vector<float>::iterator pixel = tile.begin();
+          for (PixOrd_t kk = range[2].first; kk != range[2].second; ++kk)
+            for (PixOrd_t jj = range[1].first; jj != range[1].second; ++jj)
+              for (PixOrd_t ii = range[0].first; ii != range[0].second; ++ii, ++pixel)
+                assembled[ii + dims[0] * (jj + dims[1] * kk)] = *pixel;
+          if (pixel != tile.end()) throw TipException("ImageTileReader returned a tile of the wrong size");
+        }
+        if (num_tiles != reader.getNumTiles() || expected != assembled)
+          throw TipException("ImageTileReader with prefetch " + toString(prefetch) +
+            " did not read each pixel of the cube exactly once");
+      }
+
+      try {
+        ImageTileReader<float> reader(*image, ImageBase::PixelCoordinate(2, 1));
+        ReportUnexpected("TestImage::test created an ImageTileReader with a tile shape of the wrong dimension");
+      } catch (const TipException & x) {
+        ReportExpected("TestImage::test could not create an ImageTileReader with a tile shape of the wrong dimension",
+          x);
+      }
+
+      ReportExpected("TestImage::test read a cube one tile at a time, with and without reading ahead");
+    } catch (const TipException & x) {
+      ReportUnexpected("TestImage::test caught exception ", x);
+    }
+    remove("tile_image.fits");
+
+    // Test writing and reading a tile-compressed cube, large enough to be decompressed in several threads.
+    try {
+      remove("compressed_image.fits");
+      std::vector<PixOrd_t> dims(3);
+      dims[0] = 256;
+      dims[1] = 256;
+      dims[2] = 20;
+      ImageBase::PixelCoordinate tile_shape(dims);
+      tile_shape[2] = 1;
+      IFileSvc::instance().appendImage("compressed_image.fits", "cube", dims,
+        ImageCompression(ImageCompression::eGzip2, tile_shape));
+
+      std::vector<float> expected(dims[0] * dims[1] * dims[2]);
+      for (std::size_t ii = 0; ii != expected.size(); ++ii) expected[ii] = .25f * (ii % 4099);
+      {
+        std::unique_ptr<TypedImage<float> > image(IFileSvc::instance().editImageFlt("compressed_image.fits", "cube"));
+        image->set(expected);
+      }
+
+      // Compressed images are stored in tables, so the file must start with an empty primary array.
+      FileSummary summary;
+      IFileSvc::instance().getFileSummary("compressed_image.fits", summary);
+      if (2 != summary.size() || "cube" != summary[1].getExtId())
+        throw TipException("Compressed image was not written to the first extension after an empty primary array");
+
+      unsigned int image_threads = IFileSvc::getImageThreads();
+      IFileSvc::setImageThreads(4);
+      std::unique_ptr<const TypedImage<float> > image(IFileSvc::instance().readImageFlt("compressed_image.fits", "cube"));
+      std::vector<float> image_vec;
+      image->get(image_vec);
+      Image::PixelCoordRange range(3);
+      range[0] = std::make_pair(PixOrd_t(3), PixOrd_t(250));
+      range[1] = std::make_pair(PixOrd_t(0), dims[1]);
+      range[2] = std::make_pair(PixOrd_t(1), PixOrd_t(19));
+      std::vector<float> slice_vec;
+      image->get(range, slice_vec);
+      IFileSvc::setImageThreads(image_threads);
+
+      if (expected != image_vec) throw TipException("Compressed cube did not read back the same as it was written");
+      std::vector<float>::iterator pixel = slice_vec.begin();
+      for (PixOrd_t kk = range[2].first; kk != range[2].second; ++kk)
+        for (PixOrd_t jj = range[1].first; jj != range[1].second; ++jj)
+          for (PixOrd_t ii = range[0].first; ii != range[0].second; ++ii, ++pixel)
+            if (*pixel != expected[ii + dims[0] * (jj + dims[1] * kk)])
+              throw TipException("Slice of compressed cube did not read back the same as it was written");
+
+      ReportExpected("TestImage::test wrote and read back a compressed cube without loss");
+    } catch (const TipException & x) {
+      ReportUnexpected("TestImage::test caught exception ", x);
+    }
+    remove("compressed_image.fits");
+
+    // Test creating images with other pixel types and scaling, and reading them through the typed templates.
+    try {
+      remove("typed_image.fits");
+      std::vector<PixOrd_t> dims(2);
+      dims[0] = 6;
+      dims[1] = 5;
+      IFileSvc::instance().createFile("typed_image.fits", ImageBase::eDouble, dims);
+      IFileSvc::instance().appendImage("typed_image.fits", "counts", dims, ImageBase::eShort);
+      IFileSvc::instance().appendImage("typed_image.fits", "unsigned", dims, ImageBase::eShort, 1., 32768.);
+      IFileSvc::instance().appendImage("typed_image.fits", "scaled", dims, ImageBase::eShort, .5, 100.);
+
+      const char * ext_name[] = { "", "counts", "unsigned", "scaled" };
+      const int expected_bitpix[] = { -64, 16, 16, 16 };
+      for (int ii = 0; ii != 4; ++ii) {
+        std::unique_ptr<const TypedImage<double> > image(IFileSvc::instance().readImage<double>("typed_image.fits",
+          ext_name[ii]));
+        int bitpix = 0;
+        image->getHeader()["BITPIX"].get(bitpix);
+        if (expected_bitpix[ii] != bitpix || dims != image->getImageDimensions())
+          throw TipException(std::string("Image \"") + ext_name[ii] + "\" was created with BITPIX = " + toString(bitpix) +
+            ", not " + toString(expected_bitpix[ii]) + ", or with the wrong dimensions");
+      }
+
+      std::vector<short> counts(dims[0] * dims[1]);
+      std::vector<unsigned short> unsigned_counts(counts.size());
+      std::vector<double> scaled(counts.size());
+      for (std::size_t ii = 0; ii != counts.size(); ++ii) {
+        counts[ii] = short(ii * 1000 - 15000);
+        unsigned_counts[ii] = static_cast<unsigned short>(ii * 2000 + 5000);
+        scaled[ii] = 100. + .5 * ii - 7.;
+      }
+      {
+        std::unique_ptr<TypedImage<short> > image(IFileSvc::instance().editImage<short>("typed_image.fits", "counts"));
+        image->set(counts);
+        std::unique_ptr<TypedImage<unsigned short> > unsigned_image(
+          IFileSvc::instance().editImage<unsigned short>("typed_image.fits", "unsigned"));
+        unsigned_image->set(unsigned_counts);
+        std::unique_ptr<TypedImage<double> > scaled_image(
+          IFileSvc::instance().editImage<double>("typed_image.fits", "scaled"));
+        scaled_image->set(scaled);
+      }
+
+      std::unique_ptr<const TypedImage<short> > image(IFileSvc::instance().readImage<short>("typed_image.fits",
+        "counts"));
+      std::vector<short> counts_read;
+      image->get(counts_read);
+      if (counts != counts_read) throw TipException("16-bit integer image did not read back the same as it was written");
+
+      std::unique_ptr<const TypedImage<unsigned short> > unsigned_image(
+        IFileSvc::instance().readImage<unsigned short>("typed_image.fits", "unsigned"));
+      std::vector<unsigned short> unsigned_counts_read;
+      unsigned_image->get(unsigned_counts_read);
+      if (unsigned_counts != unsigned_counts_read)
+        throw TipException("Unsigned 16-bit integer image did not read back the same as it was written");
+
+      std::unique_ptr<const TypedImage<double> > scaled_image(
+        IFileSvc::instance().readImage<double>("typed_image.fits", "scaled"));
+      std::vector<double> scaled_read;
+      scaled_image->get(scaled_read);
+      if (scaled != scaled_read) throw TipException("Scaled image did not read back the same as it was written");
+      double zero = 0.;
+      scaled_image->getHeader()["BZERO"].get(zero);
+      if (100. != zero) throw TipException("Scaled image has BZERO = " + toString(zero) + ", not 100");
+
+      ReportExpected("TestImage::test created images of several pixel types and read them back with the typed "
+        "templates");
+    } catch (const TipException & x) {
+      ReportUnexpected("TestImage::test caught exception ", x);
+    }
+    remove("typed_image.fits");
+
+    // Floating point pixels cannot be compressed losslessly with Rice.
+    try {
+      std::vector<PixOrd_t> dims(2, 16);
+      IFileSvc::instance().appendImage("compressed_image.fits", "rice", dims, ImageCompression(ImageCompression::eRice));
+      ReportUnexpected("TestImage::test compressed a floating point image with Rice without quantizing it");
+    } catch (const TipException & x) {
+      ReportExpected("TestImage::test could not compress a floating point image with Rice without quantizing it", x);
+    }
+    remove("compressed_image.fits");
+
     // Test creating an image/file without a template.
     try {
       std::vector<PixOrd_t> dims(2);
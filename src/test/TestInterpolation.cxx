@@ -2,12 +2,18 @@
     \brief Implementation of class to perform detailed testing of Interpolation abstractions.
     \author James Peachey, HEASARC
 */
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
 #include <exception>
 #include <memory>
 #include <vector>
 
 #include "TestInterpolation.h"
+#include "tip/AngularInterp.h"
+#include "tip/HermiteInterp.h"
 #include "tip/IFileSvc.h"
+#include "tip/IndexedLinearInterp.h"
 #include "tip/LinearInterp.h"
 #include "tip/Table.h"
 
@@ -88,6 +94,263 @@ namespace tip {
       ReportUnexpected("interpolating channel field with value == first value succeeded", x);
     }
 
+    // The indexed interpolator must report the same errors.
+    IndexedLinearInterp indexed_interp(table->begin(), table->end());
+    try {
+      indexed_interp.interpolate("TIME", -1.);
+      ReportUnexpected("IndexedLinearInterp: interpolating non-existent field succeeded");
+    } catch (const std::exception & x) {
+      ReportExpected("IndexedLinearInterp: interpolating non-existent field failed", x);
+    }
+
+    try {
+      indexed_interp.get("CHANNEL");
+      ReportUnexpected("IndexedLinearInterp: get before interpolate succeeded");
+    } catch (const std::exception & x) {
+      ReportExpected("IndexedLinearInterp: get before interpolate failed", x);
+    }
+
+    try {
+      indexed_interp.interpolate("CHANNEL", -1.);
+      ReportUnexpected("IndexedLinearInterp: interpolating channel field before first value succeeded");
+    } catch (const std::exception & x) {
+      ReportExpected("IndexedLinearInterp: interpolating channel field before first value failed", x);
+    }
+
+    try {
+      indexed_interp.interpolate("CHANNEL", 4098.);
+      ReportUnexpected("IndexedLinearInterp: interpolating channel field after last value succeeded");
+    } catch (const std::exception & x) {
+      ReportExpected("IndexedLinearInterp: interpolating channel field after last value failed", x);
+    }
+
+    // Results must match LinearInterp exactly, whether values arrive in increasing order, which uses the cursor,
+    // or in decreasing order, which uses the binary search.
+    try {
+      std::vector<double> values;
+      for (double value = 0.; value < 4095.; value += 13.37) values.push_back(value);
+      values.push_back(4094.999);
+      for (double value = 4094.5; value >= 0.; value -= 211.1) values.push_back(value);
+
+      int num_mismatch = 0;
+      std::vector<double> counts_vec;
+      std::vector<double> indexed_counts_vec;
+      for (std::vector<double>::iterator itor = values.begin(); itor != values.end(); ++itor) {
+        interp.interpolate("CHANNEL", *itor);
+        indexed_interp.interpolate("CHANNEL", *itor);
+        interp.get("COUNTS", counts_vec);
+        indexed_interp.get("COUNTS", indexed_counts_vec);
+        if (interp.get("CHANNEL") != indexed_interp.get("CHANNEL") || counts_vec != indexed_counts_vec) ++num_mismatch;
+      }
+      if (0 != num_mismatch)
+        ReportUnexpected("IndexedLinearInterp did not return the same values as LinearInterp");
+      else
+        ReportExpected("IndexedLinearInterp returned the same values as LinearInterp");
+    } catch (const std::exception & x) {
+      ReportUnexpected("IndexedLinearInterp comparison with LinearInterp failed", x);
+    }
+
+    // Interpolating many values at once must give the same results as interpolating them one at a time.
+    std::vector<double> values;
+    for (double value = 4094.5; value >= 0.; value -= 97.3) values.push_back(value);
+    values.push_back(0.);
+    values.push_back(2000.25);
+    Table::FieldCont fields;
+    fields.push_back("CHANNEL");
+    fields.push_back("COUNTS");
+    std::vector<std::vector<double> > results;
+    try {
+      indexed_interp.interpolate("CHANNEL", values, fields, results);
+
+      int num_mismatch = 0;
+      std::vector<double> counts_vec;
+      std::size_t num_elements = results.size() == 2 ? results[1].size() / values.size() : 0;
+      for (std::size_t ii = 0; ii != values.size() && 2 == results.size(); ++ii) {
+        interp.interpolate("CHANNEL", values[ii]);
+        interp.get("COUNTS", counts_vec);
+        std::vector<double>::const_iterator batch_begin = results[1].begin() + ii * num_elements;
+        std::vector<double> batch_counts(batch_begin, batch_begin + num_elements);
+        if (interp.get("CHANNEL") != results[0][ii] || counts_vec != batch_counts) ++num_mismatch;
+      }
+      if (2 != results.size() || values.size() != results[0].size() || 0 != num_mismatch)
+        ReportUnexpected("IndexedLinearInterp batch interpolation did not return the same values as LinearInterp");
+      else
+        ReportExpected("IndexedLinearInterp batch interpolation returned the same values as LinearInterp");
+    } catch (const std::exception & x) {
+      ReportUnexpected("IndexedLinearInterp batch interpolation failed", x);
+    }
+
+    try {
+      values.push_back(4098.);
+      indexed_interp.interpolate("CHANNEL", values, fields, results);
+      ReportUnexpected("IndexedLinearInterp batch interpolation with a value after the last value succeeded");
+    } catch (const std::exception & x) {
+      ReportExpected("IndexedLinearInterp batch interpolation with a value after the last value failed", x);
+    }
+
+    try {
+      indexed_interp.interpolate("CHANNEL", 77.333);
+      indexed_interp.get("COUNTS");
+      ReportUnexpected("IndexedLinearInterp: getting vector field as a scalar succeeded");
+    } catch (const std::exception & x) {
+      ReportExpected("IndexedLinearInterp: getting vector field as a scalar failed", x);
+    }
+
+    // Create a small spacecraft table for the higher-order and angular interpolators: a smooth scalar, a position
+    // which changes linearly, a rotation about z as a vector field and as 4 scalar fields (one record stored with
+    // the opposite sign), and a direction moving along the equator through RA 0.
+    const double deg_per_rad = 180. / std::acos(-1.);
+    std::string file_name = "interp_table.fits";
+    std::unique_ptr<const Table> sc_table;
+    try {
+      remove(file_name.c_str());
+      IFileSvc::instance().appendTable(file_name, "SC_DATA");
+      std::unique_ptr<Table> out_table(IFileSvc::instance().editTable(file_name, "SC_DATA"));
+      out_table->appendField("START", "1D");
+      out_table->appendField("X", "1D");
+      out_table->appendField("POS", "3D");
+      out_table->appendField("QUAT", "4D");
+      out_table->appendField("QSJ_1", "1D");
+      out_table->appendField("QSJ_2", "1D");
+      out_table->appendField("QSJ_3", "1D");
+      out_table->appendField("QSJ_4", "1D");
+      out_table->appendField("RA", "1D");
+      out_table->appendField("DEC", "1D");
+      out_table->setNumRecords(11);
+      Table::Iterator itor = out_table->begin();
+      for (int index = 0; index != 11; ++index, ++itor) {
+        double t = 10. * index;
+        double half_angle = t / deg_per_rad;
+        double sign = 5 == index ? -1. : 1.;
+        std::vector<double> pos(3);
+        pos[0] = 2. * t + 1.;
+        pos[1] = -t;
+        pos[2] = 3.;
+        std::vector<double> quat(4, 0.);
+        quat[2] = sign * std::sin(half_angle);
+        quat[3] = sign * std::cos(half_angle);
+        (*itor)["START"].set(t);
+        (*itor)["X"].set(std::sin(t / 20.));
+        (*itor)["POS"].set(pos);
+        (*itor)["QUAT"].set(quat);
+        (*itor)["QSJ_1"].set(quat[0]);
+        (*itor)["QSJ_2"].set(quat[1]);
+        (*itor)["QSJ_3"].set(quat[2]);
+        (*itor)["QSJ_4"].set(quat[3]);
+        (*itor)["RA"].set(std::fmod(355. + t, 360.));
+        (*itor)["DEC"].set(0.);
+      }
+      out_table.reset();
+      sc_table.reset(IFileSvc::instance().readTable(file_name, "SC_DATA"));
+    } catch (const std::exception & x) {
+      ReportUnexpected("creating " + file_name + " failed", x);
+    }
+
+    if (0 != sc_table.get()) {
+      // Splines reproduce positions which change linearly, pass through the records, and follow smooth curves
+      // more closely than straight lines.
+      try {
+        HermiteInterp akima(sc_table->begin(), sc_table->end());
+        HermiteInterp finite_diff(sc_table->begin(), sc_table->end(), HermiteInterp::eFiniteDifference);
+        IndexedLinearInterp linear(sc_table->begin(), sc_table->end());
+        std::vector<double> pos;
+        akima.interpolate("START", 33.3);
+        akima.get("POS", pos);
+        if (3 != pos.size() || 1.e-9 < std::fabs(pos[0] - 67.6) || 1.e-9 < std::fabs(pos[1] + 33.3) ||
+          1.e-9 < std::fabs(pos[2] - 3.))
+          ReportUnexpected("HermiteInterp did not reproduce a position which changes linearly");
+        else
+          ReportExpected("HermiteInterp reproduced a position which changes linearly");
+
+        akima.interpolate("START", 40.);
+        if (std::sin(2.) != akima.get("X"))
+          ReportUnexpected("HermiteInterp did not return the value of the record at its abscissa");
+        else
+          ReportExpected("HermiteInterp returned the value of the record at its abscissa");
+
+        double max_linear_error = 0.;
+        double max_akima_error = 0.;
+        double max_finite_diff_error = 0.;
+        for (double t = 12.5; t < 90.; t += 5.) {
+          double expected = std::sin(t / 20.);
+          linear.interpolate("START", t);
+          akima.interpolate("START", t);
+          finite_diff.interpolate("START", t);
+          max_linear_error = std::max(max_linear_error, std::fabs(linear.get("X") - expected));
+          max_akima_error = std::max(max_akima_error, std::fabs(akima.get("X") - expected));
+          max_finite_diff_error = std::max(max_finite_diff_error, std::fabs(finite_diff.get("X") - expected));
+        }
+        if (max_akima_error >= max_linear_error || max_finite_diff_error >= max_linear_error)
+          ReportUnexpected("HermiteInterp was not more accurate than linear interpolation for a smooth field");
+        else
+          ReportExpected("HermiteInterp was more accurate than linear interpolation for a smooth field");
+
+        // Used through a reference to its base class, the spline still interpolates, and refuses batches, which
+        // would only be linear.
+        IndexedLinearInterp & base(akima);
+        base.interpolate("START", 33.3);
+        linear.interpolate("START", 33.3);
+        if (linear.get("X") == base.get("X"))
+          ReportUnexpected("HermiteInterp interpolated linearly when used as an IndexedLinearInterp");
+        else
+          ReportExpected("HermiteInterp interpolated with splines when used as an IndexedLinearInterp");
+        try {
+          std::vector<std::vector<double> > results;
+          base.interpolate("START", std::vector<double>(1, 33.3), Table::FieldCont(1, "X"), results);
+          ReportUnexpected("HermiteInterp interpolated a batch of values linearly");
+        } catch (const TipException & x) {
+          ReportExpected("HermiteInterp refused to interpolate a batch of values", x);
+        }
+      } catch (const std::exception & x) {
+        ReportUnexpected("HermiteInterp test failed", x);
+      }
+
+      // Quaternions follow the rotation, even across the record stored with the opposite sign.
+      try {
+        AngularInterp angular(sc_table->begin(), sc_table->end());
+        angular.interpolate("START", 45.);
+        std::vector<double> quat;
+        angular.getQuaternion("QUAT", quat);
+        Table::FieldCont qsj_fields;
+        qsj_fields.push_back("QSJ_1");
+        qsj_fields.push_back("QSJ_2");
+        qsj_fields.push_back("QSJ_3");
+        qsj_fields.push_back("QSJ_4");
+        std::vector<double> qsj;
+        angular.getQuaternion(qsj_fields, qsj);
+        double half_angle = 45. / deg_per_rad;
+        if (4 != quat.size() || 1.e-12 < std::fabs(std::fabs(quat[2] * std::sin(half_angle) +
+          quat[3] * std::cos(half_angle)) - 1.) || quat != qsj)
+          ReportUnexpected("AngularInterp::getQuaternion did not follow the rotation");
+        else
+          ReportExpected("AngularInterp::getQuaternion followed the rotation");
+
+        // Between RA 355 and 5 the direction passes through RA 0, not RA 180.
+        angular.interpolate("START", 3.);
+        double ra = 0.;
+        double dec = 0.;
+        angular.getDirection("RA", "DEC", ra, dec);
+        if (1.e-9 < std::fabs(ra - 358.) || 1.e-9 < std::fabs(dec))
+          ReportUnexpected("AngularInterp::getDirection did not follow the great circle through RA 0");
+        else
+          ReportExpected("AngularInterp::getDirection followed the great circle through RA 0");
+      } catch (const std::exception & x) {
+        ReportUnexpected("AngularInterp test failed", x);
+      }
+
+      try {
+        AngularInterp angular(sc_table->begin(), sc_table->end());
+        angular.interpolate("START", 45.);
+        std::vector<double> quat;
+        angular.getQuaternion("POS", quat);
+        ReportUnexpected("AngularInterp::getQuaternion succeeded for a field with 3 elements");
+      } catch (const std::exception & x) {
+        ReportExpected("AngularInterp::getQuaternion failed for a field with 3 elements", x);
+      }
+    }
+    sc_table.reset();
+    remove(file_name.c_str());
+
     return getStatus();
   }
 
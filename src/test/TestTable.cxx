@@ -3,6 +3,7 @@
     \author James Peachey, HEASARC
 */
 
+#include <algorithm>
 #include <cmath>
 #include <cstdlib>
 #include <limits>
@@ -11,11 +12,15 @@
 #include <string>
 #include <vector>
 
+#include "FitsFilteredTable.h"
+#include "FitsMappedTable.h"
 #include "FitsPrimProps.h"
 #include "FitsTable.h"
 #include "TestTable.h"
+#include "tip/ColumnIndex.h"
 #include "tip/IFileSvc.h"
 #include "tip/Table.h"
+#include "tip/TableScan.h"
 #include "tip/tip_types.h"
 
 #ifndef BUILD_WITHOUT_ROOT
@@ -58,18 +63,50 @@ namespace tip {
     // Test iterator access to vector columns:
     readWriteVectorFieldTest();
 
+    // Test reading ranges of records in one operation:
+    bulkReadTest();
+
+    // Test writing ranges of records in one operation:
+    bulkWriteTest();
+
+    // Test read-ahead buffering of iterator access:
+    readAheadTest();
+
+    // Test access to cells through field handles:
+    fieldHandleTest();
+
+    // Test reading whole columns:
+    columnDataTest();
+
+    // Test reading tables through a memory mapping.
+    mappedTableTest();
+
+    // Test scanning tables in parallel.
+    tableScanTest();
+
+    filterViewTest();
+
+    // Test finding records by the values of sorted fields.
+    columnIndexTest();
+
     // Test appending a field to an existing table.
     appendFieldTest();
 
     // Test copying records from one table to another.
     copyFieldTest();
 
+    // Test copying many records at once.
+    copyRowsTest();
+
     // Test that bug when only one column is present was corrected.
     singleFieldBugTest();
 
     // Test that unsigned integers are handled correctly.
     unsignedIntTest();
 
+    // Test that 64-bit integers are handled correctly.
+    longLongTest();
+
     // Test that Root version of FT2 file is read correctly.
     rootFt2Test();
 
@@ -499,6 +536,509 @@ namespace tip {
     }
   }
 
+  void TestTable::bulkReadTest() {
+    bulkReadTest(m_fits_table, "channel");
+
+    if (0 != m_fits_table) {
+      std::string msg;
+      std::vector<double> values(m_fits_table->getNumRecords() + 1);
+
+      // Error cases: vector field, inverted range, range extending past the end of the table.
+      msg = "reading a range of records from vector-valued field \"counts\"";
+      try {
+        m_fits_table->get("counts", 0, 2, &values[0]);
+        ReportUnexpected(msg + " succeeded");
+      } catch (const TipException & x) {
+        ReportExpected(msg + " failed", x);
+      }
+
+      msg = "reading a range of records whose end precedes its beginning";
+      try {
+        m_fits_table->get("channel", 2, 1, &values[0]);
+        ReportUnexpected(msg + " succeeded");
+      } catch (const TipException & x) {
+        ReportExpected(msg + " failed", x);
+      }
+
+      msg = "reading a range of records extending past the end of the table";
+      try {
+        m_fits_table->get("channel", 0, m_fits_table->getNumRecords() + 1, &values[0]);
+        ReportUnexpected(msg + " succeeded");
+      } catch (const TipException & x) {
+        ReportExpected(msg + " failed", x);
+      }
+    }
+
+#ifndef BUILD_WITHOUT_ROOT
+    bulkReadTest(m_root_table, "McEnergy");
+#endif
+  }
+
+  void TestTable::bulkReadTest(const Table * table, const std::string & field_name) {
+    if (0 == table) return;
+    std::string msg = "reading all records of field \"" + field_name + "\" in one operation";
+    try {
+      // Read field one record at a time for comparison.
+      std::vector<double> expected;
+      readFieldTest(table, field_name, expected);
+
+      Index_t num_records = table->getNumRecords();
+      std::vector<double> values(num_records);
+      table->get(field_name, 0, num_records, &values[0]);
+      if (expected == values)
+        ReportExpected(msg + " gave the same values as iterator access");
+      else
+        ReportUnexpected(msg + " did not give the same values as iterator access");
+
+      // Read the second half of the table through a cell, starting at the current iterator position.
+      Index_t half = num_records / 2;
+      Table::ConstIterator itor = table->begin();
+      for (Index_t ii = 0; ii != half; ++ii) ++itor;
+      std::vector<long> lvalues(num_records - half);
+      (*itor)[field_name].get(num_records - half, &lvalues[0]);
+      bool mismatch = false;
+      for (Index_t ii = half; ii != num_records; ++ii) {
+        if (long(expected[ii]) != lvalues[ii - half]) {
+          std::ostringstream os;
+          os << "reading field \"" << field_name << "\" through a cell starting in record " << half << " gave " <<
+            lvalues[ii - half] << " in record " << ii << ", not " << long(expected[ii]);
+          ReportUnexpected(os.str());
+          mismatch = true;
+          break;
+        }
+      }
+      if (!mismatch) ReportExpected("reading field \"" + field_name + "\" through a cell gave the same values as iterator access");
+    } catch (const TipException & x) {
+      ReportUnexpected(msg + " failed", x);
+    }
+  }
+
+  void TestTable::bulkWriteTest() {
+    std::string msg;
+    try {
+      remove("bulk_write.fits");
+
+      // Create a table with one floating point and one integer column.
+      IFileSvc::instance().appendTable("bulk_write.fits", "DUMMY");
+      std::unique_ptr<Table> table(IFileSvc::instance().editTable("bulk_write.fits", "DUMMY"));
+      table->appendField("DVALUE", "1D");
+      table->appendField("JVALUE", "1J");
+      table->appendField("VECTOR", "2D");
+
+      const Index_t num_records = 10;
+      table->setNumRecords(num_records);
+
+      std::vector<double> dvalues(num_records);
+      std::vector<long> jvalues(num_records);
+      std::vector<char> null_mask(num_records, 0);
+      for (Index_t ii = 0; ii != num_records; ++ii) {
+        dvalues[ii] = 1.5 * ii;
+        jvalues[ii] = 100 + ii;
+      }
+      null_mask[3] = 1;
+      null_mask[7] = 1;
+
+      // Write the first column through the table, the second through a cell starting in the second record.
+      table->set("dvalue", 0, &dvalues[0], &dvalues[0] + num_records, &null_mask[0]);
+      Table::Iterator itor = table->begin();
+      ++itor;
+      (*itor)["jvalue"].set(num_records - 1, &jvalues[1], &null_mask[1]);
+
+      // Error cases: vector field, range extending past the end of the table.
+      msg = "writing a range of records to vector-valued field \"vector\"";
+      try {
+        table->set("vector", 0, &dvalues[0], &dvalues[0] + 2);
+        ReportUnexpected(msg + " succeeded");
+      } catch (const TipException & x) {
+        ReportExpected(msg + " failed", x);
+      }
+
+      msg = "writing a range of records extending past the end of the table";
+      try {
+        table->set("dvalue", 1, &dvalues[0], &dvalues[0] + num_records);
+        ReportUnexpected(msg + " succeeded");
+      } catch (const TipException & x) {
+        ReportExpected(msg + " failed", x);
+      }
+
+      // Close and re-open the table, then compare record by record.
+      delete table.release();
+      table.reset(IFileSvc::instance().editTable("bulk_write.fits", "DUMMY"));
+
+      msg = "TestTable::bulkWriteTest: reading back values written in one operation";
+      bool mismatch = false;
+      Index_t record_index = 0;
+      for (itor = table->begin(); itor != table->end() && !mismatch; ++itor, ++record_index) {
+        // The integer column was not written in the first record.
+        if (0 == record_index) continue;
+        bool expect_null = 0 != null_mask[record_index];
+        if (expect_null != (*itor)["dvalue"].isNull() || expect_null != (*itor)["jvalue"].isNull()) {
+          std::ostringstream os;
+          os << msg << ": null status of record " << record_index << " is not " << expect_null;
+          ReportUnexpected(os.str());
+          mismatch = true;
+        } else if (!expect_null) {
+          double dvalue = 0.;
+          long jvalue = 0;
+          (*itor)["dvalue"].get(dvalue);
+          (*itor)["jvalue"].get(jvalue);
+          if (dvalues[record_index] != dvalue || jvalues[record_index] != jvalue) {
+            std::ostringstream os;
+            os << msg << ": record " << record_index << " contains " << dvalue << " and " << jvalue << ", not " <<
+              dvalues[record_index] << " and " << jvalues[record_index];
+            ReportUnexpected(os.str());
+            mismatch = true;
+          }
+        }
+      }
+      if (!mismatch) ReportExpected(msg + " gave the expected values and nulls");
+    } catch (const TipException & x) {
+      ReportUnexpected("TestTable::bulkWriteTest had a problem", x);
+    }
+    remove("bulk_write.fits");
+  }
+
+  void TestTable::readAheadTest() {
+    if (0 == m_fits_table) return;
+    std::string msg = "reading field \"channel\" with read-ahead enabled";
+    try {
+      std::vector<double> expected;
+      readFieldTest(m_fits_table, "channel", expected);
+
+      // Use a small block size so that the buffer is refilled many times.
+      const Index_t block_size = 7;
+      m_fits_table->setReadAhead(block_size);
+      std::vector<double> values;
+      readFieldTest(m_fits_table, "channel", values);
+      if (expected == values)
+        ReportExpected(msg + " gave the same values as unbuffered reads");
+      else
+        ReportUnexpected(msg + " did not give the same values as unbuffered reads");
+
+      unsigned long num_hits = 0;
+      unsigned long num_misses = 0;
+      m_fits_table->getReadAheadStats(num_hits, num_misses);
+      unsigned long expected_misses = (m_fits_table->getNumRecords() + block_size - 1) / block_size;
+      if (expected_misses == num_misses && 0 != num_hits) {
+        ReportExpected(msg + " refilled the buffer once per block of records");
+      } else {
+        std::ostringstream os;
+        os << msg << " had " << num_hits << " hits and " << num_misses << " misses, not " << expected_misses << " misses";
+        ReportUnexpected(os.str());
+      }
+
+      // Writing a cell must not leave a stale value in the buffer.
+      Table::Iterator itor = m_fits_table->begin();
+      ++itor;
+      long original = 0;
+      (*itor)["channel"].get(original);
+      (*itor)["channel"].set(original + 1);
+      long modified = 0;
+      (*itor)["channel"].get(modified);
+      (*itor)["channel"].set(original);
+      if (original + 1 == modified) {
+        ReportExpected(msg + " gave the new value after a cell was modified");
+      } else {
+        std::ostringstream os;
+        os << msg << " gave " << modified << " after a cell was modified, not " << original + 1;
+        ReportUnexpected(os.str());
+      }
+    } catch (const TipException & x) {
+      ReportUnexpected(msg + " failed", x);
+    }
+    m_fits_table->setReadAhead(0);
+  }
+
+  void TestTable::fieldHandleTest() {
+    if (0 == m_fits_table) return;
+    const Table * table = m_fits_table;
+    std::string msg = "reading field \"channel\" through a field handle";
+    try {
+      std::vector<double> expected;
+      readFieldTest(table, "channel", expected);
+
+      // Look up the field once, with a name which differs in case from the field name.
+      Table::FieldHandle channel = table->getFieldHandle("ChAnNeL");
+      std::vector<double> values;
+      for (Table::ConstIterator itor = table->begin(); itor != table->end(); ++itor) values.push_back((*itor)[channel].get());
+      if (expected == values)
+        ReportExpected(msg + " gave the same values as access by name");
+      else
+        ReportUnexpected(msg + " did not give the same values as access by name");
+
+      // Access by handle and by name must refer to the same cell.
+      Table::ConstIterator itor = table->begin();
+      if (&(*itor)[channel] == &(*itor)["ChAnNeL"])
+        ReportExpected(msg + " used the same cell as access by name");
+      else
+        ReportUnexpected(msg + " did not use the same cell as access by name");
+    } catch (const TipException & x) {
+      ReportUnexpected(msg + " failed", x);
+    }
+
+    msg = "getting a handle for a field which does not exist";
+    try {
+      table->getFieldHandle("no_such_field");
+      ReportUnexpected(msg + " succeeded");
+    } catch (const TipException & x) {
+      ReportExpected(msg + " failed", x);
+    }
+
+    msg = "using a field handle with a record of a different table";
+    try {
+      std::unique_ptr<const Table> other(IFileSvc::instance().readTable(getDataDir() + "a1.pha", "SPECTRUM"));
+      Table::FieldHandle channel = other->getFieldHandle("channel");
+      (*table->begin())[channel].get();
+      ReportUnexpected(msg + " succeeded");
+    } catch (const TipException & x) {
+      ReportExpected(msg + " failed", x);
+    }
+  }
+
+  namespace {
+    /// \brief Function object which copies blocks of values it is given into a vector.
+    class BlockCollector {
+      public:
+        BlockCollector(): m_values(), m_next_record(0), m_in_order(true) {}
+
+        void operator ()(Index_t record_begin, Index_t record_end, const double * buffer) {
+          if (record_begin != m_next_record) m_in_order = false;
+          m_values.insert(m_values.end(), buffer, buffer + (record_end - record_begin));
+          m_next_record = record_end;
+        }
+
+        std::vector<double> m_values;
+        Index_t m_next_record;
+        bool m_in_order;
+    };
+  }
+
+  void TestTable::columnDataTest() {
+    std::string msg;
+    if (0 != m_fits_table) {
+      msg = "getting field \"channel\" with getColumnData";
+      try {
+        std::vector<double> expected;
+        readFieldTest(m_fits_table, "channel", expected);
+        std::vector<double> values;
+        m_fits_table->getColumnData("channel", values);
+        if (expected == values)
+          ReportExpected(msg + " gave the same values as iterator access");
+        else
+          ReportUnexpected(msg + " did not give the same values as iterator access");
+
+        // Read the same field in small blocks.
+        double buffer[10];
+        BlockCollector collector;
+        m_fits_table->getColumnData("channel", buffer, 10, collector);
+        if (expected == collector.m_values && collector.m_in_order)
+          ReportExpected(msg + " in blocks of 10 records gave the same values as iterator access");
+        else
+          ReportUnexpected(msg + " in blocks of 10 records did not give the same values as iterator access");
+
+        // A lambda may be passed directly.
+        std::vector<double> lambda_values;
+        m_fits_table->getColumnData("channel", buffer, 7,
+          [&lambda_values](Index_t record_begin, Index_t record_end, const double * block) {
+            lambda_values.insert(lambda_values.end(), block, block + (record_end - record_begin));
+          });
+        if (expected == lambda_values)
+          ReportExpected(msg + " in blocks passed to a lambda gave the same values as iterator access");
+        else
+          ReportUnexpected(msg + " in blocks passed to a lambda did not give the same values as iterator access");
+      } catch (const TipException & x) {
+        ReportUnexpected(msg + " failed", x);
+      }
+
+      msg = "getting vector-valued field \"counts\" with getColumnData";
+      try {
+        std::vector<double> values;
+        m_fits_table->getColumnData("counts", values);
+        ReportUnexpected(msg + " succeeded");
+      } catch (const TipException & x) {
+        ReportExpected(msg + " failed", x);
+      }
+    }
+
+    msg = "TestTable::columnDataTest: getting fields with null values";
+    try {
+      remove("column_data.fits");
+
+      // Create a table with integer, logical and string columns, and write some nulls.
+      IFileSvc::instance().appendTable("column_data.fits", "DUMMY");
+      std::unique_ptr<Table> table(IFileSvc::instance().editTable("column_data.fits", "DUMMY"));
+      table->appendField("JVALUE", "1J");
+      table->appendField("LVALUE", "1L");
+      table->appendField("SVALUE", "8A");
+
+      const Index_t num_records = 5;
+      table->setNumRecords(num_records);
+      long jvalues[num_records] = { 1, 2, 3, 4, 5 };
+      char null_mask[num_records] = { 0, 1, 0, 0, 1 };
+      table->set("jvalue", 0, jvalues, jvalues + num_records, null_mask);
+      const char * svalues[num_records] = { "a", "bb", "ccc", "dddd", "eeeee" };
+      Index_t record_index = 0;
+      for (Table::Iterator itor = table->begin(); itor != table->end(); ++itor, ++record_index) {
+        (*itor)["lvalue"].set(0 == record_index % 2);
+        (*itor)["svalue"].set(std::string(svalues[record_index]));
+      }
+
+      std::vector<long> with_sentinel;
+      table->getColumnData("jvalue", with_sentinel, -999l);
+      std::vector<long> without_nulls;
+      std::vector<bool> null_flags;
+      table->getColumnData("jvalue", without_nulls, null_flags);
+      std::vector<bool> lvalues;
+      table->getColumnData("lvalue", lvalues);
+      std::vector<std::string> strings;
+      table->getColumnData("svalue", strings);
+
+      bool mismatch = num_records != Index_t(with_sentinel.size()) || num_records != Index_t(null_flags.size()) ||
+        num_records != Index_t(lvalues.size()) || num_records != Index_t(strings.size());
+      for (Index_t ii = 0; !mismatch && ii != num_records; ++ii) {
+        bool is_null = 0 != null_mask[ii];
+        mismatch = (is_null ? -999l : jvalues[ii]) != with_sentinel[ii] || is_null != null_flags[ii] ||
+          (!is_null && jvalues[ii] != without_nulls[ii]) || (0 == ii % 2) != lvalues[ii] || svalues[ii] != strings[ii];
+        if (mismatch) {
+          std::ostringstream os;
+          os << msg << ": record " << ii << " did not contain the expected values";
+          ReportUnexpected(os.str());
+        }
+      }
+      if (!mismatch) ReportExpected(msg + " gave the expected values and nulls");
+    } catch (const TipException & x) {
+      ReportUnexpected(msg + " failed", x);
+    }
+    remove("column_data.fits");
+  }
+
+  void TestTable::mappedTableTest() {
+    std::string msg = "TestTable::mappedTableTest: creating mapped_table.fits";
+    const Index_t num_records = 2000;
+    try {
+      remove("mapped_table.fits");
+
+      // Create a table with all the mapped formats, scaled (1U) unsigned values and a string field which is not mapped.
+      IFileSvc::instance().appendTable("mapped_table.fits", "DUMMY");
+      std::unique_ptr<Table> table(IFileSvc::instance().editTable("mapped_table.fits", "DUMMY"));
+      table->appendField("DVALUE", "1D");
+      table->appendField("SVALUE", "8A");
+      table->appendField("EVALUE", "3E");
+      table->appendField("UVALUE", "1U");
+      table->appendField("JVALUE", "1J");
+      table->appendField("BVALUE", "1B");
+      table->appendField("KVALUE", "1K");
+      table->setNumRecords(num_records);
+
+      std::vector<double> dvalues(num_records);
+      std::vector<long> jvalues(num_records);
+      std::vector<long long> kvalues(num_records);
+      std::vector<char> null_mask(num_records);
+      Index_t record_index = 0;
+      for (Table::Iterator itor = table->begin(); itor != table->end(); ++itor, ++record_index) {
+        dvalues[record_index] = record_index * .5 - 100.;
+        jvalues[record_index] = record_index * 1000 - 1000000;
+        kvalues[record_index] = (record_index - 1000) * 1000000000000ll;
+        null_mask[record_index] = 0 == record_index % 7;
+        std::ostringstream os;
+        os << "s" << record_index;
+        (*itor)["svalue"].set(os.str());
+        std::vector<float> evalue(3);
+        evalue[0] = record_index; evalue[1] = -record_index; evalue[2] = record_index * .25;
+        (*itor)["evalue"].set(evalue);
+        (*itor)["uvalue"].set((unsigned short)(60000 - record_index));
+        (*itor)["bvalue"].set((unsigned char)(record_index % 100));
+      }
+      table->set("dvalue", 0, &dvalues[0], &dvalues[0] + num_records);
+      table->set("jvalue", 0, &jvalues[0], &jvalues[0] + num_records, &null_mask[0]);
+      table->set("kvalue", 0, &kvalues[0], &kvalues[0] + num_records, &null_mask[0]);
+    } catch (const TipException & x) {
+      ReportUnexpected(msg + " failed", x);
+      remove("mapped_table.fits");
+      return;
+    }
+
+    bool map_tables = IFileSvc::getMapTables();
+    msg = "TestTable::mappedTableTest: comparing memory-mapped and FITS access to mapped_table.fits";
+    try {
+      IFileSvc::setMapTables(false);
+      std::unique_ptr<const Table> fits_table(IFileSvc::instance().readTable("mapped_table.fits", "DUMMY"));
+      IFileSvc::setMapTables(true);
+      std::unique_ptr<const Table> mapped_table(IFileSvc::instance().readTable("mapped_table.fits", "DUMMY"));
+
+      const FitsMappedTable * mapped = dynamic_cast<const FitsMappedTable *>(mapped_table.get());
+      if (0 != mapped && mapped->isMapped())
+        ReportExpected(msg + ": readTable mapped the table");
+      else
+        ReportUnexpected(msg + ": readTable did not map the table");
+
+      const char * fields[] = { "dvalue", "uvalue", "jvalue", "bvalue", "kvalue" };
+      for (std::size_t index = 0; index != sizeof(fields) / sizeof(fields[0]); ++index) {
+        std::vector<double> expected;
+        std::vector<bool> expected_nulls;
+        fits_table->getColumnData(fields[index], expected, expected_nulls);
+        std::vector<double> values;
+        std::vector<bool> nulls;
+        mapped_table->getColumnData(fields[index], values, nulls);
+        std::vector<long> long_expected;
+        fits_table->getColumnData(fields[index], long_expected, -1l);
+        std::vector<long> long_values;
+        mapped_table->getColumnData(fields[index], long_values, -1l);
+        // Values read into null cells are not specified.
+        for (std::vector<bool>::size_type ii = 0; ii != expected_nulls.size() && ii != nulls.size(); ++ii)
+          if (expected_nulls[ii] && nulls[ii]) expected[ii] = values[ii] = 0.;
+        if (expected == values && expected_nulls == nulls && long_expected == long_values)
+          ReportExpected(msg + ": field " + fields[index] + " has the same values and nulls");
+        else
+          ReportUnexpected(msg + ": field " + fields[index] + " does not have the same values and nulls");
+      }
+
+      // Compare cell by cell, including vectors and strings, which are left to cfitsio.
+      bool mismatch = false;
+      Table::ConstIterator fits_itor = fits_table->begin();
+      for (Table::ConstIterator itor = mapped_table->begin(); !mismatch && itor != mapped_table->end(); ++itor, ++fits_itor) {
+        std::vector<double> evalue;
+        std::vector<double> expected_evalue;
+        (*itor)["evalue"].get(evalue);
+        (*fits_itor)["evalue"].get(expected_evalue);
+        unsigned short uvalue = 0;
+        unsigned short expected_uvalue = 0;
+        (*itor)["uvalue"].get(uvalue);
+        (*fits_itor)["uvalue"].get(expected_uvalue);
+        std::string svalue;
+        std::string expected_svalue;
+        (*itor)["svalue"].get(svalue);
+        (*fits_itor)["svalue"].get(expected_svalue);
+        mismatch = evalue != expected_evalue || uvalue != expected_uvalue || svalue != expected_svalue ||
+          (*itor)["jvalue"].isNull() != (*fits_itor)["jvalue"].isNull();
+      }
+      if (!mismatch)
+        ReportExpected(msg + ": iterator access gave the same values");
+      else
+        ReportUnexpected(msg + ": iterator access did not give the same values");
+
+      // Values which do not fit in the requested type must fail as they do with cfitsio.
+      try {
+        std::vector<unsigned char> values;
+        mapped_table->getColumnData("jvalue", values);
+        ReportUnexpected(msg + ": reading negative values as unsigned char did not fail");
+      } catch (const TipException & x) {
+        ReportExpected(msg + ": reading negative values as unsigned char failed", x);
+      }
+
+      // Filtered tables are not mapped.
+      std::unique_ptr<const Table> filtered_table(IFileSvc::instance().readTable("mapped_table.fits", "DUMMY", "dvalue > 0"));
+      if (0 == dynamic_cast<const FitsMappedTable *>(filtered_table.get()) && 1799 == filtered_table->getNumRecords())
+        ReportExpected(msg + ": readTable did not map a filtered table");
+      else
+        ReportUnexpected(msg + ": readTable mapped a filtered table, or filtered it incorrectly");
+    } catch (const TipException & x) {
+      ReportUnexpected(msg + " failed", x);
+    }
+    IFileSvc::setMapTables(map_tables);
+    remove("mapped_table.fits");
+  }
+
   void TestTable::readWriteVectorFieldTest() {
     if (m_fits_table) {
       Table * table = m_fits_table;
@@ -803,6 +1343,125 @@ namespace tip {
     }
   }
 
+  void TestTable::copyRowsTest() {
+    std::string file_name = "copy_rows.fits";
+    std::string msg = "TestTable::copyRowsTest: creating " + file_name;
+    const Index_t num_records = 1000;
+    IFileSvc & file_svc(IFileSvc::instance());
+    try {
+      // A source table, a table with the same layout, and one whose fields have other types and another order.
+      remove(file_name.c_str());
+      const char * table_names[] = { "EVENTS", "SAME", "OTHER" };
+      const char * field_names[][3] = { { "TIME", "JVALUE", "EVALUE" }, { "TIME", "JVALUE", "EVALUE" },
+        { "EVALUE", "JVALUE", "TIME" } };
+      const char * formats[][3] = { { "1D", "1J", "2E" }, { "1D", "1J", "2E" }, { "2E", "1D", "1E" } };
+      for (int tt = 0; tt != 3; ++tt) {
+        file_svc.appendTable(file_name, table_names[tt]);
+        std::unique_ptr<Table> table(file_svc.editTable(file_name, table_names[tt]));
+        for (int ff = 0; ff != 3; ++ff) table->appendField(field_names[tt][ff], formats[tt][ff]);
+      }
+
+      std::unique_ptr<Table> table(file_svc.editTable(file_name, "EVENTS"));
+      table->setNumRecords(num_records);
+      std::vector<double> tvalues(num_records);
+      std::vector<long> jvalues(num_records);
+      std::vector<float> evalues(2);
+      Table::Iterator itor = table->begin();
+      for (Index_t ii = 0; ii != num_records; ++ii, ++itor) {
+        tvalues[ii] = 2. * ii;
+        jvalues[ii] = ii;
+        evalues[0] = ii;
+        evalues[1] = -ii;
+        (*itor)["evalue"].set(evalues);
+      }
+      table->set("time", 0, &tvalues[0], &tvalues[0] + num_records);
+      table->set("jvalue", 0, &jvalues[0], &jvalues[0] + num_records);
+    } catch (const TipException & x) {
+      ReportUnexpected(msg + " failed", x);
+      remove(file_name.c_str());
+      return;
+    }
+
+    // Record k of the destination, from dest_begin on, must hold source record rows[k], whose values derive from
+    // its index.
+    struct Check {
+      static bool copied(const Table & dest, Index_t dest_begin, const std::vector<Index_t> & rows) {
+        std::vector<double> time(rows.size());
+        std::vector<double> jvalue(rows.size());
+        dest.get("time", dest_begin, dest_begin + rows.size(), &time[0]);
+        dest.get("jvalue", dest_begin, dest_begin + rows.size(), &jvalue[0]);
+        std::vector<float> evalue;
+        Table::ConstIterator itor = dest.begin();
+        for (Index_t ii = 0; ii != dest_begin; ++ii) ++itor;
+        for (std::vector<Index_t>::size_type kk = 0; kk != rows.size(); ++kk, ++itor) {
+          (*itor)["evalue"].get(evalue);
+          if (2. * rows[kk] != time[kk] || double(rows[kk]) != jvalue[kk] || 2 != evalue.size() ||
+            float(rows[kk]) != evalue[0] || -float(rows[kk]) != evalue[1])
+            return false;
+        }
+        return true;
+      }
+    };
+
+    // Copy a run of consecutive records, then every third record, into the middle of each destination table, which
+    // must grow to hold them.
+    std::vector<Index_t> rows;
+    for (Index_t ii = 0; ii != 100; ++ii) rows.push_back(ii);
+    for (Index_t ii = 100; ii < num_records; ii += 3) rows.push_back(ii);
+    const Index_t dest_begin = 5;
+    const char * dest_names[] = { "SAME", "OTHER" };
+    for (int tt = 0; tt != 2; ++tt) {
+      msg = std::string("TestTable::copyRowsTest: copying records to table ") + dest_names[tt];
+      try {
+        std::unique_ptr<const Table> src(file_svc.readTable(file_name, "EVENTS"));
+        std::unique_ptr<Table> dest(file_svc.editTable(file_name, dest_names[tt]));
+        dest->setNumRecords(10);
+        dest->copyRows(src.get(), rows, dest_begin);
+        if (dest_begin + Index_t(rows.size()) != dest->getNumRecords())
+          ReportUnexpected(msg + " left it with " + toString(dest->getNumRecords()) + " records, not " +
+            toString(dest_begin + rows.size()));
+        else if (!Check::copied(*dest, dest_begin, rows))
+          ReportUnexpected(msg + " did not copy the values of the source records");
+        else
+          ReportExpected(msg + " succeeded");
+      } catch (const TipException & x) {
+        ReportUnexpected(msg + " failed", x);
+      }
+    }
+
+    // The records of a filtered view are the rows it selects, and may be appended to a table.
+    msg = "TestTable::copyRowsTest: appending records of a filtered view";
+    try {
+      IFileSvc::setFilterViews(true);
+      std::unique_ptr<const Table> view(file_svc.readTable(file_name, "EVENTS", "JVALUE % 2 == 0"));
+      IFileSvc::setFilterViews(false);
+      std::vector<Index_t> view_records;
+      std::vector<Index_t> table_rows;
+      for (Index_t ii = 0; ii != view->getNumRecords(); ++ii) {
+        view_records.push_back(ii);
+        table_rows.push_back(2 * ii);
+      }
+      std::unique_ptr<Table> dest(file_svc.editTable(file_name, "SAME"));
+      Index_t num_dest_records = dest->getNumRecords();
+      dest->copyRows(view.get(), view_records, num_dest_records);
+      if (num_records / 2 != Index_t(view_records.size()) || !Check::copied(*dest, num_dest_records, table_rows))
+        ReportUnexpected(msg + " did not copy the values of the selected rows");
+      else
+        ReportExpected(msg + " succeeded");
+
+      try {
+        dest->copyRows(view.get(), std::vector<Index_t>(1, view->getNumRecords()), 0);
+        ReportUnexpected(msg + ": copying a record past the end of the source did not throw");
+      } catch (const TipException & x) {
+        ReportExpected(msg + ": copying a record past the end of the source threw", x);
+      }
+    } catch (const TipException & x) {
+      IFileSvc::setFilterViews(false);
+      ReportUnexpected(msg + " failed", x);
+    }
+    remove(file_name.c_str());
+  }
+
   void TestTable::singleFieldBugTest() {
     try {
       // Create an empty table.
@@ -913,6 +1572,459 @@ namespace tip {
     }
   }
 
+  namespace {
+    // Sums one field and counts its nulls, as an example of a scan with a reduction.
+    struct ScanSum {
+      ScanSum(): m_sum(0.), m_num_nulls(0), m_num_records(0) {}
+      void operator ()(const ScanBlock & block) {
+        const double * values = block.getValues(0);
+        const char * null_flags = block.getNullFlags(1);
+        for (Index_t ii = 0; ii != block.getNumRecords(); ++ii) {
+          m_sum += values[ii];
+          if (0 != null_flags[ii]) ++m_num_nulls;
+        }
+        m_num_records += block.getNumRecords();
+      }
+      double m_sum;
+      Index_t m_num_nulls;
+      Index_t m_num_records;
+    };
+
+    struct ScanSumMerge {
+      void operator ()(ScanSum & total, const ScanSum & part) const {
+        total.m_sum += part.m_sum;
+        total.m_num_nulls += part.m_num_nulls;
+        total.m_num_records += part.m_num_records;
+      }
+    };
+
+    // Copies one field to its records in an output array, as an example of a scan with a shared function object.
+    struct ScanCopy {
+      ScanCopy(std::vector<double> & dest): m_dest(dest) {}
+      void operator ()(const ScanBlock & block) {
+        std::copy(block.getValues(0), block.getValues(0) + block.getNumRecords(), m_dest.begin() + block.getRecordBegin());
+      }
+      std::vector<double> & m_dest;
+    };
+
+    struct ScanFail {
+      void operator ()(const ScanBlock & block) {
+        if (0 != block.getRecordBegin()) throw TipException("ScanFail: deliberate failure");
+      }
+    };
+  }
+
+  void TestTable::tableScanTest() {
+    std::string msg = "TestTable::tableScanTest: creating scan_table.fits";
+    const Index_t num_records = 10000;
+    std::vector<double> tvalues(num_records);
+    double expected_sum = 0.;
+    Index_t expected_num_nulls = 0;
+    try {
+      remove("scan_table.fits");
+      IFileSvc::instance().appendTable("scan_table.fits", "EVENTS");
+      std::unique_ptr<Table> table(IFileSvc::instance().editTable("scan_table.fits", "EVENTS"));
+      table->appendField("TIME", "1D");
+      table->appendField("JVALUE", "1J");
+      table->appendField("EVALUE", "3E");
+      table->setNumRecords(num_records);
+      std::vector<long> jvalues(num_records);
+      std::vector<char> null_mask(num_records);
+      for (Index_t ii = 0; ii != num_records; ++ii) {
+        // Integral values, so that sums do not depend on the order of addition.
+        tvalues[ii] = double(ii * 3);
+        expected_sum += tvalues[ii];
+        jvalues[ii] = ii;
+        null_mask[ii] = 0 == ii % 11;
+        if (0 != null_mask[ii]) ++expected_num_nulls;
+      }
+      table->set("time", 0, &tvalues[0], &tvalues[0] + num_records);
+      table->set("jvalue", 0, &jvalues[0], &jvalues[0] + num_records, &null_mask[0]);
+    } catch (const TipException & x) {
+      ReportUnexpected(msg + " failed", x);
+      remove("scan_table.fits");
+      return;
+    }
+
+    Table::FieldCont fields;
+    fields.push_back("TIME");
+    fields.push_back("jvalue");
+
+    msg = "TestTable::tableScanTest: scanning scan_table.fits";
+    try {
+      std::unique_ptr<const Table> table(IFileSvc::instance().readTable("scan_table.fits", "EVENTS"));
+      TableScan scan(*table, fields);
+      scan.setNumThreads(4);
+      scan.setBlockSize(333);
+
+      ScanSum sum;
+      scan.run(sum, ScanSumMerge());
+      if (expected_sum == sum.m_sum && expected_num_nulls == sum.m_num_nulls && num_records == sum.m_num_records)
+        ReportExpected(msg + " with a reduction gave the correct sum and number of nulls");
+      else
+        ReportUnexpected(msg + " with a reduction did not give the correct sum and number of nulls");
+      if (1 == scan.getNumThreadsUsed())
+        ReportWarning(msg + " used only one thread; cfitsio may not be thread safe");
+
+      std::vector<double> copy(num_records);
+      ScanCopy copy_func(copy);
+      scan.run(copy_func);
+      if (tvalues == copy)
+        ReportExpected(msg + " with a shared function object read every record once");
+      else
+        ReportUnexpected(msg + " with a shared function object did not read every record once");
+
+      // Failures in any thread are passed on to the caller.
+      try {
+        ScanFail fail;
+        scan.run(fail);
+        ReportUnexpected(msg + " with a function object which throws did not throw");
+      } catch (const TipException & x) {
+        ReportExpected(msg + " with a function object which throws threw", x);
+      }
+    } catch (const TipException & x) {
+      ReportUnexpected(msg + " failed", x);
+    }
+
+    // With pooling, the table itself is opened through the pool, but the readers of other threads must not share
+    // its file, so they do not use the pool.
+    msg = "TestTable::tableScanTest: scanning scan_table.fits with the file pool enabled";
+    try {
+      IFileSvc::setFilePoolSize(4);
+      std::unique_ptr<const Table> table(IFileSvc::instance().readTable("scan_table.fits", "EVENTS"));
+      unsigned long start_hits = 0;
+      unsigned long start_misses = 0;
+      IFileSvc::getFilePoolStats(start_hits, start_misses);
+      TableScan scan(*table, fields);
+      scan.setNumThreads(4);
+      scan.setBlockSize(333);
+      ScanSum sum;
+      scan.run(sum, ScanSumMerge());
+      unsigned long num_hits = 0;
+      unsigned long num_misses = 0;
+      IFileSvc::getFilePoolStats(num_hits, num_misses);
+      if (expected_sum != sum.m_sum || expected_num_nulls != sum.m_num_nulls || num_records != sum.m_num_records)
+        ReportUnexpected(msg + " did not give the correct sum and number of nulls");
+      else if (start_hits != num_hits || start_misses != num_misses)
+        ReportUnexpected(msg + " opened the readers of other threads through the pool");
+      else
+        ReportExpected(msg + " gave the correct sum, without opening readers through the pool");
+    } catch (const TipException & x) {
+      ReportUnexpected(msg + " failed", x);
+    }
+    IFileSvc::setFilePoolSize(0);
+
+    msg = "TestTable::tableScanTest: scanning filtered scan_table.fits";
+    try {
+      std::unique_ptr<const Table> table(IFileSvc::instance().readTable("scan_table.fits", "EVENTS", "#row <= 1000"));
+      TableScan scan(*table, fields);
+      scan.setNumThreads(4);
+      scan.setBlockSize(100);
+      ScanSum sum;
+      scan.run(sum, ScanSumMerge());
+      if (1 == scan.getNumThreadsUsed() && 1000 == sum.m_num_records && 1000. * 999. * 3. / 2. == sum.m_sum)
+        ReportExpected(msg + " read the filtered records in the calling thread");
+      else
+        ReportUnexpected(msg + " did not read the filtered records correctly in the calling thread");
+    } catch (const TipException & x) {
+      ReportUnexpected(msg + " failed", x);
+    }
+
+    msg = "TestTable::tableScanTest: scanning a vector field";
+    try {
+      std::unique_ptr<const Table> table(IFileSvc::instance().readTable("scan_table.fits", "EVENTS"));
+      TableScan scan(*table, Table::FieldCont(1, "evalue"));
+      ScanSum sum;
+      scan.run(sum, ScanSumMerge());
+      ReportUnexpected(msg + " did not fail");
+    } catch (const TipException & x) {
+      ReportExpected(msg + " failed", x);
+    }
+
+    remove("scan_table.fits");
+  }
+
+  void TestTable::filterViewTest() {
+    std::string msg = "TestTable::filterViewTest: creating filter_view.fits";
+    const Index_t num_records = 1000;
+    try {
+      remove("filter_view.fits");
+      IFileSvc::instance().appendTable("filter_view.fits", "EVENTS");
+      std::unique_ptr<Table> table(IFileSvc::instance().editTable("filter_view.fits", "EVENTS"));
+      table->appendField("TIME", "1D");
+      table->appendField("JVALUE", "1J");
+      table->appendField("EVALUE", "2E");
+      table->setNumRecords(num_records);
+      std::vector<double> tvalues(num_records);
+      std::vector<long> jvalues(num_records);
+      std::vector<float> evalues(2);
+      Table::Iterator itor = table->begin();
+      for (Index_t ii = 0; ii != num_records; ++ii, ++itor) {
+        tvalues[ii] = 2. * ii;
+        jvalues[ii] = ii;
+        evalues[0] = ii;
+        evalues[1] = -ii;
+        (*itor)["evalue"].set(evalues);
+      }
+      table->set("time", 0, &tvalues[0], &tvalues[0] + num_records);
+      table->set("jvalue", 0, &jvalues[0], &jvalues[0] + num_records);
+    } catch (const TipException & x) {
+      ReportUnexpected(msg + " failed", x);
+      remove("filter_view.fits");
+      return;
+    }
+
+    // A view must read the same records as a table filtered by cfitsio, one at a time and in bulk.
+    msg = "TestTable::filterViewTest: reading a view of filter_view.fits";
+    try {
+      std::string filter = "JVALUE % 3 == 0";
+      std::unique_ptr<const Table> copied_table(IFileSvc::instance().readTable("filter_view.fits", "EVENTS", filter));
+      IFileSvc::setFilterViews(true);
+      std::unique_ptr<const Table> view(IFileSvc::instance().readTable("filter_view.fits", "EVENTS", filter));
+      IFileSvc::setFilterViews(false);
+
+      if (0 == dynamic_cast<const FitsFilteredTable *>(view.get()))
+        ReportUnexpected(msg + ": readTable did not return a view");
+      Index_t num_filtered = copied_table->getNumRecords();
+      if (334 != num_filtered || num_filtered != view->getNumRecords()) {
+        ReportUnexpected(msg + ": view did not have the same number of records as the table filtered by cfitsio");
+      } else {
+        std::vector<double> copied_time(num_filtered);
+        std::vector<double> view_time(num_filtered);
+        copied_table->get("time", 0, num_filtered, &copied_time[0]);
+        view->get("time", 0, num_filtered, &view_time[0]);
+
+        bool same = copied_time == view_time;
+        std::vector<float> copied_evalue;
+        std::vector<float> view_evalue;
+        Table::ConstIterator view_itor = view->begin();
+        for (Table::ConstIterator itor = copied_table->begin(); itor != copied_table->end(); ++itor, ++view_itor) {
+          (*itor)["evalue"].get(copied_evalue);
+          (*view_itor)["evalue"].get(view_evalue);
+          same = same && copied_evalue == view_evalue && (*itor)["jvalue"].get() == (*view_itor)["jvalue"].get();
+        }
+        if (same)
+          ReportExpected(msg + " read the same records as the table filtered by cfitsio");
+        else
+          ReportUnexpected(msg + " did not read the same records as the table filtered by cfitsio");
+      }
+    } catch (const TipException & x) {
+      IFileSvc::setFilterViews(false);
+      ReportUnexpected(msg + " failed", x);
+    }
+
+    // Filtering a view again narrows the selection without changing the file.
+    msg = "TestTable::filterViewTest: filtering a view twice";
+    try {
+      FitsFilteredTable view(new FitsTable("filter_view.fits", "EVENTS"), "JVALUE % 3 == 0");
+      view.filterRows("TIME > 1000");
+      double first_time = 0.;
+      (*view.begin())["time"].get(first_time);
+      if (167 == view.getNumRecords() && 1002. == first_time)
+        ReportExpected(msg + " selected the records which match both expressions");
+      else
+        ReportUnexpected(msg + " did not select the records which match both expressions");
+
+      std::unique_ptr<const Table> table(IFileSvc::instance().readTable("filter_view.fits", "EVENTS"));
+      if (num_records == table->getNumRecords())
+        ReportExpected(msg + " did not change the file");
+      else
+        ReportUnexpected(msg + " changed the file");
+
+      try {
+        view.setNumRecords(10);
+        ReportUnexpected(msg + ": changing the number of records of a view did not fail");
+      } catch (const TipException & x) {
+        ReportExpected(msg + ": changing the number of records of a view failed", x);
+      }
+
+      // Views can be scanned in several threads, which share the selection.
+      TableScan scan(view, Table::FieldCont(1, "jvalue"));
+      scan.setNumThreads(4);
+      scan.setBlockSize(50);
+      ScanSum sum;
+      scan.run(sum, ScanSumMerge());
+      // Multiples of 3 from 501 to 999.
+      if (167 == sum.m_num_records && 3. * (167. * 166. / 2. + 167. * 167.) == sum.m_sum)
+        ReportExpected(msg + ": scanning the view read the selected records");
+      else
+        ReportUnexpected(msg + ": scanning the view did not read the selected records");
+    } catch (const TipException & x) {
+      ReportUnexpected(msg + " failed", x);
+    }
+
+    remove("filter_view.fits");
+  }
+
+  void TestTable::columnIndexTest() {
+    std::string msg = "TestTable::columnIndexTest: creating column_index.fits";
+    const Index_t num_records = 1000;
+    std::vector<double> time(num_records);
+    try {
+      remove("column_index.fits");
+      IFileSvc::instance().appendTable("column_index.fits", "EVENTS");
+      std::unique_ptr<Table> table(IFileSvc::instance().editTable("column_index.fits", "EVENTS"));
+      table->appendField("TIME", "1D");
+      table->appendField("ENERGY", "1E");
+      table->setNumRecords(num_records);
+      std::vector<float> energy(num_records);
+      for (Index_t ii = 0; ii != num_records; ++ii) {
+        // Runs of equal times, which may cross block boundaries.
+        time[ii] = 10. + ii / 3;
+        energy[ii] = (ii * 37) % 100;
+      }
+      table->set("time", 0, &time[0], &time[0] + num_records);
+      table->set("energy", 0, &energy[0], &energy[0] + num_records);
+    } catch (const TipException & x) {
+      ReportUnexpected(msg + " failed", x);
+      remove("column_index.fits");
+      return;
+    }
+
+    // Both ways of building the index must find the same records as searching all values in memory.
+    msg = "TestTable::columnIndexTest: searching TIME";
+    try {
+      std::unique_ptr<const Table> table(IFileSvc::instance().readTable("column_index.fits", "EVENTS"));
+      for (int check = 0; check != 2; ++check) {
+        ColumnIndex index(*table, "TIME", 0 == check ? ColumnIndex::eCheckOrder : ColumnIndex::eAssumeOrder, 64);
+        bool same = true;
+        for (double value = 0.; value < 350.; value += .5) {
+          Index_t lower = std::lower_bound(time.begin(), time.end(), value) - time.begin();
+          Index_t upper = std::upper_bound(time.begin(), time.end(), value + 5.) - time.begin();
+          ColumnIndex::Range_t range = index.equalRange(value, value + 5.);
+          same = same && lower == index.lowerBound(value) && lower == range.first && upper == range.second;
+        }
+        if (same)
+          ReportExpected(msg + " found the same records as a search in memory");
+        else
+          ReportUnexpected(msg + " did not find the same records as a search in memory");
+      }
+
+      // A query on a new index must read only a few blocks.
+      ColumnIndex index(*table, "TIME", ColumnIndex::eAssumeOrder, 64);
+      ColumnIndex::Range_t range = index.equalRange(100., 110.);
+      if (270 != range.first || 303 != range.second)
+        ReportUnexpected(msg + ": equalRange(100., 110.) returned the wrong range");
+      else if (3 * 64 < index.getNumRecordsRead())
+        ReportUnexpected(msg + ": equalRange(100., 110.) read " + toString(index.getNumRecordsRead()) + " records");
+      else
+        ReportExpected(msg + ": equalRange(100., 110.) read " + toString(index.getNumRecordsRead()) + " records");
+
+      // Intervals are given out of order and overlap.
+      double start_values[] = { 300., 10.5, 11., 50.1 };
+      double stop_values[] = { 1000., 12., 13., 50.9 };
+      std::vector<double> start(start_values, start_values + 4);
+      std::vector<double> stop(stop_values, stop_values + 4);
+      ColumnIndex::RangeCont_t ranges;
+      index.findIntervals(start, stop, ranges);
+      if (2 == ranges.size() && ColumnIndex::Range_t(3, 12) == ranges[0] &&
+        ColumnIndex::Range_t(870, num_records) == ranges[1])
+        ReportExpected(msg + ": findIntervals found the records in the intervals");
+      else
+        ReportUnexpected(msg + ": findIntervals did not find the records in the intervals");
+    } catch (const TipException & x) {
+      ReportUnexpected(msg + " failed", x);
+    }
+
+    msg = "TestTable::columnIndexTest: indexing ENERGY, which is not sorted,";
+    try {
+      std::unique_ptr<const Table> table(IFileSvc::instance().readTable("column_index.fits", "EVENTS"));
+      ColumnIndex index(*table, "ENERGY");
+      ReportUnexpected(msg + " did not throw an exception");
+    } catch (const TipException & x) {
+      ReportExpected(msg + " threw exception", x);
+    }
+
+    remove("column_index.fits");
+  }
+
+  void TestTable::longLongTest() {
+    std::string msg = "TestTable::longLongTest";
+    try {
+      remove("long_long.fits");
+
+      // Create a table with scalar and vector 64-bit integer fields.
+      IFileSvc::instance().appendTable("long_long.fits", "DUMMY");
+      std::unique_ptr<Table> table(IFileSvc::instance().editTable("long_long.fits", "DUMMY"));
+      table->appendField("KSCALAR", "1K");
+      table->appendField("KVECTOR", "3K");
+      table->appendField("WSCALAR", "1W");
+      table->setNumRecords(3);
+
+      // Use values which a double cannot hold exactly.
+      const long long big = (1ll << 60) + 1;
+      std::vector<long long> expected_vector(3);
+      expected_vector[0] = big; expected_vector[1] = -big; expected_vector[2] = std::numeric_limits<long long>::max();
+
+      Table::Iterator itor = table->begin();
+      (*itor)["KSCALAR"].set(big);
+      (*itor)["KVECTOR"].set(expected_vector);
+      ++itor;
+      (*itor)["KSCALAR"].set(-big);
+      ++itor;
+      (*itor)["KSCALAR"].set((unsigned long long)(big + 2));
+
+      // Unsigned values of K fields offset by 2^63, including those past the largest long long.
+      const unsigned long long ubig = (1ull << 63) + 5;
+      std::vector<unsigned long long> expected_unsigned(3);
+      expected_unsigned[0] = ubig; expected_unsigned[1] = 3; expected_unsigned[2] = ubig + 1000;
+      table->set("WSCALAR", 0, &expected_unsigned[0], &expected_unsigned[0] + expected_unsigned.size());
+
+      // Close and re-open the table.
+      delete table.release();
+      table.reset(IFileSvc::instance().editTable("long_long.fits", "DUMMY"));
+
+      if ("1K" == table->getColumn(table->getFieldIndex("KSCALAR"))->getFormat())
+        ReportExpected(msg + ": KSCALAR column format read agrees with the format used to create column");
+      else
+        ReportUnexpected(msg + ": KSCALAR column format read disagrees with the format used to create column");
+
+      std::vector<long long> values;
+      table->getColumnData("KSCALAR", values, 0ll);
+      unsigned long long unsigned_value = 0;
+      std::vector<long long> vector_value;
+      itor = table->begin();
+      (*itor)["KSCALAR"].get(unsigned_value);
+      (*itor)["KVECTOR"].get(vector_value);
+      if (3 == values.size() && big == values[0] && -big == values[1] && big + 2 == values[2] &&
+        (unsigned long long)(big) == unsigned_value && expected_vector == vector_value)
+        ReportExpected(msg + ": reading and writing 64-bit integers is consistent");
+      else
+        ReportUnexpected(msg + ": 64-bit integers did not read back the same as they were written");
+
+      std::vector<unsigned long long> unsigned_values(3);
+      table->get("WSCALAR", 0, 3, &unsigned_values[0]);
+      const IColumn * column = table->getColumn(table->getFieldIndex("WSCALAR"));
+      if ("1W" != column->getFormat())
+        ReportUnexpected(msg + ": WSCALAR column format read is " + column->getFormat() + ", not 1W");
+      else if (expected_unsigned != unsigned_values)
+        ReportUnexpected(msg + ": unsigned 64-bit integers did not read back the same as they were written");
+      else
+        ReportExpected(msg + ": reading and writing unsigned 64-bit integers is consistent");
+
+      // A negative value does not fit in an unsigned long long.
+      try {
+        ++itor;
+        (*itor)["KSCALAR"].get(unsigned_value);
+        ReportUnexpected(msg + ": reading a negative 64-bit integer as unsigned long long did not fail");
+      } catch (const TipException & x) {
+        ReportExpected(msg + ": reading a negative 64-bit integer as unsigned long long failed", x);
+      }
+
+      // Read-ahead does not apply to 64-bit fields, which a double buffer would truncate.
+      table->setReadAhead(10);
+      long long value = 0;
+      (*table->begin())["KSCALAR"].get(value);
+      if (big == value)
+        ReportExpected(msg + ": read-ahead does not change 64-bit integer values");
+      else
+        ReportUnexpected(msg + ": read-ahead changed a 64-bit integer value");
+    } catch (const TipException & x) {
+      ReportUnexpected(msg + " had a problem", x);
+    }
+    remove("long_long.fits");
+  }
+
   void TestTable::rootFt2Test() {
     if (0 == m_root_ft2) return;
 
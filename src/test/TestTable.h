@@ -58,12 +58,48 @@ namespace tip {
       */
       void writeFieldTest(Table * table, const std::string & field_name, const std::vector<double> & field_values);
 
+      /// \brief Test reading ranges of records from a scalar field in one operation.
+      void bulkReadTest();
+
+      /** \brief Test reading ranges of records from one scalar field of a table, comparing to iterator access.
+          \param table The table.
+          \param field_name The name of the field.
+      */
+      void bulkReadTest(const Table * table, const std::string & field_name);
+
+      /// \brief Test writing ranges of records to scalar fields in one operation, including null values.
+      void bulkWriteTest();
+
+      /// \brief Test that reading through read-ahead buffers gives the same results as unbuffered reads.
+      void readAheadTest();
+
+      /// \brief Test access to cells through field handles.
+      void fieldHandleTest();
+
+      /// \brief Test reading whole columns into vectors, including null handling and reading in blocks.
+      void columnDataTest();
+
+      /// \brief Test that memory-mapped tables read the same values as ordinary FITS tables.
+      void mappedTableTest();
+
+      /// \brief Test scanning tables in several threads.
+      void tableScanTest();
+
+      /// \brief Test filtered views, which select rows through an index instead of copying them.
+      void filterViewTest();
+
+      /// \brief Test finding records by the values of sorted fields with ColumnIndex.
+      void columnIndexTest();
+
       /// \brief Test reading and writing vector-valued fields (just for FITS case for now).
       void readWriteVectorFieldTest();
 
       /// \brief Test copying one table's columns to another.
       void copyFieldTest();
 
+      /// \brief Test copying many records at once with Table::copyRows.
+      void copyRowsTest();
+
       /// \brief Test that bug when only one column is present was corrected.
       void singleFieldBugTest();
 
@@ -74,6 +110,9 @@ namespace tip {
       /// \brief Test that unsigned integers are handled correctly.
       void unsignedIntTest();
 
+      /// \brief Test that 64-bit integers are handled correctly.
+      void longLongTest();
+
       /// \brief Test that Root version of FT2 files are readable.
       void rootFt2Test();
 
@@ -0,0 +1,76 @@
+/** \file AngularInterp.h
+
+    \brief Utility to interpolate orientations and directions in tables along great circles.
+    Table must be ordered on the field used to interpolate.
+*/
+#ifndef tip_AngularInterp_h
+#define tip_AngularInterp_h
+
+#include <string>
+#include <vector>
+
+#include "tip/IndexedLinearInterp.h"
+#include "tip/Table.h"
+
+namespace tip {
+
+  /** \class AngularInterp
+
+      \brief Interpolates quantities which live on spheres, where blending components one by one, as LinearInterp
+      does, gives results which are not unit quaternions or directions, and moves at the wrong rate: attitude
+      quaternions are interpolated by spherical linear interpolation (SLERP), and directions given as (RA, Dec)
+      pairs along the great circle through the two records, which also handles RA wrapping through 0.
+
+      Interval search and the other fields are handled as by IndexedLinearInterp, so the same object can
+      interpolate, for example, position linearly and attitude spherically at each time. Only getQuaternion and
+      getDirection interpolate spherically; get, including through a reference to IndexedLinearInterp,
+      interpolates linearly.
+  */
+  class AngularInterp : public IndexedLinearInterp {
+    public:
+      /** \brief Create an interpolator for the given range of records.
+          \param begin Iterator pointing to the first record.
+          \param end Iterator pointing to the record after the last record.
+      */
+      AngularInterp(const Table::ConstIterator & begin, const Table::ConstIterator & end);
+
+      /** \brief Compute the interpolated unit quaternion stored in a vector field with 4 elements. The quaternions
+          need not be normalized, and q and -q are treated as the same rotation, so the shorter arc is taken.
+          \param field The name of the field.
+          \param quaternion The interpolated quaternion, in the order of the elements of the field.
+      */
+      void getQuaternion(const std::string & field, std::vector<double> & quaternion) const;
+
+      /** \brief Compute the interpolated unit quaternion stored in 4 scalar fields, such as QSJ_1 to QSJ_4.
+          \param fields The names of the 4 fields.
+          \param quaternion The interpolated quaternion, in the order of the fields.
+      */
+      void getQuaternion(const Table::FieldCont & fields, std::vector<double> & quaternion) const;
+
+      /** \brief Compute the interpolated direction given by a pair of scalar fields, in degrees.
+          \param ra_field The name of the field holding the longitude, e.g. RA_SCZ.
+          \param dec_field The name of the field holding the latitude, e.g. DEC_SCZ.
+          \param ra The interpolated longitude, from 0 up to 360.
+          \param dec The interpolated latitude.
+      */
+      void getDirection(const std::string & ra_field, const std::string & dec_field, double & ra, double & dec) const;
+
+    private:
+      /** \brief Interpolate between two quaternions along the shorter arc.
+          \param q0 The quaternion at the record before the value, which is normalized.
+          \param q1 The quaternion at the record after the value, which is normalized and may be negated.
+          \param result The interpolated unit quaternion.
+      */
+      void slerpQuaternion(std::vector<double> & q0, std::vector<double> & q1, std::vector<double> & result) const;
+
+      /** \brief Interpolate along the great circle between two unit vectors of any dimension.
+          \param v0 The vector at the record before the value.
+          \param v1 The vector at the record after the value.
+          \param result The interpolated unit vector.
+      */
+      void slerp(const std::vector<double> & v0, const std::vector<double> & v1, std::vector<double> & result) const;
+  };
+
+}
+
+#endif
@@ -0,0 +1,132 @@
+/** \file ColumnIndex.h
+
+    \brief Sparse index of a sorted field of a table, for finding the records in ranges of values.
+*/
+#ifndef tip_ColumnIndex_h
+#define tip_ColumnIndex_h
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "tip/IColumn.h"
+#include "tip/Table.h"
+#include "tip/tip_types.h"
+
+namespace tip {
+
+  /** \class ColumnIndex
+
+      \brief Finds records of a table by the value of a scalar field whose values never decrease from one record to
+      the next, such as TIME in event and spacecraft tables, without reading the whole field. The records are
+      divided into blocks, and the index keeps the first value of each block. A query searches these values to find
+      the one block which can hold the answer, then reads just that block, so cutting a short time window out of a
+      long table reads a few blocks rather than every record.
+
+      The order of the field is either checked when the index is built, which reads the field once, in bulk, and
+      fills the whole index; or it is assumed, in which case only the first values of the blocks visited by the
+      binary searches are read, as they are needed, and each block read is checked. Null values are not allowed.
+
+      The index does not follow changes made to the table after it is built.
+
+      \code
+        // Select the events in a list of good time intervals.
+        ColumnIndex index(*events, "TIME", ColumnIndex::eAssumeOrder);
+        ColumnIndex::RangeCont_t ranges;
+        index.findIntervals(gti_start, gti_stop, ranges);
+        for (ColumnIndex::RangeCont_t::iterator itor = ranges.begin(); itor != ranges.end(); ++itor)
+          processEvents(*events, itor->first, itor->second);
+      \endcode
+  */
+  class ColumnIndex {
+    public:
+      /// \brief A range of records, from the first record to the record after the last.
+      typedef std::pair<Index_t, Index_t> Range_t;
+      typedef std::vector<Range_t> RangeCont_t;
+
+      /// \brief How the order of the field is established.
+      enum OrderCheck {
+        eCheckOrder, ///< Read the whole field once to check that it is sorted.
+        eAssumeOrder ///< Trust that the field is sorted, and read only what queries need.
+      };
+
+      /** \brief Build an index of a field of a table. The table must outlive the index.
+          \param table The table.
+          \param field The name of the field, which must be a scalar and sorted in increasing order.
+          \param check How the order of the field is established.
+          \param block_size The number of records in each block. 0 selects a size which is fast to read.
+      */
+      ColumnIndex(const Table & table, const std::string & field, OrderCheck check = eCheckOrder,
+        Index_t block_size = 0);
+
+      /** \brief Return the first record whose value is not less than the given value, or the number of records
+          if there is no such record.
+          \param value The value.
+      */
+      Index_t lowerBound(double value) const;
+
+      /** \brief Return the first record whose value is greater than the given value, or the number of records
+          if there is no such record.
+          \param value The value.
+      */
+      Index_t upperBound(double value) const;
+
+      /** \brief Return the range of records whose values v satisfy low <= v <= high.
+          \param low The lowest value in the range.
+          \param high The highest value in the range.
+      */
+      Range_t equalRange(double low, double high) const;
+
+      /** \brief Find the records whose values lie in any of the given intervals, which include both limits, as in
+          GTI extensions. The intervals need not be in order and may overlap.
+          \param start The starts of the intervals.
+          \param stop The stops of the intervals, in the same order as the starts.
+          \param ranges The output ranges of records, in increasing order, not empty and not adjacent.
+      */
+      void findIntervals(const std::vector<double> & start, const std::vector<double> & stop, RangeCont_t & ranges)
+        const;
+
+      /// \brief Return the number of records in the table when the index was built.
+      Index_t getNumRecords() const { return m_num_records; }
+
+      /// \brief Return the number of records in each block.
+      Index_t getBlockSize() const { return m_block_size; }
+
+      /// \brief Return the number of records read so far, including those read while building the index.
+      Index_t getNumRecordsRead() const { return m_num_records_read; }
+
+    private:
+      /** \brief Return the first value of a block, reading it if it is not yet known.
+          \param block The number of the block.
+      */
+      double getFirst(Index_t block) const;
+
+      /** \brief Read a block, unless it is the block read most recently, and check its order.
+          \param block The number of the block.
+      */
+      const std::vector<double> & readBlock(Index_t block) const;
+
+      /** \brief Return the first block whose first value is not less than (or, if strict, greater than) a value.
+          \param value The value.
+          \param strict Whether to look for first values greater than the value.
+      */
+      Index_t findBlock(double value, bool strict) const;
+
+      /// \brief Throw an exception if a value read from the field is null.
+      void checkValue(double value, char null_flag) const;
+
+      const Table & m_table;
+      std::string m_field;
+      const IColumn * m_column;
+      Index_t m_num_records;
+      Index_t m_block_size;
+      mutable std::vector<double> m_first;
+      mutable std::vector<char> m_first_known;
+      mutable std::vector<double> m_block;
+      mutable Index_t m_block_read;
+      mutable Index_t m_num_records_read;
+  };
+
+}
+
+#endif
@@ -7,6 +7,8 @@
 #ifndef tip_Extension_h
 #define tip_Extension_h
 
+#include <string>
+
 namespace tip {
 
   class Header;
@@ -8,23 +8,65 @@
 #include <string>
 #include <vector>
 
+#include "tip/tip_types.h"
+
 namespace tip {
   /** \class ExtSummary
       \brief Class encapsulating essential information about an extension.
   */
   class ExtSummary {
     public:
+      /// \brief The kinds of extension.
+      enum ExtType { eUnknown, eImage, eAsciiTable, eBinaryTable };
+
       /** \brief Create ExtSummary object for the given extension.
           \param ext_id The id of the extension.
       */
       ExtSummary(const std::string & ext_id);
 
+      /** \brief Create ExtSummary object describing the layout of the given extension.
+          \param ext_id The id of the extension.
+          \param ext_type The kind of extension.
+          \param num_records The number of records in a table, 0 for an image.
+          \param num_bytes The size of the data unit in bytes, including padding.
+          \param image_dims The dimensions of an image, empty for a table.
+          \param field_names The names of the fields of a table, lowercased as Table::getValidFields gives them.
+      */
+      ExtSummary(const std::string & ext_id, ExtType ext_type, Index_t num_records, long long num_bytes,
+        const std::vector<PixOrd_t> & image_dims, const std::vector<std::string> & field_names);
+
       /** \brief Return the id of this extension.
       */
       const std::string & getExtId() const;
 
+      /// \brief Return the kind of this extension.
+      ExtType getExtType() const;
+
+      /// \brief Return whether this extension is an image, including a tile-compressed image.
+      bool isImage() const;
+
+      /// \brief Return whether this extension is an ASCII or binary table.
+      bool isTable() const;
+
+      /// \brief Return the number of records in this extension if it is a table, or 0.
+      Index_t getNumRecords() const;
+
+      /// \brief Return the size in bytes of the data unit of this extension, including padding.
+      long long getNumBytes() const;
+
+      /// \brief Return the dimensions of this extension if it is an image.
+      const std::vector<PixOrd_t> & getImageDimensions() const;
+
+      /// \brief Return the names of the fields of this extension if it is a table.
+      const std::vector<std::string> & getFieldNames() const;
+
     private:
       std::string m_ext_id;
+      ExtType m_ext_type;
+      Index_t m_num_records;
+      long long m_num_bytes;
+      std::vector<PixOrd_t> m_image_dims;
+      std::vector<std::string> m_field_names;
   };
 
   typedef std::vector<ExtSummary> FileSummary;
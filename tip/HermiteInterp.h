@@ -0,0 +1,102 @@
+/** \file HermiteInterp.h
+
+    \brief Utility to interpolate values in tables with cubic Hermite splines.
+    Table must be ordered on the field used to interpolate.
+*/
+#ifndef tip_HermiteInterp_h
+#define tip_HermiteInterp_h
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "tip/IndexedLinearInterp.h"
+#include "tip/Table.h"
+#include "tip/tip_types.h"
+
+namespace tip {
+
+  /** \class HermiteInterp
+
+      \brief Interpolates fields with cubic Hermite splines through the records on either side of each value,
+      which follow smooth quantities such as orbit positions much more closely than straight lines, so that
+      tables may be sampled more coarsely. The first get of a field reads the whole field and computes the
+      slope of the spline at every record, after which each get takes constant time. Vector fields are
+      interpolated element by element.
+
+      The interface is that of IndexedLinearInterp, whose interval search it uses; only the values returned
+      by get differ. The spline passes through the value of each record.
+  */
+  class HermiteInterp : public IndexedLinearInterp {
+    public:
+      /** \brief How the slope of the spline at each record is computed.
+      */
+      enum SlopeMethod {
+        eFiniteDifference, ///< Mean of the slopes of the intervals on either side.
+        eAkima ///< Akima's weighted mean, which does not overshoot near abrupt changes.
+      };
+
+      /** \brief Create an interpolator for the given range of records.
+          \param begin Iterator pointing to the first record.
+          \param end Iterator pointing to the record after the last record.
+          \param method How to compute the slopes.
+      */
+      HermiteInterp(const Table::ConstIterator & begin, const Table::ConstIterator & end,
+        SlopeMethod method = eAkima);
+
+      /** \brief Find the records on either side of the given value, as IndexedLinearInterp does.
+          \param field The name of the field to interpolate on.
+          \param value The value of that field at which to interpolate.
+      */
+      void interpolate(const std::string & field, double value) { IndexedLinearInterp::interpolate(field, value); }
+
+      /** \brief The batch form of interpolate, which IndexedLinearInterp only does linearly, is not supported, and
+          throws, so that it does not give linear results when called through a reference to IndexedLinearInterp.
+      */
+      virtual void interpolate(const std::string & field, const std::vector<double> & values,
+        const Table::FieldCont & fields, std::vector<std::vector<double> > & results);
+
+      /** \brief Return the interpolated value of a scalar field.
+          \param field The name of the field.
+      */
+      virtual double get(const std::string & field) const;
+
+      /** \brief Compute the interpolated values of a scalar or vector field.
+          \param field The name of the field.
+          \param value The interpolated values.
+      */
+      virtual void get(const std::string & field, std::vector<double> & value) const;
+
+    private:
+      /** \brief The values of one field for every record of the range, with the slope of the spline at each.
+      */
+      struct Spline {
+        Spline(): m_abscissa_index(-1), m_num_elements(0), m_value(), m_slope() {}
+        FieldIndex_t m_abscissa_index;
+        std::size_t m_num_elements;
+        std::vector<double> m_value;
+        std::vector<double> m_slope;
+      };
+
+      /** \brief Return the spline for the given field, computing it if it has not been computed for the field
+          last interpolated on.
+          \param field The name of the field.
+      */
+      const Spline & getSpline(const std::string & field) const;
+
+      /** \brief Compute the slopes of one element of a field.
+          \param x The abscissa of every record.
+          \param y The first value of the element.
+          \param stride The distance between values of the element in consecutive records.
+          \param slope The first slope of the element, which has the same stride.
+      */
+      void computeSlopes(const std::vector<double> & x, const double * y, std::size_t stride, double * slope) const;
+
+      SlopeMethod m_method;
+      mutable std::map<FieldIndex_t, Spline> m_splines;
+  };
+
+}
+
+#endif
@@ -41,6 +41,8 @@ namespace tip {
       virtual void get(Index_t, unsigned short &) const { unsupported("get(Index_t, unsigned short &)"); }
       virtual void get(Index_t, unsigned int &) const { unsupported("get(Index_t, unsigned int &)"); }
       virtual void get(Index_t, unsigned long &) const { unsupported("get(Index_t, unsigned long &)"); }
+      virtual void get(Index_t, signed long long &) const { unsupported("get(Index_t, signed long long &)"); }
+      virtual void get(Index_t, unsigned long long &) const { unsupported("get(Index_t, unsigned long long &)"); }
       virtual void get(Index_t, std::string &) const { unsupported("get(Index_t, std::string &)"); }
       virtual void get(Index_t, BitStruct &) const { unsupported("get(Index_t, BitStruct &)"); }
 
@@ -56,9 +58,54 @@ namespace tip {
       virtual void get(Index_t, std::vector<unsigned short> &) const { unsupported("get(Index_t, std::vector<unsigned short> &)");}
       virtual void get(Index_t, std::vector<unsigned int> &) const { unsupported("get(Index_t, std::vector<unsigned int> &)"); }
       virtual void get(Index_t, std::vector<unsigned long> &) const { unsupported("get(Index_t, std::vector<unsigned long> &)"); }
+      virtual void get(Index_t, std::vector<signed long long> &) const
+        { unsupported("get(Index_t, std::vector<signed long long> &)"); }
+      virtual void get(Index_t, std::vector<unsigned long long> &) const
+        { unsupported("get(Index_t, std::vector<unsigned long long> &)"); }
       virtual void get(Index_t, std::vector<std::string> &) const { unsupported("get(Index_t, std::vector<std::string> &)"); }
       virtual void get(Index_t, std::vector<BitStruct> &) const { unsupported("get(Index_t, std::vector<BitStruct> &)"); }
 
+      /** \brief Get values from a contiguous range of records of a scalar column in one operation.
+          An implementation which just throws an exception is provided in the base class.
+          \param record_begin Index of the first record to read.
+          \param record_end Index of the record after the last record to read.
+          \param dest Pointer to the first element of the destination array. The caller
+          is responsible for making sure adequate space is allocated.
+          \param null_flags Optional array parallel to the destination, which will be set non-0 for
+          records whose values are null. If it is omitted, null values are given the undefined value
+          for the type of the destination.
+      */
+      virtual void get(Index_t, Index_t, double *, char * = 0) const
+        { unsupported("get(Index_t, Index_t, double *, char *)"); }
+      virtual void get(Index_t, Index_t, float *, char * = 0) const
+        { unsupported("get(Index_t, Index_t, float *, char *)"); }
+      virtual void get(Index_t, Index_t, char *, char * = 0) const
+        { unsupported("get(Index_t, Index_t, char *, char *)"); }
+      virtual void get(Index_t, Index_t, signed char *, char * = 0) const
+        { unsupported("get(Index_t, Index_t, signed char *, char *)"); }
+      virtual void get(Index_t, Index_t, signed short *, char * = 0) const
+        { unsupported("get(Index_t, Index_t, signed short *, char *)"); }
+      virtual void get(Index_t, Index_t, signed int *, char * = 0) const
+        { unsupported("get(Index_t, Index_t, signed int *, char *)"); }
+      virtual void get(Index_t, Index_t, signed long *, char * = 0) const
+        { unsupported("get(Index_t, Index_t, signed long *, char *)"); }
+      virtual void get(Index_t, Index_t, unsigned char *, char * = 0) const
+        { unsupported("get(Index_t, Index_t, unsigned char *, char *)"); }
+      virtual void get(Index_t, Index_t, unsigned short *, char * = 0) const
+        { unsupported("get(Index_t, Index_t, unsigned short *, char *)"); }
+      virtual void get(Index_t, Index_t, unsigned int *, char * = 0) const
+        { unsupported("get(Index_t, Index_t, unsigned int *, char *)"); }
+      virtual void get(Index_t, Index_t, unsigned long *, char * = 0) const
+        { unsupported("get(Index_t, Index_t, unsigned long *, char *)"); }
+      virtual void get(Index_t, Index_t, signed long long *, char * = 0) const
+        { unsupported("get(Index_t, Index_t, signed long long *, char *)"); }
+      virtual void get(Index_t, Index_t, unsigned long long *, char * = 0) const
+        { unsupported("get(Index_t, Index_t, unsigned long long *, char *)"); }
+      virtual void get(Index_t, Index_t, bool *, char * = 0) const
+        { unsupported("get(Index_t, Index_t, bool *, char *)"); }
+      virtual void get(Index_t, Index_t, std::string *, char * = 0) const
+        { unsupported("get(Index_t, Index_t, std::string *, char *)"); }
+
       virtual void set(Index_t, const bool &) { unsupported("get(Index_t, bool &)"); }
       virtual void set(Index_t, const double &) { unsupported("set(Index_t, const double &)"); }
       virtual void set(Index_t, const float &) { unsupported("set(Index_t, const float &)"); }
@@ -71,6 +118,8 @@ namespace tip {
       virtual void set(Index_t, const unsigned short &) { unsupported("set(Index_t, const unsigned short &)"); }
       virtual void set(Index_t, const unsigned int &) { unsupported("set(Index_t, const unsigned int &)"); }
       virtual void set(Index_t, const unsigned long &) { unsupported("set(Index_t, const unsigned long &)"); }
+      virtual void set(Index_t, const signed long long &) { unsupported("set(Index_t, const signed long long &)"); }
+      virtual void set(Index_t, const unsigned long long &) { unsupported("set(Index_t, const unsigned long long &)"); }
       virtual void set(Index_t, const char *) { unsupported("set(Index_t, const char *)"); }
       virtual void set(Index_t, const std::string &) { unsupported("set(Index_t, const std::string &)"); }
       virtual void set(Index_t, const BitStruct &) { unsupported("get(Index_t, BitStruct &)"); }
@@ -95,11 +144,50 @@ namespace tip {
         { unsupported("set(Index_t, const std::vector<unsigned int> &)"); }
       virtual void set(Index_t, const std::vector<unsigned long> &)
         { unsupported("set(Index_t, const std::vector<unsigned long> &)"); }
+      virtual void set(Index_t, const std::vector<signed long long> &)
+        { unsupported("set(Index_t, const std::vector<signed long long> &)"); }
+      virtual void set(Index_t, const std::vector<unsigned long long> &)
+        { unsupported("set(Index_t, const std::vector<unsigned long long> &)"); }
       virtual void set(Index_t, const std::vector<std::string> &)
         { unsupported("set(Index_t, const std::vector<std::string> &)"); }
       virtual void set(Index_t, const std::vector<BitStruct> &)
         { unsupported("set(Index_t, const std::vector<BitStruct> &)"); }
 
+      /** \brief Set values in a contiguous range of records of a scalar column in one operation.
+          An implementation which just throws an exception is provided in the base class.
+          \param record_begin Index of the first record to write.
+          \param src_begin Pointer to the first input element.
+          \param src_end Pointer to one element past the last input element.
+          \param null_mask Optional array parallel to the input. Records for which it is non-0
+          are written as null (undefined) values.
+      */
+      virtual void set(Index_t, const double *, const double *, const char * = 0)
+        { unsupported("set(Index_t, const double *, const double *, const char *)"); }
+      virtual void set(Index_t, const float *, const float *, const char * = 0)
+        { unsupported("set(Index_t, const float *, const float *, const char *)"); }
+      virtual void set(Index_t, const char *, const char *, const char * = 0)
+        { unsupported("set(Index_t, const char *, const char *, const char *)"); }
+      virtual void set(Index_t, const signed char *, const signed char *, const char * = 0)
+        { unsupported("set(Index_t, const signed char *, const signed char *, const char *)"); }
+      virtual void set(Index_t, const signed short *, const signed short *, const char * = 0)
+        { unsupported("set(Index_t, const signed short *, const signed short *, const char *)"); }
+      virtual void set(Index_t, const signed int *, const signed int *, const char * = 0)
+        { unsupported("set(Index_t, const signed int *, const signed int *, const char *)"); }
+      virtual void set(Index_t, const signed long *, const signed long *, const char * = 0)
+        { unsupported("set(Index_t, const signed long *, const signed long *, const char *)"); }
+      virtual void set(Index_t, const unsigned char *, const unsigned char *, const char * = 0)
+        { unsupported("set(Index_t, const unsigned char *, const unsigned char *, const char *)"); }
+      virtual void set(Index_t, const unsigned short *, const unsigned short *, const char * = 0)
+        { unsupported("set(Index_t, const unsigned short *, const unsigned short *, const char *)"); }
+      virtual void set(Index_t, const unsigned int *, const unsigned int *, const char * = 0)
+        { unsupported("set(Index_t, const unsigned int *, const unsigned int *, const char *)"); }
+      virtual void set(Index_t, const unsigned long *, const unsigned long *, const char * = 0)
+        { unsupported("set(Index_t, const unsigned long *, const unsigned long *, const char *)"); }
+      virtual void set(Index_t, const signed long long *, const signed long long *, const char * = 0)
+        { unsupported("set(Index_t, const signed long long *, const signed long long *, const char *)"); }
+      virtual void set(Index_t, const unsigned long long *, const unsigned long long *, const char * = 0)
+        { unsupported("set(Index_t, const unsigned long long *, const unsigned long long *, const char *)"); }
+
       virtual bool isNull(Index_t) const { unsupported("isNull() const"); return true; }
       virtual bool getNull(Index_t, bool &) const { unsupported("getNull(Index_t, bool &) const"); return true; }
       virtual bool getNull(Index_t, std::vector<bool> &) const
@@ -110,6 +198,17 @@ namespace tip {
       */
       virtual void copy(const IColumn *, Index_t, Index_t) { unsupported("copy(const IColumn *, Index_t, Index_t)"); }
 
+      /** \brief Copy cells of the given records of another column into consecutive records of this column, which
+          must already exist. The default implementation copies one cell at a time.
+          \param src Pointer to the source column.
+          \param src_indices Indices of the cells in the source column, in the order they are to be copied.
+          \param dest_begin Index of the cell in this column which receives the first source cell.
+      */
+      virtual void copy(const IColumn * src, const std::vector<Index_t> & src_indices, Index_t dest_begin) {
+        for (std::vector<Index_t>::size_type index = 0; index != src_indices.size(); ++index)
+          copy(src, src_indices[index], dest_begin + Index_t(index));
+      }
+
       /** \brief Return a flag indicating whether this column holds scalar data.
       */
       virtual bool isScalar() const { return true; }
@@ -150,6 +249,19 @@ namespace tip {
       /// \brief Return a string identifying the full data type of the column.
       virtual std::string getFormat() const { unsupported("getFormat"); return ""; }
 
+      /** \brief Read scalar values of this column ahead in blocks of records, so that subsequent reads of
+          individual cells are served from memory. This is only a hint: the default implementation ignores it.
+          \param num_records The number of records to read at a time. 0 disables read-ahead.
+      */
+      virtual void setReadAhead(Index_t) const {}
+
+      /** \brief Get the number of cell reads which were (hits) and were not (misses) served from the read-ahead buffer.
+          \param num_hits The number of reads served from memory.
+          \param num_misses The number of reads which required the buffer to be refilled.
+      */
+      virtual void getReadAheadStats(unsigned long & num_hits, unsigned long & num_misses) const
+        { num_hits = 0; num_misses = 0; }
+
     protected:
       std::string m_units;
 
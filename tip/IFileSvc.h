@@ -13,6 +13,7 @@
 #include "tip/FileSummary.h"
 #include "tip/Header.h"
 #include "tip/Image.h"
+#include "tip/ImageCompression.h"
 #include "tip/TipFile.h" 
 
 namespace tip {
@@ -26,6 +27,14 @@ namespace tip {
   */
   class IFileSvc {
     public:
+      /** \brief When the CHECKSUM and DATASUM keywords of FITS extensions opened for writing are updated:
+                 eChecksumAlways updates every extension when it is closed, whether or not it changed;
+                 eChecksumModified updates only extensions which changed, rehashing only the header if the data did
+                 not change; eChecksumDeferred notes the extensions which changed, and leaves updating them to
+                 finalize.
+      */
+      enum ChecksumPolicy { eChecksumAlways, eChecksumModified, eChecksumDeferred };
+
       /** \brief Singleton access to I/O service objects. Deprecated: used instance() instead!
       */
       static IFileSvc & getSvc();
@@ -52,6 +61,122 @@ namespace tip {
       */
       static void setTmpFileName(const std::string & tmp_file_name);
 
+      /// \brief Return whether readTable maps unfiltered FITS tables into memory.
+      static bool getMapTables();
+
+      /** \brief Make readTable map the data of unfiltered FITS binary tables into memory, and read numeric fields
+                 directly from the mapping instead of through cfitsio. Tables which cannot be mapped, for example
+                 compressed files, are read through cfitsio as usual. Mapped tables cannot be filtered after they
+                 are opened. By default tables are not mapped.
+          \param map_tables Whether to map tables.
+      */
+      static void setMapTables(bool map_tables);
+
+      /// \brief Return whether readTable filters FITS tables through a row index.
+      static bool getFilterViews();
+
+      /** \brief Make readTable apply filters to FITS tables by evaluating the expression once and keeping the
+                 indices of the matching rows, instead of having cfitsio copy the matching rows into memory or
+                 a temporary file. The table returned reads the selected rows in place, and filterRows narrows
+                 the selection without changing the file. Its number of records cannot be changed. By default
+                 filters are applied by cfitsio.
+          \param filter_views Whether to filter through a row index.
+      */
+      static void setFilterViews(bool filter_views);
+
+      /// \brief Return whether filtered views evaluate expressions with TableFilter.
+      static bool getCompiledFilters();
+
+      /** \brief Make the views returned by readTable when setFilterViews is enabled evaluate their expressions with
+                 TableFilter, which reads the fields used in bulk and evaluates blocks of rows in parallel.
+                 Expressions which TableFilter does not support are still evaluated by cfitsio. Arithmetic is done
+                 in double precision, so unlike cfitsio, 5/2 is 2.5 even for integer fields. By default
+                 expressions are evaluated by cfitsio.
+          \param compiled_filters Whether to evaluate expressions with TableFilter.
+      */
+      static void setCompiledFilters(bool compiled_filters);
+
+      /// \brief Return the directory in which readTable caches the rows matching filters, or "" if none.
+      static const std::string & getIndexCacheDir();
+
+      /** \brief Make readTable keep the indices of the rows of FITS tables which match each filter in sidecar files
+                 in the given directory, and reuse them when the same file is read with the same filter again,
+                 instead of evaluating the expression again. Tables read this way are filtered views, as after
+                 setFilterViews(true). An entry is ignored, and replaced, if the size or modification time of the
+                 file, or the number of records or DATASUM keyword of the table, has changed since it was stored.
+                 The modification time is compared to the nanosecond where the file system records it, but on file
+                 systems which record only whole seconds, a file rewritten with the same size within the same second
+                 may not be seen to have changed; DATASUM is no help if checksums are deferred. Filters which read
+                 other files, such as gtifilter and regfilter, are not cached. The directory must exist. By default,
+                 and if dir_name is "", no cache is used.
+          \param dir_name The name of the directory.
+      */
+      static void setIndexCacheDir(const std::string & dir_name);
+
+      /// \brief Return the number of threads used to decompress tile-compressed images, 0 meaning one per core.
+      static unsigned int getImageThreads();
+
+      /** \brief Set the number of threads which decompress the tiles of large tile-compressed FITS images while they
+                 are read. Each thread reads whole tiles through its own file handle, so this has effect only if
+                 cfitsio was built to be thread safe (fits_is_reentrant). By default one thread per core is used;
+                 1 decompresses all tiles in the calling thread.
+          \param num_threads The number of threads, or 0 for one per core.
+      */
+      static void setImageThreads(unsigned int num_threads);
+
+      /// \brief Return the maximum number of FITS files kept open after they are closed, 0 meaning none.
+      static unsigned int getFilePoolSize();
+
+      /** \brief Set the maximum number of FITS files which are kept open after the last object using them is closed,
+                 so that opening them again, for example to list, classify and then read their extensions, reuses
+                 the open file and its buffers instead of opening it and parsing its headers again. Only plain file
+                 names, without cfitsio's extended syntax, are pooled. A file is reopened if it has changed on disk
+                 since it was last used, and files in the pool are flushed when the last object writing them is
+                 closed. The least recently used files are closed when the pool is full. By default, and if
+                 max_files is 0, no files are kept open.
+          \param max_files The maximum number of files.
+      */
+      static void setFilePoolSize(unsigned int max_files);
+
+      /** \brief Get the number of opens of pooled FITS files which found the file already open, and the number which
+                 had to open it.
+          \param num_hits The number of opens which found the file open.
+          \param num_misses The number of opens which opened the file.
+      */
+      static void getFilePoolStats(unsigned long & num_hits, unsigned long & num_misses);
+
+      /// \brief Return when the checksums of FITS extensions are updated.
+      static ChecksumPolicy getChecksumPolicy();
+
+      /** \brief Set when the checksums of FITS extensions opened for writing are updated. By default
+                 (eChecksumModified), appending an extension to a large file hashes only the new extension, not every
+                 extension in the file. With eChecksumDeferred, files whose checksums are stale until finalize is
+                 called must not be given to other programs before then.
+          \param policy The checksum policy.
+      */
+      static void setChecksumPolicy(ChecksumPolicy policy);
+
+      /** \brief Update the checksums of all extensions which changed while the checksum policy was
+                 eChecksumDeferred. Each extension is hashed once, however many times it was changed.
+      */
+      static void finalize();
+
+      /** \brief Return the number of bytes of FITS headers and data hashed so far to compute checksums, by which
+                 the savings of a checksum policy can be measured.
+      */
+      static unsigned long long getNumChecksumBytes();
+
+      /// \brief Return the number of threads used to sum the data of FITS extensions, 0 meaning one per core.
+      static unsigned int getChecksumThreads();
+
+      /** \brief Set the number of threads which sum the data of large FITS extensions when their DATASUM keywords
+                 are computed. Each thread sums whole records of at least about 4 MB, in place in the file, so only
+                 data units of several such blocks use more than one. By default one thread per core is used; 1
+                 sums every data unit in the calling thread.
+          \param num_threads The number of threads, or 0 for one per core.
+      */
+      static void setChecksumThreads(unsigned int num_threads);
+
       /** \brief Destruct an I/O service object.
       */
       virtual ~IFileSvc();
@@ -63,6 +188,18 @@ namespace tip {
       */
       virtual void createFile(const std::string & file_name, const std::string & template_name = "", bool clobber = true);
 
+      /** \brief Create a new FITS file whose primary array is an image of the given type and dimensions.
+          \param file_name The name of the new file.
+          \param pixel_type The type in which pixels are stored, which sets BITPIX.
+          \param dims Set of dimensions of each axis of the image; empty for a primary array with no data.
+          \param scale The value of the BSCALE keyword, by which stored values are multiplied when they are read.
+          \param zero The value of the BZERO keyword, which is added to stored values after scaling.
+          \param clobber Should existing files be overwritten?
+      */
+      virtual void createFile(const std::string & file_name, ImageBase::PixelType pixel_type,
+        const ImageBase::PixelCoordinate & dims = ImageBase::PixelCoordinate(), double scale = 1., double zero = 0.,
+        bool clobber = true);
+
       /** \brief Use a FITS template to create a new file in memory.
           \param file_name The name of the new file.
           \param template_name The name of the template file.
@@ -84,6 +221,33 @@ namespace tip {
       virtual void appendImage(const std::string & file_name, const std::string & image_name,
         const ImageBase::PixelCoordinate & dims);
 
+      /** \brief Append a new tile-compressed image extension in a file. If the file does not exist, it will be
+                 created with an empty primary image extension, because compressed images are stored in tables.
+          \param file_name The name of the new file.
+          \param image_name The name of the new image extension.
+          \param dims Set of dimensions of each axis of the image.
+          \param compression How the image is compressed.
+      */
+      virtual void appendImage(const std::string & file_name, const std::string & image_name,
+        const ImageBase::PixelCoordinate & dims, const ImageCompression & compression);
+
+      /** \brief Append a new image extension whose pixels are stored in the given type, and optionally scaled and
+                 compressed. For example, counts maps may be stored as 16-bit integers, and exposure cubes as doubles.
+                 If the file does not exist, it will be created with its primary image extension named with the
+                 image name, unless the image is compressed.
+          \param file_name The name of the new file.
+          \param image_name The name of the new image extension.
+          \param dims Set of dimensions of each axis of the image.
+          \param pixel_type The type in which pixels are stored, which sets BITPIX.
+          \param scale The value of the BSCALE keyword, by which stored values are multiplied when they are read.
+          \param zero The value of the BZERO keyword, which is added to stored values after scaling. For example,
+                 16-bit integers with zero = 32768 store unsigned values.
+          \param compression How the image is compressed.
+      */
+      virtual void appendImage(const std::string & file_name, const std::string & image_name,
+        const ImageBase::PixelCoordinate & dims, ImageBase::PixelType pixel_type, double scale = 1., double zero = 0.,
+        const ImageCompression & compression = ImageCompression());
+
       /** \brief Append a new table extension in a file. If the file does not exist, it will be created with
                  an empty primary image extension.
           \param file_name The name of the new file.
@@ -132,6 +296,26 @@ namespace tip {
       virtual TypedImage<int> * editImageInt(const std::string & file_name, const std::string & table_name,
         const std::string & filter = "");
 
+      /** \brief Open an existing image with modification access. Each pixel is treated as a 64-bit long long,
+          so that 64-bit integer (BITPIX = 64) images are read and written without loss of precision.
+          \param file_name The name of the file (any supported format OK).
+          \param table_name The name of the table.
+          \param filter Filtering string.
+      */
+      virtual TypedImage<long long> * editImageLongLong(const std::string & file_name, const std::string & table_name,
+        const std::string & filter = "");
+
+      /** \brief Open an existing image with modification access. Each pixel is converted to and from type T, which
+          may be unsigned char, short, unsigned short, int, long long, float or double, whatever type the pixels are
+          stored in. Reading pixels stored in a type no larger than T avoids converting them twice.
+          \param file_name The name of the file (any supported format OK).
+          \param image_name The name of the image.
+          \param filter Filtering string.
+      */
+      template <typename T>
+      TypedImage<T> * editImage(const std::string & file_name, const std::string & image_name,
+        const std::string & filter = "");
+
       /** \brief Open an existing table with modification access.
           \param file_name The name of the file (any supported format OK).
           \param table_name The name of the table.
@@ -181,6 +365,24 @@ namespace tip {
       virtual const TypedImage<int> * readImageInt(const std::string & file_name, const std::string & table_name,
         const std::string & filter = "");
 
+      /** \brief Open an existing image without modification access. Each pixel is treated as a 64-bit long long.
+          \param file_name The name of the file (any supported format OK).
+          \param table_name The name of the table.
+          \param filter Filtering string.
+      */
+      virtual const TypedImage<long long> * readImageLongLong(const std::string & file_name,
+        const std::string & table_name, const std::string & filter = "");
+
+      /** \brief Open an existing image without modification access. Each pixel is converted to type T, which
+          may be unsigned char, short, unsigned short, int, long long, float or double.
+          \param file_name The name of the file (any supported format OK).
+          \param image_name The name of the image.
+          \param filter Filtering string.
+      */
+      template <typename T>
+      const TypedImage<T> * readImage(const std::string & file_name, const std::string & image_name,
+        const std::string & filter = "");
+
       /** \brief Open an existing table without modification access.
           \param file_name The name of the file (any supported format OK).
           \param table_name The name of the table.
@@ -189,6 +391,17 @@ namespace tip {
       virtual const Table * readTable(const std::string & file_name, const std::string & table_name,
         const std::string & filter = "");
 
+      /** \brief Open an existing table without modification access, setting up only the fields which will be used.
+          Other fields remain accessible, but are set up the first time they are used. This makes opening
+          tables with many fields much faster when only a few of them are read.
+          \param file_name The name of the file (any supported format OK).
+          \param table_name The name of the table.
+          \param filter Filtering string.
+          \param fields The names of the fields which will be used.
+      */
+      virtual const Table * readTable(const std::string & file_name, const std::string & table_name,
+        const std::string & filter, const std::vector<std::string> & fields);
+
       /** \brief Obtain summary of the file's contents.
           \param file_name The name of the file.
           \param summary The summary object to fill.
@@ -24,6 +24,16 @@ namespace tip {
       typedef std::vector<PixOrd_t> PixelCoordinate;
       typedef std::vector<std::pair<PixOrd_t, PixOrd_t> > PixelCoordRange;
 
+      /// \brief The types in which the pixels of new images are stored, with the values of the BITPIX keyword.
+      enum PixelType {
+        eByte = 8, ///< 8-bit unsigned integers.
+        eShort = 16, ///< 16-bit integers.
+        eInt = 32, ///< 32-bit integers.
+        eLongLong = 64, ///< 64-bit integers.
+        eFloat = -32, ///< Single precision floating point.
+        eDouble = -64 ///< Double precision floating point.
+      };
+
       /** \brief Destructor. Closes image if it is open.
       */
       virtual ~ImageBase() {}
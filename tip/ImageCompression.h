@@ -0,0 +1,92 @@
+/** \file ImageCompression.h
+    \brief Description of how the pixels of a new image are to be tile-compressed.
+*/
+#ifndef tip_ImageCompression_h
+#define tip_ImageCompression_h
+
+#include "tip/Image.h"
+
+namespace tip {
+  /** \class ImageCompression
+      \brief Describes how a new image is compressed: the algorithm, the shape of the tiles which are compressed
+      separately, and, for floating point images, how values are quantized. Compressed images are stored as
+      binary tables following the FITS tiled image convention, but are read and written as images, and cfitsio
+      only decompresses the tiles holding the pixels read.
+
+      Floating point pixels are stored losslessly by default, which is only possible with GZIP. With the other
+      algorithms, a quantization level q must be given: values are then rounded to multiples of the noise in each
+      tile divided by q, which is lossy, but much more compact.
+
+      \code
+        // Compress an exposure cube one energy plane per tile.
+        ImageBase::PixelCoordinate tile_shape(dims);
+        tile_shape[2] = 1;
+        IFileSvc::instance().appendImage("expcube.fits", "EXPOSURE", dims,
+          ImageCompression(ImageCompression::eGzip2, tile_shape));
+      \endcode
+  */
+  class ImageCompression {
+    public:
+      /// \brief The compression algorithms.
+      enum Algorithm {
+        eNone, ///< Store pixels uncompressed.
+        eRice, ///< Rice coding; fast, and good for integer and quantized floating point pixels.
+        eGzip, ///< GZIP.
+        eGzip2, ///< GZIP after shuffling the bytes of the pixels, which helps floating point pixels.
+        eHCompress, ///< H-transform coding of two-dimensional tiles; may be lossy for integer pixels.
+        ePlio ///< IRAF PLIO coding, for integer masks with values below 2^24.
+      };
+
+      /** \brief Describe a compression.
+          \param algorithm The compression algorithm.
+          \param tile_shape The size of the tiles along each axis; empty selects one row of the image per tile.
+      */
+      ImageCompression(Algorithm algorithm = eNone,
+        const ImageBase::PixelCoordinate & tile_shape = ImageBase::PixelCoordinate());
+
+      /// \brief Return the compression algorithm.
+      Algorithm getAlgorithm() const;
+
+      /// \brief Return whether the image is to be compressed at all.
+      bool isCompressed() const;
+
+      /// \brief Return the size of the tiles along each axis, or an empty shape for one row per tile.
+      const ImageBase::PixelCoordinate & getTileShape() const;
+
+      /// \brief Return the level at which floating point pixels are quantized, or 0 if they are stored losslessly.
+      float getQuantizeLevel() const;
+
+      /** \brief Set the level at which floating point pixels are quantized. Negative levels give the spacing of
+          quantized values directly, rather than as a fraction of the noise.
+          \param quantize_level The level, or 0 to store floating point pixels losslessly.
+      */
+      void setQuantizeLevel(float quantize_level);
+
+      /// \brief Return the scale of HCOMPRESS, 0 for lossless compression.
+      float getHCompressScale() const;
+
+      /** \brief Set the scale of HCOMPRESS, in units of the noise of each tile if positive, absolute if negative.
+          \param scale The scale, or 0 for lossless compression.
+      */
+      void setHCompressScale(float scale);
+
+      /// \brief Return whether HCOMPRESS smooths images while decompressing them.
+      bool getHCompressSmooth() const;
+
+      /** \brief Set whether HCOMPRESS smooths images while decompressing them, which reduces artifacts when the
+          scale is not 0.
+          \param smooth Whether to smooth.
+      */
+      void setHCompressSmooth(bool smooth);
+
+    private:
+      Algorithm m_algorithm;
+      ImageBase::PixelCoordinate m_tile_shape;
+      float m_quantize_level;
+      float m_hcompress_scale;
+      bool m_hcompress_smooth;
+  };
+
+}
+
+#endif
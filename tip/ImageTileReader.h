@@ -0,0 +1,213 @@
+/** \file ImageTileReader.h
+
+    \brief Reads an image one N-dimensional tile at a time, optionally reading ahead in another thread.
+*/
+#ifndef tip_ImageTileReader_h
+#define tip_ImageTileReader_h
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "tip/Image.h"
+#include "tip/TipException.h"
+#include "tip/tip_types.h"
+
+namespace tip {
+
+  /** \class ImageTileReader
+
+      \brief Reads the whole of an image as a sequence of tiles of a given shape, so that images far larger than
+      memory can be processed with one tile-sized buffer. Tiles are read in storage order, that is, with the first
+      axis varying fastest; tiles at the upper edges of the image are smaller if the shape does not divide the image.
+      Each tile is read with one subset read (fits_read_subset for FITS images) straight into the caller's buffer.
+
+      With a prefetch depth greater than 0, another thread reads up to that many tiles ahead while the caller
+      processes the current one, so computation and reading overlap. Buffers are then exchanged with the caller's
+      rather than copied, so no more than prefetch + 1 tile buffers exist at any time. While such a reader exists,
+      the image must not be used by the caller, and tip must not be used in other threads unless cfitsio is thread
+      safe (see fits_is_reentrant).
+
+      \code
+        // Sum an exposure cube one energy plane at a time.
+        ImageBase::PixelCoordinate shape(image->getImageDimensions());
+        shape[2] = 1;
+        ImageTileReader<float> reader(*image, shape, 1);
+        std::vector<float> plane;
+        while (reader.next(plane)) total[reader.getRange()[2].first] += sum(plane);
+      \endcode
+  */
+  template <typename T>
+  class ImageTileReader {
+    public:
+      /** \brief Create a reader for the given image, which must outlive the reader.
+          \param image The image.
+          \param tile_shape The size of the tiles along each axis of the image; 0 selects the whole axis.
+          \param prefetch The number of tiles to read ahead in another thread; 0 reads each tile when it is requested.
+      */
+      ImageTileReader(const TypedImage<T> & image, const ImageBase::PixelCoordinate & tile_shape,
+        unsigned int prefetch = 0);
+
+      /** \brief Destructor. Stops reading ahead.
+      */
+      ~ImageTileReader();
+
+      /** \brief Read the next tile into the given buffer, whose memory is reused when possible. Return false, without
+          changing the buffer, once all tiles have been read.
+          \param tile The buffer, resized to the number of pixels in the tile, with the first axis varying fastest.
+      */
+      bool next(std::vector<T> & tile);
+
+      /** \brief Return the pixels covered by the tile returned most recently, as ranges from the first pixel to one
+          past the last along each axis.
+      */
+      const ImageBase::PixelCoordRange & getRange() const { return m_range; }
+
+      /** \brief Return the total number of tiles in the image.
+      */
+      PixOrd_t getNumTiles() const { return m_num_tiles; }
+
+    private:
+      typedef std::pair<ImageBase::PixelCoordRange, std::vector<T> > Tile_t;
+
+      // Readers are not copied.
+      ImageTileReader(const ImageTileReader &);
+      ImageTileReader & operator =(const ImageTileReader &);
+
+      /** \brief Compute the pixels covered by a tile.
+          \param tile_number The number of the tile, in storage order.
+          \param range The output ranges of pixels.
+      */
+      void getTileRange(PixOrd_t tile_number, ImageBase::PixelCoordRange & range) const;
+
+      /** \brief Read tiles ahead of the caller, until all have been read or the reader is destroyed.
+      */
+      void readAhead();
+
+      const TypedImage<T> & m_image;
+      ImageBase::PixelCoordinate m_dims;
+      ImageBase::PixelCoordinate m_shape;
+      ImageBase::PixelCoordRange m_range;
+      PixOrd_t m_num_tiles;
+      PixOrd_t m_num_delivered;
+      unsigned int m_prefetch;
+      std::thread m_thread;
+      std::mutex m_mutex;
+      std::condition_variable m_changed;
+      std::deque<Tile_t> m_ready;
+      std::vector<std::vector<T> > m_free;
+      std::exception_ptr m_error;
+      bool m_stop;
+  };
+
+  template <typename T>
+  inline ImageTileReader<T>::ImageTileReader(const TypedImage<T> & image, const ImageBase::PixelCoordinate & tile_shape,
+    unsigned int prefetch): m_image(image), m_dims(image.getImageDimensions()), m_shape(tile_shape), m_range(),
+    m_num_tiles(1), m_num_delivered(0), m_prefetch(prefetch), m_thread(), m_mutex(), m_changed(), m_ready(), m_free(),
+    m_error(), m_stop(false) {
+    if (m_shape.size() != m_dims.size())
+      throw TipException("ImageTileReader: the tile shape does not have one size per image axis");
+    for (ImageBase::PixelCoordinate::size_type axis = 0; axis != m_dims.size(); ++axis) {
+      if (0 >= m_shape[axis] || m_shape[axis] > m_dims[axis]) m_shape[axis] = m_dims[axis];
+      m_num_tiles *= 0 < m_shape[axis] ? (m_dims[axis] + m_shape[axis] - 1) / m_shape[axis] : 0;
+    }
+    if (m_dims.empty()) m_num_tiles = 0;
+    if (0 != m_prefetch && 0 != m_num_tiles) m_thread = std::thread(&ImageTileReader::readAhead, this);
+  }
+
+  template <typename T>
+  inline ImageTileReader<T>::~ImageTileReader() {
+    if (m_thread.joinable()) {
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+      }
+      m_changed.notify_all();
+      m_thread.join();
+    }
+  }
+
+  template <typename T>
+  inline bool ImageTileReader<T>::next(std::vector<T> & tile) {
+    if (m_num_delivered == m_num_tiles) return false;
+
+    if (0 == m_prefetch) {
+      getTileRange(m_num_delivered, m_range);
+      m_image.get(m_range, tile);
+      ++m_num_delivered;
+      return true;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_changed.wait(lock, [this] { return !m_ready.empty() || m_error; });
+    if (m_ready.empty()) std::rethrow_exception(m_error);
+
+    // Hand over the tile, and give the caller's old buffer to the reading thread to reuse.
+    Tile_t & ready(m_ready.front());
+    m_range.swap(ready.first);
+    tile.swap(ready.second);
+    m_free.push_back(std::vector<T>());
+    m_free.back().swap(ready.second);
+    m_ready.pop_front();
+    ++m_num_delivered;
+    lock.unlock();
+    m_changed.notify_all();
+    return true;
+  }
+
+  template <typename T>
+  inline void ImageTileReader<T>::getTileRange(PixOrd_t tile_number, ImageBase::PixelCoordRange & range) const {
+    range.resize(m_dims.size());
+    for (ImageBase::PixelCoordinate::size_type axis = 0; axis != m_dims.size(); ++axis) {
+      PixOrd_t num_tiles = (m_dims[axis] + m_shape[axis] - 1) / m_shape[axis];
+      PixOrd_t begin = (tile_number % num_tiles) * m_shape[axis];
+      range[axis].first = begin;
+      range[axis].second = m_dims[axis] - begin < m_shape[axis] ? m_dims[axis] : begin + m_shape[axis];
+      tile_number /= num_tiles;
+    }
+  }
+
+  template <typename T>
+  inline void ImageTileReader<T>::readAhead() {
+    for (PixOrd_t tile_number = 0; tile_number != m_num_tiles; ++tile_number) {
+      Tile_t tile;
+      {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_changed.wait(lock, [this] { return m_stop || m_ready.size() < m_prefetch; });
+        if (m_stop) return;
+        if (!m_free.empty()) {
+          tile.second.swap(m_free.back());
+          m_free.pop_back();
+        }
+      }
+
+      // Read without holding the lock, so the caller can take tiles which are already read.
+      try {
+        getTileRange(tile_number, tile.first);
+        m_image.get(tile.first, tile.second);
+      } catch (...) {
+        {
+          std::lock_guard<std::mutex> lock(m_mutex);
+          m_error = std::current_exception();
+        }
+        m_changed.notify_all();
+        return;
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_ready.push_back(Tile_t());
+        m_ready.back().first.swap(tile.first);
+        m_ready.back().second.swap(tile.second);
+      }
+      m_changed.notify_all();
+    }
+  }
+
+}
+
+#endif
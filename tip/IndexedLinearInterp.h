@@ -0,0 +1,153 @@
+/** \file IndexedLinearInterp.h
+
+    \brief Utility to interpolate values in tables, searching an in-memory copy of the field used to interpolate.
+    Table must be ordered on the field used to interpolate.
+*/
+#ifndef tip_IndexedLinearInterp_h
+#define tip_IndexedLinearInterp_h
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "tip/Table.h"
+#include "tip/tip_types.h"
+
+namespace tip {
+
+  /** \class IndexedLinearInterp
+
+      \brief Drop-in replacement for LinearInterp for large tables, such as interpolating spacecraft position
+      from an FT2 file at the time of every event. The first interpolation on a field reads the whole field
+      in one bulk read, and each interpolation then finds its interval by binary search, or in constant time
+      when values are interpolated in increasing order. The two records used by the most recent interpolation
+      are kept in memory for each field retrieved with get, so that nearby interpolations do not read them again.
+
+      Results, and the errors reported for values out of range, are the same as for LinearInterp. The table must
+      not change while the interpolator is in use. Interpolators which derive from this class, such as
+      HermiteInterp, override get and the batch form of interpolate, so that they may be used through a
+      reference to this class.
+  */
+  class IndexedLinearInterp {
+    public:
+      /** \brief Create an interpolator for the given range of records.
+          \param begin Iterator pointing to the first record.
+          \param end Iterator pointing to the record after the last record.
+      */
+      IndexedLinearInterp(const Table::ConstIterator & begin, const Table::ConstIterator & end);
+
+      virtual ~IndexedLinearInterp() {}
+
+      /** \brief Find the records on either side of the given value of a scalar field, and compute the coefficients
+          for interpolating other fields. The field must not decrease from one record to the next.
+          \param field The name of the field to interpolate on.
+          \param value The value of that field at which to interpolate.
+      */
+      void interpolate(const std::string & field, double value);
+
+      /** \brief Return the interpolated value of a scalar field.
+          \param field The name of the field.
+      */
+      virtual double get(const std::string & field) const;
+
+      /** \brief Compute the interpolated values of a vector field.
+          \param field The name of the field.
+          \param value The interpolated values.
+      */
+      virtual void get(const std::string & field, std::vector<double> & value) const;
+
+      /** \brief Interpolate several fields at many values of the field to interpolate on, in one call. The values
+          may be in any order, but are handled fastest when they increase. Errors are the same as for interpolate,
+          and are reported before any result is computed. This does not change the state used by get.
+          \param field The name of the field to interpolate on.
+          \param values The values of that field at which to interpolate.
+          \param fields The names of the fields to interpolate, scalar or vector.
+          \param results One array for each field in fields. For a field with n elements, element j of the result
+          for values[i] is results[field][i * n + j].
+      */
+      virtual void interpolate(const std::string & field, const std::vector<double> & values,
+        const Table::FieldCont & fields, std::vector<std::vector<double> > & results);
+
+    protected:
+      /** \brief Return the table being interpolated.
+      */
+      const Table * getTable() const { return m_table; }
+
+      /** \brief Return the index of the first record of the range.
+      */
+      Index_t getBeginIndex() const { return m_begin_index; }
+
+      /** \brief Return the number of records in the range.
+      */
+      Index_t getNumRecords() const { return m_num_records; }
+
+      /** \brief Return the index of the field last interpolated on, or -1 if there is none.
+      */
+      FieldIndex_t getAbscissaIndex() const { return m_abscissa_index; }
+
+      /** \brief Return the values of the field last interpolated on, one for each record of the range.
+      */
+      const std::vector<double> & getAbscissa() const { return m_abscissa; }
+
+      /** \brief Return the position in the range of the record before the value last interpolated.
+      */
+      Index_t getInterval() const;
+
+      /** \brief Return the position of the value last interpolated within its interval, from 0 to 1.
+      */
+      double getFraction() const { return m_coeff[1]; }
+
+      /** \brief Return the values of one field in one of the records last matched.
+          \param field The name of the field.
+          \param which 0 for the record before the value, 1 for the record after it.
+      */
+      const std::vector<double> & getRecord(const std::string & field, int which) const { return getRow(field, which); }
+
+    private:
+      /** \brief The most recently used records of one field, read as double.
+      */
+      struct RowCache {
+        RowCache() { m_record[0] = m_record[1] = -1; }
+        Index_t m_record[2];
+        std::vector<double> m_value[2];
+      };
+
+      /** \brief Read the given field into memory, unless it is already there.
+          \param field_index The index of the field.
+          \param field The name of the field.
+      */
+      void loadAbscissa(FieldIndex_t field_index, const std::string & field);
+
+      /** \brief Return the offset of the first record whose abscissa is greater than the given value.
+          \param value The value.
+      */
+      Index_t findAfter(double value) const;
+
+      /** \brief Return the values of one of the records last matched, reading them if they are not in memory.
+          \param field The name of the field.
+          \param which 0 for the record before the value, 1 for the record after it.
+      */
+      const std::vector<double> & getRow(const std::string & field, int which) const;
+
+      /** \brief Return the values of a record of a column, reading them into the cache if they are not there.
+          \param column The column.
+          \param record The index of the record.
+          \param keep The index of another record which should stay in the cache.
+          \param cache The cache.
+      */
+      static const std::vector<double> & fetchRow(const IColumn * column, Index_t record, Index_t keep, RowCache & cache);
+
+      const Table * m_table;
+      Index_t m_begin_index;
+      Index_t m_num_records;
+      FieldIndex_t m_abscissa_index;
+      std::vector<double> m_abscissa;
+      Index_t m_cursor;
+      Index_t m_match[2];
+      double m_coeff[2];
+      mutable std::map<FieldIndex_t, RowCache> m_rows;
+  };
+
+}
+
+#endif
@@ -7,9 +7,11 @@
 #ifndef tip_Table_h
 #define tip_Table_h
 
+#include <algorithm>
 #include <cassert>
 #include <map>
 #include <string>
+#include <vector>
 
 #include "tip/Extension.h"
 #include "tip/IColumn.h"
@@ -24,6 +26,40 @@ namespace tip {
   class ConstTableRecord;
   class Table;
 
+  /** \class TableFieldHandle
+
+      \brief A field of a particular table, looked up by name once so that its cells may then be accessed
+      in records without any further work with strings. Obtain one from Table::getFieldHandle.
+  */
+  class TableFieldHandle {
+    public:
+      /** \brief Construct a handle which does not refer to any field. Such a handle may be assigned later.
+      */
+      TableFieldHandle(): m_table(0), m_name(), m_index(-1) {}
+
+      /** \brief Construct a handle referring to the given field of the given table.
+          \param table The table containing the field.
+          \param name The name of the field.
+          \param index The index of the field in the table, as returned by Table::getFieldIndex.
+      */
+      TableFieldHandle(const Table * table, const std::string & name, FieldIndex_t index): m_table(table), m_name(name),
+        m_index(index) {}
+
+      /// \brief Return the table containing the field.
+      const Table * getTable() const { return m_table; }
+
+      /// \brief Return the name of the field.
+      const std::string & getName() const { return m_name; }
+
+      /// \brief Return the index of the field in the table.
+      FieldIndex_t getIndex() const { return m_index; }
+
+    private:
+      const Table * m_table;
+      std::string m_name;
+      FieldIndex_t m_index;
+  };
+
   /** \class TableCell
 
       \brief Encapsulation of a single table cell, which may contain (in principle) any type of object.
@@ -58,6 +94,16 @@ namespace tip {
       template <typename T>
       void get(Index_t src_begin, Index_t src_end, T * dest_begin) const;
 
+      /** \brief Get values of this scalar field from a block of consecutive records in a single read operation,
+          starting with the record at the current iterator position.
+          The type of the converted sequence is given by the template parameter.
+          \param num_records The number of records to read.
+          \param dest_begin Pointer to the first element in the destination sequence. The caller
+          is responsible for making sure adequate space is allocated.
+      */
+      template <typename T>
+      void get(Index_t num_records, T * dest_begin) const;
+
       /** \brief Get a single value from this TableCell at the current iterator position as a double.
           (One can also use the templated get(double & value) above).
       */
@@ -72,6 +118,17 @@ namespace tip {
       template <typename T>
       void set(const T * src_begin, const T * src_end, Index_t dest_begin);
 
+      /** \brief Set values of this scalar field in a block of consecutive records in a single write operation,
+          starting with the record at the current iterator position.
+          The type of the source sequence is given by the template parameter.
+          \param num_records The number of records to write.
+          \param src_begin Pointer to the first input element.
+          \param null_mask Optional array parallel to the input. Records for which it is non-0
+          are written as null (undefined) values.
+      */
+      template <typename T>
+      void set(Index_t num_records, const T * src_begin, const char * null_mask = 0);
+
       /** \brief Set a single value in this TableCell at the current iterator position.
           The type of the source value is given by the template parameter.
           \param value The current value.
@@ -111,16 +168,18 @@ namespace tip {
       /** \brief Construct a ConstTableRecord object, without immediate association with a tabular data object
           Such an association may be formed later by assignment.
       */
-      ConstTableRecord(): m_cells(), m_tab_data(0), m_index(0) {}
+      ConstTableRecord(): m_cells(), m_indexed_cells(), m_tab_data(0), m_index(0) {}
 
       /** \brief Construct a ConstTableRecord object, without immediate association with a tabular data object
           Such an association may be formed later by assignment.
       */
-      ConstTableRecord(const ConstTableRecord & rec): m_cells(), m_tab_data(rec.m_tab_data), m_index(rec.m_index) {}
+      ConstTableRecord(const ConstTableRecord & rec): m_cells(), m_indexed_cells(), m_tab_data(rec.m_tab_data),
+        m_index(rec.m_index) {}
 
       /** \brief Construct a ConstTableRecord object, associated with the given data object and record index.
       */
-      ConstTableRecord(Table * tab_data, Index_t index): m_cells(), m_tab_data(tab_data), m_index(index) {}
+      ConstTableRecord(Table * tab_data, Index_t index): m_cells(), m_indexed_cells(), m_tab_data(tab_data),
+        m_index(index) {}
 
       /** \brief Assignment operator. Note that this behaves somewhat unusually!
 
@@ -143,6 +202,12 @@ namespace tip {
       */
       const TableCell & operator [](const std::string & field) const { return find_or_make(field); }
 
+      /** \brief Return a const TableCell object for the field identified by the given handle, without
+          looking up the field by name. The handle must have been obtained from the table this record belongs to.
+          \param field The handle of the field.
+      */
+      const TableCell & operator [](const TableFieldHandle & field) const { return find_or_make(field); }
+
       // Client code should not normally need to call methods below here, but they are
       // public because cell and iterator abstractions need to call them.
       // Get the current record index and tab_data.
@@ -170,7 +235,11 @@ namespace tip {
     protected:
       TableCell & find_or_make(const std::string & field) const;
 
+      TableCell & find_or_make(const TableFieldHandle & field) const;
+
       CellCont_t m_cells;
+      // Cells in m_cells which have been accessed by handle, indexed by field index.
+      std::vector<TableCell *> m_indexed_cells;
       Table * m_tab_data;
       Index_t m_index;
   };
@@ -234,6 +303,19 @@ namespace tip {
           \param field The name of the TableCell object (the field in this ConstTableRecord).
       */
       const TableCell & operator [](const std::string & field) const { return find_or_make(field); }
+
+      /** \brief Return a TableCell object for the field identified by the given handle, without
+          looking up the field by name. The handle must have been obtained from the table this record belongs to.
+          \param field The handle of the field.
+      */
+      TableCell & operator [](const TableFieldHandle & field) { return find_or_make(field); }
+
+      /** \brief Return a const TableCell object for the field identified by the given handle, without
+          looking up the field by name. This duplicates the method in the base class for the same reason
+          as operator [](const std::string &) const.
+          \param field The handle of the field.
+      */
+      const TableCell & operator [](const TableFieldHandle & field) const { return find_or_make(field); }
   };
 }
 
@@ -272,6 +354,10 @@ namespace tip {
       */
       typedef std::vector<std::string> FieldCont;
 
+      /** \brief Handle of a field, looked up once for fast repeated access to cells in that field.
+      */
+      typedef TableFieldHandle FieldHandle;
+
       /** \brief Helper type: auxilliary Cell access through a type which behaves like a primitive,
           but is connected to the table cell.
           WARNING: This class is deprecated. Don't start using it!
@@ -340,6 +426,85 @@ namespace tip {
       */
       virtual FieldIndex_t getFieldIndex(const std::string & field_name) const = 0;
 
+      /** \brief Look up a field by name once, returning a handle which may be used to access cells of that
+          field in this table's records without looking it up again, e.g. (*itor)[handle].get(value).
+          \param field_name The name of the field.
+      */
+      FieldHandle getFieldHandle(const std::string & field_name) const;
+
+      /** \brief Get values of a scalar field from a contiguous range of records in a single read operation.
+          This is much faster than reading the same values one record at a time through an iterator.
+          \param field_name The name of the field.
+          \param record_begin Index of the first record to read.
+          \param record_end Index of the record after the last record to read.
+          \param dest_begin Pointer to the first element in the destination sequence. The caller
+          is responsible for making sure adequate space is allocated.
+      */
+      template <typename T>
+      void get(const std::string & field_name, Index_t record_begin, Index_t record_end, T * dest_begin) const;
+
+      /** \brief Set values of a scalar field in a contiguous range of records in a single write operation.
+          The records must already exist; use setNumRecords to extend the table first if necessary.
+          \param field_name The name of the field.
+          \param record_begin Index of the first record to write.
+          \param src_begin Pointer to the first input element.
+          \param src_end Pointer to one element past the last input element.
+          \param null_mask Optional array parallel to the input. Records for which it is non-0
+          are written as null (undefined) values.
+      */
+      template <typename T>
+      void set(const std::string & field_name, Index_t record_begin, const T * src_begin, const T * src_end,
+        const char * null_mask = 0);
+
+      /** \brief Get all values of a scalar field, reading them in blocks of the size which is optimal for
+          the underlying file. Null values are given the undefined value for T.
+          \param field_name The name of the field.
+          \param dest The output vector, which will be resized to hold one value per record.
+      */
+      template <typename T>
+      void getColumnData(const std::string & field_name, std::vector<T> & dest) const;
+
+      /** \brief Get all values of a scalar field, replacing null values with the given value.
+          \param field_name The name of the field.
+          \param dest The output vector, which will be resized to hold one value per record.
+          \param null_value The value to use for records whose value is null.
+      */
+      template <typename T>
+      void getColumnData(const std::string & field_name, std::vector<T> & dest, const T & null_value) const;
+
+      /** \brief Get all values of a scalar field, and flags indicating which values are null.
+          \param field_name The name of the field.
+          \param dest The output vector, which will be resized to hold one value per record.
+          \param null_flags The output flags, one per record, true for records whose value is null.
+      */
+      template <typename T>
+      void getColumnData(const std::string & field_name, std::vector<T> & dest, std::vector<bool> & null_flags) const;
+
+      /** \brief Get all values of a scalar field one block at a time, passing each block to the given function
+          object, so that the whole column never needs to be held in memory at once. Null values are given the
+          undefined value for T.
+          \param field_name The name of the field.
+          \param buffer The buffer to fill repeatedly.
+          \param buffer_size The number of values the buffer holds.
+          \param func Function object, called as func(record_begin, record_end, buffer) after each block of
+          records is read into the buffer. It may be a lambda or other temporary; a named function object is used
+          itself, not a copy, so that it keeps what it gathers.
+      */
+      template <typename T, typename Func>
+      void getColumnData(const std::string & field_name, T * buffer, Index_t buffer_size, Func && func) const;
+
+      /** \brief Return the number of records which is most efficient to read or write at once. The default
+          implementation returns a fixed number which is reasonable for tables in memory.
+      */
+      virtual Index_t getOptimalNumRecords() const { return 65536; }
+
+      /** \brief Open another read-only instance of this table, with its own file handle, which may be read in
+          another thread while this table is being used. Returns 0 if this is not possible, which is what the
+          default implementation does. The caller owns the new table. See TableScan.
+          \param fields Names of fields to set up when the table is opened. If empty, all fields are set up.
+      */
+      virtual Table * openReader(const FieldCont & = FieldCont()) const { return 0; }
+
       /** \brief Copy a cell from a source extension data object to a cell in this object.
           \param src_ext The source extension data object.
           \param src_field The field identifier in the source data object.
@@ -357,6 +522,19 @@ namespace tip {
       */
       virtual void copyRecord(const Table * src_ext, Index_t src_record, Index_t dest_record) = 0;
 
+      /** \brief Copy the given records of a source table, in order, into consecutive records of this table starting
+          at dest_first_record, adding records to this table, all at once, if it has too few. As with copyRecord,
+          every field of this table is copied from the field of the same name in the source. This is much faster
+          than copying records one at a time: FITS tables copy rows as raw bytes when the two tables have the
+          same layout, and otherwise copy field by field in blocks of records, converting values as needed.
+          The records copied must not be among those they overwrite.
+          \param src_ext The source table.
+          \param src_records The indices of the records to copy from the source table.
+          \param dest_first_record The index of the record of this table which receives the first record copied,
+          at most the number of records in this table.
+      */
+      virtual void copyRows(const Table * src_ext, const std::vector<Index_t> & src_records, Index_t dest_first_record);
+
       /** \brief Append a field to the table. This will fail if a field of the same name (case insensitive) already exists.
           \param field_name The name of the field to append.
           \param format The format of the field to append, e.g. 1D for scalar double, 8J for vector long, etc.
@@ -370,6 +548,36 @@ namespace tip {
       */
       virtual void filterRows(const std::string & filter) = 0;
 
+      /** \brief Read scalar fields ahead in blocks of records, so that iterator loops which read cells one at
+          a time are served from memory, refilling a field's buffer once per block. This is off by default.
+          It is const because it affects only performance, so that it may be used with tables opened by readTable.
+          \param num_records The number of records to read at a time, e.g. 65536. 0 disables read-ahead.
+      */
+      virtual void setReadAhead(Index_t num_records) const;
+
+      /** \brief Get the number of cell reads which were (hits) and were not (misses) served from read-ahead
+          buffers, summed over all fields of the table. Use these to tune the argument to setReadAhead.
+          \param num_hits The number of reads served from memory.
+          \param num_misses The number of reads which required a buffer to be refilled.
+      */
+      virtual void getReadAheadStats(unsigned long & num_hits, unsigned long & num_misses) const;
+
+    protected:
+      /** \brief Check the arguments of copyRows, throwing if a record to be copied is not in the source table, or
+          the first destination record is past the end of this table.
+      */
+      void checkCopyRows(const Table * src_ext, const std::vector<Index_t> & src_records, Index_t dest_first_record) const;
+
+    private:
+      /** \brief Read all values of a scalar field in blocks of the optimal size.
+          \param field_name The name of the field.
+          \param dest The output vector, already sized to hold one value per record.
+          \param null_flags Optional array of one null flag per record.
+      */
+      template <typename T>
+      void readColumnData(const std::string & field_name, std::vector<T> & dest, char * null_flags) const;
+
+      void readColumnData(const std::string & field_name, std::vector<bool> & dest, char * null_flags) const;
   };
 
   /* TODO 7: 4/2/2004: 2 problems with random access: 1. operator * needs to return a
@@ -405,6 +613,15 @@ namespace tip {
     for (IndexDiff_t ii = 0; ii < src_end - src_begin; ++ii) dest_begin[ii] = tmp_dest[src_begin + ii];
   }
 
+  template <typename T>
+  inline void TableCell::get(Index_t num_records, T * dest_begin) const {
+    const Table * table = m_record.getExtensionData();
+    Index_t record_begin = m_record.getIndex();
+    if (0 > num_records || table->getNumRecords() < record_begin + num_records)
+      throw TipException("TableCell::get(Index_t, T *) called for records past the end of the table");
+    table->getColumn(getFieldIndex())->get(record_begin, record_begin + num_records, dest_begin);
+  }
+
   inline double TableCell::get() const {
     double retval;
     get(retval);
@@ -424,6 +641,15 @@ namespace tip {
     m_record.getExtensionData()->getColumn(getFieldIndex())->set(m_record.getIndex(), tmp_src);
   }
 
+  template <typename T>
+  inline void TableCell::set(Index_t num_records, const T * src_begin, const char * null_mask) {
+    Table * table = m_record.getExtensionData();
+    Index_t record_begin = m_record.getIndex();
+    if (0 > num_records || table->getNumRecords() < record_begin + num_records)
+      throw TipException("TableCell::set(Index_t, const T *, const char *) called for records past the end of the table");
+    table->getColumn(getFieldIndex())->set(record_begin, src_begin, src_begin + num_records, null_mask);
+  }
+
   inline Index_t TableCell::getNumElements() const {
     return m_record.getExtensionData()->getColumn(getFieldIndex())->getNumElements(m_record.getIndex());
   }
@@ -450,6 +676,152 @@ namespace tip {
     return itor->second;
   }
 
+  inline TableCell & ConstTableRecord::find_or_make(const TableFieldHandle & field) const {
+    if (field.getTable() != m_tab_data)
+      throw TipException("ConstTableRecord::operator [] called with a handle to field \"" + field.getName() +
+        "\" of a different table");
+    ConstTableRecord & rec = const_cast<ConstTableRecord &>(*this);
+    std::vector<TableCell *>::size_type index = field.getIndex();
+    if (rec.m_indexed_cells.size() <= index) rec.m_indexed_cells.resize(index + 1, 0);
+    // The first access by handle shares the cell accessed by name, which is never moved by later insertions.
+    TableCell * & cell(rec.m_indexed_cells[index]);
+    if (0 == cell) cell = &find_or_make(field.getName());
+    return *cell;
+  }
+
+  // Table
+  inline Table::FieldHandle Table::getFieldHandle(const std::string & field_name) const {
+    return FieldHandle(this, field_name, getFieldIndex(field_name));
+  }
+
+  template <typename T>
+  inline void Table::get(const std::string & field_name, Index_t record_begin, Index_t record_end, T * dest_begin) const {
+    if (0 > record_begin || record_begin > record_end || getNumRecords() < record_end)
+      throw TipException("Table::get(const std::string &, Index_t, Index_t, T *) called with an invalid range of records");
+    getColumn(getFieldIndex(field_name))->get(record_begin, record_end, dest_begin);
+  }
+
+  template <typename T>
+  inline void Table::set(const std::string & field_name, Index_t record_begin, const T * src_begin, const T * src_end,
+    const char * null_mask) {
+    if (0 > record_begin || src_begin > src_end || getNumRecords() < record_begin + (src_end - src_begin))
+      throw TipException("Table::set(const std::string &, Index_t, const T *, const T *, const char *) called with an "
+        "invalid range of records");
+    getColumn(getFieldIndex(field_name))->set(record_begin, src_begin, src_end, null_mask);
+  }
+
+  template <typename T>
+  inline void Table::getColumnData(const std::string & field_name, std::vector<T> & dest) const {
+    dest.resize(getNumRecords());
+    readColumnData(field_name, dest, 0);
+  }
+
+  template <typename T>
+  inline void Table::getColumnData(const std::string & field_name, std::vector<T> & dest, const T & null_value) const {
+    Index_t num_records = getNumRecords();
+    dest.resize(num_records);
+    std::vector<char> null_flags(num_records);
+    if (0 != num_records) readColumnData(field_name, dest, &null_flags[0]);
+    for (Index_t ii = 0; ii != num_records; ++ii) if (0 != null_flags[ii]) dest[ii] = null_value;
+  }
+
+  template <typename T>
+  inline void Table::getColumnData(const std::string & field_name, std::vector<T> & dest,
+    std::vector<bool> & null_flags) const {
+    Index_t num_records = getNumRecords();
+    dest.resize(num_records);
+    std::vector<char> tmp_null_flags(num_records);
+    if (0 != num_records) readColumnData(field_name, dest, &tmp_null_flags[0]);
+    null_flags.assign(tmp_null_flags.begin(), tmp_null_flags.end());
+  }
+
+  template <typename T, typename Func>
+  inline void Table::getColumnData(const std::string & field_name, T * buffer, Index_t buffer_size, Func && func) const {
+    if (0 >= buffer_size) throw TipException("Table::getColumnData called with an empty buffer");
+    const IColumn * column = getColumn(getFieldIndex(field_name));
+    Index_t num_records = getNumRecords();
+    for (Index_t record_begin = 0; record_begin < num_records; record_begin += buffer_size) {
+      Index_t record_end = num_records - record_begin < buffer_size ? num_records : record_begin + buffer_size;
+      column->get(record_begin, record_end, buffer);
+      func(record_begin, record_end, buffer);
+    }
+  }
+
+  template <typename T>
+  inline void Table::readColumnData(const std::string & field_name, std::vector<T> & dest, char * null_flags) const {
+    const IColumn * column = getColumn(getFieldIndex(field_name));
+    Index_t num_records = dest.size();
+    Index_t chunk_size = getOptimalNumRecords();
+    if (0 >= chunk_size) chunk_size = 1;
+    for (Index_t record_begin = 0; record_begin < num_records; record_begin += chunk_size) {
+      Index_t record_end = num_records - record_begin < chunk_size ? num_records : record_begin + chunk_size;
+      column->get(record_begin, record_end, &dest[record_begin], 0 == null_flags ? 0 : null_flags + record_begin);
+    }
+  }
+
+  inline void Table::readColumnData(const std::string & field_name, std::vector<bool> & dest, char * null_flags) const {
+    // The elements of vector<bool> are not addressable, so read each block into an intermediate array.
+    const IColumn * column = getColumn(getFieldIndex(field_name));
+    Index_t num_records = dest.size();
+    Index_t chunk_size = getOptimalNumRecords();
+    if (0 >= chunk_size) chunk_size = 1;
+    bool * buffer = new bool[chunk_size];
+    try {
+      for (Index_t record_begin = 0; record_begin < num_records; record_begin += chunk_size) {
+        Index_t record_end = num_records - record_begin < chunk_size ? num_records : record_begin + chunk_size;
+        column->get(record_begin, record_end, buffer, 0 == null_flags ? 0 : null_flags + record_begin);
+        std::copy(buffer, buffer + (record_end - record_begin), dest.begin() + record_begin);
+      }
+    } catch (...) {
+      delete [] buffer;
+      throw;
+    }
+    delete [] buffer;
+  }
+
+  inline void Table::copyRows(const Table * src_ext, const std::vector<Index_t> & src_records,
+    Index_t dest_first_record) {
+    checkCopyRows(src_ext, src_records, dest_first_record);
+    Index_t dest_end = dest_first_record + Index_t(src_records.size());
+    if (getNumRecords() < dest_end) setNumRecords(dest_end);
+
+    // Copy field by field, letting each column copy its cells in blocks if it can.
+    const FieldCont & fields(getValidFields());
+    for (FieldCont::const_iterator itor = fields.begin(); itor != fields.end(); ++itor)
+      getColumn(getFieldIndex(*itor))->copy(src_ext->getColumn(src_ext->getFieldIndex(*itor)), src_records,
+        dest_first_record);
+  }
+
+  inline void Table::checkCopyRows(const Table * src_ext, const std::vector<Index_t> & src_records,
+    Index_t dest_first_record) const {
+    if (0 == src_ext) throw TipException("Table::copyRows called without a source table");
+    if (0 > dest_first_record || getNumRecords() < dest_first_record)
+      throw TipException("Table::copyRows called with a destination record past the end of the table");
+    Index_t num_src_records = src_ext->getNumRecords();
+    for (std::vector<Index_t>::const_iterator itor = src_records.begin(); itor != src_records.end(); ++itor)
+      if (0 > *itor || num_src_records <= *itor)
+        throw TipException("Table::copyRows called with a source record which is not in the source table");
+  }
+
+  inline void Table::setReadAhead(Index_t num_records) const {
+    const FieldCont & fields(getValidFields());
+    for (FieldCont::const_iterator itor = fields.begin(); itor != fields.end(); ++itor)
+      getColumn(getFieldIndex(*itor))->setReadAhead(num_records);
+  }
+
+  inline void Table::getReadAheadStats(unsigned long & num_hits, unsigned long & num_misses) const {
+    num_hits = 0;
+    num_misses = 0;
+    const FieldCont & fields(getValidFields());
+    for (FieldCont::const_iterator itor = fields.begin(); itor != fields.end(); ++itor) {
+      unsigned long field_hits = 0;
+      unsigned long field_misses = 0;
+      getColumn(getFieldIndex(*itor))->getReadAheadStats(field_hits, field_misses);
+      num_hits += field_hits;
+      num_misses += field_misses;
+    }
+  }
+
   // TableRecord
   inline TableRecord & TableRecord::operator =(const TableRecord & rec) {
     if (this != &rec) {
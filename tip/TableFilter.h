@@ -0,0 +1,167 @@
+/** \file TableFilter.h
+
+    \brief Row filtering expressions which are compiled once and evaluated on blocks of records read in bulk.
+*/
+#ifndef tip_TableFilter_h
+#define tip_TableFilter_h
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "tip/Table.h"
+#include "tip/tip_types.h"
+
+namespace tip {
+
+  class ScanBlock;
+
+  /** \class TableFilter
+
+      \brief Selects the records of a table which satisfy an expression. The expression is parsed and compiled
+      once into a list of instructions; records are then processed in blocks, reading each field used by the
+      expression with one bulk read per block, and each instruction is applied to the whole block in a tight loop
+      over arrays, rather than interpreting the expression record by record as cfitsio's row filters do.
+
+      Because only the generic Table interface is used, any table may be filtered, whether it is in a FITS file, a
+      Root file, or is itself a filtered view. Blocks are processed in parallel as by TableScan.
+
+      The supported expressions are a subset of cfitsio's row filter syntax, with the usual precedence:
+        - numbers, names of scalar numeric fields (not case sensitive), and #row, the record number from 1
+        - arithmetic: + - * / % and ** (or ^) for powers, and unary -
+        - comparisons: == (or =), !=, <, <=, >, >=, and their Fortran forms .eq., .ne., .lt., .le., .gt., .ge.
+        - logic: && (.and.), || (.or.), ! (.not.), and parentheses
+        - functions: abs, sqrt, exp, log, log10, sin, cos, tan, min(x, y), max(x, y), and range(x, low, high),
+          which is true when low <= x <= high
+        - gtifilter("file[ext]", x, "START", "STOP"), which is true when x lies in one of the intervals in the
+          given table (GTI if no extension is given); x defaults to TIME, and the field names to START and STOP
+
+      A record is selected when the expression is non-0 and none of the fields used is null in that record.
+
+      \code
+        TableFilter filter("ENERGY > 100. && range(ZENITH_ANGLE, 0., 105.) && gtifilter(\"ft1.fits[GTI]\")");
+        std::vector<char> selected;
+        filter.select(*table, selected);
+      \endcode
+  */
+  class TableFilter {
+    public:
+      /** \brief Where the time of the most recent selection went, in seconds. Times of reading and evaluating
+          are summed over all threads, so with several threads they may add up to more than the total time.
+      */
+      struct Stats {
+        Stats(): m_parse_time(0.), m_read_time(0.), m_evaluate_time(0.), m_total_time(0.), m_num_records(0),
+          m_num_selected(0), m_num_threads(0) {}
+        double m_parse_time;
+        double m_read_time;
+        double m_evaluate_time;
+        double m_total_time;
+        Index_t m_num_records;
+        Index_t m_num_selected;
+        unsigned int m_num_threads;
+      };
+
+      /** \brief Parse and compile the given expression. Throws TipException if it is not valid or uses features
+          which are not supported.
+          \param expression The expression.
+      */
+      TableFilter(const std::string & expression);
+
+      /** \brief Return the expression.
+      */
+      const std::string & getExpression() const { return m_expression; }
+
+      /** \brief Return the names of the fields used by the expression, as they were first written in it.
+      */
+      const Table::FieldCont & getFields() const { return m_fields; }
+
+      /** \brief Set the number of threads to use. 0, the default, uses one per hardware thread.
+          \param num_threads The number of threads.
+      */
+      void setNumThreads(unsigned int num_threads) { m_num_threads = num_threads; }
+
+      /** \brief Evaluate the expression for every record of a table.
+          \param table The table.
+          \param selected The output flags, one per record, non-0 for records which are selected.
+      */
+      void select(const Table & table, std::vector<char> & selected) const;
+
+      /** \brief Evaluate the expression for every record of a table, and return the indices of those selected.
+          \param table The table.
+          \param records The output indices of the selected records, in increasing order.
+      */
+      void select(const Table & table, std::vector<Index_t> & records) const;
+
+      /** \brief Return the timing of parsing the expression and of the most recent selection.
+      */
+      const Stats & getStats() const { return m_stats; }
+
+    private:
+      class Parser;
+      class Worker;
+
+      /** \brief Operations which may be compiled.
+      */
+      enum OpCode {
+        eAdd, eSubtract, eMultiply, eDivide, eModulo, ePower, eEqual, eNotEqual, eLess, eLessEqual, eGreater,
+        eGreaterEqual, eAnd, eOr, eNegate, eNot, eAbs, eSqrt, eExp, eLog, eLog10, eSin, eCos, eTan, eMin, eMax,
+        eRange, eInterval, eRow
+      };
+
+      /** \brief An argument of an instruction: a constant, a field (by its position in m_fields) or the result of
+          an earlier instruction (by the number of the register holding it).
+      */
+      struct Operand {
+        enum Kind { eConstant, eField, eRegister };
+        Operand(Kind kind = eConstant, double value = 0., std::size_t index = 0): m_kind(kind), m_value(value),
+          m_index(index) {}
+        Kind m_kind;
+        double m_value;
+        std::size_t m_index;
+      };
+
+      /** \brief One step of the compiled expression, which stores its result in its own register.
+      */
+      struct Instruction {
+        OpCode m_op;
+        std::vector<Operand> m_args;
+        std::size_t m_result;
+        std::size_t m_intervals;
+      };
+
+      /** \brief Evaluate the compiled expression for one block of records.
+          \param block The values of the fields used by the expression.
+          \param registers Buffers for the results of the instructions, one per instruction.
+          \param selected The output flags for the records of the block.
+      */
+      void evaluate(const ScanBlock & block, std::vector<std::vector<double> > & registers, char * selected) const;
+
+      /** \brief Apply one instruction to a block of n values.
+          \param instruction The instruction.
+          \param args Pointers to the values of each argument, or 0 for constant arguments.
+          \param record_begin Index of the first record of the block, for #row.
+          \param num_values The number of values.
+          \param result The output values.
+      */
+      void apply(const Instruction & instruction, const std::vector<const double *> & args, Index_t record_begin,
+        Index_t num_values, double * result) const;
+
+      /** \brief Return whether the given value lies in one of the intervals of a gtifilter call.
+          \param intervals The number of the set of intervals.
+          \param value The value.
+      */
+      bool inIntervals(std::size_t intervals, double value) const;
+
+      std::string m_expression;
+      Table::FieldCont m_fields;
+      std::vector<Instruction> m_code;
+      Operand m_result;
+      std::vector<std::vector<double> > m_starts;
+      std::vector<std::vector<double> > m_stops;
+      unsigned int m_num_threads;
+      mutable Stats m_stats;
+  };
+
+}
+
+#endif
@@ -0,0 +1,209 @@
+/** \file TableScan.h
+
+    \brief Parallel scan of scalar fields of a table, in blocks of records read in bulk.
+*/
+#ifndef tip_TableScan_h
+#define tip_TableScan_h
+
+#include <cstddef>
+#include <vector>
+
+#include "tip/IColumn.h"
+#include "tip/Table.h"
+#include "tip/tip_types.h"
+
+namespace tip {
+
+  /** \class ScanBlock
+
+      \brief The values of the scanned fields in one contiguous block of records, read as double.
+  */
+  class ScanBlock {
+    public:
+      /** \brief Create an empty block for the given number of fields.
+          \param num_fields The number of fields.
+      */
+      ScanBlock(std::size_t num_fields = 0): m_values(num_fields), m_null_flags(num_fields), m_record_begin(0),
+        m_record_end(0), m_read_time(0.) {}
+
+      /** \brief Return the index of the first record in the block.
+      */
+      Index_t getRecordBegin() const { return m_record_begin; }
+
+      /** \brief Return the index of the record after the last record in the block.
+      */
+      Index_t getRecordEnd() const { return m_record_end; }
+
+      /** \brief Return the number of records in the block.
+      */
+      Index_t getNumRecords() const { return m_record_end - m_record_begin; }
+
+      /** \brief Return the number of fields in the block.
+      */
+      std::size_t getNumFields() const { return m_values.size(); }
+
+      /** \brief Return the time spent in the most recent call to read, in seconds.
+      */
+      double getReadTime() const { return m_read_time; }
+
+      /** \brief Return the values of one field, one per record in the block. Null values are 0.
+          \param field_number The position of the field in the container of fields given to the TableScan.
+      */
+      const double * getValues(std::size_t field_number) const { return &m_values.at(field_number)[0]; }
+
+      /** \brief Return flags which are non-0 for records of one field whose values are null.
+          \param field_number The position of the field in the container of fields given to the TableScan.
+      */
+      const char * getNullFlags(std::size_t field_number) const { return &m_null_flags.at(field_number)[0]; }
+
+      /** \brief Read the given records of the given columns into the block, with one bulk read per column.
+          \param columns The columns, in the same order as the fields of the block.
+          \param record_begin Index of the first record to read.
+          \param record_end Index of the record after the last record to read.
+      */
+      void read(const std::vector<const IColumn *> & columns, Index_t record_begin, Index_t record_end);
+
+    private:
+      std::vector<std::vector<double> > m_values;
+      std::vector<std::vector<char> > m_null_flags;
+      Index_t m_record_begin;
+      Index_t m_record_end;
+      double m_read_time;
+  };
+
+  /** \class TableScan
+
+      \brief Calls a function object for every block of records of a table, using several threads. Each thread
+      opens its own read-only instance of the table (see Table::openReader), takes the next block of records
+      not yet taken by another thread, reads the scanned fields for the whole block with one bulk read per
+      field, and passes the block to the function object. Blocks are therefore processed in no particular order.
+
+      Tables which cannot be opened again, for example filtered tables or tables in files which are not FITS,
+      are scanned in the calling thread, with the same results.
+
+      \code
+        // Histogram event times with all cores of the machine.
+        Table::FieldCont fields(1, "TIME");
+        TableScan scan(*table, fields);
+        TimeHistogram hist(t_start, t_stop, num_bins);
+        scan.run(hist, TimeHistogram::Merge());
+      \endcode
+  */
+  class TableScan {
+    public:
+      /** \class IWorker
+          \brief Interface for the objects which process blocks in each thread.
+      */
+      class IWorker {
+        public:
+          virtual ~IWorker() {}
+
+          /** \brief Process one block of records.
+              \param block The block.
+          */
+          virtual void process(const ScanBlock & block) = 0;
+      };
+
+      /** \brief Create a scan of the given scalar fields of a table. The table must outlive the scan.
+          \param table The table.
+          \param fields The names of the fields to read. Each ScanBlock holds them in this order.
+      */
+      TableScan(const Table & table, const Table::FieldCont & fields);
+
+      /** \brief Destructor. Closes any instances of the table opened by the scan.
+      */
+      ~TableScan();
+
+      /** \brief Set the number of threads to use. 0, the default, uses one per hardware thread.
+          \param num_threads The number of threads.
+      */
+      void setNumThreads(unsigned int num_threads) { m_num_threads = num_threads; }
+
+      /** \brief Set the number of records in each block. 0, the default, uses the table's optimal number of records.
+          \param num_records The number of records.
+      */
+      void setBlockSize(Index_t num_records) { m_block_size = num_records; }
+
+      /** \brief Return the number of threads used by the most recent run.
+      */
+      unsigned int getNumThreadsUsed() const { return m_num_threads_used; }
+
+      /** \brief Scan the table, calling func(block) for every block. All threads call the same object, so it must
+          be safe to call concurrently, e.g. by only writing results for the records of the block it is given.
+          \param func The function object.
+      */
+      template <typename Func>
+      void run(Func & func);
+
+      /** \brief Scan the table, giving each thread its own copy of func. Once all blocks are processed, the calling
+          thread combines the results by calling reduce(func, copy) for each thread's copy.
+          \param func The function object, which is copied for each thread and receives the combined result.
+          \param reduce Function object which combines the result of one copy into func.
+      */
+      template <typename Func, typename Reduce>
+      void run(Func & func, Reduce reduce);
+
+    private:
+      /// \brief Adapts a reference to a shared function object to the worker interface.
+      template <typename Func>
+      class SharedWorker : public IWorker {
+        public:
+          SharedWorker(Func & func): m_func(func) {}
+          virtual void process(const ScanBlock & block) { m_func(block); }
+        private:
+          Func & m_func;
+      };
+
+      /// \brief Adapts a copy of a function object to the worker interface.
+      template <typename Func>
+      class CopyWorker : public IWorker {
+        public:
+          CopyWorker(const Func & func): m_func(func) {}
+          virtual void process(const ScanBlock & block) { m_func(block); }
+          Func m_func;
+      };
+
+      // Scans are not copied.
+      TableScan(const TableScan &);
+      TableScan & operator =(const TableScan &);
+
+      /** \brief Open the instances of the table to be read by each thread, and return how many threads will be used.
+      */
+      unsigned int openReaders();
+
+      /** \brief Run the given workers, one per thread, then close the instances of the table.
+          \param workers The workers, one for each thread returned by openReaders.
+      */
+      void execute(const std::vector<IWorker *> & workers);
+
+      void closeReaders();
+
+      const Table & m_table;
+      Table::FieldCont m_fields;
+      std::vector<Table *> m_readers;
+      std::vector<std::vector<const IColumn *> > m_columns;
+      Index_t m_block_size;
+      unsigned int m_num_threads;
+      unsigned int m_num_threads_used;
+  };
+
+  template <typename Func>
+  inline void TableScan::run(Func & func) {
+    std::vector<IWorker *> workers(openReaders());
+    SharedWorker<Func> worker(func);
+    for (std::vector<IWorker *>::iterator itor = workers.begin(); itor != workers.end(); ++itor) *itor = &worker;
+    execute(workers);
+  }
+
+  template <typename Func, typename Reduce>
+  inline void TableScan::run(Func & func, Reduce reduce) {
+    std::vector<CopyWorker<Func> > copies(openReaders(), CopyWorker<Func>(func));
+    std::vector<IWorker *> workers(copies.size());
+    for (std::size_t index = 0; index != copies.size(); ++index) workers[index] = &copies[index];
+    execute(workers);
+    for (std::size_t index = 0; index != copies.size(); ++index) reduce(func, copies[index].m_func);
+  }
+
+}
+
+#endif
@@ -10,6 +10,8 @@ def generate(env, **kw):
         return
 
     env.Tool('addLibrary', library = env['cfitsioLibs'] + env['rootLibs'])
+    if env['PLATFORM'] != 'win32':
+        env.AppendUnique(LIBS = ['pthread'])
 
 def exists(env):
 	return 1